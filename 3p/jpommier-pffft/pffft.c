@@ -1204,20 +1204,13 @@ struct PFFFT_Setup {
   float *twiddle; // points into 'data', N/4 elements
 };
 
-PFFFT_Setup *pffft_new_setup(int N, pffft_transform_t transform) {
-  PFFFT_Setup *s = (PFFFT_Setup*)malloc(sizeof(PFFFT_Setup));
+/* fills in everything but s->data, returns 0 if N isn't decomposable */
+static int init_setup(PFFFT_Setup *s, int N, pffft_transform_t transform) {
   int k, m;
-  /* unfortunately, the fft size must be a multiple of 16 for complex FFTs 
-     and 32 for real FFTs -- a lot of stuff would need to be rewritten to
-     handle other cases (or maybe just switch to a scalar fft, I don't know..) */
-  if (transform == PFFFT_REAL) { assert((N%(2*SIMD_SZ*SIMD_SZ))==0 && N>0); }
-  if (transform == PFFFT_COMPLEX) { assert((N%(SIMD_SZ*SIMD_SZ))==0 && N>0); }
-  //assert((N % 32) == 0);
   s->N = N;
   s->transform = transform;  
   /* nb of complex simd vectors */
   s->Ncvec = (transform == PFFFT_REAL ? N/2 : N)/SIMD_SZ;
-  s->data = (v4sf*)pffft_aligned_malloc(2*s->Ncvec * sizeof(v4sf));
   s->e = (float*)s->data;
   s->twiddle = (float*)(s->data + (2*s->Ncvec*(SIMD_SZ-1))/SIMD_SZ);  
 
@@ -1247,13 +1240,41 @@ PFFFT_Setup *pffft_new_setup(int N, pffft_transform_t transform) {
 
   /* check that N is decomposable with allowed prime factors */
   for (k=0, m=1; k < s->ifac[1]; ++k) { m *= s->ifac[2+k]; }
-  if (m != N/SIMD_SZ) {
+  return m == N/SIMD_SZ;
+}
+
+PFFFT_Setup *pffft_new_setup(int N, pffft_transform_t transform) {
+  PFFFT_Setup *s = (PFFFT_Setup*)malloc(sizeof(PFFFT_Setup));
+  /* unfortunately, the fft size must be a multiple of 16 for complex FFTs 
+     and 32 for real FFTs -- a lot of stuff would need to be rewritten to
+     handle other cases (or maybe just switch to a scalar fft, I don't know..) */
+  if (transform == PFFFT_REAL) { assert((N%(2*SIMD_SZ*SIMD_SZ))==0 && N>0); }
+  if (transform == PFFFT_COMPLEX) { assert((N%(SIMD_SZ*SIMD_SZ))==0 && N>0); }
+  //assert((N % 32) == 0);
+  s->data = (v4sf*)pffft_aligned_malloc(2*((transform == PFFFT_REAL ? N/2 : N)/SIMD_SZ) * sizeof(v4sf));
+
+  if (!init_setup(s, N, transform)) {
     pffft_destroy_setup(s); s = 0;
   }
 
   return s;
 }
 
+/* pnifft: setups in caller owned memory, so changing size doesn't allocate */
+size_t pffft_setup_size(int N, pffft_transform_t transform) {
+  int Ncvec = (transform == PFFFT_REAL ? N/2 : N)/SIMD_SZ;
+  return sizeof(PFFFT_Setup) + MALLOC_V4SF_ALIGNMENT + 2*Ncvec*sizeof(v4sf);
+}
+
+PFFFT_Setup *pffft_init_setup(void *mem, size_t nb_bytes, int N, pffft_transform_t transform) {
+  PFFFT_Setup *s = (PFFFT_Setup*)mem;
+  int multiple = transform == PFFFT_REAL ? 2*SIMD_SZ*SIMD_SZ : SIMD_SZ*SIMD_SZ;
+  if (N <= 0 || N % multiple != 0 || pffft_setup_size(N, transform) > nb_bytes) {
+    return 0;
+  }
+  s->data = (v4sf*)(((size_t)(s + 1) + MALLOC_V4SF_ALIGNMENT - 1) & ~((size_t)MALLOC_V4SF_ALIGNMENT - 1));
+  return init_setup(s, N, transform) ? s : 0;
+}
 
 void pffft_destroy_setup(PFFFT_Setup *s) {
   pffft_aligned_free(s->data);
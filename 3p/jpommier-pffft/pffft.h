@@ -102,6 +102,16 @@ extern "C" {
   */
   PFFFT_Setup *pffft_new_setup(int N, pffft_transform_t transform);
   void pffft_destroy_setup(PFFFT_Setup *);
+
+  /*
+    pnifft addition: the same, in 'mem' (pointer aligned, at least
+    pffft_setup_size(N, transform) bytes), so a new plan doesn't
+    allocate.  Returns 0 (instead of asserting) if N isn't supported or
+    doesn't fit.  Nothing to destroy, just stop using 'mem'.  The size
+    grows with N, so memory sized for one N fits any smaller one.
+  */
+  size_t pffft_setup_size(int N, pffft_transform_t transform);
+  PFFFT_Setup *pffft_init_setup(void *mem, size_t nb_bytes, int N, pffft_transform_t transform);
   /* 
      Perform a Fourier transform , The z-domain data is stored in the
      most efficient order for transforming it back, or using it for
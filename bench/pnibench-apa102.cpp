@@ -0,0 +1,40 @@
+
+#include "pnibench.h"
+
+#include "pniapa102.h"
+
+using namespace std;
+using namespace pni;
+using namespace pnibench;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    // Bit-bangs into the host gpio stand-in, so this is the cost of
+    // packing and clocking out the frame, without the pin writes' bus
+    // time.
+void benchFrame(Runner& run, char const* name, size_t num) {
+    Apa102Software apa;
+    apa.init({ GPIO_NUM_23, GPIO_NUM_18 });
+
+    Apa102::Colors colors;
+    colors.mColor.resize(num);
+    Lcg lcg;
+    for(auto& color : colors.mColor) {
+        color = { uint8_t(lcg.next() >> 24), uint8_t(lcg.next() >> 24), uint8_t(lcg.next() >> 24), 0x1f };
+    }
+
+    run.measure(name, num, [&]() {
+        apa.writeColors(colors);
+    });
+    apa.deinit();
+}
+
+void benchFrames(Runner& run) {
+    benchFrame(run, "apa102.writeColors.60", 60);
+    benchFrame(run, "apa102.writeColors.144", 144);
+}
+PNI_BENCH(benchFrames);
+
+} // end anonymous namespace
@@ -0,0 +1,57 @@
+
+#include "pnibench.h"
+
+#include "pnicolor.h"
+
+using namespace std;
+using namespace pni;
+using namespace pnibench;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    // About an LED strip's worth.
+const size_t Num = 256;
+
+void benchConvert(Runner& run) {
+    vector< ColorHsv > hsv(Num);
+    vector< ColorRgb > rgb(Num);
+    vector< Color::Rgb > rgbOut(Num);
+    vector< Color::Hsv > hsvOut(Num);
+    Lcg lcg;
+    for(size_t ind = 0; ind < Num; ++ind) {
+        hsv[ ind ] = Color::Hsv{ lcg.unit(), lcg.unit(), lcg.unit() };
+        rgb[ ind ] = Color::Rgb{ lcg.unit(), lcg.unit(), lcg.unit() };
+    }
+
+    run.measure("color.hsvToRgb", Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            rgbOut[ ind ] = hsv[ ind ].toRgb();
+        }
+        keep(rgbOut);
+    });
+    run.measure("color.rgbToHsv", Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            hsvOut[ ind ] = rgb[ ind ].toHsv();
+        }
+        keep(hsvOut);
+    });
+
+    Color::Component tval(0.3f);
+    run.measure("color.lerpRgb", Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            rgbOut[ ind ] = Color::lerp(rgb[ ind ], rgb[ Num - 1 - ind ], tval);
+        }
+        keep(rgbOut);
+    });
+    run.measure("color.lerpHsv", Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            hsvOut[ ind ] = Color::lerp(hsv[ ind ], hsv[ Num - 1 - ind ], tval);
+        }
+        keep(hsvOut);
+    });
+}
+PNI_BENCH(benchConvert);
+
+} // end anonymous namespace
@@ -0,0 +1,256 @@
+
+#include "pnibench.h"
+
+#include "esp_log.h"
+
+#include "pnifft.h"
+#include "pnifilters.h"
+#include "pnipeaks.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace pni;
+using namespace pnibench;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    // Two tones plus noise and a DC offset, like the mic delivers.
+FftSData makeSignal(size_t num) {
+    FftSData data(num);
+    Lcg lcg;
+    for(size_t ind = 0; ind < num; ++ind) {
+        float val = 6000.0f * sinf(0.2f * ind) + 3000.0f * sinf(1.3f * ind) + 1000.0f;
+        data[ ind ] = FftSDatum(val + lcg.range(-500, 500));
+    }
+    return data;
+}
+
+    // doFft replaces the input with the spectrum (and doIfft the other
+    // way round), so each op reloads the same input first (an O(n) copy,
+    // small next to the transform).
+void benchEngine(Runner& run, FftBase& fft, string const& prefix) {
+    FftSData const src = makeSignal(fft.getNum());
+
+    run.measure((prefix + ".doFft").c_str(), 1, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doFft();
+        keep(fft.mReal);
+    });
+    copy(src.begin(), src.end(), fft.mReal.begin());
+    fft.doFft();
+    FftSData const spectrum = fft.mReal;
+    run.measure((prefix + ".doIfft").c_str(), 1, [&]() {
+        copy(spectrum.begin(), spectrum.end(), fft.mReal.begin());
+        fft.doIfft();
+        keep(fft.mReal);
+    });
+    run.measure((prefix + ".frame").c_str(), 1, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doHanningWindow(fft.calcBias());
+        fft.doFft();
+        fft.convToReal();
+        keep(fft.mReal);
+    });
+}
+
+template< class FftType >
+void benchEngine(Runner& run, string const& prefix) {
+    FftType fft;
+    benchEngine(run, fft, prefix);
+}
+
+void benchPffft(Runner& run) {
+    benchEngine< FftPffft< 5 > >(run, "fft.pffft.32");
+    benchEngine< FftPffft< 6 > >(run, "fft.pffft.64");
+    benchEngine< FftPffft< 8 > >(run, "fft.pffft.256");
+    benchEngine< FftPffft< 9 > >(run, "fft.pffft.512");
+    benchEngine< FftPffft< 10 > >(run, "fft.pffft.1024");
+}
+PNI_BENCH(benchPffft);
+
+    // Against fft.pffft.*: what the size being a variable costs.
+void benchPffftRuntime(Runner& run) {
+    FftPffftRuntime fft(256, 1024);
+    benchEngine(run, fft, "fft.pffftRuntime.256");
+    fft.plan(512);
+    benchEngine(run, fft, "fft.pffftRuntime.512");
+    fft.plan(1024);
+    benchEngine(run, fft, "fft.pffftRuntime.1024");
+
+        // Twiddles and factors, no allocation.
+    size_t num = 512;
+    run.measure("fft.pffftRuntime.plan.512_1024", 1, [&]() {
+        num = num == 512 ? 1024 : 512;
+        fft.plan(num);
+        keep(fft.mReal);
+    });
+}
+PNI_BENCH(benchPffftRuntime);
+
+    // Needs the 3p/fix_fft submodule, see the Makefile.
+#if PNI_BENCH_FIX_FFT
+void benchFix(Runner& run) {
+    benchEngine< FftFix< 8 > >(run, "fft.fix.256");
+    benchEngine< FftFix< 9 > >(run, "fft.fix.512");
+    benchEngine< FftFix< 10 > >(run, "fft.fix.1024");
+}
+PNI_BENCH(benchFix);
+#endif
+
+    // O(n^2), so mostly the small sizes it's meant for.
+void benchTiny(Runner& run) {
+    benchEngine< FftTiny< 3 > >(run, "fft.tiny.8");
+    benchEngine< FftTiny< 4 > >(run, "fft.tiny.16");
+    benchEngine< FftTiny< 5 > >(run, "fft.tiny.32");
+    benchEngine< FftTiny< 6 > >(run, "fft.tiny.64");
+    benchEngine< FftTiny< 8 > >(run, "fft.tiny.256");
+
+        // A few bins out of many, e.g., just the bass.
+    FftTiny< 8 > fft;
+    fft.selectBinRange(1, 9);
+    FftSData const src = makeSignal(fft.Num);
+    run.measure("fft.tiny.256.8bins.doFft", 1, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doFft();
+        keep(fft.mReal);
+    });
+}
+PNI_BENCH(benchTiny);
+
+    // Channels transformed per op: an FftPffft per channel (how it was
+    // done before), then FftPffftMulti separate and paired.
+template< size_t Pow >
+void benchChannels(Runner& run, size_t numChannels) {
+    using Multi = FftPffftMulti< Pow >;
+    string prefix = "fft.multi." + to_string(Multi::Num) + ".x" + to_string(numChannels);
+    FftSData const src = makeSignal(Multi::Num);
+
+    vector< unique_ptr< FftPffft< Pow > > > singles;
+    for(size_t chan = 0; chan < numChannels; ++chan) {
+        singles.emplace_back(new FftPffft< Pow >);
+    }
+    run.measure((prefix + ".single.doFft").c_str(), 1, [&]() {
+        for(auto& single : singles) {
+            copy(src.begin(), src.end(), single->mReal.begin());
+            single->doFft();
+            keep(single->mReal);
+        }
+    });
+
+    Multi separate(numChannels, Multi::Separate);
+    Multi paired(numChannels, Multi::Paired);
+    for(auto multi : { &separate, &paired }) {
+        char const* mode = multi == &separate ? ".separate" : ".paired";
+        run.measure((prefix + mode + ".doFft").c_str(), 1, [&]() {
+            for(size_t chan = 0; chan < numChannels; ++chan) {
+                copy(src.begin(), src.end(), multi->getChannel(chan));
+            }
+            multi->doFft();
+            keep(multi->mReal);
+        });
+        FftSData const spectra = multi->mReal;
+        run.measure((prefix + mode + ".doIfft").c_str(), 1, [&]() {
+            copy(spectra.begin(), spectra.end(), multi->mReal.begin());
+            multi->doIfft();
+            keep(multi->mReal);
+        });
+    }
+}
+
+void benchMulti(Runner& run) {
+    for(size_t numChannels : { 1, 2, 4 }) {
+        benchChannels< 8 >(run, numChannels);
+        benchChannels< 9 >(run, numChannels);
+    }
+}
+PNI_BENCH(benchMulti);
+
+void benchWindow(Runner& run) {
+    FftPffft< 9 > fft;
+    FftSData const src = makeSignal(fft.Num);
+
+    run.measure("fft.hanning.512", fft.Num, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doHanningWindow(1000);
+        keep(fft.mReal);
+    });
+    run.measure("fft.hanningFloat.512", fft.Num, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doHanningWindowFloat(1000.0f);
+        keep(fft.mReal);
+    });
+    run.measure("fft.convToReal.512", fft.Num, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.convToReal();
+        keep(fft.mReal);
+    });
+}
+PNI_BENCH(benchWindow);
+
+    // Per frame analysis after convToReal, and the whole frame with it.
+void benchPeaks(Runner& run) {
+    FftPffft< 9 > fft;
+    FftSData const src = makeSignal(fft.Num);
+    copy(src.begin(), src.end(), fft.mReal.begin());
+    fft.doHanningWindow(fft.calcBias());
+    fft.doFft();
+    fft.convToReal();
+    FftSData const mags = fft.mReal;
+
+    PeakTrackerT< 8 > tracker;
+    run.measure("peaks.find.512", 1, [&]() {
+        keep(tracker.findPeaks(&mags[ 0 ], fft.NumOut));
+    });
+    run.measure("peaks.update.512", 1, [&]() {
+        tracker.update(&mags[ 0 ], fft.NumOut);
+        keep(tracker.getNumTracks());
+    });
+    run.measure("peaks.hps.512", 1, [&]() {
+        keep(calcHpsPitch(&mags[ 0 ], fft.NumOut));
+    });
+    run.measure("peaks.frame.512", 1, [&]() {
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doHanningWindow(fft.calcBias());
+        fft.doFft();
+        fft.convToReal();
+        tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+        keep(calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut));
+    });
+}
+PNI_BENCH(benchPeaks);
+
+////////////////////////////////////////////////////////////////////
+
+const size_t NumSamples = 512;
+
+void benchFilter(Runner& run, char const* name, Filter& filter) {
+    FftSData const src = makeSignal(NumSamples);
+    FftSData dst(NumSamples);
+
+    run.measure(name, NumSamples, [&]() {
+        filter.apply(dst, src);
+        keep(dst);
+    });
+}
+
+void benchFilters(Runner& run) {
+    LowPassFilter lowPass(0.8f);
+    HighPassFilter highPass(0.8f);
+    BiasCalcFilter biasCalc;
+    BiasApplyFilter biasApply;
+    biasApply.setBias(1000);
+
+    benchFilter(run, "filter.lowPass.512", lowPass);
+    benchFilter(run, "filter.highPass.512", highPass);
+    benchFilter(run, "filter.biasCalc.512", biasCalc);
+    benchFilter(run, "filter.biasApply.512", biasApply);
+}
+PNI_BENCH(benchFilters);
+
+} // end anonymous namespace
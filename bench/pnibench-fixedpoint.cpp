@@ -0,0 +1,97 @@
+
+#include "pnibench.h"
+
+#include "pnifixedpoint.h"
+#include "pnifixedpointarray.h"
+#include "pnifpmath.h"
+
+using namespace std;
+using namespace pni;
+using namespace pnibench;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const size_t Num = 1024;
+
+template< typename Fp >
+void benchFormat(Runner& run, string const& prefix) {
+    vector< Fp > lhs(Num);
+    vector< Fp > rhs(Num);
+    vector< Fp > out(Num);
+    Lcg lcg;
+    for(size_t ind = 0; ind < Num; ++ind) {
+        lhs[ ind ] = Fp(lcg.unit() * 0.5f);
+        rhs[ ind ] = Fp(0.25f + lcg.unit() * 0.5f);
+    }
+
+    run.measure((prefix + ".add").c_str(), Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            out[ ind ] = lhs[ ind ] + rhs[ ind ];
+        }
+        keep(out);
+    });
+    run.measure((prefix + ".mul").c_str(), Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            out[ ind ] = lhs[ ind ] * rhs[ ind ];
+        }
+        keep(out);
+    });
+    run.measure((prefix + ".div").c_str(), Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            out[ ind ] = lhs[ ind ] / rhs[ ind ];
+        }
+        keep(out);
+    });
+    run.measure((prefix + ".array.mul").c_str(), Num, [&]() {
+        fparray::mul(&out[ 0 ], &lhs[ 0 ], &rhs[ 0 ], Num);
+        keep(out);
+    });
+    run.measure((prefix + ".array.dot").c_str(), Num, [&]() {
+        Fp sum = fparray::dot(&lhs[ 0 ], &rhs[ 0 ], Num);
+        keep(sum);
+    });
+}
+
+void benchFormats(Runner& run) {
+    benchFormat< FixedPoint< int32_t, 7, 8 > >(run, "fixedpoint.s7_8");
+    benchFormat< FixedPointSat< int32_t, 7, 8 > >(run, "fixedpoint.s7_8sat");
+    benchFormat< FixedPoint< int16_t, 0, 15 > >(run, "fixedpoint.q15");
+    benchFormat< FixedPointSat< int16_t, 0, 15 > >(run, "fixedpoint.q15sat");
+    benchFormat< FixedPoint< int32_t, 0, 31 > >(run, "fixedpoint.q31");
+}
+PNI_BENCH(benchFormats);
+
+    // One call per input over a sweep, so branchy paths see a mix.
+template< typename Func >
+void benchMathFunc(Runner& run, char const* name, vector< FixedPoint< int32_t, 15, 16 > > const& args, Func func) {
+    run.measure(name, args.size(), [&]() {
+        for(auto const& arg : args) {
+            auto val = func(arg);
+            keep(val);
+        }
+    });
+}
+
+void benchMath(Runner& run) {
+    using Fp = FixedPoint< int32_t, 15, 16 >;
+    vector< Fp > angles(Num);
+    vector< Fp > positive(Num);
+    Lcg lcg;
+    for(size_t ind = 0; ind < Num; ++ind) {
+        angles[ ind ] = Fp(-6.0f + 12.0f * lcg.unit());
+        positive[ ind ] = Fp(0.01f + 1000.0f * lcg.unit());
+    }
+
+    benchMathFunc(run, "fpmath.sin", angles, [](Fp val) { return fpmath::sin(val); });
+    benchMathFunc(run, "fpmath.sinCordic", angles, [](Fp val) { return fpmath::sinCordic(val); });
+    benchMathFunc(run, "fpmath.atan2", angles, [](Fp val) { return fpmath::atan2(val, Fp(0.5f)); });
+    benchMathFunc(run, "fpmath.sqrt", positive, [](Fp val) { return fpmath::sqrt(val); });
+    benchMathFunc(run, "fpmath.rsqrt", positive, [](Fp val) { return fpmath::rsqrt(val); });
+    benchMathFunc(run, "fpmath.exp2", angles, [](Fp val) { return fpmath::exp2(val); });
+    benchMathFunc(run, "fpmath.log2", positive, [](Fp val) { return fpmath::log2(val); });
+}
+PNI_BENCH(benchMath);
+
+} // end anonymous namespace
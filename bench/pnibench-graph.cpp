@@ -0,0 +1,46 @@
+
+#include "pnibench.h"
+
+#include "pnigraph.h"
+
+using namespace std;
+using namespace pni;
+using namespace pnibench;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const size_t Num = 128;
+
+void benchXform(Runner& run) {
+    Graph graph;
+    graph.mViewport = { 0, 0, 128, 64 };
+    graph.resize(Num, 0);
+    graph.mXAxis.setRange(0, 0, int(Num));
+    graph.mYAxis.setRange(0, 0, 100);
+
+    vector< Graph::Point > src(Num);
+    vector< Graph::Point > dst(Num);
+    Lcg lcg;
+    for(size_t ind = 0; ind < Num; ++ind) {
+        src[ ind ].mXVal = int(ind);
+        src[ ind ].mYVal = lcg.range(-10, 110);     // Some out of range, to clamp
+    }
+
+    run.measure("graph.xformPoint", Num, [&]() {
+        for(size_t ind = 0; ind < Num; ++ind) {
+            dst[ ind ] = src[ ind ];
+            graph.xformPoint(dst[ ind ]);
+        }
+        keep(dst);
+    });
+    run.measure("graph.xformAll", Num, [&]() {
+        copy(src.begin(), src.end(), dst.begin());
+        graph.xformAll(&dst[ 0 ], Num);
+        keep(dst);
+    });
+}
+PNI_BENCH(benchXform);
+
+} // end anonymous namespace
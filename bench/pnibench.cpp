@@ -0,0 +1,216 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pnibench.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <new>
+
+#include <unistd.h>
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+std::atomic< size_t > sAllocCount(0);
+std::atomic< size_t > sAllocBytes(0);
+
+std::vector< pnibench::BenchFunc >& registry() {
+    static std::vector< pnibench::BenchFunc > funcs;
+    return funcs;
+}
+
+} // end anonymous namespace
+
+////////////////////////////////////////////////////////////////////
+
+    // Counting allocator.  The array, nothrow and sized forms all end
+    // up here or in the matching delete.
+void* operator new(size_t size) {
+    sAllocCount.fetch_add(1, std::memory_order_relaxed);
+    sAllocBytes.fetch_add(size, std::memory_order_relaxed);
+    if(void* ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnibench {
+
+////////////////////////////////////////////////////////////////////
+
+Allocs getAllocs() {
+    return Allocs{ sAllocCount.load(std::memory_order_relaxed), sAllocBytes.load(std::memory_order_relaxed) };
+}
+
+Registrar::Registrar(BenchFunc func) {
+    registry().push_back(func);
+}
+
+bool Runner::wants(char const* name) const {
+    return mConfig.mFilter.empty() || strstr(name, mConfig.mFilter.c_str());
+}
+
+void Runner::record(char const* name, std::vector< double >& samples, double allocsPerOp, double bytesPerOp,
+        size_t opsPerCall, size_t calls) {
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.mName = name;
+    result.mNsPerOp = samples[ samples.size() / 2 ];
+    result.mNsPerOpMin = samples.front();
+    result.mAllocsPerOp = allocsPerOp;
+    result.mBytesPerOp = bytesPerOp;
+    result.mOpsPerCall = opsPerCall;
+    result.mCalls = calls;
+    result.mSamples = samples.size();
+    mResults.push_back(result);
+
+    printf("{\"name\":\"%s\",\"ns_per_op\":%.4f,\"ns_per_op_min\":%.4f,\"ops_per_sec\":%.1f,"
+            "\"allocs_per_op\":%.4f,\"bytes_per_op\":%.2f,\"ops_per_call\":%u,\"calls\":%u,\"samples\":%u}\n",
+            name, result.mNsPerOp, result.mNsPerOpMin, result.mNsPerOp > 0.0 ? 1e9 / result.mNsPerOp : 0.0,
+            allocsPerOp, bytesPerOp, unsigned(opsPerCall), unsigned(calls), unsigned(samples.size()));
+    fflush(stdout);
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pnibench
+
+////////////////////////////////////////////////////////////////////
+
+using namespace pnibench;
+
+namespace {
+
+struct BaseVal {
+    double mNsPerOp;
+    double mAllocsPerOp;
+};
+
+    // Reads back our own output, so just looks for the keys.
+bool loadBaseline(char const* path, std::map< std::string, BaseVal >& base) {
+    FILE* file = fopen(path, "r");
+    if( ! file) {
+        fprintf(stderr, "pnibench: can't open baseline %s\n", path);
+        return false; // EARLY RETURN!!!
+    }
+    char line[ 512 ];
+    while(fgets(line, sizeof(line), file)) {
+        char const* name = strstr(line, "\"name\":\"");
+        char const* ns = strstr(line, "\"ns_per_op\":");
+        char const* allocs = strstr(line, "\"allocs_per_op\":");
+        if( ! name || ! ns || ! allocs) {
+            continue;
+        }
+        name += strlen("\"name\":\"");
+        char const* nameEnd = strchr(name, '"');
+        if( ! nameEnd) {
+            continue;
+        }
+        BaseVal val;
+        val.mNsPerOp = strtod(ns + strlen("\"ns_per_op\":"), 0);
+        val.mAllocsPerOp = strtod(allocs + strlen("\"allocs_per_op\":"), 0);
+        base[ std::string(name, nameEnd) ] = val;
+    }
+    fclose(file);
+    return true;
+}
+
+    // Slower by more than `tolerance`, or any more allocations, fails.
+size_t compare(std::vector< Result > const& results, std::map< std::string, BaseVal > const& base, double tolerance) {
+    size_t regressions = 0;
+    for(auto const& result : results) {
+        auto found = base.find(result.mName);
+        if(found == base.end()) {
+            fprintf(stderr, "new        %-40s %10.3f ns/op\n", result.mName.c_str(), result.mNsPerOp);
+            continue;
+        }
+        BaseVal const& val = found->second;
+        double change = val.mNsPerOp > 0.0 ? result.mNsPerOp / val.mNsPerOp - 1.0 : 0.0;
+        bool slower = change > tolerance;
+        bool allocs = result.mAllocsPerOp > val.mAllocsPerOp + 1e-6;
+        if(slower || allocs) {
+            ++regressions;
+        }
+        fprintf(stderr, "%-10s %-40s %10.3f -> %10.3f ns/op (%+.1f%%), %.4f -> %.4f allocs/op\n",
+                slower || allocs ? "REGRESSED" : "ok", result.mName.c_str(), val.mNsPerOp, result.mNsPerOp,
+                change * 100.0, val.mAllocsPerOp, result.mAllocsPerOp);
+    }
+    return regressions;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: pnibench [-f filter] [-t min sample ms] [-n samples] [-b baseline.jsonl] [-r tolerance %%]\n"
+            "  Writes one JSON object per benchmark to stdout.  With -b, compares\n"
+            "  against a saved run on stderr and exits 1 if any benchmark got slower\n"
+            "  by more than the tolerance (default 10%%) or allocates more.\n");
+}
+
+} // end anonymous namespace
+
+int main(int argc, char* argv[]) {
+    Runner::Config config;
+    char const* baseline = 0;
+    double tolerance = 0.10;
+
+    int opt;
+    while((opt = getopt(argc, argv, "f:t:n:b:r:h")) != -1) {
+        switch(opt) {
+            case 'f': config.mFilter = optarg; break;
+            case 't': config.mMinSampleMs = atof(optarg); break;
+            case 'n': config.mSamples = std::max(1, atoi(optarg)); break;
+            case 'b': baseline = optarg; break;
+            case 'r': tolerance = atof(optarg) / 100.0; break;
+            default: usage(); return 2;
+        }
+    }
+
+    std::map< std::string, BaseVal > base;
+    if(baseline && ! loadBaseline(baseline, base)) {
+        return 2;
+    }
+
+    Runner runner(config);
+    for(auto func : registry()) {
+        func(runner);
+    }
+
+    if(baseline) {
+        size_t regressions = compare(runner.getResults(), base, tolerance);
+        fprintf(stderr, "%u regression(s) against %s\n", unsigned(regressions), baseline);
+        return regressions ? 1 : 0;
+    }
+    return 0;
+}
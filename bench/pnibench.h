@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////
+//
+//  pnibench: the host benchmark suite for the pni components.
+//
+//  Each pnibench-<component>.cpp registers functions with PNI_BENCH.
+//  A function does its setup, then calls Runner::measure once per
+//  benchmark with the work for one call and how many ops that is:
+//    static void benchMul(Runner& run) {
+//        ... fill lhs, rhs ...
+//        run.measure("fixedpoint.q15.mul", Num, [&]() {
+//            for(size_t ind = 0; ind < Num; ++ind) {
+//                out[ ind ] = lhs[ ind ] * rhs[ ind ];
+//            }
+//            keep(out);
+//        });
+//    }
+//    PNI_BENCH(benchMul);
+//
+//  measure() warms up, picks a call count that runs for at least the
+//  minimum sample time, then takes the median of several samples.
+//  Allocations (operator new) during the samples are counted too.
+//  Inputs come from fixed seeds so runs are comparable.
+//
+//  Results are JSON lines, one object per benchmark, so they can be
+//  saved as a baseline and compared against later:
+//    ./pnibench > baseline.jsonl
+//    ./pnibench -b baseline.jsonl      # exits 1 on regressions
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnibench_h
+#define pnibench_h
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnibench {
+
+////////////////////////////////////////////////////////////////////
+
+    // Keeps the optimizer from throwing away benchmark results.
+template< typename Type >
+inline void keep(Type const& val) {
+    asm volatile("" : : "g"(&val) : "memory");
+}
+
+    // Deterministic inputs, same sequence every run.
+struct Lcg {
+    uint32_t mSeed;
+
+    Lcg(uint32_t seed = 12345) : mSeed(seed) {}
+
+    uint32_t next() {
+        mSeed = mSeed * 1664525 + 1013904223;
+        return mSeed;
+    }
+
+        // [beg, end)
+    int32_t range(int32_t beg, int32_t end) {
+        return beg + int32_t((next() >> 8) % uint32_t(end - beg));
+    }
+
+        // [0, 1)
+    float unit() {
+        return (next() >> 8) * (1.0f / (1 << 24));
+    }
+};
+
+    // Allocation counters, bumped by the operator new in pnibench.cpp.
+struct Allocs {
+    size_t mCount;
+    size_t mBytes;
+};
+
+Allocs getAllocs();
+
+struct Result {
+    std::string mName;
+    double mNsPerOp;        // Median over the samples
+    double mNsPerOpMin;
+    double mAllocsPerOp;
+    double mBytesPerOp;
+    size_t mOpsPerCall;
+    size_t mCalls;          // Per sample
+    size_t mSamples;
+};
+
+class Runner {
+    public:
+        struct Config {
+            std::string mFilter;            // Substring of names to run, all if empty
+            double mMinSampleMs = 20.0;
+            size_t mSamples = 5;
+        };
+
+        Runner(Config const& config) : mConfig(config) {}
+
+        bool wants(char const* name) const;
+
+            // Times func(), which does `opsPerCall` ops per call.
+        template< typename Func >
+        void measure(char const* name, size_t opsPerCall, Func&& func) {
+            if( ! wants(name)) {
+                return; // EARLY RETURN!!!
+            }
+
+            func();     // Warm caches, lazy init, etc.
+
+            size_t calls = 1;
+            while(true) {
+                double ns = sample(calls, func);
+                if(ns >= mConfig.mMinSampleMs * 1e6 || calls >= (size_t(1) << 30)) {
+                    break;
+                }
+                size_t scale = ns <= 0.0 ? 16 : size_t(mConfig.mMinSampleMs * 1e6 * 1.2 / ns) + 1;
+                calls *= scale < 2 ? 2 : (scale > 16 ? 16 : scale);
+            }
+
+            std::vector< double > samples;
+            samples.reserve(mConfig.mSamples);
+            Allocs beg = getAllocs();
+            for(size_t num = 0; num < mConfig.mSamples; ++num) {
+                samples.push_back(sample(calls, func) / double(calls * opsPerCall));
+            }
+            Allocs end = getAllocs();
+
+            double ops = double(calls * opsPerCall * mConfig.mSamples);
+            record(name, samples, (end.mCount - beg.mCount) / ops, (end.mBytes - beg.mBytes) / ops,
+                    opsPerCall, calls);
+        }
+
+        std::vector< Result > const& getResults() const { return mResults; }
+
+    private:
+        template< typename Func >
+        static double sample(size_t calls, Func& func) {
+            auto beg = std::chrono::steady_clock::now();
+            for(size_t num = 0; num < calls; ++num) {
+                func();
+            }
+            auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration< double, std::nano >(end - beg).count();
+        }
+
+        void record(char const* name, std::vector< double >& samples, double allocsPerOp, double bytesPerOp,
+                size_t opsPerCall, size_t calls);
+
+        Config mConfig;
+        std::vector< Result > mResults;
+};
+
+typedef void (*BenchFunc)(Runner& run);
+
+struct Registrar {
+    Registrar(BenchFunc func);
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pnibench
+
+#define PNI_BENCH(func) static ::pnibench::Registrar func ## Registrar(func)
+
+#endif // pnibench_h
@@ -45,7 +45,12 @@ class Apa102 {
         void deinit();
 
         virtual void writeColor(Color const& color) = 0;
-        virtual void writeColors(Colors const& colors) = 0;
+            // Any contiguous colors, e.g., from an ArenaVector (pnimem.h).
+        virtual void writeColors(Color const* colors, size_t num) = 0;
+
+        void writeColors(Colors const& colors) {
+            writeColors(colors.mColor.data(), colors.mColor.size());
+        }
 
     protected:
         InitArgs mInitArgs;
@@ -58,9 +63,10 @@ class Apa102 {
 
 class Apa102Software : public Apa102 {
     public:
+        using Apa102::writeColors;
 
         virtual void writeColor(Color const& color);
-        virtual void writeColors(Colors const& colors);
+        virtual void writeColors(Color const* colors, size_t num);
 
     protected:
         virtual void initHook();
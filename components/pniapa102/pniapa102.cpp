@@ -7,6 +7,7 @@
 // Using some info from: https://cpldcpu.com/2014/08/27/apa102/
 
 #include "pniapa102.h"
+#include "pnitrace.h"
 
 namespace pni {
 
@@ -30,10 +31,11 @@ void Apa102Software::writeColor(Color const& color) {
     writeEnd();
 }
     
-void Apa102Software::writeColors(Colors const& colors) {
+void Apa102Software::writeColors(Color const* colors, size_t num) {
+    PNI_TRACE_SCOPE("apa102.write");
     writeBeg();
-    for (auto cur : colors.mColor) {
-        writeSingleColor(cur);
+    for (size_t ind = 0; ind < num; ++ind) {
+        writeSingleColor(colors[ ind ]);
     }   
     writeEnd();
 }
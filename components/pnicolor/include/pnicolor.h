@@ -30,7 +30,7 @@ class Color {
 
         using value_type = int32_t;
         static const size_t NumDenBits = 7;
-        static const size_t NumDivBits = 8;
+        static const size_t NumDivBits = 24;    // Full width, FixedPoint multiplies in 64 bits.
 
         using Component = FixedPoint< value_type, NumDenBits, NumDivBits >;
 
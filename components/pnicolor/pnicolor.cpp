@@ -9,8 +9,6 @@
 
 #include "pnicolor.h"
 
-#include <vector>
-
 ////////////////////////////////////////////////////////////////////
 
 namespace pni {
@@ -95,12 +93,11 @@ Color::Hsv ColorRgb::toHsv() const {
     if (maxVal == minVal) {
         hsv.h = 0;
     } else {
-        static const Component One(1);
-        static const Component Two(2);
-        static const Component Three(3);
-        static const Component Six (6);
-        static const Component OneThird(1.0f / 3.0f);
-        static const Component TwoThird(2.0f / 3.0f);
+            // constexpr, so no guard variables or runtime init.
+        static constexpr Component One(1);
+        static constexpr Component Six (6);
+        static constexpr Component OneThird(1.0f / 3.0f);
+        static constexpr Component TwoThird(2.0f / 3.0f);
 
         if (maxVal == mRgb.r) {
             hsv.h = ((mRgb.g - mRgb.b) / vd) / Six + One;           // [-1/6, 1/6] + 1
@@ -152,7 +149,7 @@ ColorHsv::ColorHsv(Hsv const& hsv) :
 }
     
 Color::Rgb ColorHsv::toRgb() const {
-    static const auto table = std::vector< Rgb > { { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 } };
+    static constexpr Rgb table[] = { { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 }, { 0, 1, 1 }, { 0, 0, 1 }, { 1, 0, 1 } };
 
     Component hn6 = mHsv.h % 1;     // [0,1), can do that because hue wraps around anyway
     hn6 *= 6;                       // [0,6)
@@ -180,15 +177,14 @@ ColorHsv& ColorHsv::clamp(Hsv const& beg, Hsv const& end) {
 
 ColorHsv& ColorHsv::clamp() {
     const auto maxVal = Component::RawOneVal - 1;
-    mHsv.h %= maxVal;                   // wrap, not clamp
+    mHsv.h %= Component::oneVal();      // wrap, not clamp
     mHsv.s.clampRaw(0, maxVal);
     mHsv.v.clampRaw(0, maxVal);
     return *this;
 }
 
 ColorHsv& ColorHsv::clampDown() {
-    const auto maxVal = Component::RawOneVal - 1;
-    mHsv.h %= maxVal;                   // wrap, not clamp
+    mHsv.h %= Component::oneVal();      // wrap, not clamp
     mHsv.s.clampDown();
     mHsv.v.clampDown();
     return *this;
@@ -0,0 +1,743 @@
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include "microtest/microtest.h"
+
+#include "pnifft.h"
+#include "pnipeaks.h"
+
+using namespace std;
+using namespace pni;
+
+    // Counts heap allocations, to check transforms don't allocate.
+static atomic< size_t > gAllocs(0);
+
+void* operator new(size_t size) {
+    ++gAllocs;
+    void* ptr = malloc(size ? size : 1);
+    if( ! ptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+namespace {
+
+struct Lcg {
+    uint32_t mState = 1;
+    int16_t next() {
+        mState = mState * 1664525 + 1013904223;
+        return int16_t(mState >> 16);
+    }
+};
+
+const double TwoPi = 8.0 * atan(1.0);
+
+    // Double precision DFT, scaled like FftTiny, packed [ririri].
+vector< double > refDft(FftSData const& src) {
+    size_t num = src.size();
+    vector< double > out(num);
+    for(size_t bin = 0; bin <= num / 2; ++bin) {
+        double re = 0.0;
+        double im = 0.0;
+        for(size_t ind = 0; ind < num; ++ind) {
+            re += src[ ind ] * cos(TwoPi * bin * ind / num);
+            im -= src[ ind ] * sin(TwoPi * bin * ind / num);
+        }
+        re = max(-32768.0, min(re / num, 32767.0));
+        im = max(-32768.0, min(im / num, 32767.0));
+        if(bin == 0) {
+            out[ 0 ] = re;
+        } else if(bin == num / 2) {
+            out[ 1 ] = re;
+        } else {
+            out[ bin * 2 ] = re;
+            out[ bin * 2 + 1 ] = im;
+        }
+    }
+    return out;
+}
+
+template< size_t Pow >
+double calcTinyError(FftSData const& src) {
+    FftTiny< Pow > fft;
+    copy(src.begin(), src.end(), fft.mReal.begin());
+    fft.doFft();
+    vector< double > ref = refDft(src);
+    double err = 0.0;
+    for(size_t ind = 0; ind < ref.size(); ++ind) {
+        err = max(err, fabs(fft.mReal[ ind ] - ref[ ind ]));
+    }
+    return err;
+}
+
+FftSData makeNoise(size_t num, int32_t amplitude) {
+    Lcg lcg;
+    FftSData src(num);
+    for(auto& val : src) {
+        val = FftSDatum(int32_t(lcg.next()) * amplitude / 32768);
+    }
+    return src;
+}
+
+template< size_t Pow >
+double calcTinyRandomError(bool fullScale) {
+    Lcg lcg;
+    FftSData src(size_t(1) << Pow);
+    for(auto& val : src) {
+        val = fullScale ? (lcg.next() < 0 ? -32768 : 32767) : lcg.next() / 4;
+    }
+    return calcTinyError< Pow >(src);
+}
+
+    // Largest difference after doFft then doIfft.
+template< class Engine >
+int32_t calcRoundTripError(FftSData const& src) {
+    Engine fft;
+    copy(src.begin(), src.end(), fft.mReal.begin());
+    fft.doFft();
+    fft.doIfft();
+    int32_t err = 0;
+    for(size_t ind = 0; ind < src.size(); ++ind) {
+        err = max(err, abs(int32_t(fft.mReal[ ind ]) - src[ ind ]));
+    }
+    return err;
+}
+
+void fillSine(FftBase& fft, double amplitude, double bin, double phase = 0.0) {
+    size_t num = fft.getNum();
+    for(size_t ind = 0; ind < num; ++ind) {
+        fft.mReal[ ind ] = FftSDatum(lround(amplitude * cos(TwoPi * bin * ind / num + phase)));
+    }
+}
+
+} // end anonymous namespace
+
+TEST(tinyMatchesDft) {
+    ASSERT_TRUE(calcTinyRandomError< 2 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 3 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 4 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 5 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 6 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 8 >(false) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 10 >(false) <= 1.0);
+}
+
+    // Worst case inputs can't overflow the accumulators.
+TEST(tinyFullScale) {
+    ASSERT_TRUE(calcTinyRandomError< 3 >(true) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 5 >(true) <= 1.0);
+    ASSERT_TRUE(calcTinyRandomError< 9 >(true) <= 1.0);
+
+    FftSData low(32, -32768);
+    FftSData high(32, 32767);
+    ASSERT_TRUE(calcTinyError< 5 >(low) <= 1.0);
+    ASSERT_TRUE(calcTinyError< 5 >(high) <= 1.0);
+
+    FftSData square(32);
+    for(size_t ind = 0; ind < square.size(); ++ind) {
+        square[ ind ] = ind & 1 ? -32768 : 32767;
+    }
+    ASSERT_TRUE(calcTinyError< 5 >(square) <= 1.0);
+}
+
+TEST(tinySine) {
+    FftTiny< 5 > fft;
+    for(size_t ind = 0; ind < fft.Num; ++ind) {
+        fft.mReal[ ind ] = FftSDatum(20000.0 * sin(TwoPi * 5 * ind / fft.Num));
+    }
+    fft.doFft();
+    fft.convToReal();
+        // Half the amplitude, in bin 5 only.
+    ASSERT_TRUE(abs(fft.mReal[ 5 ] - 10000) <= 1);
+    for(size_t bin = 0; bin < fft.NumOut; ++bin) {
+        if(bin != 5) {
+            ASSERT_TRUE(fft.mReal[ bin ] <= 1);
+        }
+    }
+}
+
+TEST(tinySelectedBins) {
+    Lcg lcg;
+    FftSData src(64);
+    for(auto& val : src) {
+        val = lcg.next();
+    }
+
+    FftTiny< 6 > all;
+    FftTiny< 6 > some;
+    size_t bins[] = { 0, 3, 16, 29, 31, 99 };
+    some.selectBins(bins, sizeof(bins) / sizeof(bins[ 0 ]));
+    ASSERT_EQ(some.getNumBins(), 5u);
+
+    copy(src.begin(), src.end(), all.mReal.begin());
+    copy(src.begin(), src.end(), some.mReal.begin());
+    all.doFft();
+    some.doFft();
+    for(size_t bin = 0; bin < all.NumOut; ++bin) {
+        bool selected = bin == 0 || bin == 3 || bin == 16 || bin == 29 || bin == 31;
+        ASSERT_EQ(some.mReal[ bin * 2 ], selected ? all.mReal[ bin * 2 ] : 0);
+        ASSERT_EQ(some.mReal[ bin * 2 + 1 ], selected ? all.mReal[ bin * 2 + 1 ] : 0);
+    }
+
+    some.selectBinRange(30, 40);
+    ASSERT_EQ(some.getNumBins(), 2u);
+    some.selectAllBins();
+    ASSERT_EQ(some.getNumBins(), 32u);
+}
+
+TEST(tinyNoAlloc) {
+    FftTiny< 5 > fft;
+    size_t before = gAllocs;
+    for(int ind = 0; ind < 10; ++ind) {
+        fft.doFft();
+        fft.doIfft();
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+}
+
+    // pffft's spectrum isn't scaled, so the input has to be quiet enough
+    // for DC not to saturate: then only float rounding is left.
+TEST(pffftRoundTrip) {
+    FftPffft< 5 > fft;
+    ASSERT_EQ(fft.getForwardShift(), 0u);
+
+    int32_t err32 = calcRoundTripError< FftPffft< 5 > >(makeNoise(32, 32767 / 32));
+    int32_t err256 = calcRoundTripError< FftPffft< 8 > >(makeNoise(256, 32767 / 256));
+    int32_t err1024 = calcRoundTripError< FftPffft< 10 > >(makeNoise(1024, 32767 / 1024));
+    ASSERT_TRUE(err32 <= 1);
+    ASSERT_TRUE(err256 <= 1);
+    ASSERT_TRUE(err1024 <= 1);
+
+        // A sine only fills one bin, so it can be louder.
+    FftPffft< 8 > sine;
+    fillSine(sine, 200.0, 9.0);
+    FftSData src(sine.mReal);
+    int32_t errSine = calcRoundTripError< FftPffft< 8 > >(src);
+    ASSERT_TRUE(errSine <= 1);
+}
+
+    // The spectrum is scaled by 1 / Num and rounded to 16 bits, so
+    // errors grow like sqrt(Num), at any level: sqrt(Num / 6) rms from
+    // the rounding alone, and that's what's measured.  Bounds are 1.5 *
+    // sqrt(Num).
+TEST(tinyRoundTrip) {
+    FftTiny< 5 > fft;
+    ASSERT_EQ(fft.getForwardShift(), 5u);
+
+    int32_t err4 = calcRoundTripError< FftTiny< 2 > >(makeNoise(4, 32767));
+    int32_t err8 = calcRoundTripError< FftTiny< 3 > >(makeNoise(8, 32767));
+    int32_t err32 = calcRoundTripError< FftTiny< 5 > >(makeNoise(32, 32767));
+    int32_t err256 = calcRoundTripError< FftTiny< 8 > >(makeNoise(256, 32767));
+    int32_t errQuiet = calcRoundTripError< FftTiny< 8 > >(makeNoise(256, 100));
+    ASSERT_TRUE(err4 <= 2);
+    ASSERT_TRUE(err8 <= 4);
+    ASSERT_TRUE(err32 <= 9);
+    ASSERT_TRUE(err256 <= 24);
+    ASSERT_TRUE(errQuiet <= 24);
+
+        // Extremes saturate rather than wrap.
+    FftSData square(32);
+    for(size_t ind = 0; ind < square.size(); ++ind) {
+        square[ ind ] = ind & 1 ? -32768 : 32767;
+    }
+    int32_t errSquare = calcRoundTripError< FftTiny< 5 > >(square);
+    int32_t errLow = calcRoundTripError< FftTiny< 5 > >(FftSData(32, -32768));
+    ASSERT_TRUE(errSquare <= 1);
+    ASSERT_TRUE(errLow <= 1);
+}
+
+    // Needs the 3p/fix_fft submodule, see the Makefile.  fix_fft's
+    // inverse gives up low bits for headroom as it goes, on top of the
+    // spectrum's rounding.
+#if PNI_TEST_FIX_FFT
+TEST(fixRoundTrip) {
+    FftFix< 5 > fft;
+    ASSERT_EQ(fft.getForwardShift(), 5u);
+
+    int32_t err32 = calcRoundTripError< FftFix< 5 > >(makeNoise(32, 16384));
+    int32_t err256 = calcRoundTripError< FftFix< 8 > >(makeNoise(256, 16384));
+    ASSERT_TRUE(err32 <= 32);
+    ASSERT_TRUE(err256 <= 256);
+
+        // Same layout as the others.
+    FftFix< 6 > fix;
+    FftTiny< 6 > tiny;
+    fillSine(fix, 8000.0, 7.0, 0.5);
+    fillSine(tiny, 8000.0, 7.0, 0.5);
+    fix.doFft();
+    tiny.doFft();
+    for(size_t ind = 0; ind < fix.Num; ++ind) {
+        ASSERT_TRUE(abs(fix.mReal[ ind ] - tiny.mReal[ ind ]) <= 4);
+    }
+}
+#endif
+
+TEST(spectrumLayout) {
+    FftTiny< 4 > fft;
+    fillSine(fft, 8000.0, 8.0);                 // Nyquist
+    for(size_t ind = 0; ind < fft.Num; ++ind) {
+        fft.mReal[ ind ] += 1000;               // DC
+    }
+    fft.doFft();
+
+    FftSpectrum spec(fft);
+    ASSERT_EQ(spec.getNumBins(), 9u);
+    ASSERT_EQ(spec.getRe(0), 1000);
+    ASSERT_EQ(spec.getIm(0), 0);
+    ASSERT_EQ(spec.getRe(8), 8000);
+    ASSERT_EQ(spec.getIm(8), 0);
+    ASSERT_EQ(fft.mReal[ 1 ], 8000);
+
+        // Imaginary parts of the real only bins go nowhere.
+    spec.set(8, -7000, 1234);
+    ASSERT_EQ(spec.getRe(8), -7000);
+    ASSERT_EQ(spec.getIm(8), 0);
+    ASSERT_EQ(spec.getRe(0), 1000);
+
+    spec.set(3, 40000, -40000);
+    ASSERT_EQ(spec.getRe(3), 32767);
+    ASSERT_EQ(spec.getIm(3), -32768);
+    ASSERT_EQ(fft.mReal[ 6 ], 32767);
+    ASSERT_EQ(fft.mReal[ 7 ], -32768);
+}
+
+TEST(spectrumPolar) {
+    FftTiny< 6 > fft;
+    fillSine(fft, 20000.0, 5.0, 1.0);
+    fft.doFft();
+    FftSpectrum spec(fft);
+
+        // Half the amplitude, phase as generated (1 rad).
+    uint32_t mag = spec.getMag(5);
+    ASSERT_TRUE(abs(int32_t(mag) - 10000) <= 1);
+    uint32_t power = spec.getPower(5);
+    ASSERT_TRUE(abs(int32_t(power) - 100000000) <= 20000);
+    const double BamPerRad = 4294967296.0 / TwoPi;
+    int64_t phaseErr = int32_t(spec.getPhase(5) - uint32_t(BamPerRad));
+    ASSERT_TRUE(llabs(phaseErr) < int64_t(BamPerRad / 1000.0));
+
+    spec.setPolar(5, 3000, 0x40000000);         // Quarter turn
+    ASSERT_TRUE(abs(spec.getRe(5)) <= 1);
+    ASSERT_TRUE(abs(spec.getIm(5) - 3000) <= 1);
+
+    spec.rotate(5, 0x80000000);                 // Half turn
+    ASSERT_TRUE(abs(spec.getRe(5)) <= 1);
+    ASSERT_TRUE(abs(spec.getIm(5) + 3000) <= 1);
+
+    spec.scale(5, FftSpectrum::GainOne / 2);
+    ASSERT_TRUE(abs(spec.getIm(5) + 1500) <= 1);
+    spec.scale(5, FftSpectrum::GainOne * 100);
+    ASSERT_EQ(spec.getIm(5), -32768);
+}
+
+TEST(spectrumBulk) {
+        // Slots 0, 100, 200... so bin k is (200k, 200k + 100), DC is 0
+        // and Nyquist 100.
+    FftSData data(16);
+    for(size_t ind = 0; ind < data.size(); ++ind) {
+        data[ ind ] = FftSDatum(ind * 100);
+    }
+    FftSpectrum spec(&data[ 0 ], data.size());
+
+        // Bin 1's magnitude is 360.6.
+    size_t gated = spec.gate(361);
+    ASSERT_EQ(gated, 3u);
+    ASSERT_EQ(spec.getRe(0), 0);
+    ASSERT_EQ(spec.getRe(1), 0);
+    ASSERT_EQ(spec.getIm(1), 0);
+    ASSERT_EQ(spec.getRe(2), 400);
+    ASSERT_EQ(spec.getRe(8), 0);
+
+    spec.zero(2, 4);
+    ASSERT_EQ(spec.getRe(2), 0);
+    ASSERT_EQ(spec.getIm(3), 0);
+    ASSERT_EQ(spec.getRe(4), 800);
+
+    spec.shift(1);
+    ASSERT_EQ(spec.getRe(5), 800);
+    ASSERT_EQ(spec.getIm(5), 900);
+    ASSERT_EQ(spec.getRe(8), 1400);
+    ASSERT_EQ(spec.getRe(1), 0);
+    spec.shift(-1);
+    ASSERT_EQ(spec.getRe(4), 800);
+    ASSERT_EQ(spec.getIm(4), 900);
+    ASSERT_EQ(spec.getRe(7), 1400);
+    ASSERT_EQ(spec.getRe(8), 0);
+
+    vector< int32_t > gains(spec.getNumBins(), FftSpectrum::GainOne / 2);
+    spec.scaleAll(&gains[ 0 ]);
+    ASSERT_EQ(spec.getRe(4), 400);
+    ASSERT_EQ(spec.getIm(4), 450);
+}
+
+    // Forward, gate, inverse: noise below the threshold goes, the tone
+    // stays.
+TEST(spectrumNoiseGate) {
+    FftTiny< 8 > fft;
+    fillSine(fft, 8000.0, 12.0);
+    FftSData clean(fft.mReal);
+    FftSData noise = makeNoise(fft.Num, 1000);
+    for(size_t ind = 0; ind < fft.Num; ++ind) {
+        fft.mReal[ ind ] += noise[ ind ];
+    }
+
+    auto calcRms = [&]() {
+        double sum = 0.0;
+        for(size_t ind = 0; ind < fft.Num; ++ind) {
+            double diff = fft.mReal[ ind ] - clean[ ind ];
+            sum += diff * diff;
+        }
+        return sqrt(sum / fft.Num);
+    };
+    double before = calcRms();
+
+    fft.doFft();
+    FftSpectrum spec(fft);
+    size_t gated = spec.gate(200);
+    fft.doIfft();
+    double after = calcRms();
+
+    ASSERT_TRUE(gated >= 120);
+    ASSERT_TRUE(before > 500.0);
+    ASSERT_TRUE(after < before / 4.0);
+}
+
+TEST(spectrumNoAlloc) {
+    FftTiny< 5 > fft;
+    size_t before = gAllocs;
+    FftSpectrum spec(fft);
+    spec.gate(10);
+    spec.shift(2);
+    spec.rotate(3, 12345);
+    ASSERT_EQ(gAllocs - before, 0u);
+}
+
+    // Same pffft, same results, bit for bit.
+TEST(runtimeMatchesPffft) {
+    FftPffft< 9 > fixed;
+    FftPffftRuntime runtime(512);
+    ASSERT_EQ(runtime.getNum(), 512u);
+    ASSERT_EQ(runtime.getMaxNum(), 512u);
+    ASSERT_EQ(runtime.getForwardShift(), 0u);
+
+    FftSData src = makeNoise(512, 20000);
+    copy(src.begin(), src.end(), fixed.mReal.begin());
+    copy(src.begin(), src.end(), runtime.mReal.begin());
+    fixed.doHanningWindow(fixed.calcBias());
+    runtime.doHanningWindow(runtime.calcBias());
+    ASSERT_TRUE(fixed.mReal == runtime.mReal);
+    fixed.doFft();
+    runtime.doFft();
+    ASSERT_TRUE(fixed.mReal == runtime.mReal);
+    fixed.doIfft();
+    runtime.doIfft();
+    ASSERT_TRUE(fixed.mReal == runtime.mReal);
+}
+
+TEST(runtimeReplan) {
+    FftPffftRuntime fft(256, 1024);
+    ASSERT_EQ(fft.getNum(), 256u);
+    ASSERT_EQ(fft.getMaxNum(), 1024u);
+
+    size_t before = gAllocs;
+    const size_t Sizes[] = { 1024, 96, 512, 160, 256 };
+    for(size_t num : Sizes) {
+        bool ok = fft.plan(num);
+        ASSERT_TRUE(ok);
+        ASSERT_EQ(fft.getNum(), num);
+        ASSERT_EQ(fft.getNumOut(), num / 2);
+
+        FftSData src = makeNoise(num, 32767 / int32_t(num));
+        copy(src.begin(), src.end(), fft.mReal.begin());
+        fft.doHanningWindow();
+        FftSData windowed(fft.mReal);
+
+            // Right size: a sine lands in its bin.
+        fillSine(fft, 32767.0 / num, 5.0);
+        fft.doFft();
+        FftSpectrum spec(fft);
+        ASSERT_EQ(spec.getNumBins(), num / 2 + 1);
+        ASSERT_TRUE(spec.getMag(5) > spec.getMag(4) * 10);
+
+        copy(windowed.begin(), windowed.end(), fft.mReal.begin());
+        fft.doFft();
+        fft.doIfft();
+        int32_t err = 0;
+        for(size_t ind = 0; ind < num; ++ind) {
+            err = max(err, abs(int32_t(fft.mReal[ ind ]) - windowed[ ind ]));
+        }
+        ASSERT_TRUE(err <= 1);
+    }
+        // Only the test's own vectors allocated: 2 per size.
+    ASSERT_EQ(gAllocs - before, 2 * sizeof(Sizes) / sizeof(Sizes[ 0 ]));
+
+        // Unsupported or too big: the plan stays.
+    bool tooBig = fft.plan(2048);
+    bool notMultiple = fft.plan(100);
+    bool badFactor = fft.plan(224);             // 32 * 7
+    ASSERT_FALSE(tooBig);
+    ASSERT_FALSE(notMultiple);
+    ASSERT_FALSE(badFactor);
+    ASSERT_EQ(fft.getNum(), 256u);
+
+    FftPffftRuntime bad(100);
+    ASSERT_EQ(bad.getNum(), 0u);
+    bad.doFft();
+    bad.doIfft();
+}
+
+template< class Multi >
+void fillMulti(Multi& fft, int32_t amplitude) {
+    for(size_t chan = 0; chan < fft.getNumChannels(); ++chan) {
+        Lcg lcg;
+        lcg.mState = uint32_t(chan + 1);
+        for(size_t ind = 0; ind < fft.Num; ++ind) {
+            fft.getChannel(chan)[ ind ] = FftSDatum(int32_t(lcg.next()) * amplitude / 32768);
+        }
+    }
+}
+
+    // Largest difference from FftPffft over all channels, after doFft
+    // then after doIfft.
+template< size_t Pow >
+void calcMultiError(size_t numChannels, typename FftPffftMulti< Pow >::Mode mode, int32_t& fwdErr, int32_t& invErr) {
+    FftPffftMulti< Pow > multi(numChannels, mode);
+    fillMulti(multi, 32767 >> Pow);
+    FftSData src(multi.mReal);
+    multi.doHanningWindow();
+    multi.doFft();
+    FftSData spectra(multi.mReal);
+    multi.doIfft();
+
+    FftPffft< Pow > single;
+    fwdErr = 0;
+    invErr = 0;
+    for(size_t chan = 0; chan < numChannels; ++chan) {
+        auto beg = src.begin() + chan * single.Num;
+        copy(beg, beg + single.Num, single.mReal.begin());
+        single.doHanningWindow();
+        single.doFft();
+        for(size_t ind = 0; ind < single.Num; ++ind) {
+            fwdErr = max(fwdErr, abs(single.mReal[ ind ] - spectra[ chan * single.Num + ind ]));
+        }
+        single.doIfft();
+        for(size_t ind = 0; ind < single.Num; ++ind) {
+            invErr = max(invErr, abs(single.mReal[ ind ] - multi.getChannel(chan)[ ind ]));
+        }
+    }
+}
+
+TEST(multiMatchesSingle) {
+    using Multi = FftPffftMulti< 9 >;
+    for(size_t numChannels = 1; numChannels <= 4; ++numChannels) {
+        int32_t fwdErr = 0;
+        int32_t invErr = 0;
+        calcMultiError< 9 >(numChannels, Multi::Separate, fwdErr, invErr);
+        ASSERT_EQ(fwdErr, 0);
+        ASSERT_EQ(invErr, 0);
+            // Different float rounding.
+        calcMultiError< 9 >(numChannels, Multi::Paired, fwdErr, invErr);
+        ASSERT_TRUE(fwdErr <= 1);
+        ASSERT_TRUE(invErr <= 1);
+    }
+    int32_t fwdErr = 0;
+    int32_t invErr = 0;
+    calcMultiError< 5 >(2, FftPffftMulti< 5 >::Paired, fwdErr, invErr);
+    ASSERT_TRUE(fwdErr <= 1);
+    ASSERT_TRUE(invErr <= 1);
+}
+
+    // A pair shares one FFT, but nothing leaks between them.
+TEST(multiPairIsolation) {
+    FftPffftMulti< 8 > fft(2, FftPffftMulti< 8 >::Paired);
+    FftPffft< 8 > sine;
+    fillSine(sine, 100.0, 17.0, 0.3);
+    copy(sine.mReal.begin(), sine.mReal.end(), fft.getChannel(1));
+    fft.doFft();
+
+    FftSpectrum quiet = fft.getSpectrum(0);
+    FftSpectrum loud = fft.getSpectrum(1);
+    for(size_t bin = 0; bin < quiet.getNumBins(); ++bin) {
+        ASSERT_TRUE(quiet.getMag(bin) <= 1);
+    }
+    ASSERT_TRUE(abs(int32_t(loud.getMag(17)) - 12800) <= 2);
+
+    fft.doIfft();
+    for(size_t ind = 0; ind < fft.Num; ++ind) {
+        ASSERT_EQ(fft.getChannel(0)[ ind ], 0);
+        ASSERT_TRUE(abs(fft.getChannel(1)[ ind ] - sine.mReal[ ind ]) <= 1);
+    }
+}
+
+TEST(multiNoAlloc) {
+    FftPffftMulti< 8 > separate(3);
+    FftPffftMulti< 8 > paired(3, FftPffftMulti< 8 >::Paired);
+    ASSERT_EQ(separate.getMode(), FftPffftMulti< 8 >::Separate);
+    separate.doHanningWindow();
+    paired.doHanningWindow();
+    size_t before = gAllocs;
+    for(int ind = 0; ind < 10; ++ind) {
+        separate.doHanningWindow();
+        separate.doFft();
+        separate.doIfft();
+        paired.doHanningWindow();
+        paired.doFft();
+        paired.doIfft();
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+}
+
+    // Tones at fractional bins (amplitude, bin) through the usual
+    // window, FFT and convToReal: magnitudes in [0, NumOut).
+template< size_t Pow >
+void makeMagnitudes(FftPffft< Pow >& fft, vector< pair< double, double > > const& tones) {
+    for(size_t ind = 0; ind < fft.Num; ++ind) {
+        double val = 0.0;
+        for(auto const& tone : tones) {
+            val += tone.first * sin(TwoPi * tone.second * ind / fft.Num);
+        }
+        fft.mReal[ ind ] = FftSDatum(lround(val));
+    }
+    fft.doHanningWindow();
+    fft.doFft();
+    fft.convToReal();
+}
+
+TEST(peaksTopK) {
+    FftPffft< 9 > fft;
+    makeMagnitudes(fft, { { 40.0, 20.3 }, { 60.0, 45.7 }, { 20.0, 80.5 }, { 30.0, 150.1 } });
+
+    PeakTrackerT< 2 > two;
+    size_t num = two.findPeaks(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_EQ(num, 2u);
+    ASSERT_TRUE(fabs(two.getPeak(0).mBin - 45.7) < 0.05);
+    ASSERT_TRUE(fabs(two.getPeak(1).mBin - 20.3) < 0.05);
+        // Hanning: amplitude * Num / 4, whatever the fraction.
+    ASSERT_TRUE(fabs(two.getPeak(0).mMag - 60.0 * 512 / 4) < 60.0 * 512 / 4 * 0.03);
+
+    PeakTrackerT< 8 > eight;
+    num = eight.findPeaks(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_EQ(num, 4u);
+    const double Bins[] = { 45.7, 20.3, 150.1, 80.5 };
+    for(size_t ind = 0; ind < num; ++ind) {
+        ASSERT_TRUE(fabs(eight.getPeak(ind).mBin - Bins[ ind ]) < 0.05);
+    }
+
+        // Below the threshold: nothing.
+    PeakTracker::Config config;
+    config.mMinMag = 20000;
+    eight.setConfig(config);
+    num = eight.findPeaks(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_EQ(num, 0u);
+}
+
+TEST(peaksTracking) {
+    FftPffft< 9 > fft;
+    PeakTrackerT< 4 > tracker;
+
+        // A glide keeps its track.
+    uint32_t id = 0;
+    for(size_t frame = 0; frame < 20; ++frame) {
+        double bin = 30.0 + 0.3 * frame;
+        makeMagnitudes(fft, { { 50.0, bin }, { 10.0, 120.0 } });
+        tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+        PeakTracker::Track const* track = tracker.getStrongestTrack();
+        ASSERT_TRUE(track != nullptr);
+        ASSERT_TRUE(fabs(track->mBin - bin) < 0.05);
+        if(frame == 0) {
+            id = track->mId;
+        }
+        ASSERT_EQ(track->mId, id);
+        ASSERT_EQ(track->mAge, frame + 1);
+    }
+    ASSERT_EQ(tracker.getNumTracks(), 2u);
+
+        // Silence: tracks outlive their peaks by mMaxMissed frames.
+    for(size_t frame = 0; frame <= tracker.getConfig().mMaxMissed; ++frame) {
+        ASSERT_EQ(tracker.getNumTracks(), 2u);
+        makeMagnitudes(fft, {});
+        tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+        ASSERT_TRUE(tracker.getStrongestTrack() == nullptr);
+    }
+    ASSERT_EQ(tracker.getNumTracks(), 0u);
+
+        // A jump is a new note.
+    makeMagnitudes(fft, { { 50.0, 90.0 } });
+    tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+    PeakTracker::Track const* track = tracker.getStrongestTrack();
+    ASSERT_TRUE(track != nullptr);
+    ASSERT_TRUE(track->mId != id);
+    ASSERT_EQ(track->mAge, 1u);
+}
+
+    // More peaks than slots: the strong ones win.
+TEST(peaksTrackingFull) {
+    FftPffft< 9 > fft;
+    PeakTrackerT< 4, 2 > tracker;
+    makeMagnitudes(fft, { { 10.0, 20.0 }, { 20.0, 40.0 } });
+    tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+    makeMagnitudes(fft, { { 10.0, 20.0 }, { 80.0, 60.0 }, { 40.0, 80.0 } });
+    tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_EQ(tracker.getNumTracks(), 2u);
+    bool has60 = false;
+    bool has80 = false;
+    for(size_t ind = 0; ind < tracker.getMaxTracks(); ++ind) {
+        float bin = tracker.getTrack(ind).mBin;
+        has60 = has60 || fabs(bin - 60.0f) < 0.1f;
+        has80 = has80 || fabs(bin - 80.0f) < 0.1f;
+    }
+        // Strongest first: 60 and 80 take 20's and 40's slots before
+        // 20 gets to match.
+    ASSERT_TRUE(has60);
+    ASSERT_TRUE(has80);
+}
+
+TEST(pitchHps) {
+    FftPffft< 10 > fft;
+
+        // Fundamental weaker than its overtones.
+    makeMagnitudes(fft, { { 20.0, 10.4 }, { 60.0, 20.8 }, { 40.0, 31.2 }, { 30.0, 41.6 } });
+    PeakTrackerT< 1 > tracker;
+    tracker.findPeaks(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_TRUE(fabs(tracker.getPeak(0).mBin - 20.8) < 0.05);
+    float pitch = calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_TRUE(fabs(pitch - 10.4) < 0.05);
+
+        // Missing entirely.
+    makeMagnitudes(fft, { { 60.0, 25.6 }, { 40.0, 38.4 }, { 30.0, 51.2 } });
+    pitch = calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_TRUE(fabs(pitch - 12.8) < 0.1);
+
+    float hz = binToHz(pitch, 22050.0f, fft.Num);
+    ASSERT_TRUE(fabs(hz - 12.8f * 22050.0f / 1024) < 2.0f);
+
+    makeMagnitudes(fft, {});
+    pitch = calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut);
+    ASSERT_EQ(pitch, 0.0f);
+}
+
+TEST(peaksBudget) {
+    FftPffft< 9 > fft;
+    makeMagnitudes(fft, { { 40.0, 20.3 }, { 60.0, 45.7 } });
+    PeakTrackerT< 8 > tracker;
+    ASSERT_EQ(sizeof(tracker), sizeof(PeakTracker) + 8 * (sizeof(PeakTracker::Peak) + sizeof(PeakTracker::Track)));
+
+    size_t before = gAllocs;
+    for(int ind = 0; ind < 10; ++ind) {
+        tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+        calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut);
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+}
+
+TEST_MAIN();
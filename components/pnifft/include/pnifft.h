@@ -7,14 +7,20 @@
 #ifndef pnifft_h
 #define pnifft_h
 
+#include <algorithm>
+#include <bitset>
 #include <cstdint>
 #include <cstddef>
 #include <cmath>
 #include <climits>
+#include <cstdlib>
 #include <vector>
 
+#include "esp_log.h"
 #include "pffft.h"
 #include "fix_fft.h"
+#include "pnifpmath.h"
+#include "pnitrace.h"
 
 ////////////////////////////////////////////////////////////////////
 
@@ -40,56 +46,81 @@ namespace pni {
  *
  * \return Integer square root of the input value.
  */
- uint32_t SquareRootRounded(uint32_t a_nInput)
- {
-     uint32_t op  = a_nInput;
-     uint32_t res = 0;
-     uint32_t one = 1uL << 30; // The second-to-top bit is set: use 1u << 14 for uint16_t type; use 1uL<<30 for uint32_t type
- 
- 
-     // "one" starts at the highest power of four <= than the argument.
-     while (one > op)
-     {
-         one >>= 2;
-     }
- 
-     while (one != 0)
-     {
-         if (op >= res + one)
-         {
-             op = op - (res + one);
-             res = res +  2 * one;
-         }
-         res >>= 1;
-         one >>= 2;
-     }
- 
-     /* Do arithmetic rounding to nearest integer */
-     if (op > res)
-     {
-         res++;
-     }
- 
-     return res;
- }
+inline uint32_t SquareRootRounded(uint32_t a_nInput)
+{
+    uint32_t res = fpmath::isqrt(a_nInput);
+
+    /* Do arithmetic rounding to nearest integer */
+    if (a_nInput - res * res > res)
+    {
+        res++;
+    }
+
+    return res;
+}
 
 ////////////////////////////////////////////////////////////////////
 
 using FftSDatum = int16_t;
 using FftSData = std::vector< FftSDatum >;
 
-template< size_t Pow >
-class Fft {
+    // What all engines share, compile time sized (Fft< Pow >) or not
+    // (FftPffftRuntime), so code can take either as an FftBase&.
+class FftBase {
     public:
-
-        static const size_t Num = 1 << Pow;
-        static const size_t NumOut = Num >> 1;
-        static const size_t Num2 = Num << 1;
-
         using SDatum = FftSDatum;
         using SData = FftSData;
 
-        SData mReal;                // Input samples.   PUBLIC DATA!!!  Don't resize!!!
+            // Input samples, then the spectrum.   PUBLIC DATA!!!  Don't resize!!!
+            // The spectrum is packed [ririri], the way pffft orders it:
+            // [ r0, rN, r1, i1, r2, i2, ... ], where bin 0 (DC) and bin
+            // Num/2 (Nyquist) are real only, so Nyquist takes DC's
+            // imaginary slot.  FftSpectrum reads and edits it by bin.
+        SData mReal;
+
+            // Building blocks, also for engines that aren't FftBases
+            // (FftPffftMulti).
+        static SDatum saturate(int32_t val) {
+            return SDatum(std::max< int32_t >(INT16_MIN, std::min< int32_t >(val, INT16_MAX)));
+        }
+
+            // Rounds to nearest.  Written so loops over it vectorize.
+        static SDatum saturate(float val) {
+            val = std::max(float(INT16_MIN), std::min(val, float(INT16_MAX)));
+            return SDatum(int32_t(val + (val < 0.0f ? -0.5f : 0.5f)));
+        }
+
+            // dst = src * scale, saturated.
+        static void saturate(SDatum* dst, float const* src, size_t num, float scale) {
+            for(size_t ind = 0; ind < num; ++ind) {
+                dst[ ind ] = saturate(src[ ind ] * scale);
+            }
+        }
+
+            // Integer Hanning coefficients for `num` samples, [0,2^15],
+            // into `hco`, unless it's already that size (reserve it to
+            // keep size changes from allocating).
+        static void genHanningCoefficients(SData& hco, size_t num) {
+            if(hco.size() != num) {
+                hco.resize(num);
+
+                    // Same curve as calcHanningMod, but integer only.
+                for(size_t ind = 0; ind < num; ++ind) {
+                    uint32_t angle = uint32_t((uint64_t(ind) << 32) / (num - 1));
+                    int64_t mod = ((1 << 30) - fpmath::cosBam(angle)) >> 1;  // [0,1] Q30
+                    hco[ ind ] = (0x7fff * mod) >> 30;                        // [0,2^15]
+                }
+            }
+        }
+
+        static void applyHanningWindow(SDatum* data, SDatum const* hco, size_t num, SDatum bias) {
+            for(size_t ind = 0; ind < num; ++ind) {
+                int32_t mod = hco[ ind ];
+                int32_t val = data[ ind ];
+
+                data[ ind ] = (((val - bias) * mod) >> 15);
+            }
+        }
         
     protected:
         constexpr const static char* TAG = "pnifft";
@@ -105,9 +136,14 @@ class Fft {
                 dst[ num * dstStride + dstOffset ] = src[ num * srcStride + srcOffset];
             }
         }
-    
-        constexpr float getHanningMult() const {
-            return 1.0f / (float)(Num - 1);
+
+            // mReal = src * scale, saturated.
+        void saturateFrom(float const* src, float scale) {
+            saturate(&mReal[ 0 ], src, getNum(), scale);
+        }
+
+        float getHanningMult() const {
+            return 1.0f / (float)(getNum() - 1);
         }
 
         float getPi() const {
@@ -115,32 +151,40 @@ class Fft {
             return ret;
         }
         
-        float calcHanningMod(size_t num) const {
-            static const float mult = getHanningMult();
+        float calcHanningMod(size_t num, float mult) const {
             static const float PiVal = getPi();
             return 0.5f * (1.0f - cosf(2.0f * PiVal * num * mult));
         }
         
         SData mHco; // Will hold Hanning coefficients if needed.
 
+            // Again if the size changed (reserve mHco to keep that from
+            // allocating).
         void genHanningCoefficients() {
-            if(mHco.empty()) {
-                mHco.resize(Num);
-
-                for(auto num = 0; num < Num; ++num) {
-                    float mod = calcHanningMod(num);                          // [0,1]
-                    mHco[ num ] = (float) 0x7fff * mod;                       // [0,2^15]
-                }
-            }
+            genHanningCoefficients(mHco, getNum());
         }
 
     public:
 
-        virtual ~Fft() {}
+        virtual ~FftBase() {}
+
+            // Samples per transform.
+        size_t getNum() const { return mReal.size(); }
 
-            // Output format will be [ririri]
+            // Output format will be [ririri], packed as above.
         virtual void doFft() = 0;
 
+            // Spectrum in mReal, packed as doFft leaves it, back to
+            // samples.  doFft then doIfft gives back the input, to within
+            // the rounding of the spectrum to SDatum.
+        virtual void doIfft() = 0;
+
+            // How many bits doFft scales the spectrum down by, i.e., bins
+            // are the plain DFT >> this (doIfft undoes it).  0 for
+            // pffft, whose float math doesn't need the headroom, Pow for
+            // the integer engines so their output can't saturate.
+        virtual size_t getForwardShift() const = 0;
+
             // From: https://www.edn.com/electronics-news/4383713/Windowing-Functions-Improve-FFT-Results-Part-I
             //  and: https://stackoverflow.com/questions/3555318/implement-hann-window
             // w(n)Hanning = 0.5 – 0.5cos(2pn/N)
@@ -150,19 +194,14 @@ class Fft {
             // The `bias` value will be subracted from all source values.
         void doHanningWindow(SDatum bias = 0) {
             genHanningCoefficients();
-
-            for(auto num = 0; num < Num; ++num) {
-                int32_t mod = mHco[ num ];
-                int32_t val = mReal[ num ];
-                int32_t bias32 = bias;
-
-                mReal[ num ] = (((val - bias) * mod) >> 15);
-            }
+            applyHanningWindow(&mReal[ 0 ], &mHco[ 0 ], getNum(), bias);
         }
 
         void doHanningWindowFloat(float bias) {
-            for(auto num = 0; num < Num; ++num) {
-                float mod = calcHanningMod(num);
+            float mult = getHanningMult();
+            size_t end = getNum();
+            for(size_t num = 0; num < end; ++num) {
+                float mod = calcHanningMod(num, mult);
                 float val = mReal[ num ];
 
                 mReal[ num ] = ((val - bias) * mod);
@@ -176,18 +215,21 @@ class Fft {
             for(auto val : mReal) {
                 accum += val;
             }
-            accum /= mReal.size();
+            accum /= int32_t(mReal.size());
             return accum;
         }
 
             // After `doFtt`, convert real and imaginary bits to real-only.
             //  Only first half of array ( < index Num / 2) contain real data,
-            //  the rest is set to zero.
+            //  the rest is set to zero.  Nyquist is dropped.
             // Input format is [ririri]
             // Output format is [rrr000]
         template< bool doSqrRoot = true >
         void convToReal() {
-            for(size_t num = 0; num < Num; num += 2) {
+            size_t end = getNum();
+            int32_t dc = mReal[ 0 ];
+            mReal[ 0 ] = doSqrRoot ? saturate(std::abs(dc)) : SDatum(dc * dc);
+            for(size_t num = 2; num < end; num += 2) {
                 // do math using 32 bits so we don't overflow
                 int32_t rval = (int32_t) mReal[ num ];
                 int32_t ival = (int32_t) mReal[ num + 1 ];
@@ -199,7 +241,7 @@ class Fft {
                     // mReal is [-0x7fff, 0x7fff]
                 mReal[ num / 2 ] = out;
             }
-            for(size_t num = NumOut; num < Num; ++num) {
+            for(size_t num = end / 2; num < end; ++num) {
                 mReal[ num ] = 0;
             }
         }
@@ -221,6 +263,154 @@ class Fft {
         }
 };
 
+    // Compile time sized: 2^Pow samples.
+template< size_t Pow >
+class Fft : public FftBase {
+    public:
+
+        static const size_t Num = 1 << Pow;
+        static const size_t NumOut = Num >> 1;
+        static const size_t Num2 = Num << 1;
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Complex view of a packed spectrum (see Fft::mReal), for editing
+    // it in place between doFft and doIfft, e.g., noise gating:
+    //    fft.doFft();
+    //    FftSpectrum spec(fft);
+    //    spec.gate(40);
+    //    fft.doIfft();
+    // Bins are 0 (DC) to getNumBins() - 1 (Nyquist), both of which are
+    // real only: their imaginary parts read 0 and writes drop them.
+    // Writes saturate.  Phases are binary angles (BAM, see pnifpmath.h),
+    // uint32_t where 1 << 32 is one turn.
+class FftSpectrum {
+    public:
+        using Datum = FftSDatum;
+        static const int32_t GainOne = 1 << 15;     // Q15 gains, can be > 1
+
+        FftSpectrum(Datum* data, size_t num) : mData(data), mNum(num) {}
+
+        FftSpectrum(FftBase& fft) : mData(&fft.mReal[ 0 ]), mNum(fft.getNum()) {}
+
+        size_t getNumBins() const { return mNum / 2 + 1; }
+
+        int32_t getRe(size_t bin) const {
+            return mData[ getReSlot(bin) ];
+        }
+
+        int32_t getIm(size_t bin) const {
+            return isRealOnly(bin) ? 0 : mData[ bin * 2 + 1 ];
+        }
+
+        void set(size_t bin, int32_t re, int32_t im) {
+            mData[ getReSlot(bin) ] = FftBase::saturate(re);
+            if( ! isRealOnly(bin)) {
+                mData[ bin * 2 + 1 ] = FftBase::saturate(im);
+            }
+        }
+
+        uint32_t getPower(size_t bin) const {
+            int32_t re = getRe(bin);
+            int32_t im = getIm(bin);
+            return uint32_t(re * re) + uint32_t(im * im);
+        }
+
+        uint32_t getMag(size_t bin) const {
+            return fpmath::isqrt(getPower(bin));
+        }
+
+        uint32_t getPhase(size_t bin) const {
+            return uint32_t(fpmath::atan2Bam(getIm(bin), getRe(bin)));
+        }
+
+            // DC and Nyquist only keep the real part, so their phase is
+            // effectively 0 or half a turn.
+        void setPolar(size_t bin, uint32_t mag, uint32_t phase) {
+            int64_t re = int64_t(mag) * fpmath::cosBam(phase);
+            int64_t im = int64_t(mag) * fpmath::sinBam(phase);
+            set(bin, roundQ30(re), roundQ30(im));
+        }
+
+        void scale(size_t bin, int32_t gain) {
+            set(bin, int32_t((int64_t(getRe(bin)) * gain + (1 << 14)) >> 15),
+                    int32_t((int64_t(getIm(bin)) * gain + (1 << 14)) >> 15));
+        }
+
+            // Adds `phase` to the bin's phase.
+        void rotate(size_t bin, uint32_t phase) {
+            int64_t cosVal = fpmath::cosBam(phase);
+            int64_t sinVal = fpmath::sinBam(phase);
+            int64_t re = getRe(bin);
+            int64_t im = getIm(bin);
+            set(bin, roundQ30(re * cosVal - im * sinVal), roundQ30(re * sinVal + im * cosVal));
+        }
+
+            // `gains` has getNumBins() Q15 entries, e.g., an EQ curve.
+        void scaleAll(int32_t const* gains) {
+            for(size_t bin = 0; bin < getNumBins(); ++bin) {
+                scale(bin, gains[ bin ]);
+            }
+        }
+
+            // Zeroes bins with a magnitude below `threshold`, returns how
+            // many.  No square roots.
+        size_t gate(uint32_t threshold) {
+            uint64_t power = uint64_t(threshold) * threshold;
+            size_t num = 0;
+            for(size_t bin = 0; bin < getNumBins(); ++bin) {
+                if(getPower(bin) < power) {
+                    set(bin, 0, 0);
+                    ++num;
+                }
+            }
+            return num;
+        }
+
+            // Zeroes [beg, end), e.g., a band stop.
+        void zero(size_t beg, size_t end) {
+            for(size_t bin = beg; bin < end && bin < getNumBins(); ++bin) {
+                set(bin, 0, 0);
+            }
+        }
+
+            // Moves every bin up (num > 0) or down by `num` bins, zeroing
+            // the ones left behind: a crude pitch shift by num * sample
+            // rate / Num Hz.  DC stays put.
+        void shift(int num) {
+            int end = int(getNumBins());
+            if(num > 0) {
+                for(int bin = end - 1; bin > 0; --bin) {
+                    copyBin(bin, bin - num);
+                }
+            } else if(num < 0) {
+                for(int bin = 1; bin < end; ++bin) {
+                    copyBin(bin, bin - num);
+                }
+            }
+        }
+
+    private:
+        bool isRealOnly(size_t bin) const { return bin == 0 || bin == mNum / 2; }
+        size_t getReSlot(size_t bin) const { return bin == mNum / 2 ? 1 : bin * 2; }
+
+        void copyBin(int dst, int src) {
+            if(src > 0 && src < int(getNumBins())) {
+                set(dst, getRe(src), getIm(src));
+            } else {
+                set(dst, 0, 0);
+            }
+        }
+
+        static int32_t roundQ30(int64_t val) {
+            return int32_t((val + (1 << 29)) >> 30);
+        }
+
+        Datum* mData;
+        size_t mNum;
+};
+
 ////////////////////////////////////////////////////////////////////
 
 template< size_t Pow >
@@ -264,11 +454,269 @@ class FftPffft : public Fft< Pow > {
 
             // Does fwd fft.
             // mReal contains the input and will contain the output.
-            // Output will be [ririri]
+            // Output will be [ririri], unscaled (and saturated), so
+            // keep input levels down to about 0x7fff / sqrt(Num).
         virtual void doFft() {
+            PNI_TRACE_SCOPE("fft.pffft");
             this->doCopy(mReal, mIn);
             pffft_transform_ordered(mSetup, &mIn[ 0 ], &mOut[ 0 ], 0, PFFFT_FORWARD);
-            this->doCopy(mOut, mReal);
+            this->saturateFrom(&mOut[ 0 ], 1.0f);
+        }
+
+            // pffft's backward transform is unscaled too, so this
+            // divides by Num.
+        virtual void doIfft() {
+            PNI_TRACE_SCOPE("fft.pffft.inv");
+            this->doCopy(mReal, mOut);
+            pffft_transform_ordered(mSetup, &mOut[ 0 ], &mIn[ 0 ], 0, PFFFT_BACKWARD);
+            this->saturateFrom(&mIn[ 0 ], 1.0f / Num);
+        }
+
+        virtual size_t getForwardShift() const { return 0; }
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // FftPffft with the size picked at run time, e.g., from a settings
+    // menu, rather than an Fft< Pow > (code and tables) per size.  Same
+    // scaling and layout.  Sizes are whatever pffft takes: multiples of
+    // 32 (2 * pffft_simd_size()^2) made of 2s, 3s and 5s.
+    //
+    // Everything, setup included, is allocated once, at construction,
+    // for up to `maxNum` samples, so plan() to any size that fits
+    // doesn't allocate.  pffft's work area is one of those buffers too,
+    // rather than Num floats of stack per transform.
+class FftPffftRuntime : public FftBase {
+    public:
+            // `maxNum` defaults to `num`.  If `num` isn't supported,
+            // nothing's planned (getNum() is 0) and transforms do nothing.
+        FftPffftRuntime(size_t num, size_t maxNum = 0);
+        virtual ~FftPffftRuntime();
+
+        FftPffftRuntime(FftPffftRuntime const& rhs) = delete;
+        FftPffftRuntime& operator = (FftPffftRuntime const& rhs) = delete;
+
+            // Switches to `num` samples.  False (and logged), keeping the
+            // current plan, if `num` isn't supported or is more than
+            // getMaxNum().  mReal's contents are garbage after a change.
+        bool plan(size_t num);
+
+        static bool isSupported(size_t num);
+
+        size_t getMaxNum() const { return mMaxNum; }
+        size_t getNumOut() const { return getNum() / 2; }
+
+        virtual void doFft();
+        virtual void doIfft();
+        virtual size_t getForwardShift() const { return 0; }
+
+    private:
+        size_t mMaxNum;
+        size_t mSetupSize;
+        void* mBuf = nullptr;               // pffft_aligned_malloc, all of the below
+        float* mIn = nullptr;
+        float* mOut = nullptr;
+        float* mWork = nullptr;
+        void* mSetupMem = nullptr;
+        PFFFT_Setup* mSetup = nullptr;      // In mSetupMem, nothing to destroy
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Several channels (stereo, mic arrays) per call, e.g.:
+    //    FftPffftMulti< 9 > fft(2);
+    //    // Fill fft.getChannel(0) and fft.getChannel(1).
+    //    fft.doHanningWindow();
+    //    fft.doFft();
+    //    FftSpectrum left = fft.getSpectrum(0);
+    // rather than an FftPffft per channel: one set of setups (pffft
+    // twiddles) and one work area, and channels laid out back to back,
+    // transformed one (or one pair) at a time, so each transform's data
+    // is contiguous and the float buffers stay in cache between them.
+    // Scaling and layout per channel are FftPffft's.
+    //
+    // Separate (the default) does each channel with pffft's real FFT,
+    // bit for bit FftPffft's results.  Paired packs channels 2c and
+    // 2c + 1 into the real and imaginary parts of one complex FFT and
+    // splits the result by symmetry (the two-for-one trick), within a
+    // count of Separate; an odd last channel takes the real FFT.  But
+    // pffft's real FFT already is a half size complex one plus that same
+    // split, so Paired only adds the packing: on the host it's ~20%
+    // slower (bench fft.multi.*).  Worth measuring on the target before
+    // picking it.
+template< size_t Pow >
+class FftPffftMulti {
+    public:
+        static const size_t Num = 1 << Pow;
+        static const size_t NumOut = Num >> 1;
+
+            // pffft_new_setup fails below its minimum real size.
+        static_assert(Pow >= 5, "FftPffftMulti needs at least 32 samples");
+
+        using SDatum = FftSDatum;
+        using SData = FftSData;
+
+        enum Mode {
+            Separate,
+            Paired
+        };
+
+            // Channel c's samples, then its spectrum, are at
+            // [ c * Num, (c + 1) * Num ).   PUBLIC DATA!!!  Don't resize!!!
+        SData mReal;
+
+        FftPffftMulti(size_t numChannels, Mode mode = Separate) :
+            mNumChannels(numChannels),
+            mMode(mode) {
+            mReal.resize(Num * numChannels, 0);
+            
+                // Paired needs room for a complex FFT: twice the floats.
+            size_t numFloats = mMode == Paired ? Num2 : Num;
+            mBuf = static_cast< float* >(pffft_aligned_malloc(3 * numFloats * sizeof(float)));
+            mIn = mBuf;
+            mOut = mIn + numFloats;
+            mWork = mOut + numFloats;
+
+            if(mMode == Paired && numChannels > 1) {
+                mComplexSetup = pffft_new_setup(Num, PFFFT_COMPLEX);
+            }
+            if(mMode == Separate || numChannels % 2) {
+                mRealSetup = pffft_new_setup(Num, PFFFT_REAL);
+            }
+        }
+
+        ~FftPffftMulti() {
+            if(mComplexSetup) {
+                pffft_destroy_setup(mComplexSetup);
+            }
+            if(mRealSetup) {
+                pffft_destroy_setup(mRealSetup);
+            }
+            pffft_aligned_free(mBuf);
+        }
+
+        FftPffftMulti(FftPffftMulti const& rhs) = delete;
+        FftPffftMulti& operator = (FftPffftMulti const& rhs) = delete;
+
+        size_t getNumChannels() const { return mNumChannels; }
+        Mode getMode() const { return mMode; }
+
+        SDatum* getChannel(size_t chan) { return &mReal[ chan * Num ]; }
+
+        FftSpectrum getSpectrum(size_t chan) { return FftSpectrum(getChannel(chan), Num); }
+
+            // Same window on every channel.  See FftBase::doHanningWindow.
+        void doHanningWindow(SDatum bias = 0) {
+            FftBase::genHanningCoefficients(mHco, Num);
+            for(size_t chan = 0; chan < mNumChannels; ++chan) {
+                FftBase::applyHanningWindow(getChannel(chan), &mHco[ 0 ], Num, bias);
+            }
+        }
+
+            // Every channel's samples to its spectrum, [ririri], unscaled
+            // like FftPffft.
+        void doFft() {
+            PNI_TRACE_SCOPE("fft.pffft.multi");
+            size_t chan = 0;
+            if(mComplexSetup) {
+                for(; chan + 1 < mNumChannels; chan += 2) {
+                    doPairFft(getChannel(chan), getChannel(chan + 1));
+                }
+            }
+            for(; chan < mNumChannels; ++chan) {
+                doRealFft(getChannel(chan));
+            }
+        }
+
+            // Every channel's spectrum back to samples, scaled by 1 / Num
+            // like FftPffft.
+        void doIfft() {
+            PNI_TRACE_SCOPE("fft.pffft.multi.inv");
+            size_t chan = 0;
+            if(mComplexSetup) {
+                for(; chan + 1 < mNumChannels; chan += 2) {
+                    doPairIfft(getChannel(chan), getChannel(chan + 1));
+                }
+            }
+            for(; chan < mNumChannels; ++chan) {
+                doRealIfft(getChannel(chan));
+            }
+        }
+
+    private:
+        static const size_t Num2 = Num << 1;
+
+        size_t mNumChannels;
+        Mode mMode;
+        PFFFT_Setup* mComplexSetup = nullptr;
+        PFFFT_Setup* mRealSetup = nullptr;
+        float* mBuf = nullptr;              // pffft_aligned_malloc, all of the below
+        float* mIn = nullptr;
+        float* mOut = nullptr;
+        float* mWork = nullptr;
+        SData mHco;
+
+        void doRealFft(SDatum* data) {
+            std::copy(data, data + Num, mIn);
+            pffft_transform_ordered(mRealSetup, mIn, mOut, mWork, PFFFT_FORWARD);
+            FftBase::saturate(data, mOut, Num, 1.0f);
+        }
+
+        void doRealIfft(SDatum* data) {
+            std::copy(data, data + Num, mOut);
+            pffft_transform_ordered(mRealSetup, mOut, mIn, mWork, PFFFT_BACKWARD);
+            FftBase::saturate(data, mIn, Num, 1.0f / Num);
+        }
+
+            // z = x + iy, Z = X + iY, and X and Y are conjugate symmetric,
+            // so X[k] = (Z[k] + Z*[N - k]) / 2, Y[k] = (Z[k] - Z*[N - k]) / 2i.
+        void doPairFft(SDatum* xdata, SDatum* ydata) {
+            for(size_t num = 0; num < Num; ++num) {
+                mIn[ num * 2 ] = xdata[ num ];
+                mIn[ num * 2 + 1 ] = ydata[ num ];
+            }
+            pffft_transform_ordered(mComplexSetup, mIn, mOut, mWork, PFFFT_FORWARD);
+
+            xdata[ 0 ] = FftBase::saturate(mOut[ 0 ]);
+            ydata[ 0 ] = FftBase::saturate(mOut[ 1 ]);
+            xdata[ 1 ] = FftBase::saturate(mOut[ Num ]);      // Nyquist
+            ydata[ 1 ] = FftBase::saturate(mOut[ Num + 1 ]);
+            for(size_t bin = 1; bin < NumOut; ++bin) {
+                float re = mOut[ bin * 2 ];
+                float im = mOut[ bin * 2 + 1 ];
+                float mirrorRe = mOut[ Num2 - bin * 2 ];
+                float mirrorIm = mOut[ Num2 - bin * 2 + 1 ];
+                xdata[ bin * 2 ] = FftBase::saturate(0.5f * (re + mirrorRe));
+                xdata[ bin * 2 + 1 ] = FftBase::saturate(0.5f * (im - mirrorIm));
+                ydata[ bin * 2 ] = FftBase::saturate(0.5f * (im + mirrorIm));
+                ydata[ bin * 2 + 1 ] = FftBase::saturate(0.5f * (mirrorRe - re));
+            }
+        }
+
+            // Z[k] = X[k] + iY[k] over all N bins, the upper half from the
+            // conjugates of the lower, then x and y are z's parts.
+        void doPairIfft(SDatum* xdata, SDatum* ydata) {
+            mOut[ 0 ] = xdata[ 0 ];
+            mOut[ 1 ] = ydata[ 0 ];
+            mOut[ Num ] = xdata[ 1 ];
+            mOut[ Num + 1 ] = ydata[ 1 ];
+            for(size_t bin = 1; bin < NumOut; ++bin) {
+                float xre = xdata[ bin * 2 ];
+                float xim = xdata[ bin * 2 + 1 ];
+                float yre = ydata[ bin * 2 ];
+                float yim = ydata[ bin * 2 + 1 ];
+                mOut[ bin * 2 ] = xre - yim;
+                mOut[ bin * 2 + 1 ] = xim + yre;
+                mOut[ Num2 - bin * 2 ] = xre + yim;
+                mOut[ Num2 - bin * 2 + 1 ] = yre - xim;
+            }
+            pffft_transform_ordered(mComplexSetup, mOut, mIn, mWork, PFFFT_BACKWARD);
+
+            const float scale = 1.0f / Num;
+            for(size_t num = 0; num < Num; ++num) {
+                xdata[ num ] = FftBase::saturate(mIn[ num * 2 ] * scale);
+                ydata[ num ] = FftBase::saturate(mIn[ num * 2 + 1 ] * scale);
+            }
         }
 };
 
@@ -302,25 +750,83 @@ class FftFix : public Fft< Pow > {
             // Currently no-op
         }
 
-            // Output format will be [ririri]
+            // Output format will be [ririri], scaled by 1 / Num (fix_fft
+            // halves each pass).
         virtual void doFft() {
+            PNI_TRACE_SCOPE("fft.fix");
             mImaginary.assign(Num, 0);
             
-                // int fix_fft(int fr[], int fi[], int m, int inverse);
-            fix_fft(&mReal[ 0 ], &mImaginary[ 0 ], Num, 0);
+                // int fix_fft(short fr[], short fi[], short m, short inverse);
+            fix_fft(&mReal[ 0 ], &mImaginary[ 0 ], Pow, 0);
+
+                // Full complex out, keep [0, NumOut] packed.  Backwards, so
+                // nothing's overwritten before it's read.
+            SDatum nyquist = mReal[ NumOut ];
+            for(size_t bin = NumOut - 1; bin > 0; --bin) {
+                mReal[ bin * 2 ] = mReal[ bin ];
+                mReal[ bin * 2 + 1 ] = mImaginary[ bin ];
+            }
+            mReal[ 1 ] = nyquist;
+        }
 
-            int realDstOff = mReal.size() - 2;
-            int realSrcOff = (mReal.size() >> 1) - 1;
-            this->doCopy(mReal, mReal, -2, -1, realDstOff, realSrcOff);
+            // fix_fft's inverse scales down only as much as it needs to
+            // to avoid overflow, and says by how much, so this scales back
+            // up (saturating).
+        virtual void doIfft() {
+            PNI_TRACE_SCOPE("fft.fix.inv");
+                // Unpack into the full conjugate symmetric spectrum.
+                // Forwards, so nothing's overwritten before it's read.
+            SDatum nyquist = mReal[ 1 ];
+            mImaginary[ 0 ] = 0;
+            mImaginary[ NumOut ] = 0;
+            for(size_t bin = 1; bin < NumOut; ++bin) {
+                mImaginary[ bin ] = mReal[ bin * 2 + 1 ];
+                mImaginary[ Num - bin ] = -mReal[ bin * 2 + 1 ];
+            }
+            for(size_t bin = 1; bin < NumOut; ++bin) {
+                mReal[ bin ] = mReal[ bin * 2 ];
+            }
+            mReal[ NumOut ] = nyquist;
+            for(size_t bin = 1; bin < NumOut; ++bin) {
+                mReal[ Num - bin ] = mReal[ bin ];
+            }
 
-            int imagDstOff = mReal.size() - 1;
-            int imagSrcOff = (mReal.size() >> 1) - 1;
-            this->doCopy(mReal, mImaginary, -2, -1, imagDstOff, imagSrcOff);
+            int scale = fix_fft(&mReal[ 0 ], &mImaginary[ 0 ], Pow, 1);
+            if(scale > 0) {
+                for(auto& val : mReal) {
+                    val = Base::saturate(int32_t(val) * (1 << scale));
+                }
+            }
         }
+
+        virtual size_t getForwardShift() const { return Pow; }
 };
 
 ////////////////////////////////////////////////////////////////////
-    // Inspired by: http://blog.podkalicki.com/attiny13-dance-lights-with-fft/
+    // A DFT straight from a twiddle table, for buffers too small for
+    // pffft (which needs Num >= 32) or when only a few bins are needed.
+    // Integer only, no allocation after construction.
+    // Originally inspired by: http://blog.podkalicki.com/attiny13-dance-lights-with-fft/
+    // 
+    // The input is real, so symmetry cuts the work to ~1/8 of a plain
+    // DFT: samples n, Num - n, Num/2 - n and Num/2 + n share one twiddle
+    // (up to sign), so they're folded into sums and differences first;
+    // and bins k and Num/2 - k use the same twiddles with the odd
+    // samples negated, so they come out of one pass.  Bin k, sample n
+    // uses table entry (k * n) % Num, stepped by k and masked.  Products
+    // are int32 and shifted down by Pow - 1 before accumulating, so the
+    // sums can't overflow.
+    // 
+    // Output is packed [ririri] (see Fft::mReal), scaled by 1 / Num like
+    // fix_fft, so it always fits: a full scale sine gives a magnitude of
+    // ~0x4000.  Within a count of a double precision DFT.  Nyquist comes
+    // with bin 0.
+    //
+    // doIfft folds the same way over bins instead of samples and undoes
+    // the 1 / Num.  A round trip only loses what rounding the spectrum
+    // to 16 bits lost: sqrt(Num / 6) counts rms.  All bins, whatever is
+    // selected.  Products are summed in int64 there, since the output
+    // isn't scaled down.
 template< size_t Pow >
 class FftTiny : public Fft< Pow > {
         using Base = Fft< Pow >;
@@ -333,71 +839,237 @@ class FftTiny : public Fft< Pow > {
         using typename Base::SDatum;
         using typename Base::SData;
 
-        SData mCoefficients;
+        static_assert(Pow >= 2 && Pow <= 15, "FftTiny needs 4 to 32768 samples");
 
     private:
-        static const SDatum Mult = 0x20;
-        static const SDatum Div = 5;
-    
+        static const size_t Mask = Num - 1;
+        static const size_t Half = Num >> 1;
+        static const size_t Quarter = Num >> 2;
+        static const size_t Shift = Pow - 1;
+        static const int32_t EdgeScale = 1 << (15 - Pow);     // Sample to accumulator units
+
+        int16_t mCos[ Num ];                // Q14, cos(2 pi n / Num)
+        int16_t mSin[ Num ];
+            // Folded samples, [ 1, Quarter ) used.
+        int32_t mEvenSum[ Quarter ];        // For even bins' real parts
+        int32_t mEvenDiff[ Quarter ];       // Odd bins' real parts
+        int32_t mOddSum[ Quarter ];         // Odd bins' imaginary parts
+        int32_t mOddDiff[ Quarter ];        // Even bins' imaginary parts
+        SDatum mBins[ Num ];                // doIfft's copy of the spectrum
+        std::bitset< NumOut > mSelected;
+
     public:
 
         using Base::mReal;
         
         FftTiny() {
             mReal.resize(Num);
-            mCoefficients.resize(Num);
-            initCoefficients();
+            initTables();
+            selectAllBins();
         }
 
         virtual ~FftTiny() {
             // Currently no-op
         }
 
+            // Only computes bins [beg, end), the rest come out 0.
+        void selectBinRange(size_t beg, size_t end) {
+            mSelected.reset();
+            for(size_t bin = beg; bin < end && bin < NumOut; ++bin) {
+                mSelected.set(bin);
+            }
+        }
+
+            // Only computes the listed bins, the rest come out 0.
+        void selectBins(size_t const* bins, size_t num) {
+            mSelected.reset();
+            for(size_t ind = 0; ind < num; ++ind) {
+                if(bins[ ind ] < NumOut) {
+                    mSelected.set(bins[ ind ]);
+                }
+            }
+        }
+
+        void selectAllBins() {
+            mSelected.set();
+        }
+
+        size_t getNumBins() const { return mSelected.count(); }
+
             // Output format is [ririri...]
-            // This algorithm does not deal with imaginary at all, so
-            //  doing a `convToReal` after will just rearrange components
-            //  in the right order.
         virtual void doFft() {
+            PNI_TRACE_SCOPE("fft.tiny");
             doTinyFft();
         }
 
-    private:
-        void initCoefficients() {
-
-                // From the original code:
-                // const int8_t W[N] = {10, 4, -5, -9, -4, 5};
-                // Note that it doesn't quite complete a cos, 
-                //  so below, we only go through 1.75 of a circle.
+        virtual void doIfft() {
+            PNI_TRACE_SCOPE("fft.tiny.inv");
+            doTinyIfft();
+        }
 
-            const float Pi = Base::getPi();
-            const float div = 1.75f * Pi / (Num - 1.0f);
+        virtual size_t getForwardShift() const { return Pow; }
 
+    private:
+        void initTables() {
+                // Integer only, like genHanningCoefficients.  1 is exact,
+                // -1 is clamped to -0x3fff so folded samples (18 bits,
+                // down to -0x20000) times these fit 32.
             for(size_t num = 0; num < Num; ++num) {
-                mCoefficients[ num ] = (float) Mult * cosf(num * div);
-                ESP_LOGI(Base::TAG, "coefficient %d = %d", num, mCoefficients[ num ]);
+                int32_t val = (fpmath::cosBam(uint32_t((uint64_t(num) << 32) >> Pow)) + (1 << 15)) >> 16;
+                mCos[ num ] = int16_t(std::max< int32_t >(-0x3fff, std::min< int32_t >(val, 0x4000)));
             }
+                // sin(a) = cos(a - pi / 2)
+            for(size_t num = 0; num < Num; ++num) {
+                mSin[ num ] = mCos[ (num - Quarter) & Mask ];
+            }
+        }
+
+        static SDatum toOut(int32_t acc) {
+            acc = (acc + (1 << 14)) >> 15;
+            return SDatum(std::max< int32_t >(-0x8000, std::min< int32_t >(acc, 0x7fff)));
         }
 
             // Output format is [ririri]
         void doTinyFft() {
-            SData re(Num, 0);
+            for(size_t num = 1; num < Quarter; ++num) {
+                int32_t loSum = int32_t(mReal[ num ]) + mReal[ Num - num ];
+                int32_t loDiff = int32_t(mReal[ num ]) - mReal[ Num - num ];
+                int32_t hiSum = int32_t(mReal[ Half - num ]) + mReal[ Half + num ];
+                int32_t hiDiff = int32_t(mReal[ Half - num ]) - mReal[ Half + num ];
+                mEvenSum[ num ] = loSum + hiSum;
+                mEvenDiff[ num ] = loSum - hiSum;
+                mOddSum[ num ] = loDiff + hiDiff;
+                mOddDiff[ num ] = loDiff - hiDiff;
+            }
+                // The samples with twiddles of 0 and +-1.
+            int32_t first = mReal[ 0 ];
+            int32_t mid = mReal[ Half ];
+            int32_t quarterSum = int32_t(mReal[ Quarter ]) + mReal[ Half + Quarter ];
+            int32_t quarterDiff = int32_t(mReal[ Quarter ]) - mReal[ Half + Quarter ];
+
+            std::fill(mReal.begin(), mReal.end(), 0);
+
+            for(size_t bin = 0; bin <= Quarter; ++bin) {
+                size_t pair = Half - bin;
+                bool doPair = bin && bin < Quarter && mSelected[ pair ];
+                if( ! mSelected[ bin ] && ! doPair) {
+                    continue;
+                }
+
+                    // Separate sums for odd and even samples, the pair
+                    // bin subtracts the odd ones.
+                int32_t const* evenVals = bin & 1 ? mEvenDiff : mEvenSum;
+                int32_t const* oddVals = bin & 1 ? mOddSum : mOddDiff;
+                int32_t reOdd = 0;
+                int32_t reEven = 0;
+                int32_t imOdd = 0;
+                int32_t imEven = 0;
+                size_t pos = 0;
+                for(size_t num = 1; num < Quarter; num += 2) {
+                    pos = (pos + bin) & Mask;
+                    reOdd += (evenVals[ num ] * mCos[ pos ]) >> Shift;
+                    imOdd += (oddVals[ num ] * mSin[ pos ]) >> Shift;
+                    if(num + 1 < Quarter) {
+                        pos = (pos + bin) & Mask;
+                        reEven += (evenVals[ num + 1 ] * mCos[ pos ]) >> Shift;
+                        imEven += (oddVals[ num + 1 ] * mSin[ pos ]) >> Shift;
+                    }
+                }
+
+                if(mSelected[ bin ]) {
+                    mReal[ bin * 2 ] = toOut(calcEdgeRe(bin, first, mid, quarterSum) + reEven + reOdd);
+                    if(bin) {
+                        mReal[ bin * 2 + 1 ] = toOut(calcEdgeIm(bin, quarterDiff) - imEven - imOdd);
+                    } else {
+                            // Nyquist, bin 0's real only pair.
+                        mReal[ 1 ] = toOut(calcEdgeRe(Half, first, mid, quarterSum) + reEven - reOdd);
+                    }
+                }
+                if(doPair) {
+                    mReal[ pair * 2 ] = toOut(calcEdgeRe(pair, first, mid, quarterSum) + reEven - reOdd);
+                    mReal[ pair * 2 + 1 ] = toOut(calcEdgeIm(pair, quarterDiff) + imEven - imOdd);
+                }
+            }
+        }
 
-            for (size_t k = 0; k <= (Num >> 1); ++k) {
-                SDatum a = 0;
-                for (size_t n = 0; n < Num; ++n) {
-                    re[k] += mCoefficients[a % Num] * mReal[n];
-                    a += k;
+            // Output format is [ririri], in place of the spectrum.
+        void doTinyIfft() {
+            std::copy(mReal.begin(), mReal.end(), mBins);
+            int32_t first = mBins[ 0 ];
+            int32_t mid = mBins[ 1 ];
+
+                // Samples 0, Num/4, Num/2 and 3Num/4 only see twiddles of
+                // 0 and +-1: plain sums of the bins by bin % 4.
+            int32_t reSums[ 4 ] = { 0, 0, 0, 0 };
+            int32_t imSums[ 4 ] = { 0, 0, 0, 0 };
+            for(size_t bin = 1; bin < Half; ++bin) {
+                reSums[ bin & 3 ] += mBins[ bin * 2 ];
+                imSums[ bin & 3 ] += mBins[ bin * 2 + 1 ];
+            }
+            int32_t reEvenSum = reSums[ 0 ] - reSums[ 2 ];
+            int32_t imOddDiff = imSums[ 1 ] - imSums[ 3 ];
+            mReal[ 0 ] = Base::saturate(calcBase(0, first, mid) + 2 * (reSums[ 0 ] + reSums[ 1 ] + reSums[ 2 ] + reSums[ 3 ]));
+            mReal[ Half ] = Base::saturate(calcBase(Half, first, mid) + 2 * (reSums[ 0 ] - reSums[ 1 ] + reSums[ 2 ] - reSums[ 3 ]));
+            mReal[ Quarter ] = Base::saturate(calcBase(Quarter, first, mid) + 2 * (reEvenSum - imOddDiff));
+            mReal[ Half + Quarter ] = Base::saturate(calcBase(Half + Quarter, first, mid) + 2 * (reEvenSum + imOddDiff));
+
+                // Samples n, Num - n, Num/2 - n and Num/2 + n share
+                // twiddles, up to the sign of the odd bins and the sines.
+            for(size_t num = 1; num < Quarter; ++num) {
+                int64_t reOdd = 0;
+                int64_t reEven = 0;
+                int64_t imOdd = 0;
+                int64_t imEven = 0;
+                size_t pos = 0;
+                for(size_t bin = 1; bin < Half; bin += 2) {
+                    pos = (pos + num) & Mask;
+                    reOdd += int32_t(mBins[ bin * 2 ]) * mCos[ pos ];
+                    imOdd += int32_t(mBins[ bin * 2 + 1 ]) * mSin[ pos ];
+                    if(bin + 1 < Half) {
+                        pos = (pos + num) & Mask;
+                        reEven += int32_t(mBins[ bin * 2 + 2 ]) * mCos[ pos ];
+                        imEven += int32_t(mBins[ bin * 2 + 3 ]) * mSin[ pos ];
+                    }
                 }
-                if (re[k] < 0)
-                    re[k] = -(re[k] + 1);
+
+                    // Num/2 is even, so all four get the same DC and Nyquist.
+                int32_t base = calcBase(num, first, mid);
+                mReal[ num ] = toSample(base, (reEven + reOdd) - (imEven + imOdd));
+                mReal[ Num - num ] = toSample(base, (reEven + reOdd) + (imEven + imOdd));
+                mReal[ Half - num ] = toSample(base, (reEven - reOdd) + (imEven - imOdd));
+                mReal[ Half + num ] = toSample(base, (reEven - reOdd) - (imEven - imOdd));
             }
+        }
+
+            // DC and Nyquist's part of sample `num`.
+        static int32_t calcBase(size_t num, int32_t first, int32_t mid) {
+            return first + (num & 1 ? -mid : mid);
+        }
+
+            // `acc` is the sum of the Q14 products for bins [1, Num/2),
+            // which count twice (for their mirror images).
+        static SDatum toSample(int32_t base, int64_t acc) {
+            int64_t val = (int64_t(base) * (1 << 13) + acc + (1 << 12)) >> 13;
+            return SDatum(std::max< int64_t >(INT16_MIN, std::min< int64_t >(val, INT16_MAX)));
+        }
+
+            // Samples 0, Num/2 (cos 1, +-1) and Num/4, 3Num/4 (cos 0, +-1,
+            // sin the other way round), exact, in accumulator units.
+        static int32_t calcEdgeRe(size_t bin, int32_t first, int32_t mid, int32_t quarterSum) {
+            int32_t val = first + (bin & 1 ? -mid : mid);
+            switch(bin & 3) {
+                case 0: val += quarterSum; break;
+                case 2: val -= quarterSum; break;
+            }
+            return val * EdgeScale;
+        }
 
-                // Switch from [rrr000] to [r0r0r0]
-                // Also scale back
-            for(size_t num = 0; num < NumOut; ++num) {
-                mReal[ num * 2 ] = re[ num ];
-                mReal[ num * 2 + 1 ] = 0;
+        static int32_t calcEdgeIm(size_t bin, int32_t quarterDiff) {
+            switch(bin & 3) {
+                case 1: return -quarterDiff * EdgeScale;
+                case 3: return quarterDiff * EdgeScale;
             }
+            return 0;
         }
 };
 
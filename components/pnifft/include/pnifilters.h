@@ -16,6 +16,7 @@
 
 #include "pnifixedpoint.h"
 #include "pnifft.h"
+#include "pnitrace.h"
 
 ////////////////////////////////////////////////////////////////////
 
@@ -56,6 +57,7 @@ class LowPassFilter : public Filter {
         }
 
         virtual void apply(FftSData& dst, FftSData const& src) {
+            PNI_TRACE_SCOPE("filter.lowpass");
             assert(dst.size() == src.size());
             assert(src.size() > 0);
 
@@ -93,6 +95,7 @@ class HighPassFilter : public Filter {
         }
 
         virtual void apply(FftSData& dst, FftSData const& src) {
+            PNI_TRACE_SCOPE("filter.highpass");
             assert(dst.size() == src.size());
             assert(src.size() > 0);
 
@@ -119,6 +122,7 @@ class BiasCalcFilter : public Filter {
     public:
 
         virtual void apply(FftSData& dst, FftSData const& src) {
+            PNI_TRACE_SCOPE("filter.biascalc");
             int32_t tBias = 0;
             for(auto val : src) {
                 tBias += val;
@@ -139,6 +143,7 @@ class BiasApplyFilter : public Filter {
         public:
     
             virtual void apply(FftSData& dst, FftSData const& src) {
+                PNI_TRACE_SCOPE("filter.biasapply");
                 assert(dst.size() == src.size());
                 assert(src.size() > 0);
 
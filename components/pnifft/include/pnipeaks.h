@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Spectral peaks: the strongest peaks in a magnitude spectrum, to
+//  sub-bin accuracy, tracked from frame to frame, and a harmonic
+//  product spectrum pitch estimate, e.g., for note colored LEDs:
+//    PeakTrackerT< 4 > tracker;
+//    ...
+//    fft.doHanningWindow(fft.calcBias());
+//    fft.doFft();
+//    fft.convToReal();           // Magnitudes in [0, Num/2)
+//    tracker.update(&fft.mReal[ 0 ], fft.NumOut);
+//    PeakTracker::Track const* track = tracker.getStrongestTrack();
+//    float bin = calcHpsPitch(&fft.mReal[ 0 ], fft.NumOut);
+//    float hz = binToHz(bin, sampleRate, fft.Num);
+//
+//  No allocation: PeakTracker works in arrays it's given, PeakTrackerT
+//  has them inline.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnipeaks_h
+#define pnipeaks_h
+
+#include <cstdint>
+#include <cstddef>
+
+#include "pnifft.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+inline float binToHz(float bin, float sampleRate, size_t fftNum) {
+    return bin * sampleRate / fftNum;
+}
+
+    // Fundamental, in (fractional) bins, of the magnitude spectrum `mags`,
+    // by harmonic product spectrum: the bin k in [minBin, numBins /
+    // numHarmonics) whose harmonics' magnitudes mags[ k ], mags[ 2k ]...
+    // have the largest product, refined like PeakTracker's peaks.  Finds
+    // fundamentals that are weaker than their overtones, or missing.
+    // `numHarmonics` is [1, 4] (products are 64 bit).  0 if every
+    // product is 0 or the fundamental's bin is below `minMag`.
+float calcHpsPitch(FftSDatum const* mags, size_t numBins, size_t numHarmonics = 3, size_t minBin = 1, FftSDatum minMag = 1);
+
+////////////////////////////////////////////////////////////////////
+
+    // Out here so it can default PeakTracker's constructor argument.
+struct PeakTrackerConfig {
+    FftSDatum mMinMag = 4;          // Smaller peaks are ignored
+    uint8_t mFloorShift = 6;        // So are those under the strongest >> this, 0 for none
+    size_t mMinBin = 1;             // Skips DC
+    size_t mSpan = 2;               // Bins each side a peak must top, 2 skips Hanning's sidelobes
+    float mMaxJump = 1.5f;          // Bins a track can move per frame
+    uint32_t mMaxMissed = 3;        // Frames a track outlives its peak
+    float mSmoothing = 0.0f;        // [0,1), of track bins, 0 follows the peak
+};
+
+class PeakTracker {
+    public:
+        using SDatum = FftSDatum;
+
+        struct Peak {
+            float mBin = 0.0f;          // Fractional bin
+            float mMag = 0.0f;          // Interpolated magnitude
+        };
+
+        struct Track {
+            uint32_t mId = 0;           // 0 for a free slot, otherwise unique
+            float mBin = 0.0f;
+            float mMag = 0.0f;
+            uint32_t mAge = 0;          // Frames matched
+            uint32_t mMissed = 0;       // Frames since last matched
+        };
+
+        using Config = PeakTrackerConfig;
+
+            // `peaks` and `tracks` must outlive the tracker.
+        PeakTracker(Peak* peaks, size_t maxPeaks, Track* tracks, size_t maxTracks, Config const& config = Config());
+
+        PeakTracker(PeakTracker const& rhs) = delete;
+        PeakTracker& operator = (PeakTracker const& rhs) = delete;
+
+        void setConfig(Config const& config) { mConfig = config; }
+        Config const& getConfig() const { return mConfig; }
+
+            // One pass over `mags`: the strongest local maxima (over
+            // mSpan bins each side), up to getMaxPeaks(), strongest
+            // first, each refined by fitting a parabola to the log
+            // magnitudes of it and its neighbors (accurate to a few
+            // hundredths of a bin with a Hanning window).  Returns how
+            // many.
+        size_t findPeaks(SDatum const* mags, size_t numBins);
+
+            // findPeaks, then matches the peaks to tracks, strongest
+            // first, each to the nearest track within mMaxJump.  Unmatched
+            // peaks start tracks (replacing the weakest unmatched one if
+            // full), unmatched tracks go after mMaxMissed frames.
+        void update(SDatum const* mags, size_t numBins);
+
+        size_t getMaxPeaks() const { return mMaxPeaks; }
+        size_t getNumPeaks() const { return mNumPeaks; }
+        Peak const& getPeak(size_t ind) const { return mPeaks[ ind ]; }
+
+            // Slots, some free (mId == 0).
+        size_t getMaxTracks() const { return mMaxTracks; }
+        Track const& getTrack(size_t ind) const { return mTracks[ ind ]; }
+        size_t getNumTracks() const;
+
+            // Strongest track matched this frame, nullptr if none.
+        Track const* getStrongestTrack() const;
+
+        void reset();
+
+    private:
+        void refinePeak(Peak& peak, SDatum const* mags) const;
+        Track* findTrack(float bin);
+        Track* findFreeTrack(float mag);
+
+        Peak* mPeaks;
+        size_t mMaxPeaks;
+        size_t mNumPeaks = 0;
+        Track* mTracks;
+        size_t mMaxTracks;
+        uint32_t mNextId = 1;
+        Config mConfig;
+};
+
+    // Arrays inline: a fixed sizeof(PeakTrackerT).
+template< size_t MaxPeaks, size_t MaxTracks = MaxPeaks >
+class PeakTrackerT : public PeakTracker {
+    public:
+        PeakTrackerT(Config const& config = Config()) :
+            PeakTracker(mPeakStorage, MaxPeaks, mTrackStorage, MaxTracks, config) {}
+
+    private:
+        Peak mPeakStorage[ MaxPeaks ];
+        Track mTrackStorage[ MaxTracks ];
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pnipeaks_h
@@ -12,8 +12,81 @@ namespace pni {
     
 ////////////////////////////////////////////////////////////////////
 
+FftPffftRuntime::FftPffftRuntime(size_t num, size_t maxNum) :
+    mMaxNum(std::max(num, maxNum)),
+    mSetupSize(pffft_setup_size(int(mMaxNum), PFFFT_REAL)) {
+    if( ! isSupported(mMaxNum)) {
+        ESP_LOGE(TAG, "FftPffftRuntime: unsupported max size %d", int(mMaxNum));
+        mMaxNum = 0;
+        return; // EARLY RETURN!!!
+    }
+
+        // One block: in, out and work (each a multiple of 32 floats, so
+        // they stay aligned), then the setup.
+    mBuf = pffft_aligned_malloc(3 * mMaxNum * sizeof(float) + mSetupSize);
+    mIn = static_cast< float* >(mBuf);
+    mOut = mIn + mMaxNum;
+    mWork = mOut + mMaxNum;
+    mSetupMem = mWork + mMaxNum;
+
+    mReal.reserve(mMaxNum);
+    mHco.reserve(mMaxNum);
+    plan(num);
+}
+
+FftPffftRuntime::~FftPffftRuntime() {
+    pffft_aligned_free(mBuf);
+}
+
+bool FftPffftRuntime::isSupported(size_t num) {
+    size_t simd = pffft_simd_size();
+    if(num == 0 || num % (2 * simd * simd) != 0) {
+        return false; // EARLY RETURN!!!
+    }
+    size_t rest = num / simd;
+    for(size_t factor : { 2, 3, 5 }) {
+        while(rest % factor == 0) {
+            rest /= factor;
+        }
+    }
+    return rest == 1;
+}
+
+bool FftPffftRuntime::plan(size_t num) {
+    if(num == getNum() && mSetup) {
+        return true; // EARLY RETURN!!!
+    }
+    if(num > mMaxNum || ! isSupported(num)) {
+        ESP_LOGE(TAG, "FftPffftRuntime: can't plan %d (max %d)", int(num), int(mMaxNum));
+        return false; // EARLY RETURN!!!
+    }
+
+    mSetup = pffft_init_setup(mSetupMem, mSetupSize, int(num), PFFFT_REAL);
+    mReal.assign(num, 0);               // Within the reserve, no allocation
+    ESP_LOGD(TAG, "FftPffftRuntime: planned %d", int(num));
+    return true;
+}
+
+void FftPffftRuntime::doFft() {
+    PNI_TRACE_SCOPE("fft.pffft");
+    if( ! mSetup) {
+        return; // EARLY RETURN!!!
+    }
+    std::copy(mReal.begin(), mReal.end(), mIn);
+    pffft_transform_ordered(mSetup, mIn, mOut, mWork, PFFFT_FORWARD);
+    saturateFrom(mOut, 1.0f);
+}
+
+void FftPffftRuntime::doIfft() {
+    PNI_TRACE_SCOPE("fft.pffft.inv");
+    if( ! mSetup) {
+        return; // EARLY RETURN!!!
+    }
+    std::copy(mReal.begin(), mReal.end(), mOut);
+    pffft_transform_ordered(mSetup, mOut, mIn, mWork, PFFFT_BACKWARD);
+    saturateFrom(mIn, 1.0f / getNum());
+}
 
 ////////////////////////////////////////////////////////////////////
 
 } // end namespace pni
-
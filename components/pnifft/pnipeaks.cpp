@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pnipeaks.h"
+
+#include <algorithm>
+#include <cmath>
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+    // Peak at `bin` + the returned offset, [-0.5, 0.5], of the parabola
+    // through the log magnitudes of `bin` and its neighbors, and its
+    // height there in `mag`.
+float interpolate(FftSDatum const* mags, size_t bin, float& mag) {
+    float left = logf(std::max< float >(mags[ bin - 1 ], 1.0f));
+    float mid = logf(std::max< float >(mags[ bin ], 1.0f));
+    float right = logf(std::max< float >(mags[ bin + 1 ], 1.0f));
+    float denom = left - 2.0f * mid + right;
+    float offset = 0.0f;
+    if(denom < 0.0f) {
+        offset = std::max(-0.5f, std::min(0.5f * (left - right) / denom, 0.5f));
+    }
+    mag = expf(mid - 0.25f * (left - right) * offset);
+    return offset;
+}
+
+    // Plateaus count once, at their left end.
+bool isPeak(FftSDatum const* mags, size_t numBins, size_t bin, size_t span) {
+    FftSDatum mag = mags[ bin ];
+    for(size_t dist = 1; dist <= span; ++dist) {
+        if((dist <= bin && mag <= mags[ bin - dist ]) || (bin + dist < numBins && mag < mags[ bin + dist ])) {
+            return false; // EARLY RETURN!!!
+        }
+    }
+    return true;
+}
+
+} // end anonymous namespace
+
+float calcHpsPitch(FftSDatum const* mags, size_t numBins, size_t numHarmonics, size_t minBin, FftSDatum minMag) {
+    PNI_TRACE_SCOPE("peaks.hps");
+    numHarmonics = std::max< size_t >(1, std::min< size_t >(numHarmonics, 4));
+    minBin = std::max< size_t >(minBin, 1);
+    size_t end = numBins / numHarmonics;
+
+    uint64_t best = 0;
+    size_t bestBin = 0;
+    for(size_t bin = minBin; bin < end; ++bin) {
+        uint64_t product = uint64_t(std::max< FftSDatum >(mags[ bin ], 0));
+        for(size_t harmonic = 2; harmonic <= numHarmonics; ++harmonic) {
+            product *= uint64_t(std::max< FftSDatum >(mags[ bin * harmonic ], 0));
+        }
+        if(product > best) {
+            best = product;
+            bestBin = bin;
+        }
+    }
+    if( ! best || mags[ bestBin ] < minMag) {
+        return 0.0f; // EARLY RETURN!!!
+    }
+
+        // The fundamental's own bin is the sharpest estimate when it's
+        // a local max; otherwise (weak or missing) the 2nd harmonic's
+        // scaled down.
+    float mag = 0.0f;
+    if(bestBin + 1 < numBins && mags[ bestBin ] >= mags[ bestBin - 1 ] && mags[ bestBin ] >= mags[ bestBin + 1 ]) {
+        return bestBin + interpolate(mags, bestBin, mag); // EARLY RETURN!!!
+    }
+    size_t second = bestBin * 2;
+    if(numHarmonics > 1 && second + 1 < numBins) {
+        return (second + interpolate(mags, second, mag)) * 0.5f; // EARLY RETURN!!!
+    }
+    return float(bestBin);
+}
+
+////////////////////////////////////////////////////////////////////
+
+PeakTracker::PeakTracker(Peak* peaks, size_t maxPeaks, Track* tracks, size_t maxTracks, Config const& config) :
+    mPeaks(peaks),
+    mMaxPeaks(maxPeaks),
+    mTracks(tracks),
+    mMaxTracks(maxTracks),
+    mConfig(config) {
+}
+
+size_t PeakTracker::findPeaks(SDatum const* mags, size_t numBins) {
+    PNI_TRACE_SCOPE("peaks.find");
+    mNumPeaks = 0;
+    if( ! mMaxPeaks || numBins < 3) {
+        return 0; // EARLY RETURN!!!
+    }
+
+        // Local maxima, kept sorted strongest first by insertion (few
+        // peaks, so cheaper than a heap), as raw bins and magnitudes.
+        // Most bins are out at the first comparison or two.
+    size_t beg = std::max< size_t >(mConfig.mMinBin, 1);
+    size_t span = std::max< size_t >(mConfig.mSpan, 1);
+    for(size_t bin = beg; bin + 1 < numBins; ++bin) {
+        SDatum mag = mags[ bin ];
+        if(mag < mConfig.mMinMag || ! isPeak(mags, numBins, bin, span)) {
+            continue;
+        }
+        if(mNumPeaks == mMaxPeaks && mag <= mPeaks[ mNumPeaks - 1 ].mMag) {
+            continue;
+        }
+        size_t pos = std::min(mNumPeaks, mMaxPeaks - 1);
+        for(; pos > 0 && mPeaks[ pos - 1 ].mMag < mag; --pos) {
+            mPeaks[ pos ] = mPeaks[ pos - 1 ];
+        }
+        mPeaks[ pos ].mBin = float(bin);
+        mPeaks[ pos ].mMag = mag;
+        mNumPeaks = std::min(mNumPeaks + 1, mMaxPeaks);
+    }
+
+        // Noise and leakage well under the strongest peak go, from the
+        // weak end.
+    if(mNumPeaks && mConfig.mFloorShift) {
+        float floor = float(SDatum(mPeaks[ 0 ].mMag) >> mConfig.mFloorShift);
+        while(mNumPeaks > 1 && mPeaks[ mNumPeaks - 1 ].mMag < floor) {
+            --mNumPeaks;
+        }
+    }
+
+        // Only the survivors pay for logs.
+    for(size_t ind = 0; ind < mNumPeaks; ++ind) {
+        refinePeak(mPeaks[ ind ], mags);
+    }
+    return mNumPeaks;
+}
+
+void PeakTracker::refinePeak(Peak& peak, SDatum const* mags) const {
+    size_t bin = size_t(peak.mBin);
+    float offset = interpolate(mags, bin, peak.mMag);
+    peak.mBin = bin + offset;
+}
+
+void PeakTracker::update(SDatum const* mags, size_t numBins) {
+    findPeaks(mags, numBins);
+
+    PNI_TRACE_SCOPE("peaks.track");
+        // Everything's unmatched until a peak says otherwise.
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        if(mTracks[ ind ].mId) {
+            ++mTracks[ ind ].mMissed;
+        }
+    }
+
+    for(size_t ind = 0; ind < mNumPeaks; ++ind) {
+        Peak const& peak = mPeaks[ ind ];
+        Track* track = findTrack(peak.mBin);
+        if(track) {
+            track->mBin = mConfig.mSmoothing * track->mBin + (1.0f - mConfig.mSmoothing) * peak.mBin;
+            track->mMag = peak.mMag;
+            ++track->mAge;
+            track->mMissed = 0;
+        } else if((track = findFreeTrack(peak.mMag))) {
+            track->mId = mNextId;
+            track->mBin = peak.mBin;
+            track->mMag = peak.mMag;
+            track->mAge = 1;
+            track->mMissed = 0;
+            if( ! ++mNextId) {
+                mNextId = 1;
+            }
+        }
+    }
+
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        if(mTracks[ ind ].mMissed > mConfig.mMaxMissed) {
+            mTracks[ ind ] = Track();
+        }
+    }
+}
+
+    // Nearest unmatched track within mMaxJump.
+PeakTracker::Track* PeakTracker::findTrack(float bin) {
+    Track* best = nullptr;
+    float bestDist = mConfig.mMaxJump;
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        Track& track = mTracks[ ind ];
+        float dist = fabsf(track.mBin - bin);
+        if(track.mId && track.mMissed && dist <= bestDist) {
+            best = &track;
+            bestDist = dist;
+        }
+    }
+    return best;
+}
+
+    // A free slot, else the weakest unmatched track if it's weaker
+    // than `mag`.
+PeakTracker::Track* PeakTracker::findFreeTrack(float mag) {
+    Track* weakest = nullptr;
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        Track& track = mTracks[ ind ];
+        if( ! track.mId) {
+            return &track; // EARLY RETURN!!!
+        }
+        if(track.mMissed && track.mMag < mag && ( ! weakest || track.mMag < weakest->mMag)) {
+            weakest = &track;
+        }
+    }
+    return weakest;
+}
+
+size_t PeakTracker::getNumTracks() const {
+    size_t num = 0;
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        num += mTracks[ ind ].mId ? 1 : 0;
+    }
+    return num;
+}
+
+PeakTracker::Track const* PeakTracker::getStrongestTrack() const {
+    Track const* best = nullptr;
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        Track const& track = mTracks[ ind ];
+        if(track.mId && ! track.mMissed && ( ! best || track.mMag > best->mMag)) {
+            best = &track;
+        }
+    }
+    return best;
+}
+
+void PeakTracker::reset() {
+    mNumPeaks = 0;
+    for(size_t ind = 0; ind < mMaxTracks; ++ind) {
+        mTracks[ ind ] = Track();
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
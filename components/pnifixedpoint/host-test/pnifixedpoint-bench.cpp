@@ -0,0 +1,259 @@
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "pnifixedpoint.h"
+#include "pnifixedpointarray.h"
+#include "pnifpmath.h"
+
+using namespace std;
+using namespace pni;
+
+    // Keeps the optimizer from throwing away benchmark results.
+template< typename Type >
+static void keep(Type const& val) {
+    asm volatile("" : : "g"(&val) : "memory");
+}
+
+template< typename Func >
+static double nsPerOp(size_t ops, Func func) {
+    auto beg = chrono::steady_clock::now();
+    func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration< double, nano >(end - beg).count() / ops;
+}
+
+template< typename Fp >
+static void benchFormat(char const* name) {
+    static const size_t Num = 1024;
+    static const size_t Reps = 2000;
+
+    vector< Fp > lhs(Num);
+    vector< Fp > rhs(Num);
+    vector< Fp > out(Num);
+    for(size_t num = 0; num < Num; ++num) {
+        lhs[ num ] = Fp((float)num / Num);
+        rhs[ num ] = Fp(0.25f + (float)num / (Num * 2));
+    }
+
+    double add = nsPerOp(Num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t num = 0; num < Num; ++num) {
+                out[ num ] = lhs[ num ] + rhs[ num ];
+            }
+            keep(out);
+        }
+    });
+
+    double mul = nsPerOp(Num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t num = 0; num < Num; ++num) {
+                out[ num ] = lhs[ num ] * rhs[ num ];
+            }
+            keep(out);
+        }
+    });
+
+    double div = nsPerOp(Num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t num = 0; num < Num; ++num) {
+                out[ num ] = lhs[ num ] / rhs[ num ];
+            }
+            keep(out);
+        }
+    });
+
+    cout << name << ": add " << add << " ns, mul " << mul << " ns, div " << div << " ns" << endl;
+}
+
+    // Array kernels vs. the equivalent loop over scalar operators.
+template< typename Fp >
+static void benchArrays(char const* name, size_t num) {
+    const size_t Reps = (1 << 22) / num;
+
+    vector< Fp > lhs(num);
+    vector< Fp > rhs(num);
+    vector< Fp > out(num);
+    for(size_t ind = 0; ind < num; ++ind) {
+        lhs[ ind ] = Fp(0.5f * ind / num);
+        rhs[ ind ] = Fp(0.25f + 0.5f * ind / num);
+    }
+    Fp tval(0.3f);
+    Fp lo(0.1f);
+    Fp hi(0.4f);
+
+    double mulScalar = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t ind = 0; ind < num; ++ind) {
+                out[ ind ] = lhs[ ind ] * rhs[ ind ];
+            }
+            keep(out);
+        }
+    });
+    double mulArray = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            fparray::mul(&out[ 0 ], &lhs[ 0 ], &rhs[ 0 ], num);
+            keep(out);
+        }
+    });
+
+    double lerpScalar = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t ind = 0; ind < num; ++ind) {
+                out[ ind ] = lhs[ ind ] + (rhs[ ind ] - lhs[ ind ]) * tval;
+            }
+            keep(out);
+        }
+    });
+    double lerpArray = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            fparray::lerp(&out[ 0 ], &lhs[ 0 ], &rhs[ 0 ], tval, num);
+            keep(out);
+        }
+    });
+
+    double clampScalar = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(size_t ind = 0; ind < num; ++ind) {
+                out[ ind ] = lhs[ ind ];
+                out[ ind ].clamp(lo, hi);
+            }
+            keep(out);
+        }
+    });
+    double clampArray = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            fparray::clamp(&out[ 0 ], &lhs[ 0 ], lo, hi, num);
+            keep(out);
+        }
+    });
+
+    Fp sum;
+    double dotScalar = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            sum = Fp();
+            for(size_t ind = 0; ind < num; ++ind) {
+                sum += lhs[ ind ] * rhs[ ind ];
+            }
+            keep(sum);
+        }
+    });
+    double dotArray = nsPerOp(num * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            sum = fparray::dot(&lhs[ 0 ], &rhs[ 0 ], num);
+            keep(sum);
+        }
+    });
+
+    cout << name << " n=" << num << " (ns/element, scalar -> array)"
+        << ": mul " << mulScalar << " -> " << mulArray
+        << ", lerp " << lerpScalar << " -> " << lerpArray
+        << ", clamp " << clampScalar << " -> " << clampArray
+        << ", dot " << dotScalar << " -> " << dotArray << endl;
+}
+
+    // Cycle counter where there is one: ccount on the ESP32, the TSC on x86
+    // (reference cycles, so off by the turbo ratio), otherwise 0.
+static uint64_t readCycles() {
+#if defined(__XTENSA__)
+    uint32_t val;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(val));
+    return val;
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct Cost {
+    double mNs;
+    double mCycles;     // 0 without a cycle counter
+};
+
+static ostream& operator << (ostream& out, Cost const& cost) {
+    out << cost.mNs << " ns";
+    if(cost.mCycles > 0.0) {
+        out << " / " << cost.mCycles << " cyc";
+    }
+    return out;
+}
+
+    // Per call over a sweep of inputs, so branchy paths see a mix.
+template< typename Type, typename Func >
+static Cost perCall(vector< Type > const& args, Func func) {
+    static const size_t Reps = 200;
+    Cost cost;
+    uint64_t beg = readCycles();
+    cost.mNs = nsPerOp(args.size() * Reps, [&]() {
+        for(size_t rep = 0; rep < Reps; ++rep) {
+            for(auto const& arg : args) {
+                auto val = func(arg);
+                keep(val);
+            }
+        }
+    });
+    cost.mCycles = double(readCycles() - beg) / (args.size() * Reps);
+    return cost;
+}
+
+static void benchMath() {
+    using Fp = FixedPoint< int32_t, 15, 16 >;
+    static const size_t Num = 4096;
+
+    vector< Fp > angles(Num);
+    vector< Fp > positive(Num);
+    vector< float > anglesf(Num);
+    vector< float > positivef(Num);
+    for(size_t num = 0; num < Num; ++num) {
+        anglesf[ num ] = -6.0f + 12.0f * num / Num;
+        positivef[ num ] = 0.01f + 1000.0f * num / Num;
+        angles[ num ] = Fp(anglesf[ num ]);
+        positive[ num ] = Fp(positivef[ num ]);
+    }
+
+    cout << "fpmath s15.16 (per call, fixed vs float libm)" << endl;
+    cout << "  sin       " << perCall(angles, [](Fp val) { return fpmath::sin(val); })
+        << " vs " << perCall(anglesf, [](float val) { return sinf(val); }) << endl;
+    cout << "  sin<12>   " << perCall(angles, [](Fp val) { return fpmath::sin< 12 >(val); }) << endl;
+    cout << "  sinCordic " << perCall(angles, [](Fp val) { return fpmath::sinCordic(val); }) << endl;
+    cout << "  atan2     " << perCall(angles, [](Fp val) { return fpmath::atan2(val, Fp(0.5f)); })
+        << " vs " << perCall(anglesf, [](float val) { return atan2f(val, 0.5f); }) << endl;
+    cout << "  atan2Cord " << perCall(angles, [](Fp val) { return fpmath::atan2Cordic(val, Fp(0.5f)); }) << endl;
+    cout << "  sqrt      " << perCall(positive, [](Fp val) { return fpmath::sqrt(val); })
+        << " vs " << perCall(positivef, [](float val) { return sqrtf(val); }) << endl;
+    cout << "  rsqrt     " << perCall(positive, [](Fp val) { return fpmath::rsqrt(val); })
+        << " vs " << perCall(positivef, [](float val) { return 1.0f / sqrtf(val); }) << endl;
+    cout << "  exp2      " << perCall(angles, [](Fp val) { return fpmath::exp2(val); })
+        << " vs " << perCall(anglesf, [](float val) { return exp2f(val); }) << endl;
+    cout << "  log2      " << perCall(positive, [](Fp val) { return fpmath::log2(val); })
+        << " vs " << perCall(positivef, [](float val) { return log2f(val); }) << endl;
+}
+
+int main() {
+    benchFormat< FixedPoint< int32_t, 7, 8 > >("s78 wrap    ");
+    benchFormat< FixedPointSat< int32_t, 7, 8 > >("s78 saturate");
+    benchFormat< FixedPoint< int16_t, 0, 15 > >("q15 wrap    ");
+    benchFormat< FixedPointSat< int16_t, 0, 15 > >("q15 saturate");
+    benchFormat< FixedPoint< int32_t, 0, 31 > >("q31 wrap    ");
+    benchFormat< FixedPointSat< int32_t, 0, 31 > >("q31 saturate");
+
+    for(size_t num : { 16, 64, 256, 1024, 4096 }) {
+        benchArrays< FixedPoint< int32_t, 7, 8 > >("s78", num);
+    }
+    for(size_t num : { 16, 64, 256, 1024, 4096 }) {
+        benchArrays< FixedPoint< int16_t, 0, 15 > >("q15", num);
+    }
+    for(size_t num : { 64, 1024 }) {
+        benchArrays< FixedPointSat< int16_t, 0, 15 > >("q15 saturate", num);
+    }
+
+    benchMath();
+    return 0;
+}
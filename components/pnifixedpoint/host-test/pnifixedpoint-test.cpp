@@ -1,9 +1,12 @@
 
 #include <iostream>
+#include <cmath>
 
 #include "microtest/microtest.h"
 
 #include "pnifixedpoint.h"
+#include "pnifixedpointarray.h"
+#include "pnifpmath.h"
 
 using namespace std;
 using namespace pni;
@@ -160,4 +163,339 @@ TEST(constants) {
     ASSERT_EQ(max78.getRaw(), 0x7fff);
 }
 
+using q15_t = FixedPoint< int16_t, 0, 15 >;
+using q31_t = FixedPoint< int32_t, 0, 31 >;
+using sq15_t = FixedPointSat< int16_t, 0, 15 >;
+using s78sat_t = FixedPointSat< int32_t, 7, 8 >;
+using u88sat_t = FixedPointSat< uint32_t, 8, 8 >;
+
+TEST(fullWidthFormats) {
+    // Q15 and Q31 were rejected before wide intermediates.
+    q15_t half(0.5f);
+    ASSERT_EQ(half.getRaw(), 0x4000);
+    ASSERT_EQ((half * half).getRaw(), 0x2000);
+    ASSERT_EQ((-half * half).getRaw(), -0x2000);
+    ASSERT_EQ((q15_t(0.25f) / half).getRaw(), 0x4000);
+    ASSERT_EQ(q15_t::maxVal().getRaw(), 0x7fff);
+    ASSERT_EQ(q15_t::minVal().getRaw(), -0x7fff);
+
+    q31_t qhalf(0.5);
+    ASSERT_EQ(qhalf.getRaw(), 1 << 30);
+    ASSERT_EQ((qhalf * qhalf).getRaw(), 1 << 29);
+    ASSERT_TRUE((q31_t(0.7) * q31_t(-0.3)).eq(-0.21, 0.000001));
+
+    // Intermediate of * and / no longer overflows storage.
+    using s1516_t = FixedPoint< int32_t, 15, 16 >;
+    s1516_t big(100.5);
+    ASSERT_EQ((big * s1516_t(200)).getFloat(), 20100.0f);
+    ASSERT_EQ((big / s1516_t(0.5)).getFloat(), 201.0f);
+}
+
+TEST(wrapPolicy) {
+    // Wrap is the default and truncates to the storage type.
+    q15_t big(0.75f);
+    q15_t sum = big + big;
+    ASSERT_TRUE(sum < q15_t(0.0f));
+
+    u88_t one(1u);
+    u88_t two(2u);
+    ASSERT_EQ((one - two).getRaw(), 0xffffff00);
+}
+
+TEST(saturatePolicy) {
+    sq15_t big(0.75f);
+    ASSERT_EQ((big + big).getRaw(), 0x7fff);
+    ASSERT_EQ((-big - big).getRaw(), -0x7fff);
+
+    sq15_t acc(0.5f);
+    acc += big;
+    ASSERT_TRUE(acc == sq15_t::maxVal());
+    acc -= big;
+    ASSERT_TRUE(acc.eq(0.25f, 0.0001f));
+
+    // Saturate to the format range, not the storage range.
+    s78sat_t hundred(100);
+    ASSERT_TRUE((hundred * hundred) == s78sat_t::maxVal());
+    ASSERT_TRUE((-hundred * hundred) == s78sat_t::minVal());
+    ASSERT_TRUE(s78sat_t(1000.0f) == s78sat_t::maxVal());
+    ASSERT_TRUE(s78sat_t(-1000) == s78sat_t::minVal());
+
+    // Divide by zero pins to the end of the range.
+    ASSERT_TRUE(hundred / s78sat_t(0) == s78sat_t::maxVal());
+    ASSERT_TRUE(-hundred / s78sat_t(0) == s78sat_t::minVal());
+    ASSERT_TRUE(hundred / s78sat_t(0.5f) == s78sat_t::maxVal());
+
+    // Unsigned saturates at zero rather than wrapping.
+    u88sat_t one(1u);
+    u88sat_t two(2u);
+    ASSERT_EQ((one - two).getRaw(), 0u);
+    ASSERT_EQ((-one).getRaw(), 0u);
+    ASSERT_TRUE((two * u88sat_t(200u)) == u88sat_t::maxVal());
+
+    // In range results match the wrapping policy bit for bit.
+    for(int num = -100; num < 100; num += 7) {
+        s78_t wa(num / 10.0f);
+        s78sat_t sa(num / 10.0f);
+        s78_t wb(3.3f);
+        s78sat_t sb(3.3f);
+        ASSERT_EQ((wa * wb).getRaw(), (sa * sb).getRaw());
+        ASSERT_EQ((wa / wb).getRaw(), (sa / sb).getRaw());
+        ASSERT_EQ((wa + wb).getRaw(), (sa + sb).getRaw());
+    }
+}
+
+    // Everything here is evaluated by the compiler.
+using q114_t = FixedPoint< int16_t, 1, 14 >;
+using s822_t = FixedPoint< int32_t, 8, 22 >;
+
+static constexpr s78_t ce15(1.5f);
+static constexpr q114_t ceHalf(0.5);
+static_assert(ce15.getRaw() == 0x180, "float literal construction");
+static_assert((ce15 * s78_t(2)).getRaw() == 0x300, "constexpr multiply");
+static_assert((ce15 / s78_t(3)).eq(0.5f), "constexpr divide");
+static_assert((ce15 - s78_t(2) + s78_t::oneVal()).getRaw() == 0x080, "constexpr add/sub");
+static_assert(-ce15 < ce15, "constexpr compare");
+static_assert(s78_t::fromRaw(0x80).eq(0.5f), "fromRaw");
+
+    // Mixed formats, result format computed at compile time.
+static_assert(std::is_same< decltype(ce15 * ceHalf), s822_t >::value, "product format");
+static_assert((ce15 * ceHalf).getRaw() == (3 << 20), "mixed multiply");
+static_assert(std::is_same< decltype(ce15 + ceHalf), FixedPoint< int32_t, 8, 14 > >::value, "sum format");
+static_assert((ce15 + ceHalf).eq(2.0f, 0.0001f), "mixed add");
+static_assert((ceHalf - ce15).eq(-1.0f, 0.0001f), "mixed subtract");
+    // Fraction is clipped when the sum of bits won't fit.
+static_assert(std::is_same< decltype(q31_t() * q31_t() * ce15), FixedPoint< int32_t, 7, 24 > >::value, "clipped format");
+
+    // Rescale
+static_assert(ceHalf.rescale< q15_t >().getRaw() == 0x4000, "rescale up");
+static_assert(ceHalf.rescale< s78_t >().getRaw() == 0x80, "rescale down");
+static_assert(ce15.rescale< sq15_t >() == sq15_t::maxVal(), "rescale saturates");
+
+    // A table built entirely at compile time.
+static constexpr q114_t coefficients[] = { q114_t(0.25f), q114_t(-0.5), q114_t(1.0f) };
+static_assert(coefficients[ 1 ].getRaw() == -0x2000, "table");
+
+TEST(constexprRuntime) {
+    // Same operations at runtime give the same answers.
+    s78_t val(1.5f);
+    q114_t half(0.5);
+    auto prod = val * half;
+    ASSERT_EQ(prod.getRaw(), (3 << 20));
+    ASSERT_TRUE(prod.eq(0.75));
+    ASSERT_EQ(prod.rescale< s78_t >().getRaw(), 0xc0);
+
+    s78_t neg(-3.25f);
+    ASSERT_TRUE((neg * half).eq(-1.625f, 0.0001f));
+    ASSERT_TRUE((neg + half).eq(-2.75f, 0.0001f));
+    using s74_t = FixedPoint< int16_t, 7, 4 >;
+    ASSERT_EQ(neg.rescale< s74_t >().getRaw(), -52);
+
+    for(auto const& coef : coefficients) {
+        ASSERT_TRUE(coef.rescale< s78_t >().eq(coef.getFloat(), 0.004f));
+    }
+}
+
+template< class Fp >
+static void checkArrayKernels(float range) {
+    static const size_t Num = 67;   // Not a multiple of the vector width.
+    Fp lhs[ Num ], rhs[ Num ], out[ Num ], acc[ Num ];
+    for(size_t num = 0; num < Num; ++num) {
+        lhs[ num ] = Fp(range * ((float)num / Num - 0.5f));
+        rhs[ num ] = Fp(range * (0.7f - (float)(num * 7 % Num) / Num));
+        acc[ num ] = Fp(range * 0.25f);
+    }
+    Fp tval(0.375f);
+    Fp lo(-range * 0.25f);
+    Fp hi(range * 0.125f);
+
+    fparray::add(out, lhs, rhs, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] + rhs[ num ]).getRaw());
+    }
+
+    fparray::sub(out, lhs, rhs, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] - rhs[ num ]).getRaw());
+    }
+
+    fparray::mul(out, lhs, rhs, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] * rhs[ num ]).getRaw());
+    }
+
+    fparray::scale(out, lhs, tval, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] * tval).getRaw());
+    }
+
+    fparray::lerp(out, lhs, rhs, tval, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] + (rhs[ num ] - lhs[ num ]) * tval).getRaw());
+    }
+
+    fparray::clamp(out, lhs, lo, hi, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        Fp tmp(lhs[ num ]);
+        ASSERT_EQ(out[ num ].getRaw(), tmp.clamp(lo, hi).getRaw());
+    }
+
+    Fp accRef[ Num ];
+    for(size_t num = 0; num < Num; ++num) accRef[ num ] = acc[ num ] + lhs[ num ] * rhs[ num ];
+    fparray::mac(acc, lhs, rhs, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(acc[ num ].getRaw(), accRef[ num ].getRaw());
+    }
+
+        // In place.
+    for(size_t num = 0; num < Num; ++num) out[ num ] = lhs[ num ];
+    fparray::scale(out, out, tval, Num);
+    for(size_t num = 0; num < Num; ++num) {
+        ASSERT_EQ(out[ num ].getRaw(), (lhs[ num ] * tval).getRaw());
+    }
+
+        // dot keeps full precision, compare with double.
+        // Keep the sum in range: products <= 1% of maxVal.
+    double maxVal = Fp::maxVal().getDouble();
+    double dotRef = 0.0;
+    for(size_t num = 0; num < Num; ++num) {
+        lhs[ num ] = Fp(maxVal * 0.1 * ((double)num / Num - 0.5));
+        rhs[ num ] = Fp(0.1 * (0.7 - (double)(num * 7 % Num) / Num));
+        dotRef += lhs[ num ].getDouble() * rhs[ num ].getDouble();
+    }
+    Fp dotOut = fparray::dot(lhs, rhs, Num);
+    ASSERT_TRUE(dotOut.eq(dotRef, 2.0 * Fp::epsVal().getDouble()));
+}
+
+TEST(arrayKernels) {
+    checkArrayKernels< s78_t >(100.0f);
+    checkArrayKernels< q15_t >(0.9f);
+    checkArrayKernels< FixedPoint< int16_t, 3, 12 > >(6.0f);
+}
+
+TEST(arrayKernelsSaturate) {
+    checkArrayKernels< s78sat_t >(100.0f);     // Lots of saturated products.
+    checkArrayKernels< sq15_t >(1.9f);         // Saturated sums too.
+
+    sq15_t big[ 2 ] = { sq15_t(0.75f), sq15_t(-0.75f) };
+    sq15_t out[ 2 ];
+    fparray::add(out, big, big, 2);
+    ASSERT_TRUE(out[ 0 ] == sq15_t::maxVal());
+    ASSERT_TRUE(out[ 1 ] == sq15_t::minVal());
+}
+
+////////////////////////////////////////////////////////////////////
+// fpmath, max error against libm over a sweep.
+
+using s1516_t = FixedPoint< int32_t, 15, 16 >;
+using s427_t = FixedPoint< int32_t, 4, 27 >;
+
+template< typename Func, typename Ref >
+static double maxError(double beg, double end, size_t num, Func func, Ref ref) {
+    double err = 0.0;
+    for(size_t ind = 0; ind <= num; ++ind) {
+        double val = beg + (end - beg) * ind / num;
+        double diff = std::fabs(func(val) - ref(val));
+        err = diff > err ? diff : err;
+    }
+    return err;
+}
+
+TEST(fpmathSinCos) {
+    const double Pi = 3.14159265358979323846;
+    double sinErr = maxError(-2.0 * Pi, 2.0 * Pi, 10000, [](double val) { return fpmath::sin(s427_t(val)).getDouble(); }, [](double val) { return std::sin(val); });
+    double cosErr = maxError(-2.0 * Pi, 2.0 * Pi, 10000, [](double val) { return fpmath::cos(s427_t(val)).getDouble(); }, [](double val) { return std::cos(val); });
+    double sinErr12 = maxError(-Pi, Pi, 10000, [](double val) { return fpmath::sin< 12 >(s427_t(val)).getDouble(); }, [](double val) { return std::sin(val); });
+    double cordicErr = maxError(-2.0 * Pi, 2.0 * Pi, 10000, [](double val) { return fpmath::sinCordic(s427_t(val)).getDouble(); }, [](double val) { return std::sin(val); });
+    double cordicErr24 = maxError(-Pi, Pi, 10000, [](double val) { return fpmath::cosCordic< 24 >(s427_t(val)).getDouble(); }, [](double val) { return std::cos(val); });
+    std::cout << "sin err " << sinErr << ", cos err " << cosErr << ", sin<12> err " << sinErr12
+        << ", cordic err " << cordicErr << ", cordic<24> err " << cordicErr24 << std::endl;
+    ASSERT_TRUE(sinErr < 2e-5);
+    ASSERT_TRUE(cosErr < 2e-5);
+    ASSERT_TRUE(sinErr12 < 1e-7);
+    ASSERT_TRUE(cordicErr < 5e-5);
+    ASSERT_TRUE(cordicErr24 < 2e-7);
+
+        // Q15 can't hold 1.0, results saturate rather than wrap.
+    ASSERT_TRUE(fpmath::sin(q15_t(0.0f)) == q15_t());
+    ASSERT_EQ(fpmath::sin< 8 >(s78_t(1.5707963f)).getRaw(), 256);
+    ASSERT_EQ(fpmath::cos(FixedPoint< int16_t, 3, 12 >(0.0f)).getRaw(), 4096);
+
+        // Binary angles wrap for free.
+    ASSERT_EQ(fpmath::sinBam(0), 0);
+    ASSERT_EQ(fpmath::sinBam(0x40000000), 1 << 30);
+    ASSERT_EQ(fpmath::sinBam(0xc0000000), -(1 << 30));
+    ASSERT_EQ(fpmath::cosBam(0x80000000), -(1 << 30));
+}
+
+TEST(fpmathAtan2) {
+    const double Pi = 3.14159265358979323846;
+    double tabErr = 0.0;
+    double cordicErr = 0.0;
+    for(size_t ind = 0; ind < 3600; ++ind) {
+        double ang = -Pi + 2.0 * Pi * (ind + 0.5) / 3600;
+        for(double mag : { 0.001, 0.5, 100.0 }) {
+            s1516_t yval(mag * std::sin(ang));
+            s1516_t xval(mag * std::cos(ang));
+            double ref = std::atan2(yval.getDouble(), xval.getDouble());
+            tabErr = std::fmax(tabErr, std::fabs(fpmath::atan2(yval, xval).getDouble() - ref));
+            cordicErr = std::fmax(cordicErr, std::fabs(fpmath::atan2Cordic(yval, xval).getDouble() - ref));
+        }
+    }
+    std::cout << "atan2 err " << tabErr << ", cordic err " << cordicErr << std::endl;
+    ASSERT_TRUE(tabErr < 5e-5);
+    ASSERT_TRUE(cordicErr < 1e-4);
+
+        // Axes, including +pi for the negative x axis.
+    ASSERT_TRUE(fpmath::atan2(s1516_t(0.0f), s1516_t(0.0f)) == s1516_t());
+    ASSERT_TRUE(fpmath::atan2(s1516_t(0.0f), s1516_t(-1.0f)).eq(Pi, 1e-4));
+    ASSERT_TRUE(fpmath::atan2Cordic(s1516_t(0.0f), s1516_t(-1.0f)).eq(Pi, 1e-4));
+    ASSERT_TRUE(fpmath::atan2(s1516_t(-1.0f), s1516_t(0.0f)).eq(-Pi / 2, 1e-4));
+    ASSERT_TRUE(fpmath::atan2Cordic(s1516_t(1.0f), s1516_t(0.0f)).eq(Pi / 2, 1e-4));
+}
+
+TEST(fpmathSqrt) {
+    for(uint64_t val : { 0ull, 1ull, 2ull, 3ull, 4ull, 15ull, 16ull, 17ull, 1000000ull, 0xfffffffeull,
+            0xffffffffull, 0x100000000ull, 0x3fffffffffffffffull, 0xfffffffe00000001ull, 0xffffffffffffffffull }) {
+        uint64_t root = fpmath::isqrt(val);
+        ASSERT_TRUE(root * root <= val);
+        ASSERT_TRUE(root == 0xffffffff || (root + 1) * (root + 1) > val);
+    }
+    for(uint64_t val = 1; val < (1ull << 62); val = val * 3 + 1) {
+        uint64_t root = fpmath::isqrt(val);
+        ASSERT_TRUE(root * root <= val && (root + 1) * (root + 1) > val);
+    }
+
+    double sqrtErr = maxError(0.0, 30000.0, 10000, [](double val) { return fpmath::sqrt(s1516_t(val)).getDouble(); }, [](double val) { return std::sqrt(val); });
+    double rsqrtErr = maxError(0.01, 1000.0, 10000, [](double val) { return fpmath::rsqrt(s1516_t(val)).getDouble(); }, [](double val) { return 1.0 / std::sqrt(s1516_t(val).getDouble()); });
+    std::cout << "sqrt err " << sqrtErr << ", rsqrt err " << rsqrtErr << std::endl;
+    ASSERT_TRUE(sqrtErr < 2.0 * s1516_t::epsVal().getDouble());
+    ASSERT_TRUE(rsqrtErr < 2.0 * s1516_t::epsVal().getDouble());
+
+    ASSERT_TRUE(fpmath::sqrt(s78_t(-4.0f)) == s78_t());
+    ASSERT_TRUE(fpmath::sqrt(s78_t(16.0f)) == s78_t(4.0f));
+    ASSERT_TRUE(fpmath::sqrt(q15_t(0.25f)) == q15_t(0.5f));
+    ASSERT_TRUE(fpmath::rsqrt(s78_t(0.0f)) == s78_t::maxVal());
+    ASSERT_TRUE(fpmath::rsqrt(s78_t(0.25f)) == s78_t(2.0f));
+}
+
+TEST(fpmathExpLog) {
+        // Relative error above 1, absolute below where output quantization dominates.
+    double expErr = maxError(-8.0, 14.0, 10000, [](double val) {
+        return (fpmath::exp2(s1516_t(val)).getDouble() - std::exp2(s1516_t(val).getDouble())) / std::fmax(1.0, std::exp2(val));
+    }, [](double) { return 0.0; });
+    double logErr = maxError(0.01, 30000.0, 10000, [](double val) { return fpmath::log2(s1516_t(val)).getDouble(); }, [](double val) { return std::log2(s1516_t(val).getDouble()); });
+    double logErr12 = maxError(0.01, 30000.0, 10000, [](double val) { return fpmath::log2< 12 >(s1516_t(val)).getDouble(); }, [](double val) { return std::log2(s1516_t(val).getDouble()); });
+    std::cout << "exp2 err " << expErr << ", log2 err " << logErr << ", log2<12> err " << logErr12 << std::endl;
+    ASSERT_TRUE(expErr < 2e-5);
+    ASSERT_TRUE(logErr < 2e-5);
+    ASSERT_TRUE(logErr12 < 4.0 * s1516_t::epsVal().getDouble());
+
+    ASSERT_TRUE(fpmath::exp2(s1516_t(3.0f)) == s1516_t(8.0f));
+    ASSERT_TRUE(fpmath::exp2(s1516_t(-1.0f)) == s1516_t(0.5f));
+    ASSERT_TRUE(fpmath::exp2(s1516_t(20.0f)) == s1516_t::maxVal());
+    ASSERT_TRUE(fpmath::exp2(s1516_t(-20.0f)) == s1516_t());
+    ASSERT_TRUE(fpmath::log2(s1516_t(1024.0f)) == s1516_t(10.0f));
+    ASSERT_TRUE(fpmath::log2(s1516_t(0.0f)) == s1516_t::minVal());
+}
+
 TEST_MAIN();
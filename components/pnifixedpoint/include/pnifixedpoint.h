@@ -17,104 +17,259 @@ namespace pni {
 
 ////////////////////////////////////////////////////////////////////
 
-template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType = Type >
+    // Double-width intermediate types for multiply, divide and the saturating
+    // policy.  Always signed so unsigned subtraction can saturate at zero.
+    // Types without a wider partner (64 bit) fall back to themselves.
+template< typename Type > struct FixedPointWide { using type = Type; };
+template<> struct FixedPointWide< int8_t > { using type = int16_t; };
+template<> struct FixedPointWide< uint8_t > { using type = int16_t; };
+template<> struct FixedPointWide< int16_t > { using type = int32_t; };
+template<> struct FixedPointWide< uint16_t > { using type = int32_t; };
+template<> struct FixedPointWide< int32_t > { using type = int64_t; };
+template<> struct FixedPointWide< uint32_t > { using type = int64_t; };
+
+    // Overflow policies.  Results are computed in the wide type and then
+    // narrowed back to storage by one of these.
+    // FixedPointWrap: Truncates to the storage type, cheapest, and the
+    //  behavior FixedPoint always had.
+    // FixedPointSaturate: Clamps to [minVal, maxVal] of the format, and
+    //  turns divide by zero into minVal/maxVal instead of a trap.
+struct FixedPointWrap {
+    template< typename Type, typename Wide >
+    constexpr static Type narrow(Wide val, Wide, Wide) {
+        return static_cast< Type >(val);
+    }
+
+    template< typename Type, typename Wide >
+    constexpr static Type divide(Wide num, Wide den, Wide, Wide) {
+        return static_cast< Type >(num / den);
+    }
+};
+
+struct FixedPointSaturate {
+    template< typename Type, typename Wide >
+    constexpr static Type narrow(Wide val, Wide lower, Wide upper) {
+        return static_cast< Type >(val < lower ? lower : (val > upper ? upper : val));
+    }
+
+    template< typename Type, typename Wide >
+    constexpr static Type divide(Wide num, Wide den, Wide lower, Wide upper) {
+        return den == 0 ?
+            static_cast< Type >(num < 0 ? lower : upper) :
+            narrow< Type, Wide >(num / den, lower, upper);
+    }
+};
+
+////////////////////////////////////////////////////////////////////
+
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+class FixedPoint;
+
+    // Result formats for operations mixing two different FixedPoint formats,
+    // all worked out at compile time.
+    // Storage is the larger of the two types, signed if either one is.
+    // The policy comes from the left hand side.
+template< class Lhs, class Rhs >
+struct FixedPointCommon {
+    using Larger = typename std::conditional< (sizeof(typename Lhs::ValueType) >= sizeof(typename Rhs::ValueType)),
+        typename Lhs::ValueType, typename Rhs::ValueType >::type;
+    using Type = typename std::conditional< std::is_signed< typename Lhs::ValueType >::value || std::is_signed< typename Rhs::ValueType >::value,
+        typename std::make_signed< Larger >::type, Larger >::type;
+    using Policy = typename Lhs::Policy;
+
+        // Largest IntBits + FracBits the storage and its wide type can take.
+    static const size_t SignBits = std::is_signed< Type >::value ? 1 : 0;
+    static const size_t TypeAvail = sizeof(Type) * 8 - SignBits;
+    static const size_t WideAvail = sizeof(typename FixedPointWide< Type >::type) * 8 / 2 - 1;
+    static const size_t Avail = TypeAvail < WideAvail ? TypeAvail : WideAvail;
+
+        // Keep all the integer bits and as much fraction as still fits.
+    template< size_t IntBits, size_t FracBits >
+    using Format = FixedPoint< Type, IntBits,
+        (IntBits >= Avail ? 0 : (FracBits < Avail - IntBits ? FracBits : Avail - IntBits)), Type, Policy >;
+};
+
+    // Lhs * Rhs: integer and fraction bits add.
+template< class Lhs, class Rhs >
+struct FixedPointProduct {
+    using type = typename FixedPointCommon< Lhs, Rhs >::template Format<
+        Lhs::NumIntBits + Rhs::NumIntBits, Lhs::NumFracBits + Rhs::NumFracBits >;
+};
+
+    // Lhs + Rhs, Lhs - Rhs: one more integer bit than the larger, finest fraction.
+template< class Lhs, class Rhs >
+struct FixedPointSum {
+    using type = typename FixedPointCommon< Lhs, Rhs >::template Format<
+        (Lhs::NumIntBits > Rhs::NumIntBits ? Lhs::NumIntBits : Rhs::NumIntBits) + 1,
+        (Lhs::NumFracBits > Rhs::NumFracBits ? Lhs::NumFracBits : Rhs::NumFracBits) >;
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Everything that doesn't modify the value is constexpr, so constants
+    // and tables (e.g., FixedPoint< int16_t, 1, 14 > coefficients built
+    // from float literals) are evaluated at compile time and can live in flash.
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType = Type, typename _Policy = FixedPointWrap >
 class FixedPoint {
+        template< typename, size_t, size_t, typename, typename > friend class FixedPoint;
+
     public:
         using ValueType = Type;
         using SrcType = _SrcType;
+        using WideType = typename FixedPointWide< Type >::type;
+        using Policy = _Policy;
+
+        static const size_t NumIntBits = IntBits;
+        static const size_t NumFracBits = FracBits;
 
     private:
-        static const ValueType   Scale = 1 << FracBits;
+        static const WideType Scale = WideType(1) << FracBits;
         static const size_t SignBits = std::is_unsigned<Type>::value ? 0 : 1;
         static const size_t TypeBits = sizeof(Type) * 8;
-        static const ValueType   Mask = (1 << (IntBits + FracBits)) - 1;
+        static const size_t WideBits = sizeof(WideType) * 8;
+        static const ValueType   Mask = ValueType((WideType(1) << (IntBits + FracBits)) - 1);
 
-        static_assert((IntBits + FracBits + SignBits) <= TypeBits / 2, "Sizes too big for data type");
+            // Raw range used by the saturating policy.
+        static const WideType RawMin = SignBits ? -WideType(Mask) : 0;
+        static const WideType RawMax = Mask;
+
+        static_assert((IntBits + FracBits + SignBits) <= TypeBits, "Sizes too big for data type");
+            // The product of two raw values must fit the wide type.  Unsigned types
+            // need the extra bit because the wide type is signed.
+        static_assert((IntBits + FracBits + 1) * 2 <= WideBits, "Sizes too big for intermediate type");
+
+        constexpr static Type narrow(WideType val) { return Policy::template narrow< Type, WideType >(val, RawMin, RawMax); }
+
+            // Power of two for shifting between formats without negative shift counts.
+        constexpr static int64_t pow2(size_t bits) { return int64_t(1) << bits; }
 
     public:
 
         // Convenient values and generators
-        static const ValueType   RawOneVal = Scale;
+        static const WideType   RawOneVal = Scale;
         constexpr static FixedPoint const oneVal() { return FixedPoint ((SrcType)1); }
         constexpr static FixedPoint const epsVal() { return FixedPoint (1, Raw);  }
         constexpr static FixedPoint const minVal() { return FixedPoint (SignBits ? -1 * Mask : 0, Raw); }
         constexpr static FixedPoint const maxVal() { return FixedPoint (Mask, Raw); }
         constexpr static FixedPoint const maskVal() { return FixedPoint (Mask, Raw); }
         
-        FixedPoint() : mVal ( 0 ) {}
-        FixedPoint(FixedPoint const& rhs) : mVal( rhs.mVal ) {}
+        constexpr FixedPoint() : mVal ( 0 ) {}
+        constexpr FixedPoint(FixedPoint const& rhs) : mVal( rhs.mVal ) {}
+
+            // Pre-scaled value, e.g. for tables generated elsewhere.
+        constexpr static FixedPoint fromRaw(ValueType val) { return FixedPoint(val, Raw); }
 
     private:
         // Internal constructor for raw values.
         // Uses dumb enum to make sure right constructor is invoked.
         enum ConstructorType { Raw };
-        FixedPoint(SrcType val, ConstructorType dummy) : mVal ( val ) {}   // Pre-scaled SrcType
+        constexpr FixedPoint(ValueType val, ConstructorType dummy) : mVal ( val ) {}   // Pre-scaled value
     
     public:        
-        // Conversion constructors, _currently_ with no range checking.
-        FixedPoint(SrcType val) : mVal ( val * Scale ) {}                // Unscaled SrcType
-        explicit FixedPoint(float val) : mVal ( val * Scale ) {}         // Unscaled float
-        explicit FixedPoint(double val) : mVal ( val * Scale ) {}        // Unscaled double
+        // Conversion constructors, range checked only with FixedPointSaturate.
+        constexpr FixedPoint(SrcType val) : mVal ( narrow(WideType(val) * Scale) ) {}           // Unscaled SrcType
+        explicit constexpr FixedPoint(float val) : mVal ( narrow(WideType(val * Scale)) ) {}    // Unscaled float
+        explicit constexpr FixedPoint(double val) : mVal ( narrow(WideType(val * Scale)) ) {}   // Unscaled double
 
         // Assignment operators
-        FixedPoint& operator = (SrcType rhs) { mVal = rhs * Scale; return *this; }
+        FixedPoint& operator = (SrcType rhs) { return *this = FixedPoint(rhs); }
         FixedPoint& operator = (FixedPoint const& rhs) { mVal = rhs.mVal; return *this; }
-        FixedPoint& operator = (float rhs) { mVal = rhs * Scale; return *this; }
-        FixedPoint& operator = (double rhs) { mVal = rhs * Scale; return *this; }
+        FixedPoint& operator = (float rhs) { return *this = FixedPoint(rhs); }
+        FixedPoint& operator = (double rhs) { return *this = FixedPoint(rhs); }
         
         // Arithmetic operations
-        FixedPoint operator + (FixedPoint const& rhs) const { return FixedPoint(mVal + rhs.mVal, Raw); }
-        FixedPoint& operator += (FixedPoint const& rhs) { mVal += rhs.mVal; return *this; }
+        // All of these are done in WideType, so intermediate results of * and /
+        // don't overflow even when the format uses the whole storage type.
+        constexpr FixedPoint operator + (FixedPoint const& rhs) const { return FixedPoint(narrow(WideType(mVal) + rhs.mVal), Raw); }
+        FixedPoint& operator += (FixedPoint const& rhs) { return *this = *this + rhs; }
         
-        FixedPoint operator - (FixedPoint const& rhs) const { return FixedPoint(mVal - rhs.mVal, Raw); }
-        FixedPoint& operator -= (FixedPoint const& rhs) { mVal -= rhs.mVal; return *this; }
+        constexpr FixedPoint operator - (FixedPoint const& rhs) const { return FixedPoint(narrow(WideType(mVal) - rhs.mVal), Raw); }
+        FixedPoint& operator -= (FixedPoint const& rhs) { return *this = *this - rhs; }
 
-        FixedPoint operator * (FixedPoint const& rhs) const { return FixedPoint(mVal * rhs.mVal / Scale, Raw); }
-        FixedPoint& operator *= (FixedPoint const& rhs) { mVal *= rhs.mVal; mVal /= Scale; return *this; }
+        constexpr FixedPoint operator * (FixedPoint const& rhs) const { return FixedPoint(narrow(WideType(mVal) * rhs.mVal / Scale), Raw); }
+        FixedPoint& operator *= (FixedPoint const& rhs) { return *this = *this * rhs; }
 
-        FixedPoint operator / (FixedPoint const& rhs) const { return FixedPoint((mVal * Scale) / rhs.mVal, Raw); }
-        FixedPoint& operator /= (FixedPoint const& rhs) { mVal *= Scale; mVal /= rhs.mVal; return *this; }
+        constexpr FixedPoint operator / (FixedPoint const& rhs) const {
+            return FixedPoint(Policy::template divide< Type, WideType >(WideType(mVal) * Scale, rhs.mVal, RawMin, RawMax), Raw);
+        }
+        FixedPoint& operator /= (FixedPoint const& rhs) { return *this = *this / rhs; }
 
-        FixedPoint operator % (FixedPoint const& rhs) const { return FixedPoint(mVal % rhs.mVal, Raw); }
+        constexpr FixedPoint operator % (FixedPoint const& rhs) const { return FixedPoint(mVal % rhs.mVal, Raw); }
         FixedPoint& operator %= (FixedPoint const& rhs) { mVal %= rhs.mVal; return *this; }
+
+        // Mixed format arithmetic.  Result formats come from FixedPointProduct
+        // and FixedPointSum, e.g.:
+        //   FixedPoint< int32_t, 7, 8 > * FixedPoint< int16_t, 1, 14 > -> FixedPoint< int32_t, 8, 22 >
+        // Same-format operands use the operators above.
+        template< typename RType, size_t RInt, size_t RFrac, typename RSrc, typename RPolicy,
+            typename Rhs = FixedPoint< RType, RInt, RFrac, RSrc, RPolicy >,
+            typename Result = typename FixedPointProduct< FixedPoint, Rhs >::type >
+        constexpr typename std::enable_if< ! std::is_same< FixedPoint, Rhs >::value, Result >::type
+        operator * (FixedPoint< RType, RInt, RFrac, RSrc, RPolicy > const& rhs) const {
+            return Result::fromRaw(Result::narrow(typename Result::WideType(mVal) * rhs.mVal 
+                / pow2(FracBits + RFrac - Result::NumFracBits)));
+        }
+
+        template< typename RType, size_t RInt, size_t RFrac, typename RSrc, typename RPolicy,
+            typename Rhs = FixedPoint< RType, RInt, RFrac, RSrc, RPolicy >,
+            typename Result = typename FixedPointSum< FixedPoint, Rhs >::type >
+        constexpr typename std::enable_if< ! std::is_same< FixedPoint, Rhs >::value, Result >::type
+        operator + (FixedPoint< RType, RInt, RFrac, RSrc, RPolicy > const& rhs) const {
+            return rescale< Result >() + rhs.template rescale< Result >();
+        }
+
+        template< typename RType, size_t RInt, size_t RFrac, typename RSrc, typename RPolicy,
+            typename Rhs = FixedPoint< RType, RInt, RFrac, RSrc, RPolicy >,
+            typename Result = typename FixedPointSum< FixedPoint, Rhs >::type >
+        constexpr typename std::enable_if< ! std::is_same< FixedPoint, Rhs >::value, Result >::type
+        operator - (FixedPoint< RType, RInt, RFrac, RSrc, RPolicy > const& rhs) const {
+            return rescale< Result >() - rhs.template rescale< Result >();
+        }
+
+        // Explicit conversion to another format, e.g. fp.rescale< FixedPoint< int16_t, 0, 15 > >().
+        // Extra fraction bits are truncated, overflow is handled by the Other policy.
+        template< class Other >
+        constexpr Other rescale() const {
+            return Other::fromRaw(Other::narrow(Other::NumFracBits >= FracBits ?
+                typename Other::WideType(mVal) * pow2(Other::NumFracBits - FracBits) :
+                typename Other::WideType(mVal / pow2(FracBits - Other::NumFracBits))));
+        }
         
         // Conversion operators
-        explicit operator SrcType () const { return mVal / Scale; }
-        explicit operator float () const { return mVal / (float) Scale; }
-        explicit operator double () const { return mVal / (double) Scale; }
+        explicit constexpr operator SrcType () const { return mVal / Scale; }
+        explicit constexpr operator float () const { return mVal / (float) Scale; }
+        explicit constexpr operator double () const { return mVal / (double) Scale; }
 
         // Comparison operators
-        bool operator == (FixedPoint const& rhs) const { return mVal == rhs.mVal; }
-        bool operator != (FixedPoint const& rhs) const { return ! (*this == rhs); }
-        bool operator == (SrcType rhs) const { return mVal == rhs * Scale; }
-        bool operator == (float rhs) const { return mVal == rhs * Scale; }
-        bool operator == (double rhs) const { return mVal == rhs * Scale; }
-
-        bool eq (float compare, float eps = 0.01) const {
-            float val = this->getFloat();
-            return ((val + eps) > compare) && ((val - eps) < compare);
+        constexpr bool operator == (FixedPoint const& rhs) const { return mVal == rhs.mVal; }
+        constexpr bool operator != (FixedPoint const& rhs) const { return ! (*this == rhs); }
+        constexpr bool operator == (SrcType rhs) const { return mVal == WideType(rhs) * Scale; }
+        constexpr bool operator == (float rhs) const { return mVal == rhs * Scale; }
+        constexpr bool operator == (double rhs) const { return mVal == rhs * Scale; }
+
+        constexpr bool eq (float compare, float eps = 0.01) const {
+            return ((getFloat() + eps) > compare) && ((getFloat() - eps) < compare);
         }
 
-        bool eq (double compare, double eps = 0.01) const {
-            double val = this->getDouble();
-            return ((val + eps) > compare) && ((val - eps) < compare);
+        constexpr bool eq (double compare, double eps = 0.01) const {
+            return ((getDouble() + eps) > compare) && ((getDouble() - eps) < compare);
         }
 
-        bool operator < (FixedPoint const& rhs) const { return mVal < rhs.mVal; }
-        bool operator <= (FixedPoint const& rhs) const { return mVal <= rhs.mVal; }
-        bool operator > (FixedPoint const& rhs) const { return mVal > rhs.mVal; }
-        bool operator >= (FixedPoint const& rhs) const { return mVal >= rhs.mVal; }
+        constexpr bool operator < (FixedPoint const& rhs) const { return mVal < rhs.mVal; }
+        constexpr bool operator <= (FixedPoint const& rhs) const { return mVal <= rhs.mVal; }
+        constexpr bool operator > (FixedPoint const& rhs) const { return mVal > rhs.mVal; }
+        constexpr bool operator >= (FixedPoint const& rhs) const { return mVal >= rhs.mVal; }
         
         // Other operators
-        explicit operator bool () { return mVal ? true : false; }
-        FixedPoint operator - () const { return FixedPoint(-mVal, Raw); }
+        explicit constexpr operator bool () const { return mVal ? true : false; }
+        constexpr FixedPoint operator - () const { return FixedPoint(narrow(-WideType(mVal)), Raw); }
 
         // Get data masked/clamped
-        SrcType get () const { return mVal / Scale; }
-        float getFloat() const { return mVal / (float) Scale; }
-        double getDouble() const { return mVal / (double) Scale; }
+        constexpr SrcType get () const { return mVal / Scale; }
+        constexpr float getFloat() const { return mVal / (float) Scale; }
+        constexpr double getDouble() const { return mVal / (double) Scale; }
 
-        SrcType get(ValueType const& mask) const { return ( mVal / Scale ) & mask; }
+        constexpr SrcType get(ValueType const& mask) const { return ( mVal / Scale ) & mask; }
         SrcType get(SrcType minVal, SrcType maxVal) const {
             FixedPoint tmp(*this);
             tmp.clamp(minVal, maxVal);
@@ -165,8 +320,8 @@ class FixedPoint {
 
         // Set/get raw bytes without being unscaled first
         FixedPoint& setRaw(ValueType const& val) { mVal = val; return *this; }
-        SrcType getRaw() const { return mVal; }
-        SrcType getRaw(ValueType const& mask) const { return ( mVal ) & mask; }
+        constexpr SrcType getRaw() const { return mVal; }
+        constexpr SrcType getRaw(ValueType const& mask) const { return ( mVal ) & mask; }
 
     protected:
 
@@ -176,17 +331,23 @@ class FixedPoint {
 
 // Const static definitions.  Need these because currently most of the 
 // FixedPoint methods take const refs which needs a real definition for ODR.
-template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType >
-const Type FixedPoint< Type, IntBits, FracBits, _SrcType>::Scale;
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const typename FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::WideType FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::Scale;
+
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const size_t FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::SignBits;
 
-template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType >
-const size_t FixedPoint< Type, IntBits, FracBits, _SrcType>::SignBits;
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const size_t FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::TypeBits;
 
-template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType >
-const size_t FixedPoint< Type, IntBits, FracBits, _SrcType>::TypeBits;
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const Type FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::Mask;
 
-template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType >
-const Type FixedPoint< Type, IntBits, FracBits, _SrcType>::Mask;
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const typename FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::WideType FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::RawMin;
+
+template< typename Type, size_t IntBits, size_t FracBits, typename _SrcType, typename _Policy >
+const typename FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::WideType FixedPoint< Type, IntBits, FracBits, _SrcType, _Policy >::RawMax;
 
 // Some predefined versions of the template.
 using FixedPointU3288 = FixedPoint< uint32_t, 8, 8 >;
@@ -194,6 +355,10 @@ using FixedPoint3278 = FixedPoint< int32_t, 7, 8 >;
 using FixedPointU1644 = FixedPoint< uint16_t, 4, 4 >;
 using FixedPoint1634 = FixedPoint< uint16_t, 3, 4 >;
 
+    // Saturating variants of the format, e.g. FixedPointSat< int16_t, 0, 15 > for Q15.
+template< typename Type, size_t IntBits, size_t FracBits >
+using FixedPointSat = FixedPoint< Type, IntBits, FracBits, Type, FixedPointSaturate >;
+
 ////////////////////////////////////////////////////////////////////
 
 } // end namespace pni
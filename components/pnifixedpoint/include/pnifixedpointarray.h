@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Bulk operations over contiguous arrays of FixedPoint.
+//
+//  FixedPoint is layout compatible with its ValueType, so the kernels
+//  work on the raw integers with plain indexed loops that GCC/clang
+//  can vectorize on x86/ARM hosts.  Results match the scalar FixedPoint
+//  operators bit for bit (same wide intermediate, same policy), except
+//  `dot`, which keeps full precision until the end.
+//
+//  dst may be the same array as a source (in place).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnifixedpointarray_h
+#define pnifixedpointarray_h
+
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "pnifixedpoint.h"
+
+    // No SIMD on Xtensa, but unrolling the inner loops helps the
+    // in-order pipeline.  `GCC unroll` only exists from GCC 8.
+#if defined(__XTENSA__) && defined(__GNUC__) && (__GNUC__ >= 8)
+    #define PNI_FP_UNROLL _Pragma("GCC unroll 4")
+#else
+    #define PNI_FP_UNROLL
+#endif
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+namespace fparray {
+
+////////////////////////////////////////////////////////////////////
+
+    // Raw access and the policy plumbing shared by all kernels.
+template< class Fp >
+struct Traits {
+    using Type = typename Fp::ValueType;
+    using Wide = typename Fp::WideType;
+    using Policy = typename Fp::Policy;
+
+    static_assert(sizeof(Fp) == sizeof(Type), "FixedPoint must be layout compatible with ValueType");
+    static_assert(std::is_standard_layout< Fp >::value, "FixedPoint must be standard layout");
+
+    static const Wide Scale = Fp::RawOneVal;
+
+    static Type* raw(Fp* ptr) { return reinterpret_cast< Type* >(ptr); }
+    static Type const* raw(Fp const* ptr) { return reinterpret_cast< Type const* >(ptr); }
+
+    static constexpr Wide lower() { return Fp::minVal().getRaw(); }
+    static constexpr Wide upper() { return Fp::maxVal().getRaw(); }
+
+    static inline Type narrow(Wide val) {
+        return Policy::template narrow< Type, Wide >(val, lower(), upper());
+    }
+
+        // Narrowest type holding the product of two raw values: the storage
+        // type itself for formats using no more than half of it (cheaper on
+        // Xtensa, and vectorizes on hosts), otherwise Wide.  Unlike
+        // FixedPoint's own operator *, that assumes raw values within the
+        // format's range, which wrapping arithmetic may not leave them in.
+    using Product = typename std::conditional< ((Fp::NumIntBits + Fp::NumFracBits + 1) * 2 <= sizeof(Type) * 8),
+        typename std::make_signed< Type >::type, Wide >::type;
+
+    static inline Type mul(Type lhs, Type rhs) {
+        return narrow(Product(lhs) * rhs / Product(Scale));
+    }
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // dst[i] = lhs[i] + rhs[i]
+template< class Fp >
+void add(Fp* dst, Fp const* lhs, Fp const* rhs, size_t num) {
+    using T = Traits< Fp >;
+    auto d = T::raw(dst);
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        d[ ind ] = T::narrow(typename T::Wide(l[ ind ]) + r[ ind ]);
+    }
+}
+
+    // dst[i] = lhs[i] - rhs[i]
+template< class Fp >
+void sub(Fp* dst, Fp const* lhs, Fp const* rhs, size_t num) {
+    using T = Traits< Fp >;
+    auto d = T::raw(dst);
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        d[ ind ] = T::narrow(typename T::Wide(l[ ind ]) - r[ ind ]);
+    }
+}
+
+    // dst[i] = lhs[i] * rhs[i]
+template< class Fp >
+void mul(Fp* dst, Fp const* lhs, Fp const* rhs, size_t num) {
+    using T = Traits< Fp >;
+    auto d = T::raw(dst);
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        d[ ind ] = T::mul(l[ ind ], r[ ind ]);
+    }
+}
+
+    // dst[i] = src[i] * factor
+template< class Fp >
+void scale(Fp* dst, Fp const* src, Fp const& factor, size_t num) {
+    using T = Traits< Fp >;
+    auto d = T::raw(dst);
+    auto s = T::raw(src);
+    auto f = static_cast< typename T::Type >(factor.getRaw());
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        d[ ind ] = T::mul(s[ ind ], f);
+    }
+}
+
+    // dst[i] = lhs[i] + (rhs[i] - lhs[i]) * tval
+    // Same expression (and rounding) as Color::Rgb::lerp.
+template< class Fp >
+void lerp(Fp* dst, Fp const* lhs, Fp const* rhs, Fp const& tval, size_t num) {
+    using T = Traits< Fp >;
+    using Wide = typename T::Wide;
+    auto d = T::raw(dst);
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    auto t = static_cast< typename T::Type >(tval.getRaw());
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        auto delta = T::narrow(Wide(r[ ind ]) - l[ ind ]);
+        d[ ind ] = T::narrow(Wide(l[ ind ]) + T::mul(delta, t));
+    }
+}
+
+    // dst[i] = clamp(src[i], minVal, maxVal)
+template< class Fp >
+void clamp(Fp* dst, Fp const* src, Fp const& minVal, Fp const& maxVal, size_t num) {
+    using T = Traits< Fp >;
+    auto d = T::raw(dst);
+    auto s = T::raw(src);
+    auto lo = static_cast< typename T::Type >(minVal.getRaw());
+    auto hi = static_cast< typename T::Type >(maxVal.getRaw());
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        auto val = s[ ind ];
+        val = val > lo ? val : lo;
+        d[ ind ] = val < hi ? val : hi;
+    }
+}
+
+    // acc[i] += lhs[i] * rhs[i]
+template< class Fp >
+void mac(Fp* acc, Fp const* lhs, Fp const* rhs, size_t num) {
+    using T = Traits< Fp >;
+    auto a = T::raw(acc);
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        a[ ind ] = T::narrow(typename T::Wide(a[ ind ]) + T::mul(l[ ind ], r[ ind ]));
+    }
+}
+
+    // sum(lhs[i] * rhs[i])
+    // Products are accumulated at full precision in WideType and scaled
+    // once at the end, so this is more accurate than summing FixedPoint
+    // products.  Headroom is WideType bits - 2 * (IntBits + FracBits + 1):
+    // 7.8 stored in int32 sums in int64 with 32 bits to spare, but stored
+    // in int16 it sums in int32 with none, and Q31 has none either.
+template< class Fp >
+Fp dot(Fp const* lhs, Fp const* rhs, size_t num) {
+    using T = Traits< Fp >;
+    using Wide = typename T::Wide;
+    auto l = T::raw(lhs);
+    auto r = T::raw(rhs);
+    Wide accum = 0;
+    PNI_FP_UNROLL
+    for(size_t ind = 0; ind < num; ++ind) {
+        accum += Wide(l[ ind ]) * r[ ind ];
+    }
+    return Fp::fromRaw(T::narrow(accum / T::Scale));
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace fparray
+
+} // end namespace pni
+
+#endif // pnifixedpointarray_h
@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Transcendental functions for FixedPoint: sin, cos, atan2, sqrt,
+//  rsqrt, exp2, log2.
+//
+//  Two families with different size/accuracy trade-offs:
+//    * Table + linear interpolation.  TableBits selects the table size
+//      (1 << TableBits segments, int32 entries), default 8 is ~1 KB
+//      per function and ~20 bits of accuracy.
+//    * CORDIC (sin/cos/atan2).  Iterations selects accuracy (about
+//      one bit per iteration) with a single 128 byte angle table.
+//  All tables are constexpr, generated by the compiler, so they cost
+//  nothing at startup and live in flash.
+//
+//  Angles are radians in the caller's FixedPoint format.  Internally
+//  they're binary angles (BAM): uint32_t where 1 << 32 is one turn,
+//  which wraps for free.  The *Bam functions are public for code that
+//  wants to stay in that representation (e.g., oscillators).
+//
+//  Results are always saturated into the range of the result format,
+//  e.g. sin of Q15 tops out at 0x7fff rather than wrapping to -1.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnifpmath_h
+#define pnifpmath_h
+
+#include <cstdint>
+#include <cstddef>
+
+#include "pnifixedpoint.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+namespace fpmath {
+
+////////////////////////////////////////////////////////////////////
+
+namespace detail {
+
+    // Compile time math in double, only used to generate tables.
+    // C++11 constexpr, so everything is single expression recursion.
+constexpr double Pi = 3.14159265358979323846;
+constexpr double Ln2 = 0.69314718055994530942;
+
+constexpr double sinSeries(double x2, double term, int num, double sum) {
+    return num > 20 ? sum : sinSeries(x2, -term * x2 / ((2 * num + 2) * (2 * num + 3)), num + 1, sum + term);
+}
+constexpr double csin(double x) { return sinSeries(x * x, x, 0, 0.0); }
+
+constexpr double expSeries(double x, double term, int num, double sum) {
+    return num > 30 ? sum : expSeries(x, term * x / (num + 1), num + 1, sum + term);
+}
+constexpr double cexp(double x) { return expSeries(x, 1.0, 0, 0.0); }
+
+    // ln(y) = 2 atanh((y - 1) / (y + 1)), converges quickly for y in [1, 2]
+constexpr double atanhSeries(double z2, double pow, int num, double sum) {
+    return num > 40 ? sum : atanhSeries(z2, pow * z2, num + 1, sum + pow / (2 * num + 1));
+}
+constexpr double cln(double y) { return 2.0 * atanhSeries(((y - 1.0) / (y + 1.0)) * ((y - 1.0) / (y + 1.0)), (y - 1.0) / (y + 1.0), 0, 0.0); }
+
+constexpr double atanSeries(double x2, double pow, int num, double sum) {
+    return num > 40 ? sum : atanSeries(x2, -pow * x2, num + 1, sum + pow / (2 * num + 1));
+}
+constexpr double atanSmall(double x) { return atanSeries(x * x, x, 0, 0.0); }
+    // t in [0, 1], reflect about pi/4 so the series argument stays <= 1/3.
+constexpr double catan(double t) { return t > 0.5 ? Pi / 4.0 - atanSmall((1.0 - t) / (1.0 + t)) : atanSmall(t); }
+
+constexpr double sqrtIter(double x, double guess, int num) {
+    return num == 0 ? guess : sqrtIter(x, 0.5 * (guess + x / guess), num - 1);
+}
+constexpr double csqrt(double x) { return sqrtIter(x, x > 1.0 ? x : 1.0, 60); }
+
+constexpr int64_t roundToInt(double val) { return val < 0.0 ? int64_t(val - 0.5) : int64_t(val + 0.5); }
+
+    // C++11 stand-in for std::index_sequence, log depth so big tables don't
+    // hit the template recursion limit.
+template< size_t... Ind > struct Seq {};
+
+template< class Lhs, class Rhs > struct Concat;
+template< size_t... Lhs, size_t... Rhs >
+struct Concat< Seq< Lhs... >, Seq< Rhs... > > { using type = Seq< Lhs..., (sizeof...(Lhs) + Rhs)... >; };
+
+template< size_t Num >
+struct MakeSeq { using type = typename Concat< typename MakeSeq< Num / 2 >::type, typename MakeSeq< Num - Num / 2 >::type >::type; };
+template<> struct MakeSeq< 0 > { using type = Seq<>; };
+template<> struct MakeSeq< 1 > { using type = Seq< 0 >; };
+
+    // Tables have (1 << Bits) + 2 entries: the extra points mean
+    // interpolation at the very end of the range never reads past the end.
+template< size_t Bits >
+struct TableSize { static const size_t value = (size_t(1) << Bits) + 2; };
+
+    // Quarter wave sine, Q30.
+template< size_t Bits, class = typename MakeSeq< TableSize< Bits >::value >::type > struct SinTable;
+template< size_t Bits, size_t... Ind >
+struct SinTable< Bits, Seq< Ind... > > {
+    static constexpr int32_t Data[] = { int32_t(roundToInt(csin(Ind * Pi / 2.0 / (1 << Bits)) * (1 << 30)))... };
+};
+template< size_t Bits, size_t... Ind >
+constexpr int32_t SinTable< Bits, Seq< Ind... > >::Data[];
+
+    // atan(t) for t in [0, 1], BAM.
+template< size_t Bits, class = typename MakeSeq< TableSize< Bits >::value >::type > struct AtanTable;
+template< size_t Bits, size_t... Ind >
+struct AtanTable< Bits, Seq< Ind... > > {
+    static constexpr int32_t Data[] = { int32_t(roundToInt(catan(double(Ind) / (1 << Bits)) / (2.0 * Pi) * 4294967296.0))... };
+};
+template< size_t Bits, size_t... Ind >
+constexpr int32_t AtanTable< Bits, Seq< Ind... > >::Data[];
+
+    // 2^t for t in [0, 1), Q30.
+template< size_t Bits, class = typename MakeSeq< TableSize< Bits >::value >::type > struct Exp2Table;
+template< size_t Bits, size_t... Ind >
+struct Exp2Table< Bits, Seq< Ind... > > {
+    static constexpr uint32_t Data[] = { uint32_t(roundToInt(cexp(Ln2 * Ind / (1 << Bits)) * (1 << 30)))... };
+};
+template< size_t Bits, size_t... Ind >
+constexpr uint32_t Exp2Table< Bits, Seq< Ind... > >::Data[];
+
+    // log2(1 + t) for t in [0, 1), Q30.
+template< size_t Bits, class = typename MakeSeq< TableSize< Bits >::value >::type > struct Log2Table;
+template< size_t Bits, size_t... Ind >
+struct Log2Table< Bits, Seq< Ind... > > {
+    static constexpr int32_t Data[] = { int32_t(roundToInt(cln(1.0 + double(Ind) / (1 << Bits)) / Ln2 * (1 << 30)))... };
+};
+template< size_t Bits, size_t... Ind >
+constexpr int32_t Log2Table< Bits, Seq< Ind... > >::Data[];
+
+    // CORDIC angles atan(2^-i), BAM.
+static const size_t CordicMax = 30;
+template< class = typename MakeSeq< CordicMax >::type > struct CordicTable;
+template< size_t... Ind >
+struct CordicTable< Seq< Ind... > > {
+    static constexpr int32_t Data[] = { int32_t(roundToInt(catan(1.0 / (uint64_t(1) << Ind)) / (2.0 * Pi) * 4294967296.0))... };
+};
+template< size_t... Ind >
+constexpr int32_t CordicTable< Seq< Ind... > >::Data[];
+
+    // CORDIC gain compensation, prod 1 / sqrt(1 + 2^-2i), Q30.
+constexpr double cordicGain(size_t num) {
+    return num == 0 ? 1.0 : cordicGain(num - 1) / csqrt(1.0 + 1.0 / double(uint64_t(1) << (2 * (num - 1))));
+}
+
+    // Seed for reciprocal square root of m in [1, 4), 48 buckets of 1/16, Q30.
+template< class = typename MakeSeq< 48 >::type > struct RsqrtSeed;
+template< size_t... Ind >
+struct RsqrtSeed< Seq< Ind... > > {
+    static constexpr uint32_t Data[] = { uint32_t(roundToInt((1 << 30) / csqrt((Ind + 16.5) / 16.0)))... };
+};
+template< size_t... Ind >
+constexpr uint32_t RsqrtSeed< Seq< Ind... > >::Data[];
+
+    // Linear interpolation into a table, pos has fracBits below the index.
+template< typename Type >
+inline int64_t lerpTable(Type const* table, uint32_t pos, size_t fracBits) {
+    uint32_t ind = pos >> fracBits;
+    int64_t frac = pos & ((uint32_t(1) << fracBits) - 1);
+    int64_t lower = table[ ind ];
+    int64_t upper = table[ ind + 1 ];
+    return lower + (((upper - lower) * frac) >> fracBits);
+}
+
+inline int64_t pow2(size_t bits) { return int64_t(1) << bits; }
+
+    // Shift a value with `bits` fraction bits into the Fp format (rounding),
+    // then saturate into its range.
+template< class Fp >
+inline Fp fromQ(int64_t val, int bits) {
+    const int shift = int(Fp::NumFracBits) - bits;
+    int64_t raw;
+    if(shift >= 0) {
+        if(shift > 62 || val > (INT64_MAX >> shift) || val < (INT64_MIN >> shift)) {
+            raw = val > 0 ? INT64_MAX : (val < 0 ? INT64_MIN : 0);
+        } else {
+            raw = val * pow2(shift);
+        }
+    } else {
+        raw = -shift > 62 ? 0 : (val + (pow2(-shift) >> 1)) >> -shift;
+    }
+    const int64_t lower = Fp::minVal().getRaw();
+    const int64_t upper = Fp::maxVal().getRaw();
+    return Fp::fromRaw(typename Fp::ValueType(raw < lower ? lower : (raw > upper ? upper : raw)));
+}
+
+inline int clz64(uint64_t val) { return __builtin_clzll(val); }
+
+    // Reciprocal square root of val normalized to m * 2^exp, m in [1, 4).
+    // Multiply-only Newton iterations from a small seed table.
+    // Returns 1/sqrt(m) in Q30, and sets m (Q30) and exp.  val must be > 0.
+inline uint32_t rsqrtNorm(uint64_t val, uint32_t& mant, int& exp) {
+    int bits = 64 - clz64(val);
+    exp = (bits - 1) & ~1;
+    mant = exp >= 30 ? uint32_t(val >> (exp - 30)) : uint32_t(val << (30 - exp));
+    uint32_t est = RsqrtSeed<>::Data[ (mant >> 26) - 16 ];
+    for(int iter = 0; iter < 3; ++iter) {
+        uint64_t est2 = (uint64_t(est) * est) >> 30;
+        uint64_t mest2 = (uint64_t(mant) * est2) >> 30;
+        est = uint32_t((uint64_t(est) * ((uint64_t(3) << 30) - mest2)) >> 31);
+    }
+    return est;
+}
+
+    // Radians <-> BAM.  2^32 / 2pi, and 2pi in Q28.
+static const int64_t BamPerRadian = 683565276;
+static const int64_t TwoPiQ28 = 1686629713;
+
+template< class Fp >
+inline uint32_t toBam(Fp const& rad) {
+    return uint32_t((int64_t(rad.getRaw()) * BamPerRadian) >> Fp::NumFracBits);
+}
+
+    // bam is signed and may be +/- (1 << 31) so +pi is representable.
+template< class Fp >
+inline Fp fromBam(int64_t bam) {
+    return fromQ< Fp >(bam * TwoPiQ28, 60);
+}
+
+} // end namespace detail
+
+////////////////////////////////////////////////////////////////////
+// Integer building blocks
+
+    // floor(sqrt(val)).
+inline uint32_t isqrt(uint64_t val) {
+    if(val == 0) {
+        return 0;
+    }
+    uint32_t mant;
+    int exp;
+    uint32_t est = detail::rsqrtNorm(val, mant, exp);
+    uint64_t root = (uint64_t(mant) * est) >> 30;       // sqrt(m), Q30
+    root = exp / 2 >= 30 ? root << (exp / 2 - 30) : root >> (30 - exp / 2);
+
+        // Last bit or two of the Q30 math.
+    while(root * root > val) {
+        --root;
+    }
+    while(root < 0xffffffff && (root + 1) * (root + 1) <= val) {
+        ++root;
+    }
+    return uint32_t(root);
+}
+
+    // sin of a BAM angle, Q30.
+template< size_t TableBits = 8 >
+inline int32_t sinBam(uint32_t angle) {
+    static_assert(TableBits >= 2 && TableBits <= 14, "TableBits out of range");
+    const uint32_t Quarter = uint32_t(1) << 30;
+    uint32_t quadrant = angle >> 30;
+    uint32_t pos = angle & (Quarter - 1);
+    if(quadrant & 1) {
+        pos = Quarter - pos;        // mirror, (0, Quarter]
+    }
+    int32_t val = int32_t(detail::lerpTable(detail::SinTable< TableBits >::Data, pos, 30 - TableBits));
+    return quadrant & 2 ? -val : val;
+}
+
+template< size_t TableBits = 8 >
+inline int32_t cosBam(uint32_t angle) {
+    return sinBam< TableBits >(angle + (uint32_t(1) << 30));
+}
+
+    // CORDIC rotation, sin and cos of a BAM angle together, Q30.
+template< size_t Iterations = 16 >
+inline void sinCosCordicBam(uint32_t angle, int32_t& sinOut, int32_t& cosOut) {
+    static_assert(Iterations >= 4 && Iterations <= detail::CordicMax, "Iterations out of range");
+    static constexpr int32_t Gain = int32_t(detail::roundToInt(detail::cordicGain(Iterations) * (1 << 30)));
+
+        // Rotate into [-45, 45) degrees, well inside CORDIC convergence.
+    uint32_t quadrant = (angle + (uint32_t(1) << 29)) >> 30;
+    int32_t zval = int32_t(angle - (quadrant << 30));
+    int32_t xval = Gain;
+    int32_t yval = 0;
+
+    for(size_t iter = 0; iter < Iterations; ++iter) {
+        int32_t dx = xval >> iter;
+        int32_t dy = yval >> iter;
+        if(zval >= 0) {
+            xval -= dy; yval += dx; zval -= detail::CordicTable<>::Data[ iter ];
+        } else {
+            xval += dy; yval -= dx; zval += detail::CordicTable<>::Data[ iter ];
+        }
+    }
+
+    switch(quadrant & 3) {
+        case 0: sinOut = yval; cosOut = xval; break;
+        case 1: sinOut = xval; cosOut = -yval; break;
+        case 2: sinOut = -yval; cosOut = -xval; break;
+        default: sinOut = -xval; cosOut = yval; break;
+    }
+}
+
+    // atan2 as a signed BAM angle in [-(1 << 31), 1 << 31], i.e. (-pi, pi].
+template< size_t TableBits = 8 >
+inline int64_t atan2Bam(int64_t yval, int64_t xval) {
+    static_assert(TableBits >= 2 && TableBits <= 14, "TableBits out of range");
+    uint64_t ax = xval < 0 ? -xval : xval;
+    uint64_t ay = yval < 0 ? -yval : yval;
+    if(ax == 0 && ay == 0) {
+        return 0;
+    }
+
+        // Octant reduction so the table only covers [0, 45] degrees.
+    bool steep = ay > ax;
+    uint64_t num = steep ? ax : ay;
+    uint64_t den = steep ? ay : ax;
+    uint32_t ratio = uint32_t((num << 30) / den);  // Q30, [0, 1]
+
+    int64_t angle = detail::lerpTable(detail::AtanTable< TableBits >::Data, ratio, 30 - TableBits);
+    if(steep) {
+        angle = (int64_t(1) << 30) - angle;
+    }
+    if(xval < 0) {
+        angle = (int64_t(1) << 31) - angle;
+    }
+    return yval < 0 ? -angle : angle;
+}
+
+    // CORDIC vectoring version of atan2Bam.
+template< size_t Iterations = 16 >
+inline int64_t atan2CordicBam(int64_t yval, int64_t xval) {
+    static_assert(Iterations >= 4 && Iterations <= detail::CordicMax, "Iterations out of range");
+    if(xval == 0 && yval == 0) {
+        return 0;
+    }
+
+        // Normalize so shifts don't eat small inputs, ~2^30 leaves room for growth.
+    uint64_t mag = uint64_t(xval < 0 ? -xval : xval) | uint64_t(yval < 0 ? -yval : yval);
+    int shift = 33 - detail::clz64(mag);
+    if(shift > 0) {
+        xval >>= shift; yval >>= shift;
+    } else {
+        xval *= detail::pow2(-shift); yval *= detail::pow2(-shift);
+    }
+
+        // Pre-rotate +/-90 degrees into the right half plane.
+    int64_t zval = 0;
+    if(xval < 0) {
+        int64_t tmp = xval;
+        if(yval >= 0) {
+            xval = yval; yval = -tmp; zval = int64_t(1) << 30;
+        } else {
+            xval = -yval; yval = tmp; zval = -(int64_t(1) << 30);
+        }
+    }
+
+    for(size_t iter = 0; iter < Iterations; ++iter) {
+        int64_t dx = xval >> iter;
+        int64_t dy = yval >> iter;
+        if(yval > 0) {
+            xval += dy; yval -= dx; zval += detail::CordicTable<>::Data[ iter ];
+        } else {
+            xval -= dy; yval += dx; zval -= detail::CordicTable<>::Data[ iter ];
+        }
+    }
+    return zval;
+}
+
+////////////////////////////////////////////////////////////////////
+// FixedPoint API
+
+template< size_t TableBits = 8, class Fp >
+inline Fp sin(Fp const& rad) {
+    return detail::fromQ< Fp >(sinBam< TableBits >(detail::toBam(rad)), 30);
+}
+
+template< size_t TableBits = 8, class Fp >
+inline Fp cos(Fp const& rad) {
+    return detail::fromQ< Fp >(cosBam< TableBits >(detail::toBam(rad)), 30);
+}
+
+template< size_t Iterations = 16, class Fp >
+inline void sinCosCordic(Fp const& rad, Fp& sinOut, Fp& cosOut) {
+    int32_t sval, cval;
+    sinCosCordicBam< Iterations >(detail::toBam(rad), sval, cval);
+    sinOut = detail::fromQ< Fp >(sval, 30);
+    cosOut = detail::fromQ< Fp >(cval, 30);
+}
+
+template< size_t Iterations = 16, class Fp >
+inline Fp sinCordic(Fp const& rad) {
+    Fp sval, cval;
+    sinCosCordic< Iterations >(rad, sval, cval);
+    return sval;
+}
+
+template< size_t Iterations = 16, class Fp >
+inline Fp cosCordic(Fp const& rad) {
+    Fp sval, cval;
+    sinCosCordic< Iterations >(rad, sval, cval);
+    return cval;
+}
+
+    // Radians in (-pi, pi], atan2(0, 0) is 0.
+template< size_t TableBits = 8, class Fp >
+inline Fp atan2(Fp const& yval, Fp const& xval) {
+    return detail::fromBam< Fp >(atan2Bam< TableBits >(yval.getRaw(), xval.getRaw()));
+}
+
+template< size_t Iterations = 16, class Fp >
+inline Fp atan2Cordic(Fp const& yval, Fp const& xval) {
+    return detail::fromBam< Fp >(atan2CordicBam< Iterations >(yval.getRaw(), xval.getRaw()));
+}
+
+    // Negative input gives 0.
+template< class Fp >
+inline Fp sqrt(Fp const& val) {
+    int64_t raw = val.getRaw();
+    if(raw <= 0) {
+        return Fp();
+    }
+    return detail::fromQ< Fp >(isqrt(uint64_t(raw) << Fp::NumFracBits), Fp::NumFracBits);
+}
+
+    // 1 / sqrt(val), saturates to maxVal for input <= 0 or results out of range.
+template< class Fp >
+inline Fp rsqrt(Fp const& val) {
+    int64_t raw = val.getRaw();
+    if(raw <= 0) {
+        return Fp::maxVal();
+    }
+        // 1/sqrt(raw / 2^F) = 2^(2F) / sqrt(raw * 2^F), and sqrt(raw * 2^F) = sqrt(m) 2^(exp/2)
+    uint32_t mant;
+    int exp;
+    uint32_t est = detail::rsqrtNorm(uint64_t(raw) << Fp::NumFracBits, mant, exp);
+    return detail::fromQ< Fp >(est, 30 + exp / 2 - 2 * int(Fp::NumFracBits) + int(Fp::NumFracBits));
+}
+
+template< size_t TableBits = 8, class Fp >
+inline Fp exp2(Fp const& val) {
+    static_assert(TableBits >= 2 && TableBits <= 14, "TableBits out of range");
+    const int FracBits = Fp::NumFracBits;
+    int64_t raw = val.getRaw();
+    int64_t whole = raw >> FracBits;                                    // floor
+    uint32_t frac = uint32_t(raw - whole * detail::pow2(FracBits));     // [0, 2^F)
+    uint32_t pos = FracBits <= 30 ? frac << (30 - FracBits) : frac >> (FracBits - 30);
+    int64_t mant = detail::lerpTable(detail::Exp2Table< TableBits >::Data, pos, 30 - TableBits);   // Q30, [1, 2)
+    if(whole > 62) {
+        return Fp::maxVal();
+    }
+    if(whole < -62) {
+        return Fp();
+    }
+    return detail::fromQ< Fp >(mant, 30 - int(whole));
+}
+
+    // Input <= 0 gives minVal.
+template< size_t TableBits = 8, class Fp >
+inline Fp log2(Fp const& val) {
+    static_assert(TableBits >= 2 && TableBits <= 14, "TableBits out of range");
+    int64_t raw = val.getRaw();
+    if(raw <= 0) {
+        return Fp::minVal();
+    }
+    int top = 63 - detail::clz64(uint64_t(raw));     // raw = 1.xxx * 2^top
+    uint64_t norm = top <= 30 ? uint64_t(raw) << (30 - top) : uint64_t(raw) >> (top - 30);   // Q30, [1, 2)
+    uint32_t pos = uint32_t(norm - (uint64_t(1) << 30));
+    int64_t frac = detail::lerpTable(detail::Log2Table< TableBits >::Data, pos, 30 - TableBits);
+    return detail::fromQ< Fp >((int64_t(top) - int64_t(Fp::NumFracBits)) * detail::pow2(30) + frac, 30);
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace fpmath
+
+} // end namespace pni
+
+#endif // pnifpmath_h
@@ -19,12 +19,14 @@ using Fpu3288 = FixedPoint< uint32_t, 8, 8>;
 using Fp3278 = FixedPoint<  int32_t, 7, 8>;
 using Fpu1644 = FixedPoint< uint16_t, 4, 4>;
 using Fp1634 = FixedPoint<  int16_t, 3, 4>;
+using Fpq15 = FixedPointSat<  int16_t, 0, 15>;
 
 // For early development to get the template to instantiate
 Fpu3288 fpu3288;
 Fp3278 fp3278;
 Fpu1644 fpu1644;
 Fp1634 fp1634;
+Fpq15 fpq15;
 // static FixedPoint<  int16_t, 14, 4> fp1634;  // Error datatype not big enough for bits
 
 #pragma GCC diagnostic push
@@ -61,6 +63,10 @@ void testTemplateExpansion() {
 
     // random
     auto maxVal = Fpu3288::maxVal();
+
+    // Saturating full-width format
+    fpq15 = Fpq15(0.5f) * Fpq15(0.5f);
+    fpq15 /= Fpq15(0.25f);
 }
 #pragma GCC diagnostic pop
 
@@ -0,0 +1,398 @@
+
+#include <iostream>
+#include <chrono>
+
+#include "pnigraph.h"
+#include "pnigraphssd1306.h"
+#include "pnigauge.h"
+
+using namespace std;
+using namespace pni;
+
+template< typename Func >
+static double nsPerOp(size_t ops, Func func) {
+    auto beg = chrono::steady_clock::now();
+    func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration< double, nano >(end - beg).count() / ops;
+}
+
+    // Spectrum-like frames, each bar moves a few pixels per frame.
+struct Walker {
+    uint32_t mSeed = 12345;
+
+    void step(Graph::Data& data, int maxVal, int delta) {
+        for(auto& val : data) {
+            mSeed = mSeed * 1664525 + 1013904223;
+            int cur = val.get() + int((mSeed >> 8) % (delta * 2 + 1)) - delta;
+            val = cur < 0 ? 0 : (cur > maxVal ? maxVal : cur);
+        }
+    }
+};
+
+static void setupGraph(Graph& graph, size_t num, Graph::Renderer* renderer) {
+    graph.mViewport = { 0, 0, 128, 64 };
+    graph.resize(num, 0);
+    graph.mXAxis.setRange(0, 0, (int)num);
+    graph.mYAxis.setRange(0, 0, 100);
+    graph.mRenderer = renderer;
+}
+
+template< class Renderer >
+static void benchFrames(char const* name, size_t num, Graph::Datum width, int delta, bool incremental) {
+    static const size_t Frames = 2000;
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Renderer renderer(&oled);
+    renderer.mWidth = width;
+    Graph graph;
+    setupGraph(graph, num, &renderer);
+
+    Walker walker;
+    walker.step(graph.mYAxis.mData, 100, 100);
+    oled.resetCounters();
+
+    double ns = nsPerOp(Frames, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            walker.step(graph.mYAxis.mData, 100, delta);
+            if( ! incremental) {
+                graph.clearViewport();
+            }
+            graph.draw();
+            graph.refresh();
+        }
+    });
+
+    cout << name << " bars=" << num << " delta=" << delta
+        << ": " << ns << " ns/frame, "
+        << oled.mPixelWrites / Frames << " pixel writes/frame, "
+        << oled.mBusBytes / Frames << " bus bytes/frame" << endl;
+}
+
+
+struct LinesIncremental : GraphSsd1306BarIncremental {
+    LinesIncremental(OLED* oled) : GraphSsd1306BarIncremental(oled) { mStyle = Lines; }
+};
+
+struct LinesFramebuffer : GraphSsd1306Framebuffer {
+    LinesFramebuffer(OLED* oled) : GraphSsd1306Framebuffer(oled) { mStyle = Lines; }
+};
+
+struct LinesFull : GraphSsd1306BarLines {
+    using GraphSsd1306BarLines::GraphSsd1306BarLines;
+    Graph::Datum mWidth;
+};
+
+    // The original multiply-then-divide xformPoint, for comparison.
+static bool legacyXform(Graph const& graph, Graph::Point& point) {
+    auto xSrcSize = graph.mXAxis.mSrcMax - graph.mXAxis.mSrcMin;
+    auto ySrcSize = graph.mYAxis.mSrcMax - graph.mYAxis.mSrcMin;
+    if(xSrcSize == 0 || ySrcSize == 0) {
+        return false;
+    }
+    point.mXVal.clamp(graph.mXAxis.mSrcMin, graph.mXAxis.mSrcMax);
+    point.mYVal.clamp(graph.mYAxis.mSrcMin, graph.mYAxis.mSrcMax);
+    point.mXVal -= graph.mXAxis.mSrcMin;
+    point.mXVal *= graph.mViewport.mXSize;
+    point.mXVal /= xSrcSize;
+    point.mXVal += graph.mViewport.mXOrig;
+    point.mYVal -= graph.mYAxis.mSrcMin;
+    point.mYVal *= graph.mViewport.mYSize;
+    point.mYVal /= ySrcSize;
+    point.mYVal += graph.mViewport.mYOrig;
+    return true;
+}
+
+    // Renderer that only transforms points, like a bar renderer with free pixels.
+struct MockRenderer : Graph::Renderer {
+    enum Mode { Legacy, Point, Batch };
+    Mode mMode = Point;
+    int32_t mSum = 0;
+    std::vector< Graph::Point > mPoints;
+
+    virtual void draw(Graph* graph) {
+        if(mMode == Batch) {
+            auto const& xData = graph->mXAxis.mData;
+            auto const& yData = graph->mYAxis.mData;
+            mPoints.resize(xData.size());
+            for(size_t num = 0; num < xData.size(); ++num) {
+                mPoints[ num ] = { xData[ num ], yData[ num ] };
+            }
+            graph->xformAll(mPoints.data(), mPoints.size());
+            for(auto const& point : mPoints) {
+                mSum += point.mXVal.getRaw() ^ point.mYVal.getRaw();
+            }
+        } else {
+            graph->map([this, graph](size_t index, Graph::Point const& point) {
+                auto dst(point);
+                if(mMode == Legacy ? legacyXform(*graph, dst) : graph->xformPoint(dst)) {
+                    mSum += dst.mXVal.getRaw() ^ dst.mYVal.getRaw();
+                }
+            });
+        }
+    }
+    virtual void clearViewport(Graph* graph) {}
+    virtual void clearAll(Graph* graph) {}
+    virtual void refresh(Graph* graph, bool force = false) {}
+};
+
+static void benchXform(size_t num) {
+    static const size_t Frames = 2000;
+    double pointsPerSec[ 3 ];
+    int32_t sums[ 3 ];
+    for(int mode = MockRenderer::Legacy; mode <= MockRenderer::Batch; ++mode) {
+        MockRenderer renderer;
+        renderer.mMode = MockRenderer::Mode(mode);
+        Graph graph;
+        setupGraph(graph, num, &renderer);
+        Walker walker;
+        double ns = nsPerOp(Frames * num, [&]() {
+            for(size_t frame = 0; frame < Frames; ++frame) {
+                walker.step(graph.mYAxis.mData, 100, 4);
+                graph.draw();
+            }
+        });
+        pointsPerSec[ mode ] = 1e9 / ns;
+        sums[ mode ] = renderer.mSum;
+    }
+    cout << "xform points=" << num << " (Mpoints/s): legacy " << pointsPerSec[ 0 ] / 1e6
+        << ", cached " << pointsPerSec[ 1 ] / 1e6 << ", xformAll " << pointsPerSec[ 2 ] / 1e6
+        << (sums[ 0 ] == sums[ 1 ] && sums[ 1 ] == sums[ 2 ] ? "" : " MISMATCH") << endl;
+}
+
+    // 128x64 page-major 1-bpp buffer, drawing as cheap as it gets so the
+    // per point overhead shows.
+struct FakeFb {
+    uint8_t mPages[ 8 ][ 128 ];
+
+    void dot(Graph::Datum xVal, Graph::Datum yVal) {
+        int x = xVal.get() & 127;
+        int y = yVal.get() & 63;
+        mPages[ y >> 3 ][ x ] |= 1 << (y & 7);
+    }
+};
+
+    // Same shape as GraphSsd1306Base: map -> std::function -> virtual drawOne.
+struct FbDotsVirtual : Graph::Renderer {
+    FakeFb* mFb;
+    FbDotsVirtual(FakeFb* fb) : mFb(fb) {}
+
+    virtual void draw(Graph* graph) {
+        graph->map([graph, this](size_t index, Graph::Point const& point) {
+            drawOne(graph, point);
+        });
+    }
+    virtual void drawOne(Graph* graph, Graph::Point const& point) {
+        auto dst(point);
+        if(graph->xformPoint(dst)) {
+            mFb->dot(dst.mXVal, dst.mYVal);
+        }
+    }
+    virtual void clearViewport(Graph* graph) {}
+    virtual void clearAll(Graph* graph) {}
+    virtual void refresh(Graph* graph, bool force = false) {}
+};
+
+struct FbDotsT : RendererT< FbDotsT > {
+    FakeFb* mFb;
+    FbDotsT(FakeFb* fb) : mFb(fb) {}
+
+    void drawBars(Graph* graph, Point const* points, size_t num, Datum base) {
+        for(size_t ind = 0; ind < num; ++ind) {
+            mFb->dot(points[ ind ].mXVal, points[ ind ].mYVal);
+        }
+    }
+    virtual void clearViewport(Graph* graph) {}
+    virtual void clearAll(Graph* graph) {}
+    virtual void refresh(Graph* graph, bool force = false) {}
+};
+
+template< class GraphType >
+static double nsPerPoint(GraphType* graphs, size_t numGraphs, size_t num) {
+    static const size_t Frames = 5000;
+    Walker walker;
+    for(size_t ind = 0; ind < numGraphs; ++ind) {
+        walker.step(graphs[ ind ].mYAxis.mData, 100, 100);
+    }
+    return nsPerOp(Frames * numGraphs * num, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            for(size_t ind = 0; ind < numGraphs; ++ind) {
+                graphs[ ind ].draw();
+            }
+        }
+    });
+}
+
+static void benchPipeline() {
+    static const size_t NumGraphs = 4;
+    static const size_t Num = 128;
+
+    FakeFb fb = {};
+    FbDotsVirtual virt(&fb);
+    FbDotsT crtp(&fb);
+    Graph virtGraphs[ NumGraphs ];
+    Graph crtpGraphs[ NumGraphs ];
+    GraphT< FbDotsT > inlineGraphs[ NumGraphs ] = { { &fb }, { &fb }, { &fb }, { &fb } };
+    for(size_t ind = 0; ind < NumGraphs; ++ind) {
+        setupGraph(virtGraphs[ ind ], Num, &virt);
+        setupGraph(crtpGraphs[ ind ], Num, &crtp);
+        setupGraph(inlineGraphs[ ind ], Num, &inlineGraphs[ ind ].mRendererT);
+    }
+    cout << "fake fb " << NumGraphs << "x" << Num << " points (ns/point): virtual "
+        << nsPerPoint(virtGraphs, NumGraphs, Num) << ", RendererT via Graph "
+        << nsPerPoint(crtpGraphs, NumGraphs, Num) << ", GraphT "
+        << nsPerPoint(inlineGraphs, NumGraphs, Num) << endl;
+
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GraphSsd1306BarLines lines(&oled);
+    Graph linesGraphs[ NumGraphs ];
+    GraphT< GraphSsd1306BarLinesT > linesTGraphs[ NumGraphs ] = { { &oled }, { &oled }, { &oled }, { &oled } };
+    for(size_t ind = 0; ind < NumGraphs; ++ind) {
+        setupGraph(linesGraphs[ ind ], Num, &lines);
+        setupGraph(linesTGraphs[ ind ], Num, &linesTGraphs[ ind ].mRendererT);
+    }
+    cout << "oled bar lines " << NumGraphs << "x" << Num << " points (ns/point): virtual "
+        << nsPerPoint(linesGraphs, NumGraphs, Num) << ", GraphT "
+        << nsPerPoint(linesTGraphs, NumGraphs, Num) << endl;
+}
+
+    // Scrolling history, one new sample per frame with DynamicPeak: shifting
+    // the static array and scanning for min/max, vs ring push().
+static void benchHistory(size_t num) {
+    static const size_t Frames = 20000;
+    Graph shift;
+    Graph ring;
+    shift.resize(num, 0);
+    ring.resizeRing(num, 0);
+    uint32_t seed = 12345;
+    int sink = 0;
+
+    double shiftNs = nsPerOp(Frames, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            seed = seed * 1664525 + 1013904223;
+            auto& data = shift.mYAxis.mData;
+            std::copy(data.begin() + 1, data.end(), data.begin());
+            data.back() = int((seed >> 8) % 201) - 100;
+            shift.mYAxis.updateDynamicRange(Graph::Axis::DynamicPeak);
+            sink += shift.mYAxis.getMinMax().second.get();
+        }
+    });
+    double ringNs = nsPerOp(Frames, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            seed = seed * 1664525 + 1013904223;
+            ring.push(int((seed >> 8) % 201) - 100);
+            ring.mYAxis.updateDynamicRange(Graph::Axis::DynamicPeak);
+            sink += ring.mYAxis.getMinMax().second.get();
+        }
+    });
+
+    cout << "history " << num << " samples (ns/frame): shift+scan " << shiftNs
+        << ", ring " << ringNs << " (" << (sink & 1) << ")" << endl;
+}
+
+    // Long history into the 128 column panel, with and without decimation.
+static void benchDecimate(size_t num) {
+    static const size_t Frames = 1000;
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GraphT< LinesFramebuffer > graph(&oled);
+    graph.mViewport = { 0, 0, 128, 64 };
+    graph.mXAxis.setRange(0, 0, (int)num);
+    graph.mYAxis.setRange(-100, 0, 100);
+    graph.resizeRing(num, 0);
+    uint32_t seed = 12345;
+
+    auto frames = [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            seed = seed * 1664525 + 1013904223;
+            graph.push(int((seed >> 8) % 201) - 100);
+            graph.clearViewport();
+            graph.draw();
+            graph.refresh();
+        }
+    };
+    double fullNs = nsPerOp(Frames, frames);
+    graph.mDecimate = true;
+    double decNs = nsPerOp(Frames, frames);
+
+    cout << "lines fb history " << num << " samples (ns/frame): all points " << fullNs
+        << ", decimated " << decNs << endl;
+}
+
+    // What a gauge costs without tables: clear, trig, rasterize per frame.
+struct NaiveRadial : GaugeRadial {
+    using GaugeRadial::GaugeRadial;
+
+    virtual void draw(Graph* graph) {
+        GaugeRadial::draw(graph);
+        int x0, y0, x1, y1;
+        getNeedle(getStep(), getNumSteps(), x0, y0, x1, y1);
+        GraphSsd1306Base::clearViewport(graph);
+        forEachLinePixel(x0, y0, x1, y1, [this](int xVal, int yVal) {
+            mOled->draw_pixel(xVal, yVal, mDrawColor);
+        });
+    }
+};
+
+template< class Gauge >
+static void benchGauge(char const* name, Graph::Viewport view, int delta) {
+    static const size_t Frames = 20000;
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Gauge gauge(&oled);
+    Graph graph;
+    graph.mViewport = view;
+    graph.mRenderer = &gauge;
+    graph.resize(1, 0);
+    graph.mYAxis.setRange(-100, 0, 100);
+    graph.draw();
+    graph.refresh();
+    oled.resetCounters();
+
+    uint32_t seed = 12345;
+    int val = 0;
+    double ns = nsPerOp(Frames, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            seed = seed * 1664525 + 1013904223;
+            val += int((seed >> 8) % (delta * 2 + 1)) - delta;
+            val = val < -100 ? -100 : (val > 100 ? 100 : val);
+            graph.mYAxis.mData[ 0 ] = val;
+            graph.draw();
+            graph.refresh();
+        }
+    });
+
+    cout << name << " delta=" << delta << ": " << ns << " ns/update, "
+        << oled.mPixelWrites / Frames << " pixel writes/update, "
+        << oled.mBusBytes / Frames << " bus bytes/update" << endl;
+}
+
+int main() {
+    for(int delta : { 1, 4, 20 }) {
+        benchFrames< GraphSsd1306BarRect >("rect full  ", 16, 6, delta, false);
+        benchFrames< GraphSsd1306BarIncremental >("rect incr  ", 16, 6, delta, true);
+        benchFrames< GraphSsd1306Framebuffer >("rect fb    ", 16, 6, delta, false);
+        benchFrames< LinesFull >("lines full ", 128, 1, delta, false);
+        benchFrames< LinesIncremental >("lines incr ", 128, 1, delta, true);
+        benchFrames< LinesFramebuffer >("lines fb   ", 128, 1, delta, false);
+    }
+
+    for(size_t num : { 16, 128, 1024 }) {
+        benchXform(num);
+    }
+
+    benchPipeline();
+
+    for(size_t num : { 128, 1024, 4096 }) {
+        benchHistory(num);
+    }
+    for(size_t num : { 512, 4096 }) {
+        benchDecimate(num);
+    }
+
+    Graph::Viewport dial = { 32, 0, 64, 64 };
+    Graph::Viewport bar = { 0, 52, 128, 12 };
+    for(int delta : { 2, 20 }) {
+        benchGauge< NaiveRadial >("radial naive", dial, delta);
+        benchGauge< GaugeRadial >("radial table", dial, delta);
+        benchGauge< GaugeLinear >("linear table", bar, delta);
+    }
+    return 0;
+}
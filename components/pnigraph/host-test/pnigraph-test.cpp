@@ -0,0 +1,690 @@
+
+#include <iostream>
+#include <cstring>
+
+#include "microtest/microtest.h"
+
+#include "pnigraph.h"
+#include "pnigraphssd1306.h"
+#include "pnigauge.h"
+
+using namespace std;
+using namespace pni;
+
+using Datum = Graph::Datum;
+using Incremental = GraphSsd1306BarIncremental;
+
+    // Deterministic "spectrum": each bar random walks a little per frame.
+struct Walker {
+    uint32_t mSeed = 12345;
+
+    int next(int range) {
+        mSeed = mSeed * 1664525 + 1013904223;
+        return (mSeed >> 8) % range;
+    }
+
+    void step(Graph::Data& data, int minVal, int maxVal, int delta) {
+        for(auto& val : data) {
+            int cur = val.get() + next(delta * 2 + 1) - delta;
+            val = cur < minVal ? minVal : (cur > maxVal ? maxVal : cur);
+        }
+    }
+};
+
+    // Bars along the value axis, one lane per index.
+static void setupGraph(Graph& graph, size_t num, bool vertical, int minVal, int center, int maxVal) {
+    graph.mViewport = { 0, 0, 128, 64 };
+    Graph::Axis& lanes = vertical ? graph.mXAxis : graph.mYAxis;
+    Graph::Axis& values = vertical ? graph.mYAxis : graph.mXAxis;
+    lanes.mData.resize(num);
+    lanes.fillAsIndices();
+    lanes.setRange(0, 0, (int)num);
+    values.mData.resize(num, center);
+    values.setRange(minVal, center, maxVal);
+}
+
+static bool sameBuffer(OLED const& lhs, OLED const& rhs) {
+    return memcmp(lhs.getBuffer(), rhs.getBuffer(), lhs.getBufferSize()) == 0;
+}
+
+static void setRectWidth(GraphSsd1306BarRect& full, Datum width) { full.mWidth = width; }
+static void setRectWidth(GraphSsd1306BarLines& full, Datum width) {}
+
+    // Incremental must match clearViewport + draw with the matching full renderer.
+template< class Full >
+static void checkMatches(Incremental::Style style, GraphSsd1306Base::Orientation orient,
+        size_t num, int minVal, int center, int maxVal, Datum width, Graph::Axis::DynamicRange range = Graph::Axis::Static) {
+    OLED fullOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    OLED incOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Full full(&fullOled);
+    Incremental inc(&incOled);
+    full.mOrientation = orient;
+    inc.mOrientation = orient;
+    inc.mStyle = style;
+    inc.mWidth = width;
+    setRectWidth(full, width);
+
+    Graph fullGraph;
+    Graph incGraph;
+    bool vertical = orient == GraphSsd1306Base::Vertical;
+    setupGraph(fullGraph, num, vertical, minVal, center, maxVal);
+    setupGraph(incGraph, num, vertical, minVal, center, maxVal);
+    fullGraph.mRenderer = &full;
+    incGraph.mRenderer = &inc;
+    fullGraph.mUseDynamicRange = range;
+    incGraph.mUseDynamicRange = range;
+
+    Walker walker;
+    bool same = true;
+    for(size_t frame = 0; frame < 50; ++frame) {
+        auto& data = vertical ? fullGraph.mYAxis.mData : fullGraph.mXAxis.mData;
+        walker.step(data, minVal, maxVal, frame == 0 ? (maxVal - minVal) : 4);
+        (vertical ? incGraph.mYAxis.mData : incGraph.mXAxis.mData) = data;
+
+        fullGraph.clearViewport();
+        fullGraph.draw();
+        fullGraph.refresh();
+
+        incGraph.draw();
+        incGraph.refresh();
+
+        same = same && sameBuffer(fullOled, incOled);
+    }
+    ASSERT_TRUE(same);
+    ASSERT_TRUE(incOled.mBusBytes < fullOled.mBusBytes);
+    ASSERT_TRUE(incOled.mPixelWrites < fullOled.mPixelWrites);
+}
+
+TEST(incrementalMatchesRect) {
+    checkMatches< GraphSsd1306BarRect >(Incremental::Rect, GraphSsd1306Base::Vertical, 16, 0, 0, 100, 5);
+    checkMatches< GraphSsd1306BarRect >(Incremental::Rect, GraphSsd1306Base::Vertical, 32, -50, 0, 50, 3);
+    checkMatches< GraphSsd1306BarRect >(Incremental::Rect, GraphSsd1306Base::Horizontal, 8, 0, 0, 200, 5);
+}
+
+TEST(incrementalMatchesLines) {
+    checkMatches< GraphSsd1306BarLines >(Incremental::Lines, GraphSsd1306Base::Vertical, 128, 0, 0, 100, 1);
+    checkMatches< GraphSsd1306BarLines >(Incremental::Lines, GraphSsd1306Base::Vertical, 64, -30, 0, 30, 1);
+    checkMatches< GraphSsd1306BarLines >(Incremental::Lines, GraphSsd1306Base::Horizontal, 64, -100, 0, 100, 1);
+}
+
+TEST(incrementalDynamicRange) {
+    checkMatches< GraphSsd1306BarRect >(Incremental::Rect, GraphSsd1306Base::Vertical, 16, 0, 0, 100, 5, Graph::Axis::Dynamic);
+    checkMatches< GraphSsd1306BarLines >(Incremental::Lines, GraphSsd1306Base::Vertical, 128, 0, 0, 100, 1, Graph::Axis::DynamicPeak);
+}
+
+TEST(incrementalDirtyPages) {
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Incremental inc(&oled);
+    Graph graph;
+    setupGraph(graph, 16, true, 0, 0, 64);
+    graph.mRenderer = &inc;
+
+        // First frame is a full redraw of the viewport.
+    graph.draw();
+    ASSERT_EQ(inc.getDirtyPages(), 0xff);
+    graph.refresh();
+    ASSERT_EQ(inc.getDirtyPages(), 0);
+
+        // Nothing changed, nothing sent.
+    oled.resetCounters();
+    graph.draw();
+    graph.refresh();
+    ASSERT_EQ(oled.mBusBytes, 0u);
+    ASSERT_EQ(oled.mPixelWrites, 0u);
+
+        // Grow one bar within the bottom page.
+    graph.mYAxis.mData[ 3 ] = 4;
+    graph.draw();
+    ASSERT_EQ(inc.getDirtyPages(), 0x01);
+    graph.refresh();
+    ASSERT_EQ(oled.mRefreshes, 1u);
+    ASSERT_EQ(oled.mPixelWrites, 5u * 4u);
+    ASSERT_TRUE(oled.getPixel(3 * 8, 3));
+    ASSERT_FALSE(oled.getPixel(3 * 8, 4));
+
+        // Shrink it back, only erases.
+    graph.mYAxis.mData[ 3 ] = 1;
+    graph.draw();
+    graph.refresh();
+    ASSERT_TRUE(oled.getPixel(3 * 8, 0));
+    ASSERT_FALSE(oled.getPixel(3 * 8, 1));
+
+        // Changing the lane layout forces a full redraw.
+    graph.mXAxis.setRange(0, 0, 32);
+    graph.draw();
+    ASSERT_EQ(inc.getDirtyPages(), 0xff);
+    graph.refresh();
+
+        // clearAll resends everything on the next refresh.
+    oled.resetCounters();
+    graph.clearAll();
+    graph.refresh();
+    ASSERT_EQ(oled.mRefreshes, 1u);
+    ASSERT_FALSE(oled.getPixel(3 * 8, 0));
+}
+
+    // A viewport taller than the panel only dirties the panel's pages.
+TEST(incrementalShortPanel) {
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x32);
+    Incremental inc(&oled);
+    Graph graph;
+    setupGraph(graph, 16, true, 0, 0, 64);
+    graph.mRenderer = &inc;
+
+    graph.mYAxis.mData[ 3 ] = 40;
+    graph.draw();
+    ASSERT_EQ(inc.getDirtyPages(), 0x0f);
+    graph.refresh();
+
+        // Growing a bar past the end of the panel changes nothing on it.
+    oled.resetCounters();
+    graph.mYAxis.mData[ 3 ] = 48;
+    graph.draw();
+    ASSERT_EQ(inc.getDirtyPages(), 0);
+    graph.refresh();
+    ASSERT_EQ(oled.mBusBytes, 0u);
+}
+
+    // The original multiply-then-divide xformPoint, as the reference.
+static bool legacyXform(Graph const& graph, Graph::Point& point) {
+    auto xSrcSize = graph.mXAxis.mSrcMax - graph.mXAxis.mSrcMin;
+    auto ySrcSize = graph.mYAxis.mSrcMax - graph.mYAxis.mSrcMin;
+    if(xSrcSize == 0 || ySrcSize == 0) {
+        return false;
+    }
+    point.mXVal.clamp(graph.mXAxis.mSrcMin, graph.mXAxis.mSrcMax);
+    point.mYVal.clamp(graph.mYAxis.mSrcMin, graph.mYAxis.mSrcMax);
+    point.mXVal -= graph.mXAxis.mSrcMin;
+    point.mXVal *= graph.mViewport.mXSize;
+    point.mXVal /= xSrcSize;
+    point.mXVal += graph.mViewport.mXOrig;
+    point.mYVal -= graph.mYAxis.mSrcMin;
+    point.mYVal *= graph.mViewport.mYSize;
+    point.mYVal /= ySrcSize;
+    point.mYVal += graph.mViewport.mYOrig;
+    return true;
+}
+
+TEST(xformMatchesLegacy) {
+    Walker walker;
+    Graph graph;
+    size_t mismatches = 0;
+    for(size_t config = 0; config < 2000; ++config) {
+            // Raw ranges from a few LSBs up to the whole 10.5 format, in viewports
+            // small enough that the legacy math doesn't overflow.
+        int32_t lower = walker.next(0x8000) - 0x4000;
+        int32_t span = 1 + walker.next(config % 3 == 0 ? 64 : 0x8000);
+        int32_t xLower = walker.next(2000) - 1000;
+        graph.mXAxis.setRange(Datum::fromRaw(xLower), 0, Datum::fromRaw(xLower + 1 + walker.next(4000)));
+        graph.mYAxis.setRange(Datum::fromRaw(lower), 0, Datum::fromRaw(lower + span));
+        graph.mViewport = { size_t(walker.next(64)), size_t(walker.next(32)), size_t(1 + walker.next(128)), size_t(1 + walker.next(64)) };
+
+        Graph::Point points[ 64 ];
+        for(auto& point : points) {
+            point.mXVal = Datum::fromRaw(walker.next(6000) - 3000);
+            point.mYVal = Datum::fromRaw(lower - 100 + walker.next(span + 200));
+        }
+        Graph::Point batch[ 64 ];
+        memcpy(batch, points, sizeof(points));
+        ASSERT_TRUE(graph.xformAll(batch, 64));
+
+        for(size_t num = 0; num < 64; ++num) {
+            Graph::Point ref = points[ num ];
+            Graph::Point out = points[ num ];
+            legacyXform(graph, ref);
+            graph.xformPoint(out);
+            if(ref.mXVal != out.mXVal || ref.mYVal != out.mYVal ||
+                    ref.mXVal != batch[ num ].mXVal || ref.mYVal != batch[ num ].mYVal) {
+                ++mismatches;
+            }
+        }
+    }
+    ASSERT_EQ(mismatches, 0u);
+    ASSERT_TRUE(graph.getYXform().mExact);
+}
+
+TEST(xformCacheUpdates) {
+    Graph graph;
+    graph.mViewport = { 0, 0, 100, 50 };
+    graph.mXAxis.setRange(0, 0, 10);
+    graph.mYAxis.setRange(0, 0, 10);
+
+    Graph::Point point = { 5, 5 };
+    ASSERT_TRUE(graph.xformPoint(point));
+    ASSERT_EQ(point.mXVal.get(), 50);
+    ASSERT_EQ(point.mYVal.get(), 25);
+
+        // Viewport and ranges are public, changes are still picked up.
+    graph.mViewport.mXSize = 200;
+    graph.mYAxis.mSrcMax = 20;
+    point = { 5, 5 };
+    ASSERT_TRUE(graph.xformPoint(point));
+    ASSERT_EQ(point.mXVal.get(), 100);
+    ASSERT_EQ(point.mYVal.get(), 12);
+
+        // Dynamic range goes through the same path.
+    graph.resize(4, 0);
+    graph.mYAxis.mData[ 2 ] = 8;
+    graph.mYAxis.updateDynamicRange(Graph::Axis::Dynamic);
+    point = { 0, 4 };
+    ASSERT_TRUE(graph.xformPoint(point));
+    ASSERT_EQ(point.mYVal.get(), 25);
+
+        // Empty and inverted ranges behave like before.
+    graph.mYAxis.setRange(3, 0, 3);
+    point = { 1, 1 };
+    ASSERT_FALSE(graph.xformPoint(point));
+    ASSERT_EQ(point.mXVal.get(), 1);
+    graph.mYAxis.setRange(10, 0, 0);
+    Graph::Point ref = { 1, 4 };
+    point = ref;
+    legacyXform(graph, ref);
+    ASSERT_TRUE(graph.xformPoint(point));
+    ASSERT_TRUE(point.mYVal == ref.mYVal);
+    ASSERT_FALSE(graph.getYXform().mExact);
+}
+
+    // CRTP renderers, through both Graph (virtual) and GraphT, match the originals.
+template< class Orig, class Crtp >
+static void checkCrtpMatches(GraphSsd1306Base::Orientation orient, size_t num, int minVal, int center, int maxVal) {
+    OLED origOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    OLED virtOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    OLED crtpOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Orig orig(&origOled);
+    Crtp virt(&virtOled);
+    orig.mOrientation = orient;
+    virt.mOrientation = orient;
+
+    bool vertical = orient == GraphSsd1306Base::Vertical;
+    Graph origGraph;
+    Graph virtGraph;
+    GraphT< Crtp > crtpGraph(&crtpOled);
+    crtpGraph.mRendererT.mOrientation = orient;
+    setupGraph(origGraph, num, vertical, minVal, center, maxVal);
+    setupGraph(virtGraph, num, vertical, minVal, center, maxVal);
+    setupGraph(crtpGraph, num, vertical, minVal, center, maxVal);
+    origGraph.mRenderer = &orig;
+    virtGraph.mRenderer = &virt;
+
+    Walker walker;
+    bool same = true;
+    for(size_t frame = 0; frame < 20; ++frame) {
+        auto& data = vertical ? origGraph.mYAxis.mData : origGraph.mXAxis.mData;
+        walker.step(data, minVal, maxVal, (maxVal - minVal) / 4);
+        (vertical ? virtGraph.mYAxis.mData : virtGraph.mXAxis.mData) = data;
+        (vertical ? crtpGraph.mYAxis.mData : crtpGraph.mXAxis.mData) = data;
+
+        origGraph.clearViewport();
+        origGraph.draw();
+        virtGraph.clearViewport();
+        virtGraph.draw();
+        crtpGraph.clearViewport();
+        crtpGraph.draw();
+
+        same = same && sameBuffer(origOled, virtOled) && sameBuffer(origOled, crtpOled);
+    }
+    ASSERT_TRUE(same);
+}
+
+TEST(crtpMatches) {
+    checkCrtpMatches< GraphSsd1306BarLines, GraphSsd1306BarLinesT >(GraphSsd1306Base::Vertical, 128, 0, 0, 100);
+    checkCrtpMatches< GraphSsd1306BarLines, GraphSsd1306BarLinesT >(GraphSsd1306Base::Vertical, 100, -40, 0, 40);
+    checkCrtpMatches< GraphSsd1306BarLines, GraphSsd1306BarLinesT >(GraphSsd1306Base::Horizontal, 64, 0, 0, 100);
+    checkCrtpMatches< GraphSsd1306BarRect, GraphSsd1306BarRectT >(GraphSsd1306Base::Vertical, 20, 0, 0, 100);
+    checkCrtpMatches< GraphSsd1306BarRect, GraphSsd1306BarRectT >(GraphSsd1306Base::Horizontal, 10, -50, 0, 50);
+}
+
+TEST(mapT) {
+    Graph graph;
+    graph.resize(5, 2);
+    int sum = 0;
+    graph.mapT([&sum](size_t index, Graph::Point const& point) {
+        sum += point.mXVal.get() * point.mYVal.get();
+    });
+    ASSERT_EQ(sum, (0 + 1 + 2 + 3 + 4) * 2);
+}
+
+    // Framebuffer renderer matches clearViewport + draw with the originals,
+    // including clipping at the panel edges.
+template< class Orig >
+static void checkFbMatches(GraphSsd1306Framebuffer::Style style, GraphSsd1306Base::Orientation orient,
+        size_t num, int minVal, int center, int maxVal, Datum width, Graph::Viewport view) {
+    OLED origOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    OLED fbOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Orig orig(&origOled);
+    orig.mOrientation = orient;
+    setRectWidth(orig, width);
+
+    bool vertical = orient == GraphSsd1306Base::Vertical;
+    Graph origGraph;
+    GraphT< GraphSsd1306Framebuffer > fbGraph(&fbOled);
+    fbGraph.mRendererT.mOrientation = orient;
+    fbGraph.mRendererT.mStyle = style;
+    fbGraph.mRendererT.mWidth = width;
+    setupGraph(origGraph, num, vertical, minVal, center, maxVal);
+    setupGraph(fbGraph, num, vertical, minVal, center, maxVal);
+    origGraph.mViewport = view;
+    fbGraph.mViewport = view;
+    origGraph.mRenderer = &orig;
+
+    Walker walker;
+    bool same = true;
+    for(size_t frame = 0; frame < 20; ++frame) {
+        auto& data = vertical ? origGraph.mYAxis.mData : origGraph.mXAxis.mData;
+        walker.step(data, minVal, maxVal, (maxVal - minVal) / 4);
+        (vertical ? fbGraph.mYAxis.mData : fbGraph.mXAxis.mData) = data;
+
+        origGraph.clearViewport();
+        origGraph.draw();
+        origGraph.refresh();
+        fbGraph.clearViewport();
+        fbGraph.draw();
+        fbGraph.refresh();
+
+        same = same && sameBuffer(origOled, fbOled);
+    }
+    ASSERT_TRUE(same);
+}
+
+TEST(framebufferMatches) {
+    using Fb = GraphSsd1306Framebuffer;
+    Graph::Viewport full = { 0, 0, 128, 64 };
+    Graph::Viewport inset = { 10, 3, 100, 50 };
+    Graph::Viewport overhang = { 100, 40, 60, 40 };
+    checkFbMatches< GraphSsd1306BarRect >(Fb::Rect, GraphSsd1306Base::Vertical, 16, 0, 0, 100, 5, full);
+    checkFbMatches< GraphSsd1306BarRect >(Fb::Rect, GraphSsd1306Base::Vertical, 20, -50, 0, 50, 7, inset);
+    checkFbMatches< GraphSsd1306BarRect >(Fb::Rect, GraphSsd1306Base::Vertical, 12, 0, 0, 100, 6, overhang);
+    checkFbMatches< GraphSsd1306BarRect >(Fb::Rect, GraphSsd1306Base::Horizontal, 8, 0, 0, 200, 5, inset);
+    checkFbMatches< GraphSsd1306BarRect >(Fb::Rect, GraphSsd1306Base::Horizontal, 8, -10, 0, 30, 3, overhang);
+    checkFbMatches< GraphSsd1306BarLines >(Fb::Lines, GraphSsd1306Base::Vertical, 128, 0, 0, 100, 1, full);
+    checkFbMatches< GraphSsd1306BarLines >(Fb::Lines, GraphSsd1306Base::Vertical, 77, -30, 0, 30, 1, inset);
+    checkFbMatches< GraphSsd1306BarLines >(Fb::Lines, GraphSsd1306Base::Vertical, 50, 0, 0, 100, 1, overhang);
+    checkFbMatches< GraphSsd1306BarLines >(Fb::Lines, GraphSsd1306Base::Horizontal, 64, -100, 0, 100, 1, full);
+}
+
+TEST(framebufferMasks) {
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GraphSsd1306Framebuffer fb(&oled);
+
+        // Rows 3..12 span two pages.
+    fb.fillRect(5, 3, 2, 10, WHITE);
+    ASSERT_EQ(fb.getBuffer()[ 5 ], 0xf8);
+    ASSERT_EQ(fb.getBuffer()[ 128 + 6 ], 0x1f);
+    ASSERT_EQ(fb.getBuffer()[ 7 ], 0x00);
+
+    fb.fillRect(5, 4, 1, 2, BLACK);
+    ASSERT_EQ(fb.getBuffer()[ 5 ], 0xc8);
+    fb.fillRect(5, 0, 1, 8, INVERT);
+    ASSERT_EQ(fb.getBuffer()[ 5 ], 0x37);
+
+        // Nothing drawn since the last refresh, nothing sent.
+    fb.refresh(0);
+    oled.resetCounters();
+    fb.refresh(0);
+    ASSERT_EQ(oled.mBusBytes, 0u);
+    ASSERT_TRUE(oled.getPixel(5, 0));
+    ASSERT_FALSE(oled.getPixel(5, 3));
+}
+
+TEST(ringPush) {
+    Graph graph;
+    graph.resizeRing(4, 0);
+    for(int val = 1; val <= 6; ++val) {
+        graph.push(val);
+    }
+        // Oldest first: 3 4 5 6
+    for(size_t ind = 0; ind < 4; ++ind) {
+        ASSERT_EQ(graph.mYAxis.at(ind).get(), int(ind) + 3);
+    }
+    ASSERT_EQ(graph.mXAxis.at(3).get(), 3);
+
+    graph.resize(4, 1);
+    ASSERT_FALSE(graph.mYAxis.mRing);
+    ASSERT_EQ(graph.mYAxis.at(0).get(), graph.mYAxis.mData[ 0 ].get());
+}
+
+    // Incremental min/max must equal a scan of the window after every push.
+TEST(ringMinMax) {
+    for(size_t num : { 1, 2, 7, 64 }) {
+        Graph::Axis axis;
+        axis.resizeRing(num, 0);
+        Walker walker;
+        bool same = true;
+        for(size_t step = 0; step < 1000; ++step) {
+                // Mix of walks and repeats, so ties get exercised.
+            int val = walker.next(4) == 0 ? axis.at(num - 1).get() : int(walker.next(201)) - 100;
+            axis.push(val);
+
+            Datum lo = axis.at(0);
+            Datum hi = lo;
+            for(size_t ind = 1; ind < num; ++ind) {
+                lo = std::min(lo, axis.at(ind));
+                hi = std::max(hi, axis.at(ind));
+            }
+            auto mm = axis.getMinMax();
+            same = same && mm.first == lo && mm.second == hi;
+        }
+        ASSERT_TRUE(same);
+    }
+}
+
+    // No data, ring or not: dynamic ranges keep what they had.
+TEST(emptyMinMax) {
+    Graph::Axis axis;
+    axis.setRange(-5, 0, 5);
+    axis.updateDynamicRange(Graph::Axis::Dynamic);
+    ASSERT_TRUE(axis.mSrcMin == Datum(-5) && axis.mSrcMax == Datum(5));
+
+    axis.resizeRing(0, 3);
+    auto mm = axis.getMinMax();
+    ASSERT_TRUE(mm.first == Datum(-5) && mm.second == Datum(5));
+    axis.updateDynamicRange(Graph::Axis::DynamicPeak);
+    ASSERT_TRUE(axis.mSrcMin == Datum(-5) && axis.mSrcMax == Datum(5));
+}
+
+    // Scrolling with push() draws the same as shifting a static array.
+TEST(ringMatchesShift) {
+    OLED shiftOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    OLED ringOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GraphSsd1306BarLines shiftRenderer(&shiftOled);
+    GraphT< GraphSsd1306Framebuffer > ring(&ringOled);
+    ring.mRendererT.mStyle = GraphSsd1306Framebuffer::Lines;
+    ring.mRendererT.mWidth = 1;
+
+    Graph shift;
+    shift.mRenderer = &shiftRenderer;
+    for(Graph* graph : { &shift, (Graph*)&ring }) {
+        graph->mViewport = { 0, 0, 128, 64 };
+        graph->mXAxis.setRange(0, 0, 100);
+        graph->mYAxis.setRange(-50, 0, 50);
+        graph->mUseDynamicRange = Graph::Axis::DynamicPeak;
+    }
+    shift.resize(100, 0);
+    ring.resizeRing(100, 0);
+
+    Walker walker;
+    bool same = true;
+    for(size_t frame = 0; frame < 300; ++frame) {
+        int val = int(walker.next(161)) - 80;
+        auto& data = shift.mYAxis.mData;
+        std::copy(data.begin() + 1, data.end(), data.begin());
+        data.back() = val;
+        ring.push(val);
+
+        shift.clearViewport();
+        shift.draw();
+        shift.refresh();
+        ring.clearViewport();
+        ring.draw();
+        ring.refresh();
+
+        same = same && sameBuffer(shiftOled, ringOled);
+        same = same && shift.mYAxis.mSrcMin == ring.mYAxis.mSrcMin && shift.mYAxis.mSrcMax == ring.mYAxis.mSrcMax;
+    }
+    ASSERT_TRUE(same);
+}
+
+TEST(decimate) {
+    Graph graph;
+    graph.mViewport = { 0, 0, 10, 64 };
+    graph.resizeRing(100, 0);
+    for(int val = 0; val < 130; ++val) {
+        graph.push(val % 17 - 8);
+    }
+
+        // Off, or not enough points per column, visits everything.
+    size_t count = 0;
+    graph.mapT([&count](size_t, Graph::Point const&) { ++count; });
+    ASSERT_EQ(count, 100u);
+    graph.mDecimate = true;
+    graph.mViewport.mXSize = 50;
+    count = 0;
+    graph.mapT([&count](size_t, Graph::Point const&) { ++count; });
+    ASSERT_EQ(count, 100u);
+
+        // A min and a max per column, at the column's first sample.
+    graph.mViewport.mXSize = 10;
+    std::vector< Graph::Point > points;
+    graph.mapT([&points](size_t index, Graph::Point const& point) {
+        ASSERT_EQ(index, points.size());
+        points.push_back(point);
+    });
+    ASSERT_EQ(points.size(), 20u);
+    bool same = true;
+    for(size_t col = 0; col < 10; ++col) {
+        Datum lo = graph.mYAxis.at(col * 10);
+        Datum hi = lo;
+        for(size_t ind = col * 10; ind < col * 10 + 10; ++ind) {
+            lo = std::min(lo, graph.mYAxis.at(ind));
+            hi = std::max(hi, graph.mYAxis.at(ind));
+        }
+        same = same && points[ col * 2 ].mXVal.get() == int(col * 10);
+        same = same && points[ col * 2 ].mYVal == lo && points[ col * 2 + 1 ].mYVal == hi;
+    }
+    ASSERT_TRUE(same);
+}
+
+    // Gauge after a run of updates must look like one drawn from scratch
+    // at the last value, while only touching what changed.
+template< class Gauge, class Setup >
+static void checkGauge(Graph::Viewport view, Setup setup, size_t maxWrites) {
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    Gauge gauge(&oled);
+    setup(gauge);
+    Graph graph;
+    graph.mViewport = view;
+    graph.mRenderer = &gauge;
+    graph.resize(1, 0);
+    graph.mYAxis.setRange(-100, 0, 100);
+
+    Walker walker;
+    bool same = true;
+    size_t worst = 0;
+    for(size_t frame = 0; frame < 200; ++frame) {
+        int val = int(walker.next(241)) - 120;
+        graph.mYAxis.mData[ 0 ] = val;
+        graph.draw();
+        graph.refresh();
+        if(frame > 0) {
+            worst = std::max(worst, oled.mPixelWrites);
+        }
+        oled.resetCounters();
+
+        OLED freshOled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+        Gauge fresh(&freshOled);
+        setup(fresh);
+        Graph freshGraph;
+        freshGraph.mViewport = view;
+        freshGraph.mRenderer = &fresh;
+        freshGraph.resize(1, val);
+        freshGraph.mYAxis.setRange(-100, 0, 100);
+        freshGraph.draw();
+        freshGraph.refresh();
+        same = same && sameBuffer(oled, freshOled);
+    }
+    ASSERT_TRUE(same);
+    ASSERT_TRUE(worst <= maxWrites);
+
+        // Same step again, nothing drawn or sent.
+    graph.draw();
+    graph.refresh();
+    ASSERT_EQ(oled.mPixelWrites, 0u);
+    ASSERT_EQ(oled.mBusBytes, 0u);
+}
+
+TEST(gaugeRadial) {
+    Graph::Viewport full = { 0, 0, 128, 64 };
+    Graph::Viewport inset = { 70, 10, 40, 50 };
+        // Needles are Bresenham lines, at most radius pixels, erase + draw.
+    checkGauge< GaugeRadial >(full, [](GaugeRadial&) {}, 2 * 32);
+    checkGauge< GaugeRadial >(inset, [](GaugeRadial& gauge) {
+        gauge.mStartDeg = 180;
+        gauge.mSweepDeg = -180;
+        gauge.mHub = 0;
+        gauge.mSteps = 16;
+    }, 2 * 20);
+
+        // Min points left, mid up, max right.
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GaugeRadial gauge(&oled);
+    gauge.mStartDeg = 180;
+    gauge.mSweepDeg = -180;
+    Graph graph;
+    graph.mViewport = full;
+    graph.mRenderer = &gauge;
+    graph.resize(1, -100);
+    graph.mYAxis.setRange(-100, 0, 100);
+    graph.draw();
+    int cx = gauge.getCenterX();
+    int cy = gauge.getCenterY();
+    int len = gauge.getRadius() - 2;
+    ASSERT_EQ(cx, 63);
+    ASSERT_EQ(cy, 31);
+    ASSERT_EQ(len, 29);
+    ASSERT_TRUE(oled.getPixel(cx - len, cy));
+    ASSERT_FALSE(oled.getPixel(cx + len, cy));
+    graph.mYAxis.mData[ 0 ] = 0;
+    graph.draw();
+    ASSERT_TRUE(oled.getPixel(cx, cy - len));
+    ASSERT_FALSE(oled.getPixel(cx - len, cy));
+    graph.mYAxis.mData[ 0 ] = 100;
+    graph.draw();
+    ASSERT_TRUE(oled.getPixel(cx + len, cy));
+    ASSERT_FALSE(oled.getPixel(cx, cy - len));
+        // The arc
+    ASSERT_TRUE(oled.getPixel(cx, cy - len - 2));
+}
+
+TEST(gaugeLinear) {
+    Graph::Viewport bar = { 4, 40, 120, 12 };
+    Graph::Viewport column = { 100, 2, 10, 60 };
+        // Bars only fill or clear the difference, lines move a 1 pixel marker.
+    checkGauge< GaugeLinear >(bar, [](GaugeLinear& gauge) {
+        gauge.mOrientation = GraphSsd1306Base::Horizontal;
+    }, 118 * 10);
+    checkGauge< GaugeLinear >(column, [](GaugeLinear& gauge) {}, 58 * 8);
+    checkGauge< GaugeLinear >(column, [](GaugeLinear& gauge) {
+        gauge.mStyle = GaugeLinear::Line;
+        gauge.mFrame = false;
+        gauge.mSteps = 20;
+    }, 2 * 10);
+
+        // Half way is half the bar.
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GaugeLinear gauge(&oled);
+    gauge.mOrientation = GraphSsd1306Base::Horizontal;
+    Graph graph;
+    graph.mViewport = bar;
+    graph.mRenderer = &gauge;
+    graph.resize(1, 0);
+    graph.mYAxis.setRange(-100, 0, 100);
+    graph.draw();
+    ASSERT_EQ(gauge.getNumSteps(), 119u);
+    ASSERT_EQ(gauge.getEdge(gauge.getStep()), 59);
+    ASSERT_TRUE(oled.getPixel(5 + 58, 45));
+    ASSERT_FALSE(oled.getPixel(5 + 59, 45));
+        // Frame
+    ASSERT_TRUE(oled.getPixel(4 + 119, 45));
+}
+
+TEST_MAIN();
@@ -0,0 +1,427 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Gauges: show one value, the newest Y sample of the Graph, as a
+//  needle (GaugeRadial) or a bar/marker (GaugeLinear).
+//
+//  All the geometry is computed once per layout (viewport or settings
+//  change) into a table per quantized value, so an update is a lookup,
+//  then erasing what the old value drew and drawing the new one.  No
+//  trig or line rasterization per frame, and no pixels touched at all
+//  when the quantized value didn't move.
+//
+//  Like the incremental bar renderer, don't clearViewport() every frame,
+//  that forces the static parts (arc, frame) to be redrawn too.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnigauge_h
+#define pnigauge_h
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+
+#include "pnigraphssd1306.h"
+#include "pnifpmath.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+class GaugeBase : public GraphSsd1306Base {
+    public:
+        using GraphSsd1306Base::GraphSsd1306Base;
+
+            // Number of quantized positions, 0 picks one per pixel of travel.
+        size_t mSteps = 0;
+
+        virtual void draw(Graph* graph) {
+            size_t num = graph->mYAxis.size();
+            if(num == 0) {
+                return; // EARLY RETURN!!!
+            }
+            Point point = { 0, graph->mYAxis.at(num - 1) };
+            drawOne(graph, point);
+        }
+
+        virtual void clearViewport(Graph* graph) {
+            GraphSsd1306Base::clearViewport(graph);
+            invalidate();
+        }
+
+        virtual void clearAll(Graph* graph) {
+            GraphSsd1306Base::clearAll(graph);
+            invalidate();
+        }
+
+            // Step shown on screen, -1 before the first draw.
+        int getStep() const { return mStep; }
+        size_t getNumSteps() const { return mNumSteps; }
+
+            // Step for `val`, clamped to the Y axis range.
+        size_t quantize(Graph const* graph, Datum val) const {
+            int64_t lo = graph->mYAxis.mSrcMin.getRaw();
+            int64_t hi = graph->mYAxis.mSrcMax.getRaw();
+            if(hi <= lo || mNumSteps < 2) {
+                return 0; // EARLY RETURN!!!
+            }
+            int64_t raw = val.getRaw();
+            raw = raw < lo ? lo : (raw > hi ? hi : raw);
+            return size_t(((raw - lo) * int64_t(mNumSteps - 1) + (hi - lo) / 2) / (hi - lo));
+        }
+
+    protected:
+        int mStep = -1;
+        size_t mNumSteps = 0;
+        bool mStaticDrawn = false;
+        Graph::Viewport mView = { 0, 0, 0, 0 };
+        size_t mBuiltSteps = 0;
+
+            // Fills the tables for the current settings, returns the step count.
+        virtual size_t buildLayout(Graph* graph) = 0;
+            // Parts that don't depend on the value.
+        virtual void drawStatic(Graph* graph) {}
+            // Takes the screen from showing step `from` (-1 for nothing) to `to`.
+        virtual void update(int from, int to) = 0;
+            // Derived classes with settings of their own extend this.
+        virtual bool layoutChanged(Graph* graph) const {
+            auto const& view = graph->mViewport;
+            return mNumSteps == 0 || mBuiltSteps != mSteps ||
+                view.mXOrig != mView.mXOrig || view.mYOrig != mView.mYOrig ||
+                view.mXSize != mView.mXSize || view.mYSize != mView.mYSize;
+        }
+
+        virtual void drawOne(Graph* graph, Point const& point) {
+            if( ! mOled) {
+                return; // EARLY RETURN!!!
+            }
+            if(layoutChanged(graph)) {
+                mView = graph->mViewport;
+                mBuiltSteps = mSteps;
+                mNumSteps = buildLayout(graph);
+                GraphSsd1306Base::clearViewport(graph);
+                invalidate();
+            }
+            if( ! mStaticDrawn) {
+                drawStatic(graph);
+                mStaticDrawn = true;
+            }
+            int step = int(quantize(graph, point.mYVal));
+            if(step != mStep) {
+                update(mStep, step);
+                mStep = step;
+            }
+        }
+
+        void invalidate() {
+            mStep = -1;
+            mStaticDrawn = false;
+        }
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Speedometer style: a needle from the viewport center over an arc.
+    // Angles are in degrees counter clockwise from 3 o'clock, the default
+    // sweeps clockwise from 7:30 to 4:30.
+class GaugeRadial : public GaugeBase {
+    public:
+        using GaugeBase::GaugeBase;
+
+        int mStartDeg = 225;    // Needle angle at the axis min
+        int mSweepDeg = -270;   // From min to max, negative is clockwise
+        size_t mHub = 2;        // Needle starts this far from the center
+        bool mArc = true;       // Draw the scale arc
+
+            // Horizontal run of pixels.
+        struct Span {
+            uint8_t mX;
+            uint8_t mY;
+            uint8_t mLen;
+        };
+
+            // Spans for a set of steps, step n is
+            // mSpans[ mOffsets[ n ] ] .. mSpans[ mOffsets[ n + 1 ] ].
+        struct SpanTable {
+            std::vector< Span > mSpans;
+            std::vector< uint32_t > mOffsets;
+
+            void clear() {
+                mSpans.clear();
+                mOffsets.assign(1, 0);
+            }
+
+            void endStep() { mOffsets.push_back(mSpans.size()); }
+
+            Span const* begin(size_t step) const { return mSpans.data() + mOffsets[ step ]; }
+            Span const* end(size_t step) const { return mSpans.data() + mOffsets[ step + 1 ]; }
+
+                // Pixels come in line order, so runs on a row are adjacent.
+            void addPixel(int xVal, int yVal) {
+                if(mSpans.size() > mOffsets.back()) {
+                    Span& last = mSpans.back();
+                    if(last.mY == yVal) {
+                        if(xVal >= last.mX && xVal < last.mX + last.mLen) {
+                            return; // EARLY RETURN!!!
+                        } else if(xVal == last.mX + last.mLen) {
+                            ++last.mLen;
+                            return; // EARLY RETURN!!!
+                        } else if(xVal + 1 == last.mX) {
+                            --last.mX;
+                            ++last.mLen;
+                            return; // EARLY RETURN!!!
+                        }
+                    }
+                }
+                mSpans.push_back({ uint8_t(xVal), uint8_t(yVal), 1 });
+            }
+        };
+
+            // Bresenham, calls func(x, y) for each pixel from start to end.
+        template< class Func >
+        static void forEachLinePixel(int x0, int y0, int x1, int y1, Func&& func) {
+            int dx = std::abs(x1 - x0);
+            int dy = -std::abs(y1 - y0);
+            int sx = x0 < x1 ? 1 : -1;
+            int sy = y0 < y1 ? 1 : -1;
+            int err = dx + dy;
+            while(true) {
+                func(x0, y0);
+                if(x0 == x1 && y0 == y1) {
+                    break;
+                }
+                int err2 = err * 2;
+                if(err2 >= dy) {
+                    err += dy;
+                    x0 += sx;
+                }
+                if(err2 <= dx) {
+                    err += dx;
+                    y0 += sy;
+                }
+            }
+        }
+
+            // Point `radius` pixels out from the center at angle `bam`
+            // (binary angle, 2^32 per turn).
+        void polarToPixel(uint32_t bam, int radius, int& xVal, int& yVal) const {
+            int64_t cosVal = fpmath::cosBam(bam);
+            int64_t sinVal = fpmath::sinBam(bam);
+            int64_t half = int64_t(1) << 29;
+            xVal = mCenterX + int((radius * cosVal + half) >> 30);
+            yVal = mCenterY - int((radius * sinVal + half) >> 30);
+        }
+
+        uint32_t stepToBam(size_t step, size_t numSteps) const {
+            int64_t sweep = int64_t(mSweepDeg) * (int64_t(1) << 32) / 360;
+            int64_t offset = numSteps < 2 ? 0 : sweep * int64_t(step) / int64_t(numSteps - 1);
+            return uint32_t(int64_t(degToBam(mStartDeg)) + offset);
+        }
+
+            // Needle end points for a step, what the table is built from.
+        void getNeedle(size_t step, size_t numSteps, int& x0, int& y0, int& x1, int& y1) const {
+            uint32_t bam = stepToBam(step, numSteps);
+            polarToPixel(bam, int(mHub), x0, y0);
+            polarToPixel(bam, mRadius - 2, x1, y1);
+        }
+
+        int getCenterX() const { return mCenterX; }
+        int getCenterY() const { return mCenterY; }
+        int getRadius() const { return mRadius; }
+
+    protected:
+        SpanTable mNeedles;
+        SpanTable mArcSpans;
+        int mCenterX = 0;
+        int mCenterY = 0;
+        int mRadius = 0;
+        int mBuiltStartDeg = 0;
+        int mBuiltSweepDeg = 0;
+        size_t mBuiltHub = 0;
+        bool mBuiltArc = false;
+
+        static uint32_t degToBam(int deg) {
+            return uint32_t(int64_t(deg) * (int64_t(1) << 32) / 360);
+        }
+
+        virtual bool layoutChanged(Graph* graph) const {
+            return GaugeBase::layoutChanged(graph) || mBuiltStartDeg != mStartDeg ||
+                mBuiltSweepDeg != mSweepDeg || mBuiltHub != mHub || mBuiltArc != mArc;
+        }
+
+        virtual size_t buildLayout(Graph* graph) {
+            mBuiltStartDeg = mStartDeg;
+            mBuiltSweepDeg = mSweepDeg;
+            mBuiltHub = mHub;
+            mBuiltArc = mArc;
+
+            auto const& view = graph->mViewport;
+            size_t side = std::min(view.mXSize, view.mYSize);
+            mCenterX = int(view.mXOrig + (view.mXSize - 1) / 2);
+            mCenterY = int(view.mYOrig + (view.mYSize - 1) / 2);
+            mRadius = side < 2 ? 0 : int((side - 1) / 2);
+
+                // Arc length in pixels, roughly 1 step per pixel.
+            int sweep = std::abs(mSweepDeg);
+            size_t numSteps = mSteps ? mSteps : size_t(sweep * mRadius * 314 / 18000) + 1;
+            numSteps = std::max(numSteps, size_t(2));
+
+            mNeedles.clear();
+            for(size_t step = 0; step < numSteps; ++step) {
+                if(mRadius - 2 > int(mHub)) {
+                    int x0, y0, x1, y1;
+                    getNeedle(step, numSteps, x0, y0, x1, y1);
+                    forEachLinePixel(x0, y0, x1, y1, [this](int xVal, int yVal) {
+                        mNeedles.addPixel(xVal, yVal);
+                    });
+                }
+                mNeedles.endStep();
+            }
+
+                // Chords every few degrees look round at OLED sizes.
+            mArcSpans.clear();
+            if(mArc && mRadius > 0) {
+                size_t segs = std::max(sweep / 5, 1);
+                int xPrev, yPrev;
+                polarToPixel(stepToBam(0, 2), mRadius, xPrev, yPrev);
+                for(size_t seg = 1; seg <= segs; ++seg) {
+                    int xVal, yVal;
+                    polarToPixel(stepToBam(seg, segs + 1), mRadius, xVal, yVal);
+                    forEachLinePixel(xPrev, yPrev, xVal, yVal, [this](int xCur, int yCur) {
+                        mArcSpans.addPixel(xCur, yCur);
+                    });
+                    xPrev = xVal;
+                    yPrev = yVal;
+                }
+            }
+            mArcSpans.endStep();
+            return numSteps;
+        }
+
+        virtual void drawStatic(Graph* graph) {
+            drawSpans(mArcSpans, 0, mDrawColor);
+        }
+
+        virtual void update(int from, int to) {
+            if(from >= 0) {
+                drawSpans(mNeedles, from, mClearColor);
+            }
+            drawSpans(mNeedles, to, mDrawColor);
+        }
+
+        void drawSpans(SpanTable const& table, size_t step, ssd1306_color_t color) {
+            for(auto span = table.begin(step); span != table.end(step); ++span) {
+                mOled->draw_hline(span->mX, span->mY, span->mLen, color);
+            }
+        }
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // A bar (or a marker line) along the viewport, inside an optional
+    // frame.  Horizontal grows left to right, Vertical bottom to top.
+    // The table is the bar edge per step, so a Bar update fills or clears
+    // just the difference and a Line update moves the marker.
+class GaugeLinear : public GaugeBase {
+    public:
+        using GaugeBase::GaugeBase;
+
+        enum Style {
+            Bar,
+            Line
+        };
+
+        Style mStyle = Bar;
+        bool mFrame = true;
+
+            // Pixels from the start of the travel to the bar end/marker.
+        uint8_t getEdge(size_t step) const { return mEdges[ step ]; }
+
+    protected:
+        std::vector< uint8_t > mEdges;
+        size_t mInnerX = 0;
+        size_t mInnerY = 0;
+        size_t mInnerW = 0;
+        size_t mInnerH = 0;
+        Style mBuiltStyle = Bar;
+        bool mBuiltFrame = false;
+        Orientation mBuiltOrientation = Vertical;
+
+        virtual bool layoutChanged(Graph* graph) const {
+            return GaugeBase::layoutChanged(graph) || mBuiltStyle != mStyle ||
+                mBuiltFrame != mFrame || mBuiltOrientation != mOrientation;
+        }
+
+        size_t getTravel() const {
+            return mOrientation == Horizontal ? mInnerW : mInnerH;
+        }
+
+        virtual size_t buildLayout(Graph* graph) {
+            mBuiltStyle = mStyle;
+            mBuiltFrame = mFrame;
+            mBuiltOrientation = mOrientation;
+
+            auto const& view = graph->mViewport;
+            size_t inset = mFrame ? 1 : 0;
+            mInnerX = view.mXOrig + inset;
+            mInnerY = view.mYOrig + inset;
+            mInnerW = view.mXSize > inset * 2 ? view.mXSize - inset * 2 : 0;
+            mInnerH = view.mYSize > inset * 2 ? view.mYSize - inset * 2 : 0;
+
+                // Bar: 0 .. travel pixels filled.  Line: marker at 0 .. travel - 1.
+            size_t travel = getTravel();
+            size_t last = mStyle == Bar ? travel : (travel ? travel - 1 : 0);
+            size_t numSteps = std::max(mSteps ? mSteps : last + 1, size_t(2));
+            mEdges.resize(numSteps);
+            for(size_t step = 0; step < numSteps; ++step) {
+                mEdges[ step ] = uint8_t((step * last + (numSteps - 1) / 2) / (numSteps - 1));
+            }
+            return numSteps;
+        }
+
+        virtual void drawStatic(Graph* graph) {
+            auto const& view = graph->mViewport;
+            if(mFrame && view.mXSize && view.mYSize) {
+                mOled->draw_rectangle(view.mXOrig, view.mYOrig, view.mXSize, view.mYSize, mDrawColor);
+            }
+        }
+
+        virtual void update(int from, int to) {
+            if(getTravel() == 0) {
+                return; // EARLY RETURN!!!
+            }
+            if(mStyle == Line) {
+                if(from >= 0) {
+                    fillTravel(mEdges[ from ], 1, mClearColor);
+                }
+                fillTravel(mEdges[ to ], 1, mDrawColor);
+            } else {
+                size_t cur = from >= 0 ? mEdges[ from ] : 0;
+                size_t next = mEdges[ to ];
+                if(next > cur) {
+                    fillTravel(cur, next - cur, mDrawColor);
+                } else if(next < cur) {
+                    fillTravel(next, cur - next, mClearColor);
+                }
+            }
+        }
+
+            // Fills `len` pixels of travel starting `beg` pixels in.
+        void fillTravel(size_t beg, size_t len, ssd1306_color_t color) {
+            if(mOrientation == Horizontal) {
+                mOled->fill_rectangle(mInnerX + beg, mInnerY, len, mInnerH, color);
+            } else {
+                mOled->fill_rectangle(mInnerX, mInnerY + mInnerH - beg - len, mInnerW, len, color);
+            }
+        }
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+////////////////////////////////////////////////////////////////////
+
+#endif // pnigauge_h
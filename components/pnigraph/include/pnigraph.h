@@ -11,7 +11,9 @@
 #include <cassert>
 #include <algorithm>
 #include <functional>
+#include <utility>
 #include "pnifixedpoint.h"
+#include "pnitrace.h"
 #include "esp_log.h"
 
 ////////////////////////////////////////////////////////////////////
@@ -25,6 +27,9 @@ class Graph {
         constexpr static const char* TAG = "pnigraph";
 
     public:
+            // Deliberately narrow: Xform's exact path maps raw values with
+            // one 64 bit multiply, which needs span^2 and size * RawOneVal
+            // to stay small, and 1/32 is already well under a pixel.
         static const size_t IntBits = 10;
         static const size_t FracBits = 5;
         using Datum = FixedPoint< int32_t, IntBits, FracBits >;
@@ -36,6 +41,54 @@ class Graph {
             Datum mYVal;
         };
 
+            // Sliding window min (or max) over the last `window` pushes, the
+            // classic monotonic deque: entries that can never be the answer
+            // again are dropped on push, so each push is amortized O(1) and
+            // the answer is always at the front.  Fixed capacity ring, no
+            // allocation after reset().
+        template< bool IsMax >
+        struct MonoQueue {
+            struct Entry {
+                Datum mVal;
+                size_t mSeq;
+            };
+
+            std::vector< Entry > mEntries;
+            size_t mBeg = 0;
+            size_t mSize = 0;
+
+            void reset(size_t window) {
+                mEntries.resize(window);
+                mBeg = 0;
+                mSize = 0;
+            }
+
+            void push(Datum val, size_t seq) {
+                size_t cap = mEntries.size();
+                    // Oldest entry fell out of the window.
+                if(mSize && mEntries[ mBeg ].mSeq + cap <= seq) {
+                    mBeg = wrap(mBeg + 1);
+                    --mSize;
+                }
+                    // Anything not better than val is dominated from now on.
+                while(mSize && ! better(mEntries[ wrap(mBeg + mSize - 1) ].mVal, val)) {
+                    --mSize;
+                }
+                mEntries[ wrap(mBeg + mSize) ] = { val, seq };
+                ++mSize;
+            }
+
+            Datum front() const { return mEntries[ mBeg ].mVal; }
+
+            static bool better(Datum const& lhs, Datum const& rhs) {
+                return IsMax ? rhs < lhs : lhs < rhs;
+            }
+
+            size_t wrap(size_t pos) const {
+                return pos < mEntries.size() ? pos : pos - mEntries.size();
+            }
+        };
+
         struct Axis {
             enum DynamicRange {
                 Static,
@@ -48,7 +101,56 @@ class Graph {
             Datum mSrcMax = 0;
             Datum mCenter = 0;
 
+                // Ring mode, see resizeRing().  Renderers read through at(),
+                // so in ring mode only write with push().
+            bool mRing = false;
+            size_t mHead = 0;               // Oldest sample
+            size_t mSeq = 0;                // Pushes so far
+            MonoQueue< false > mMinQueue;
+            MonoQueue< true > mMaxQueue;
+
+            size_t size() const { return mData.size(); }
+
+                // Logical order, oldest first in ring mode.
+            Datum const& at(size_t ind) const {
+                size_t pos = mHead + ind;
+                return mData[ pos < mData.size() ? pos : pos - mData.size() ];
+            }
+
+                // Turns the axis into a fixed length history of `num`
+                // samples, all `fill` to start.  push() then appends in O(1),
+                // dropping the oldest, instead of shifting mData.
+            void resizeRing(size_t num, Datum fill) {
+                mData.assign(num, fill);
+                mRing = true;
+                mHead = 0;
+                mSeq = 0;
+                mMinQueue.reset(num);
+                mMaxQueue.reset(num);
+                for(size_t ind = 0; ind < num; ++ind) {
+                    pushQueues(fill);
+                }
+            }
+
+            void push(Datum val) {
+                assert(mRing && ! mData.empty());
+                if(mData.empty()) {
+                    return; // EARLY RETURN!!!
+                }
+                mData[ mHead ] = val;
+                mHead = mHead + 1 < mData.size() ? mHead + 1 : 0;
+                pushQueues(val);
+            }
+
+                // O(1) in ring mode, a scan otherwise.  With no data,
+                // the current source range, so dynamic ranges hold still.
             DataPair getMinMax() const {
+                if(mData.empty()) {
+                    return DataPair(mSrcMin, mSrcMax); // EARLY RETURN!!!
+                }
+                if(mRing) {
+                    return DataPair(mMinQueue.front(), mMaxQueue.front());
+                }
                 auto mm = std::minmax_element(mData.begin(), mData.end());
                 return DataPair(*(mm.first), *(mm.second));
             }
@@ -74,6 +176,13 @@ class Graph {
                     mSrcMax = std::max(mSrcMax, range.second);
                 }
             }
+
+        private:
+            void pushQueues(Datum val) {
+                mMinQueue.push(val, mSeq);
+                mMaxQueue.push(val, mSeq);
+                ++mSeq;
+            }
         };
 
         struct Viewport {
@@ -97,19 +206,36 @@ class Graph {
         Viewport mViewport;
         Renderer* mRenderer = 0;
         Axis::DynamicRange mUseDynamicRange = Axis::Static;
+            // When there are more than two points per viewport column, map()
+            // and the renderers visit a min and a max point per column
+            // instead, so a long history still shows its peaks.
+        bool mDecimate = false;
 
         template< typename Type >
         void resize(size_t num, Type yVal) {
             mXAxis.mData.resize(num);
             mYAxis.mData.resize(num, yVal);
+            mYAxis.mRing = false;
+            mYAxis.mHead = 0;
             mXAxis.fillAsIndices();
         }
 
+            // Scrolling history: X is indices, Y a ring of `num` samples,
+            // append new ones with push().
+        template< typename Type >
+        void resizeRing(size_t num, Type yVal) {
+            mXAxis.mData.resize(num);
+            mXAxis.fillAsIndices();
+            mYAxis.resizeRing(num, yVal);
+        }
+
+        void push(Datum yVal) {
+            mYAxis.push(yVal);
+        }
+
         void draw() {
-            if(mUseDynamicRange != Axis::Static) {
-                // mXAxis.updateDynamicRange();
-                mYAxis.updateDynamicRange(mUseDynamicRange);
-            }
+            PNI_TRACE_SCOPE("graph.draw");
+            updateRanges();
             mRenderer->draw(this);
         }
 
@@ -127,58 +253,244 @@ class Graph {
 
         using MapFunc = std::function<void(size_t index, Point const& point)>;
         void map(MapFunc func) {
-            assert(mXAxis.mData.size() == mYAxis.mData.size());
-            for(size_t num = 0; num < mXAxis.mData.size(); ++num) {
-                Point tmp = {mXAxis.mData[ num ], mYAxis.mData[ num ]};
-                func(num, tmp);;
+            mapT(func);
+        }
+
+            // Same as map, but the callback type is known so it can inline.
+        template< class Func >
+        void mapT(Func&& func) {
+            assert(mXAxis.size() == mYAxis.size());
+            size_t size = mXAxis.size();
+            size_t cols = mViewport.mXSize;
+            if( ! mDecimate || size <= cols * 2 || cols == 0) {
+                for(size_t num = 0; num < size; ++num) {
+                    Point tmp = {mXAxis.at(num), mYAxis.at(num)};
+                    func(num, tmp);
+                }
+                return; // EARLY RETURN!!!
+            }
+
+                // Min then max of each column's bucket, at the X of the
+                // bucket's first sample.  Always two points per column so
+                // the count doesn't change frame to frame.
+            for(size_t col = 0; col < cols; ++col) {
+                size_t beg = col * size / cols;
+                size_t end = (col + 1) * size / cols;
+                Datum lo = mYAxis.at(beg);
+                Datum hi = lo;
+                for(size_t num = beg + 1; num < end; ++num) {
+                    Datum const& val = mYAxis.at(num);
+                    lo = val < lo ? val : lo;
+                    hi = hi < val ? val : hi;
+                }
+                Point tmp = {mXAxis.at(beg), lo};
+                func(col * 2, tmp);
+                tmp.mYVal = hi;
+                func(col * 2 + 1, tmp);
             }
         }
 
-            // TODO: Should just have utility function that xforms one dimension,
-            // and re-use that for x and y
+            // Maps a point from axis range to viewport pixels, clamping to
+            // the range.  Returns false (point untouched) if either range is
+            // empty.  Uses the cached per-axis transforms below.
         bool xformPoint(Point& point) {
-            bool ret = true;
-
-            // ESP_LOGI(TAG, "point = %d, %d", point.mXVal.get(), point.mYVal.get());
-
-            auto xSrcSize = mXAxis.mSrcMax - mXAxis.mSrcMin;
-            auto ySrcSize = mYAxis.mSrcMax - mYAxis.mSrcMin;
-
-            // ESP_LOGI(TAG, "  y min max = %d, %d",  mYAxis.mSrcMin.get(),  mYAxis.mSrcMax.get());
-            
-            // ESP_LOGI(TAG, "  src size = %d, %d", xSrcSize.get(), ySrcSize.get());
-            
-            if( xSrcSize != 0 && ySrcSize != 0) {
-                    // TODO: This clamps, but maybe we want to cull points instead.
-                point.mXVal.clamp(mXAxis.mSrcMin, mXAxis.mSrcMax);
-                point.mYVal.clamp(mYAxis.mSrcMin, mYAxis.mSrcMax);
-
-                // ESP_LOGI(TAG, "  point 1 = %d, %d", point.mXVal.get(), point.mYVal.get());
-                
-                point.mXVal -= mXAxis.mSrcMin;
-                point.mXVal *= mViewport.mXSize;
-                point.mXVal /= xSrcSize;
-                point.mXVal += mViewport.mXOrig;
-    
-                point.mYVal -= mYAxis.mSrcMin;
-                point.mYVal *= mViewport.mYSize;
-                point.mYVal /= ySrcSize;
-                point.mYVal += mViewport.mYOrig;
-
-                // ESP_LOGI(TAG, "  point 2 = %d, %d", point.mXVal.get(), point.mYVal.get());
-            } else {
-                ret = false;
-            }
-            
-            return ret;
+            if( ! updateXforms()) {
+                return false;
+            }
+            point.mXVal = mXXform.apply(point.mXVal);
+            point.mYVal = mYXform.apply(point.mYVal);
+            return true;
         }
 
+            // Batch version of xformPoint, checks the ranges once.
+        bool xformAll(Point* points, size_t num) {
+            if( ! updateXforms()) {
+                return false;
+            }
+            for(size_t ind = 0; ind < num; ++ind) {
+                points[ ind ].mXVal = mXXform.apply(points[ ind ].mXVal);
+                points[ ind ].mYVal = mYXform.apply(points[ ind ].mYVal);
+            }
+            return true;
+        }
+
+            // Affine transform for one axis:
+            //   out = (clamp(val) - min) * size / (max - min) + orig
+            // cached as a rounded up reciprocal of the range, so there's no
+            // divide per point.  That gives the same result as multiply then
+            // divide in Datum (bit for bit, wherever that doesn't overflow) for
+            // ranges up to 2^22 raw, larger or inverted ranges use the divide.
+            // Recomputed whenever the axis range or viewport changes, which is
+            // detected by comparing, since both are public data.
+        struct Xform {
+            static const size_t ScaleBits = 44;
+
+            int32_t mMin = 0;
+            int32_t mMax = 0;
+            size_t mOrig = 0;
+            size_t mSize = 0;
+            uint64_t mScale = 0;
+            int32_t mOffset = 0;
+            bool mValid = false;
+            bool mExact = false;
+
+            bool update(Axis const& axis, size_t orig, size_t size) {
+                if(axis.mSrcMin.getRaw() != mMin || axis.mSrcMax.getRaw() != mMax || orig != mOrig || size != mSize) {
+                    mMin = axis.mSrcMin.getRaw();
+                    mMax = axis.mSrcMax.getRaw();
+                    mOrig = orig;
+                    mSize = size;
+                    mOffset = Datum(int32_t(orig)).getRaw();
+
+                    int64_t span = int64_t(mMax) - mMin;
+                    uint64_t num = uint64_t(size) * Datum::RawOneVal;
+                    mValid = span != 0;
+                    mExact = span > 0 && span < (int64_t(1) << 22) && num < (uint64_t(1) << 19);
+                    mScale = mExact ? ((num << ScaleBits) + span - 1) / span : 0;
+                }
+                return mValid;
+            }
+
+            Datum apply(Datum val) const {
+                if(mExact) {
+                    int32_t raw = val.getRaw();
+                    raw = raw > mMin ? raw : mMin;
+                    raw = raw < mMax ? raw : mMax;
+                    uint64_t delta = uint32_t(raw - mMin);
+                    return Datum::fromRaw(int32_t((delta * mScale) >> ScaleBits) + mOffset);
+                } else {
+                    Datum minVal = Datum::fromRaw(mMin);
+                    Datum maxVal = Datum::fromRaw(mMax);
+                    val.clamp(minVal, maxVal);
+                    val -= minVal;
+                    val *= mSize;
+                    val /= maxVal - minVal;
+                    val += mOrig;
+                    return val;
+                }
+            }
+        };
+
+        Xform const& getXXform() const { return mXXform; }
+        Xform const& getYXform() const { return mYXform; }
+
     protected:
+        Xform mXXform;
+        Xform mYXform;
+
+        void updateRanges() {
+            if(mUseDynamicRange != Axis::Static) {
+                // mXAxis.updateDynamicRange();
+                mYAxis.updateDynamicRange(mUseDynamicRange);
+            }
+        }
+
+            // Both axes, no short circuit so both caches stay current.
+        bool updateXforms() {
+            bool xValid = mXXform.update(mXAxis, mViewport.mXOrig, mViewport.mXSize);
+            bool yValid = mYXform.update(mYAxis, mViewport.mYOrig, mViewport.mYSize);
+            return xValid && yValid;
+        }
 
     private:
 
 };
 
+////////////////////////////////////////////////////////////////////
+
+    // Static polymorphism version of the renderer path, CRTP.  Derived
+    // classes implement
+    //   void drawBars(Graph* graph, Graph::Point const* points, size_t num, Graph::Datum base);
+    // which gets a batch of points already in viewport coordinates plus
+    // `base`, the transformed axis center that bars start from.  Derived
+    // can also provide `bool isVertical() const` (default true) to say
+    // which axis the bars run along.
+    // Still a Graph::Renderer, so it works with a plain Graph through the
+    // virtual draw(), and with GraphT the per point path fully inlines.
+    // Base is the renderer base class, e.g. GraphSsd1306Base.
+template< class Derived, class Base = Graph::Renderer >
+class RendererT : public Base {
+    public:
+        using Base::Base;
+        using Datum = Graph::Datum;
+        using Point = Graph::Point;
+
+        static const size_t ChunkSize = 32;
+
+        virtual void draw(Graph* graph) { drawT(graph); }
+
+        void drawT(Graph* graph) {
+            Datum base;
+            if( ! getBase(graph, base)) {
+                return; // EARLY RETURN!!!
+            }
+
+            Point chunk[ ChunkSize ];
+            size_t num = 0;
+            graph->mapT([&](size_t, Point const& point) {
+                chunk[ num++ ] = point;
+                if(num == ChunkSize) {
+                    graph->xformAll(chunk, num);
+                    derived().drawBars(graph, chunk, num, base);
+                    num = 0;
+                }
+            });
+            if(num) {
+                graph->xformAll(chunk, num);
+                derived().drawBars(graph, chunk, num, base);
+            }
+        }
+
+            // Transforms points (in place) and draws them.
+        void drawPointsT(Graph* graph, Point* points, size_t num) {
+            Datum base;
+            if(getBase(graph, base) && graph->xformAll(points, num)) {
+                derived().drawBars(graph, points, num, base);
+            }
+        }
+
+        bool isVertical() const { return true; }
+
+    protected:
+        Derived& derived() { return *static_cast< Derived* >(this); }
+
+        bool getBase(Graph* graph, Datum& base) {
+            Point center = { graph->mXAxis.mCenter, graph->mYAxis.mCenter };
+            if( ! graph->xformPoint(center)) {
+                return false;
+            }
+            base = derived().isVertical() ? center.mYVal : center.mXVal;
+            return true;
+        }
+};
+
+template< class Derived, class Base >
+const size_t RendererT< Derived, Base >::ChunkSize;
+
+    // Graph that owns its renderer by final type, so draw() calls straight
+    // into it instead of through Renderer*.  Graph& users still work via
+    // mRenderer.  E.g.:
+    //   GraphT< GraphSsd1306BarLinesT > graph(oled);
+template< class RendererType >
+class GraphT : public Graph {
+    public:
+        RendererType mRendererT;
+
+        template< typename... Args >
+        GraphT(Args&&... args) : mRendererT(std::forward< Args >(args)...) {
+            mRenderer = &mRendererT;
+        }
+
+        GraphT(GraphT const& rhs) = delete;
+        GraphT& operator = (GraphT const& rhs) = delete;
+
+        void draw() {
+            PNI_TRACE_SCOPE("graph.draw");
+            updateRanges();
+            mRendererT.drawT(this);
+        }
+};
+
 ////////////////////////////////////////////////////////////////////
 
 } // end namespace pni
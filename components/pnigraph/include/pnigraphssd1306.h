@@ -7,6 +7,8 @@
 #ifndef pnigraphssd1306_h
 #define pnigraphssd1306_h
 
+#include <cstring>
+
 #include "pnigraph.h"
 #include "ssd1306.hpp"
 #include "driver/gpio.h"
@@ -231,6 +233,427 @@ public:
     }
 };
 
+    // CRTP versions of BarLines and BarRect, same pixels.  Per point work
+    // is a direct call into the OLED, see RendererT and GraphT.
+class GraphSsd1306BarLinesT : public RendererT< GraphSsd1306BarLinesT, GraphSsd1306Base > {
+public:
+    using RendererT::RendererT;
+
+    bool isVertical() const { return mOrientation == Vertical; }
+
+    void drawBars(Graph* graph, Point const* points, size_t num, Datum base) {
+        for(size_t ind = 0; ind < num; ++ind) {
+            Point src(points[ ind ]);
+            if(mOrientation == Vertical) {
+                src.mYVal = base;
+                draw_vline(src, points[ ind ]);
+            } else {
+                src.mXVal = base;
+                draw_hline(src, points[ ind ]);
+            }
+        }
+    }
+
+    virtual void drawOne(Graph* graph, Point const& point) {
+        Point tmp(point);
+        drawPointsT(graph, &tmp, 1);
+    }
+};
+
+class GraphSsd1306BarRectT : public RendererT< GraphSsd1306BarRectT, GraphSsd1306Base > {
+public:
+    using RendererT::RendererT;
+
+    Datum mWidth = { 5 };
+
+    bool isVertical() const { return mOrientation == Vertical; }
+
+    void drawBars(Graph* graph, Point const* points, size_t num, Datum base) {
+        for(size_t ind = 0; ind < num; ++ind) {
+            Point dst(points[ ind ]);
+            if(mOrientation == Vertical) {
+                dst.mYVal = base;
+                dst.mXVal += mWidth;
+            } else {
+                dst.mXVal = base;
+                dst.mYVal += mWidth;
+            }
+            fill_rectangle(points[ ind ], dst);
+        }
+    }
+
+    virtual void drawOne(Graph* graph, Point const& point) {
+        Point tmp(point);
+        drawPointsT(graph, &tmp, 1);
+    }
+};
+
+    // Bars composed straight into a local page-major 1-bpp framebuffer
+    //  (the SSD1306 memory layout: byte = 8 vertical pixels of one column).
+    //  Each bar is a rectangle, filled a byte at a time with a start/end
+    //  page mask, rather than the OLED's per pixel read-modify-write.
+    //  refresh() hands the whole buffer over with one update_buffer(), and
+    //  skips it entirely if nothing was drawn since the last refresh.
+    //  Same pixels as GraphSsd1306BarRect/BarLines (mStyle), including
+    //  clipping.  This renderer owns the display contents: anything drawn
+    //  into the OLED directly is overwritten on refresh.
+class GraphSsd1306Framebuffer : public RendererT< GraphSsd1306Framebuffer, GraphSsd1306Base > {
+public:
+    enum Style {
+        Lines,      // Same pixels as GraphSsd1306BarLines
+        Rect        // Same pixels as GraphSsd1306BarRect
+    };
+
+    Style mStyle = Rect;
+    Datum mWidth = { 5 };
+
+    GraphSsd1306Framebuffer(OLED* oled) : RendererT(oled) {
+        setupBuffer();
+    }
+
+    GraphSsd1306Framebuffer(gpio_num_t scl, gpio_num_t sda, ssd1306_panel_type_t type,
+            uint8_t address = 0x78) : RendererT(scl, sda, type, address) {
+        setupBuffer();
+    }
+
+    bool isVertical() const { return mOrientation == Vertical; }
+
+    void drawBars(Graph* graph, Point const* points, size_t num, Datum base) {
+        for(size_t ind = 0; ind < num; ++ind) {
+            Point src(points[ ind ]);
+            Point dst(points[ ind ]);
+            if(mStyle == Lines) {
+                (mOrientation == Vertical ? src.mYVal : src.mXVal) = base;
+                order(src.mXVal, dst.mXVal);
+                order(src.mYVal, dst.mYVal);
+                if(mOrientation == Vertical) {
+                    fillRect(src.mXVal.get(), src.mYVal.get(), 1, (dst.mYVal - src.mYVal).get(), mDrawColor);
+                } else {
+                    fillRect(src.mXVal.get(), src.mYVal.get(), (dst.mXVal - src.mXVal).get(), 1, mDrawColor);
+                }
+            } else {
+                if(mOrientation == Vertical) {
+                    dst.mYVal = base;
+                    dst.mXVal += mWidth;
+                } else {
+                    dst.mXVal = base;
+                    dst.mYVal += mWidth;
+                }
+                order(src.mXVal, dst.mXVal);
+                order(src.mYVal, dst.mYVal);
+                fillRect(src.mXVal.get(), src.mYVal.get(), (dst.mXVal - src.mXVal).get(), (dst.mYVal - src.mYVal).get(), mDrawColor);
+            }
+        }
+    }
+
+    virtual void drawOne(Graph* graph, Point const& point) {
+        Point tmp(point);
+        drawPointsT(graph, &tmp, 1);
+    }
+
+    virtual void clearViewport(Graph* graph) {
+        auto const& view = graph->mViewport;
+        fillRect(view.mXOrig, view.mYOrig, view.mXSize, view.mYSize, mClearColor);
+    }
+
+    virtual void clearAll(Graph* graph) {
+        memset(mBuffer, 0, sizeof(mBuffer));
+        mDirty = true;
+    }
+
+    virtual void refresh(Graph* graph, bool force = false) {
+        if(mOled && (mDirty || force)) {
+            mOled->update_buffer(mBuffer, mWidthPx * mPages);
+            mOled->refresh(force);
+            mDirty = false;
+        }
+    }
+
+    uint8_t const* getBuffer() const { return mBuffer; }
+
+        // Same argument types and clipping as OLED::fill_rectangle.
+    void fillRect(int8_t xVal, int8_t yVal, uint8_t width, uint8_t height, ssd1306_color_t color) {
+        int left = std::max< int >(xVal, 0);
+        int right = std::min< int >(xVal + width, mWidthPx);
+        int top = std::max< int >(yVal, 0);
+        int bottom = std::min< int >(yVal + height, mPages * 8);
+        if(left >= right || top >= bottom || color == TRANSPARENT) {
+            return; // EARLY RETURN!!!
+        }
+
+        int first = top >> 3;
+        int last = (bottom - 1) >> 3;
+        for(int page = first; page <= last; ++page) {
+            uint8_t mask = 0xff;
+            if(page == first) {
+                mask &= uint8_t(0xff << (top & 7));
+            }
+            if(page == last) {
+                mask &= uint8_t(0xff >> (7 - ((bottom - 1) & 7)));
+            }
+
+            uint8_t* cur = mBuffer + page * mWidthPx + left;
+            uint8_t* end = mBuffer + page * mWidthPx + right;
+            if(color == WHITE) {
+                for(; cur < end; ++cur) *cur |= mask;
+            } else if(color == BLACK) {
+                for(; cur < end; ++cur) *cur &= ~mask;
+            } else {
+                for(; cur < end; ++cur) *cur ^= mask;
+            }
+        }
+        mDirty = true;
+    }
+
+protected:
+    uint8_t mBuffer[ 128 * 64 / 8 ];
+    int mWidthPx = 128;
+    int mPages = 8;
+    bool mDirty = true;
+
+    void setupBuffer() {
+        if(mOled) {
+            mWidthPx = mOled->get_width();
+            mPages = mOled->get_height() / 8;
+        }
+        memset(mBuffer, 0, sizeof(mBuffer));
+    }
+};
+
+    // Bar graph that only draws what changed since the last frame.
+    //  Caches each bar's pixel extents, draws just the grow/shrink segments
+    //  and remembers which display pages (and columns) they touch.  Drawing
+    //  is deferred to refresh(), which pushes one page at a time so the OLED
+    //  dirty box only ever covers that page, and clean pages never go over
+    //  I2C.  If that's not cheaper than one box around everything (e.g.
+    //  every page changed across the full width) it sends the one box.
+    //  Produces the same pixels as GraphSsd1306BarRect/BarLines with a
+    //  clearViewport() every frame, so just don't call clearViewport()
+    //  per frame, that forces a full redraw.
+    //  Bars that overlap (e.g., mWidth wider than the spacing) fall back to
+    //  full redraws.
+class GraphSsd1306BarIncremental : public GraphSsd1306Base {
+public:
+    using GraphSsd1306Base::GraphSsd1306Base;
+
+    enum Style {
+        Lines,      // Same pixels as GraphSsd1306BarLines
+        Rect        // Same pixels as GraphSsd1306BarRect
+    };
+
+    Style mStyle = Rect;
+    Datum mWidth = { 5 };
+
+    virtual void draw(Graph* graph) {
+        mNext.clear();
+        graph->mapT([&](size_t, Point const& point) {
+            Extent extent = { 0, 0, 0, 0 };
+            calcExtent(graph, point, extent);
+            mNext.push_back(extent);
+        });
+
+        if( ! sameLayout()) {
+            clearViewport(graph);
+            for(auto const& extent : mNext) {
+                addSpan(extent, extent.mBeg, extent.mEnd, mDrawColor);
+            }
+        } else {
+            for(size_t num = 0; num < mNext.size(); ++num) {
+                auto const& cur = mExtents[ num ];
+                auto const& next = mNext[ num ];
+                    // Erase what's no longer covered, then draw what's new.
+                addSpan(cur, cur.mBeg, std::min(cur.mEnd, next.mBeg), mClearColor);
+                addSpan(cur, std::max(cur.mBeg, next.mEnd), cur.mEnd, mClearColor);
+                addSpan(next, next.mBeg, std::min(next.mEnd, cur.mBeg), mDrawColor);
+                addSpan(next, std::max(next.mBeg, cur.mEnd), next.mEnd, mDrawColor);
+            }
+        }
+        mExtents.swap(mNext);
+    }
+
+    virtual void clearViewport(Graph* graph) {
+        auto const& view = graph->mViewport;
+        addOp(view.mXOrig, view.mYOrig, view.mXSize, view.mYSize, mClearColor);
+        invalidate();
+    }
+
+    virtual void clearAll(Graph* graph) {
+        mPending.clear();
+        invalidate();
+        if(mOled) {
+            mOled->clear();
+            mDirtyPages = (1 << (mOled->get_height() / 8)) - 1;
+        }
+    }
+
+    virtual void refresh(Graph* graph, bool force = false) {
+        if( ! mOled) {
+            return;
+        }
+
+        if(force) {
+            for(auto const& op : mPending) {
+                mOled->fill_rectangle(op.mX, op.mY, op.mW, op.mH, op.mColor);
+            }
+            mOled->refresh(true);
+        } else if( ! perPageIsCheaper()) {
+            for(auto const& op : mPending) {
+                mOled->fill_rectangle(op.mX, op.mY, op.mW, op.mH, op.mColor);
+            }
+            mOled->refresh(false);
+        } else {
+            for(int page = 0; mDirtyPages >> page; ++page) {
+                if(mDirtyPages & (1 << page)) {
+                    int top = page * 8;
+                    for(auto const& op : mPending) {
+                        int beg = std::max< int >(op.mY, top);
+                        int end = std::min< int >(op.mY + op.mH, top + 8);
+                        if(beg < end) {
+                            mOled->fill_rectangle(op.mX, beg, op.mW, end - beg, op.mColor);
+                        }
+                    }
+                    mOled->refresh(false);
+                }
+            }
+        }
+        mPending.clear();
+        mDirtyPages = 0;
+    }
+
+        // Forget cached extents, next draw is a full redraw.
+    void invalidate() { mExtents.clear(); }
+
+        // One bit per 8 pixel display page, pending for the next refresh.
+    uint8_t getDirtyPages() const { return mDirtyPages; }
+
+protected:
+        // Pixel extents of one bar, [beg, end) ranges.
+    struct Extent {
+        int16_t mLaneBeg;       // Across the bar
+        int16_t mLaneEnd;
+        int16_t mBeg;           // Along the bar
+        int16_t mEnd;
+    };
+
+    struct Op {
+        int16_t mX;
+        int16_t mY;
+        int16_t mW;
+        int16_t mH;
+        ssd1306_color_t mColor;
+    };
+
+    std::vector< Extent > mExtents;
+    std::vector< Extent > mNext;
+    std::vector< Op > mPending;
+    uint8_t mDirtyPages = 0;
+    int16_t mPageLeft[ 8 ];
+    int16_t mPageRight[ 8 ];
+
+    virtual void drawOne(Graph* graph, Point const& point) {}
+
+        // Same math as the BarLines/BarRect drawOne + OLED calls, so the
+        // resulting pixels are identical.
+    bool calcExtent(Graph* graph, Point const& pointOrig, Extent& extent) {
+        auto src(pointOrig);
+        getStartPos(graph, src);
+        if(! graph->xformPoint(src)) return false; // EARLY RETURN!!!
+
+        auto dst(pointOrig);
+        if(! graph->xformPoint(dst)) return false; // EARLY RETURN!!!
+
+        bool vert = mOrientation == Vertical;
+        Datum laneVal = vert ? src.mXVal : src.mYVal;
+        Datum lower = vert ? src.mYVal : src.mXVal;
+        Datum upper = vert ? dst.mYVal : dst.mXVal;
+        order(lower, upper);
+
+        int laneWidth = 1;
+        if(mStyle == Rect) {
+            Datum laneEnd = laneVal + mWidth;
+            order(laneVal, laneEnd);
+            laneWidth = (laneEnd - laneVal).get();
+        }
+
+        extent.mLaneBeg = laneVal.get();
+        extent.mLaneEnd = extent.mLaneBeg + laneWidth;
+        extent.mBeg = lower.get();
+        extent.mEnd = extent.mBeg + (upper - lower).get();
+        return true;
+    }
+
+        // Deltas only work if bars kept their lanes and don't overlap.
+    bool sameLayout() const {
+        if(mExtents.size() != mNext.size()) {
+            return false;
+        }
+        for(size_t num = 0; num < mNext.size(); ++num) {
+            auto const& cur = mExtents[ num ];
+            auto const& next = mNext[ num ];
+            if(cur.mLaneBeg != next.mLaneBeg || cur.mLaneEnd != next.mLaneEnd) {
+                return false;
+            }
+            if(num > 0 && next.mLaneBeg < mNext[ num - 1 ].mLaneEnd) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void addSpan(Extent const& extent, int beg, int end, ssd1306_color_t color) {
+        if(beg >= end || extent.mLaneBeg >= extent.mLaneEnd) {
+            return;
+        }
+        int laneSize = extent.mLaneEnd - extent.mLaneBeg;
+        if(mOrientation == Vertical) {
+            addOp(extent.mLaneBeg, beg, laneSize, end - beg, color);
+        } else {
+            addOp(beg, extent.mLaneBeg, end - beg, laneSize, color);
+        }
+    }
+
+    void addOp(int xVal, int yVal, int width, int height, ssd1306_color_t color) {
+        int top = std::max(yVal, 0);
+        int bottom = std::min< int >(yVal + height, mOled ? mOled->get_height() : 0);
+        if(width <= 0 || top >= bottom) {
+            return; // EARLY RETURN!!!
+        }
+        Op op = { int16_t(xVal), int16_t(yVal), int16_t(width), int16_t(height), color };
+        mPending.push_back(op);
+
+        int first = top >> 3;
+        int last = (bottom - 1) >> 3;
+        for(int page = first; page <= last; ++page) {
+            if( ! (mDirtyPages & (1 << page))) {
+                mDirtyPages |= 1 << page;
+                mPageLeft[ page ] = xVal;
+                mPageRight[ page ] = xVal + width;
+            } else {
+                mPageLeft[ page ] = std::min< int >(mPageLeft[ page ], xVal);
+                mPageRight[ page ] = std::max< int >(mPageRight[ page ], xVal + width);
+            }
+        }
+    }
+
+        // Each refresh costs addressing commands plus the dirty box, so when
+        // the dirty pages all span about the same columns, one box is cheaper.
+    bool perPageIsCheaper() const {
+        static const int Overhead = 8;
+        int perPage = 0;
+        int first = 8, last = -1, left = 128, right = 0;
+        for(int page = 0; page < 8; ++page) {
+            if(mDirtyPages & (1 << page)) {
+                perPage += Overhead + mPageRight[ page ] - mPageLeft[ page ];
+                first = std::min(first, page);
+                last = page;
+                left = std::min< int >(left, mPageLeft[ page ]);
+                right = std::max< int >(right, mPageRight[ page ]);
+            }
+        }
+        return perPage < Overhead + (last - first + 1) * (right - left);
+    }
+};
+
 
 
 ////////////////////////////////////////////////////////////////////
@@ -0,0 +1,279 @@
+
+#include <atomic>
+#include <cstdlib>
+#include <list>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "microtest/microtest.h"
+
+#include "pnimem.h"
+
+#include "driver/i2s.h"
+#include "pnihost/i2ssources.h"
+
+#include "pniapa102.h"
+#include "pnifft.h"
+#include "pnimicsph0645.h"
+
+using namespace std;
+using namespace pni;
+
+    // Counts heap allocations, to check steady state processing doesn't
+    // allocate.
+static atomic< size_t > gAllocs(0);
+
+void* operator new(size_t size) {
+    ++gAllocs;
+    void* ptr = malloc(size ? size : 1);
+    if( ! ptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+TEST(arenaAlloc) {
+    ArenaT< 256 > arena;
+    ASSERT_EQ(arena.getSize(), 256u);
+
+    char* bytes = arena.allocArray< char >(3);
+    ASSERT_TRUE(bytes != nullptr);
+    ASSERT_EQ(arena.getUsed(), 3u);
+    double* dbl = arena.allocArray< double >(2);
+    ASSERT_EQ(uintptr_t(dbl) % alignof(double), 0u);
+    ASSERT_EQ(arena.getUsed(), alignof(double) + 16);
+
+        // Too big: nothing changes but the failure count.
+    size_t used = arena.getUsed();
+    void* big = arena.alloc(256);
+    ASSERT_TRUE(big == nullptr);
+    ASSERT_EQ(arena.getUsed(), used);
+    ASSERT_EQ(arena.getFailures(), 1u);
+
+    void* rest = arena.alloc(256 - used, 1);
+    ASSERT_TRUE(rest != nullptr);
+    ASSERT_TRUE(arena.owns(rest));
+    ASSERT_EQ(arena.getUsed(), 256u);
+
+    arena.reset();
+    ASSERT_EQ(arena.getUsed(), 0u);
+    ASSERT_EQ(arena.getHighWater(), 256u);
+    void* again = arena.alloc(1);
+    ASSERT_TRUE(again == bytes);
+
+    int stackVal = 0;
+    ASSERT_FALSE(arena.owns(&stackVal));
+
+    arena.clearStats();
+    ASSERT_EQ(arena.getFailures(), 0u);
+    ASSERT_EQ(arena.getHighWater(), 1u);
+}
+
+TEST(arenaFreeAndScope) {
+    Arena arena(1024);
+    void* first = arena.alloc(100);
+    void* second = arena.alloc(100);
+    size_t used = arena.getUsed();
+
+        // Only the last allocation comes back.
+    arena.free(first, 100);
+    ASSERT_EQ(arena.getUsed(), used);
+    arena.free(second, 100);
+    ASSERT_TRUE(arena.getUsed() < used);
+    void* third = arena.alloc(100);
+    ASSERT_TRUE(third == second);
+
+    used = arena.getUsed();
+    {
+        ArenaScope scope(arena);
+        arena.alloc(500);
+        ASSERT_TRUE(arena.getUsed() > used);
+    }
+    ASSERT_EQ(arena.getUsed(), used);
+}
+
+TEST(arenaVector) {
+    ArenaT< 4096 > arena;
+    size_t before = gAllocs;
+    {
+        ArenaVector< int32_t > vec(arena);
+        vec.reserve(256);
+        for(int32_t ind = 0; ind < 256; ++ind) {
+            vec.push_back(ind);
+        }
+        ASSERT_TRUE(arena.owns(vec.data()));
+        ASSERT_EQ(vec[ 255 ], 255);
+
+            // Grows into a new buffer, the old one stays until reset.
+        vec.push_back(256);
+        ASSERT_TRUE(arena.owns(vec.data()));
+        ASSERT_TRUE(arena.getUsed() >= (256 + 512) * sizeof(int32_t));
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(arena.getFailures(), 0u);
+
+        // Out of room: the heap takes over, and it shows.
+    arena.reset();
+    {
+        ArenaVector< int32_t > vec(arena);
+        vec.resize(2048);
+        ASSERT_FALSE(arena.owns(vec.data()));
+    }
+    ASSERT_EQ(gAllocs - before, 1u);
+    ASSERT_EQ(arena.getFailures(), 1u);
+}
+
+TEST(fixedPool) {
+    FixedPoolT< 20, 4 > pool;
+    ASSERT_EQ(pool.getBlockSize(), FixedPool::roundBlockSize(20));
+    ASSERT_EQ(pool.getBlockSize() % MemAlign, 0u);
+    ASSERT_EQ(pool.getNumFree(), 4u);
+
+    void* blocks[ 4 ];
+    for(auto& block : blocks) {
+        block = pool.alloc();
+        ASSERT_TRUE(block != nullptr);
+        ASSERT_TRUE(pool.owns(block));
+        ASSERT_EQ(uintptr_t(block) % MemAlign, 0u);
+    }
+    ASSERT_TRUE(blocks[ 0 ] != blocks[ 1 ]);
+    ASSERT_EQ(pool.getNumFree(), 0u);
+    void* none = pool.alloc();
+    ASSERT_TRUE(none == nullptr);
+    ASSERT_EQ(pool.getFailures(), 1u);
+
+    pool.free(blocks[ 2 ]);
+    void* reused = pool.alloc();
+    ASSERT_TRUE(reused == blocks[ 2 ]);
+    none = pool.alloc(pool.getBlockSize() + 1);
+    ASSERT_TRUE(none == nullptr);
+    ASSERT_EQ(pool.getFailures(), 2u);
+
+    for(auto& block : blocks) {
+        pool.free(block);
+    }
+    pool.free(nullptr);
+    ASSERT_EQ(pool.getNumFree(), 4u);
+    ASSERT_EQ(pool.getMinFree(), 0u);
+}
+
+TEST(fixedPoolThreads) {
+    FixedPool pool(64, 32);
+    atomic< size_t > got(0);
+    auto churn = [&]() {
+        for(size_t ind = 0; ind < 20000; ++ind) {
+            void* ptrs[ 4 ];
+            for(auto& ptr : ptrs) {
+                ptr = pool.alloc();
+                if(ptr) {
+                    ++got;
+                    *static_cast< size_t* >(ptr) = ind;
+                }
+            }
+            for(auto& ptr : ptrs) {
+                pool.free(ptr);
+            }
+        }
+    };
+    thread one(churn);
+    thread two(churn);
+    churn();
+    one.join();
+    two.join();
+        // 3 threads * 4 blocks never runs out of 32.
+    ASSERT_EQ(got, 3u * 20000 * 4);
+    ASSERT_EQ(pool.getNumFree(), 32u);
+    ASSERT_EQ(pool.getFailures(), 0u);
+}
+
+TEST(poolAllocatorList) {
+    FixedPoolT< 32, 16 > pool;
+    using Alloc = PoolAllocator< int >;
+    list< int, Alloc > items{ Alloc(pool) };
+
+    size_t before = gAllocs;
+    for(int round = 0; round < 100; ++round) {
+        for(int ind = 0; ind < 16; ++ind) {
+            items.push_back(ind);
+        }
+        items.clear();
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(pool.getNumFree(), 16u);
+    ASSERT_EQ(pool.getFailures(), 0u);
+
+        // Runs out: the 17th node comes from the heap.
+    for(int ind = 0; ind < 17; ++ind) {
+        items.push_back(ind);
+    }
+    ASSERT_EQ(gAllocs - before, 1u);
+    ASSERT_EQ(pool.getFailures(), 1u);
+    items.clear();
+    ASSERT_EQ(pool.getNumFree(), 16u);
+}
+
+    // Mic -> FFTs -> LEDs, per frame buffers from an arena: after the
+    // first frame, nothing touches the heap.
+TEST(steadyState) {
+    using namespace pnihost;
+
+    I2sGenerator gen({ { 440.0f, 0.001f } });
+    i2sSetSource(I2S_NUM_0, &gen);
+    MicSph0645 mic;
+    MicSph0645::Config config = { 0, 22050, 2, 32, 4, 128, 26, 25, I2S_PIN_NO_CHANGE, 22 };
+    bool ok = mic.init(config);
+    ASSERT_TRUE(ok);
+
+    FftPffft< 9 > fft;
+    FftTiny< 5 > tiny;
+    Apa102Software apa;
+    apa.init({ GPIO_NUM_23, GPIO_NUM_18 });
+
+    ArenaT< 8 * 1024 > arena;
+    size_t before = 0;
+    for(size_t frame = 0; frame < 20; ++frame) {
+        if(frame == 1) {
+            before = gAllocs;
+        }
+        arena.reset();
+
+        ArenaVector< int32_t > samples(arena);
+        samples.reserve(4 * 128 * 2);
+        int bytes = mic.readSamples(samples);
+        ASSERT_TRUE(bytes > 0);
+        mic.reorderSamples(samples);
+
+        for(size_t ind = 0; ind < fft.Num; ++ind) {
+            fft.mReal[ ind ] = int16_t(samples[ ind ] >> 16);
+        }
+        fft.doHanningWindow();
+        fft.doFft();
+        fft.convToReal();
+
+        for(size_t ind = 0; ind < tiny.Num; ++ind) {
+            tiny.mReal[ ind ] = fft.mReal[ ind ];
+        }
+        tiny.doFft();
+
+        ArenaVector< Apa102::Color > colors(arena);
+        colors.resize(60);
+        for(size_t ind = 0; ind < colors.size(); ++ind) {
+            uint8_t val = uint8_t(std::min< int >(fft.mReal[ ind ], 255));
+            colors[ ind ] = { val, 0, uint8_t(255 - val), 8 };
+        }
+        apa.writeColors(colors.data(), colors.size());
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(arena.getFailures(), 0u);
+    ASSERT_TRUE(arena.getHighWater() >= 4 * 128 * 2 * sizeof(int32_t));
+
+    mic.uninit();
+    i2sSetSource(I2S_NUM_0, 0);
+}
+
+TEST_MAIN();
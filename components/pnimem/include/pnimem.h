@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Memory without heap churn: a per-frame bump arena, fixed block pools
+//  and STL allocators over both.
+//
+//  Arena hands out memory by bumping an offset into one buffer and
+//  gets it all back with reset(), e.g., at the top of each frame, so
+//  buffers that only live for a frame never touch the heap:
+//    static ArenaT< 16 * 1024 > frameArena;
+//    for(;;) {
+//        frameArena.reset();
+//        ArenaVector< int32_t > samples(frameArena);
+//        mic.readSamples(samples);
+//        ...
+//    }
+//  Not thread safe: one arena per task.
+//
+//  FixedPool hands out equal sized blocks from a free list, e.g., for
+//  messages or list nodes that outlive a frame.  Alloc and free are O(1)
+//  and safe from any task (a portMUX critical section).
+//
+//  Both come in a runtime-sized version that allocates its buffer once
+//  (or uses one passed in) and a template version with the buffer inline
+//  (ArenaT, FixedPoolT), for static storage.  When they run out, alloc
+//  returns nullptr and the STL allocators fall back to the heap; either
+//  way getFailures() counts it, so size them by checking that it stays
+//  at 0 (and from the high/low water marks).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnimem_h
+#define pnimem_h
+
+#include "freertos/FreeRTOS.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+    // Default alignment: enough for any type.
+static const size_t MemAlign = alignof(std::max_align_t);
+
+////////////////////////////////////////////////////////////////////
+
+class Arena {
+    public:
+            // Allocates `size` bytes once, here.
+        Arena(size_t size);
+            // Uses `buf`, which must outlive the arena.
+        Arena(void* buf, size_t size);
+
+        Arena(Arena const& rhs) = delete;
+        Arena& operator = (Arena const& rhs) = delete;
+
+            // nullptr (and counted in getFailures) if it doesn't fit.
+            // `align` must be a power of 2.
+        void* alloc(size_t size, size_t align = MemAlign) {
+            uintptr_t base = uintptr_t(mBuf);
+            uintptr_t pos = (base + mUsed + align - 1) & ~uintptr_t(align - 1);
+            size_t end = size_t(pos - base) + size;
+            if(end > mSize) {
+                ++mFailures;
+                return nullptr; // EARLY RETURN!!!
+            }
+            mUsed = end;
+            mHighWater = std::max(mHighWater, mUsed);
+            return reinterpret_cast< void* >(pos);
+        }
+
+        template< class Type >
+        Type* allocArray(size_t num) {
+            return static_cast< Type* >(alloc(num * sizeof(Type), alignof(Type)));
+        }
+
+            // Only gives memory back if it was the last allocation, so
+            // LIFO temporaries can be reused within a frame.  Everything
+            // else comes back at reset().
+        void free(void* ptr, size_t size) {
+            if(ptr && static_cast< uint8_t* >(ptr) + size == mBuf + mUsed) {
+                mUsed = static_cast< uint8_t* >(ptr) - mBuf;
+            }
+        }
+
+            // Frees everything.  Anything allocated is garbage after this.
+        void reset() { mUsed = 0; }
+
+            // Frees everything allocated since getUsed() returned `used`.
+        void rewind(size_t used) {
+            assert(used <= mUsed);
+            mUsed = used;
+        }
+
+        bool owns(void const* ptr) const {
+            return ptr >= mBuf && ptr < mBuf + mSize;
+        }
+
+        size_t getSize() const { return mSize; }
+        size_t getUsed() const { return mUsed; }
+        size_t getHighWater() const { return mHighWater; }      // Most used at once
+        size_t getFailures() const { return mFailures; }        // Allocs that didn't fit
+
+        void clearStats() {
+            mHighWater = mUsed;
+            mFailures = 0;
+        }
+
+    private:
+        std::unique_ptr< uint8_t[] > mOwned;
+        uint8_t* mBuf;
+        size_t mSize;
+        size_t mUsed = 0;
+        size_t mHighWater = 0;
+        size_t mFailures = 0;
+};
+
+    // Buffer inline, e.g., for a static arena.
+template< size_t Size >
+class ArenaT : public Arena {
+    public:
+        ArenaT() : Arena(mStorage, Size) {}
+
+    private:
+        alignas(MemAlign) uint8_t mStorage[ Size ];
+};
+
+    // Rewinds `arena` to where it was at construction, for scratch
+    // memory within a frame.
+class ArenaScope {
+    public:
+        ArenaScope(Arena& arena) :
+            mArena(arena),
+            mUsed(arena.getUsed()) {
+        }
+
+        ~ArenaScope() {
+            mArena.rewind(mUsed);
+        }
+
+        ArenaScope(ArenaScope const& rhs) = delete;
+        ArenaScope& operator = (ArenaScope const& rhs) = delete;
+
+    private:
+        Arena& mArena;
+        size_t mUsed;
+};
+
+////////////////////////////////////////////////////////////////////
+
+class FixedPool {
+    public:
+            // `blockSize` is rounded up to a multiple of MemAlign.
+            // Allocates the blocks once, here.
+        FixedPool(size_t blockSize, size_t numBlocks);
+            // Uses `buf` (MemAlign aligned, getBufSize(blockSize,
+            // numBlocks) bytes), which must outlive the pool.
+        FixedPool(void* buf, size_t blockSize, size_t numBlocks);
+
+        FixedPool(FixedPool const& rhs) = delete;
+        FixedPool& operator = (FixedPool const& rhs) = delete;
+
+        static constexpr size_t roundBlockSize(size_t blockSize) {
+            return ((blockSize > sizeof(void*) ? blockSize : sizeof(void*)) + MemAlign - 1) & ~(MemAlign - 1);
+        }
+
+        static constexpr size_t getBufSize(size_t blockSize, size_t numBlocks) {
+            return roundBlockSize(blockSize) * numBlocks;
+        }
+
+            // nullptr (and counted in getFailures) if all blocks are out.
+        void* alloc() {
+            portENTER_CRITICAL(&mMux);
+            Node* node = mFree;
+            if(node) {
+                mFree = node->mNext;
+                --mNumFree;
+                mMinFree = std::min(mMinFree, mNumFree);
+            } else {
+                ++mFailures;
+            }
+            portEXIT_CRITICAL(&mMux);
+            return node;
+        }
+
+            // Same, but also nullptr (and counted) if `size` doesn't fit a
+            // block.
+        void* alloc(size_t size) {
+            if(size > mBlockSize) {
+                portENTER_CRITICAL(&mMux);
+                ++mFailures;
+                portEXIT_CRITICAL(&mMux);
+                return nullptr; // EARLY RETURN!!!
+            }
+            return alloc();
+        }
+
+        void free(void* ptr) {
+            if( ! ptr) {
+                return; // EARLY RETURN!!!
+            }
+            assert(owns(ptr) && (static_cast< uint8_t* >(ptr) - mBuf) % mBlockSize == 0);
+            Node* node = static_cast< Node* >(ptr);
+            portENTER_CRITICAL(&mMux);
+            node->mNext = mFree;
+            mFree = node;
+            ++mNumFree;
+            portEXIT_CRITICAL(&mMux);
+        }
+
+        bool owns(void const* ptr) const {
+            return ptr >= mBuf && ptr < mBuf + mBlockSize * mNumBlocks;
+        }
+
+        size_t getBlockSize() const { return mBlockSize; }
+        size_t getNumBlocks() const { return mNumBlocks; }
+        size_t getNumFree() const { return mNumFree; }
+        size_t getMinFree() const { return mMinFree; }          // Low water mark
+        size_t getFailures() const { return mFailures; }
+
+    private:
+        struct Node {
+            Node* mNext;
+        };
+
+        void init();
+
+        std::unique_ptr< uint8_t[] > mOwned;
+        uint8_t* mBuf;
+        size_t mBlockSize;
+        size_t mNumBlocks;
+        Node* mFree = nullptr;          // Guarded by mMux, like the counts
+        size_t mNumFree = 0;
+        size_t mMinFree = 0;
+        size_t mFailures = 0;
+        portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+    // Blocks inline, e.g., for a static pool.
+template< size_t BlockSize, size_t NumBlocks >
+class FixedPoolT : public FixedPool {
+    public:
+        FixedPoolT() : FixedPool(mStorage, BlockSize, NumBlocks) {}
+
+    private:
+        alignas(MemAlign) uint8_t mStorage[ getBufSize(BlockSize, NumBlocks) ];
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // STL allocator over an Arena.  Deallocation only gives memory back
+    // when it's the arena's last allocation, so containers that grow
+    // leave their old buffers behind until reset(): reserve() up front.
+    // Containers using it must not outlive the arena's next reset().
+template< class Type >
+class ArenaAllocator {
+    public:
+        using value_type = Type;
+
+        ArenaAllocator(Arena& arena) : mArena(&arena) {}
+
+        template< class Other >
+        ArenaAllocator(ArenaAllocator< Other > const& rhs) : mArena(rhs.getArena()) {}
+
+        Type* allocate(size_t num) {
+            void* ptr = mArena->alloc(num * sizeof(Type), alignof(Type));
+            if( ! ptr) {
+                ptr = ::operator new(num * sizeof(Type));      // Counted by the arena
+            }
+            return static_cast< Type* >(ptr);
+        }
+
+        void deallocate(Type* ptr, size_t num) {
+            if(mArena->owns(ptr)) {
+                mArena->free(ptr, num * sizeof(Type));
+            } else {
+                ::operator delete(ptr);
+            }
+        }
+
+        Arena* getArena() const { return mArena; }
+
+    private:
+        Arena* mArena;
+};
+
+template< class Lhs, class Rhs >
+bool operator == (ArenaAllocator< Lhs > const& lhs, ArenaAllocator< Rhs > const& rhs) {
+    return lhs.getArena() == rhs.getArena();
+}
+
+template< class Lhs, class Rhs >
+bool operator != (ArenaAllocator< Lhs > const& lhs, ArenaAllocator< Rhs > const& rhs) {
+    return ! (lhs == rhs);
+}
+
+template< class Type >
+using ArenaVector = std::vector< Type, ArenaAllocator< Type > >;
+
+////////////////////////////////////////////////////////////////////
+
+    // STL allocator over a FixedPool, one block per allocation, for
+    // node based containers (std::list, std::map...).  Allocations
+    // bigger than a block, or made when the pool is out, come from the
+    // heap (and are counted by the pool).
+template< class Type >
+class PoolAllocator {
+    public:
+        using value_type = Type;
+
+        PoolAllocator(FixedPool& pool) : mPool(&pool) {}
+
+        template< class Other >
+        PoolAllocator(PoolAllocator< Other > const& rhs) : mPool(rhs.getPool()) {}
+
+        Type* allocate(size_t num) {
+            static_assert(alignof(Type) <= MemAlign, "PoolAllocator blocks are only MemAlign aligned");
+            void* ptr = mPool->alloc(num * sizeof(Type));
+            if( ! ptr) {
+                ptr = ::operator new(num * sizeof(Type));
+            }
+            return static_cast< Type* >(ptr);
+        }
+
+        void deallocate(Type* ptr, size_t num) {
+            if(mPool->owns(ptr)) {
+                mPool->free(ptr);
+            } else {
+                ::operator delete(ptr);
+            }
+        }
+
+        FixedPool* getPool() const { return mPool; }
+
+    private:
+        FixedPool* mPool;
+};
+
+template< class Lhs, class Rhs >
+bool operator == (PoolAllocator< Lhs > const& lhs, PoolAllocator< Rhs > const& rhs) {
+    return lhs.getPool() == rhs.getPool();
+}
+
+template< class Lhs, class Rhs >
+bool operator != (PoolAllocator< Lhs > const& lhs, PoolAllocator< Rhs > const& rhs) {
+    return ! (lhs == rhs);
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pnimem_h
@@ -0,0 +1,57 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pnimem.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+Arena::Arena(size_t size) :
+    mOwned(new uint8_t[ size ]),
+    mBuf(mOwned.get()),
+    mSize(size) {
+}
+
+Arena::Arena(void* buf, size_t size) :
+    mBuf(static_cast< uint8_t* >(buf)),
+    mSize(size) {
+}
+
+////////////////////////////////////////////////////////////////////
+
+FixedPool::FixedPool(size_t blockSize, size_t numBlocks) :
+    mOwned(new uint8_t[ getBufSize(blockSize, numBlocks) ]),
+    mBuf(mOwned.get()),
+    mBlockSize(roundBlockSize(blockSize)),
+    mNumBlocks(numBlocks) {
+    init();
+}
+
+FixedPool::FixedPool(void* buf, size_t blockSize, size_t numBlocks) :
+    mBuf(static_cast< uint8_t* >(buf)),
+    mBlockSize(roundBlockSize(blockSize)),
+    mNumBlocks(numBlocks) {
+    assert(uintptr_t(buf) % MemAlign == 0);
+    init();
+}
+
+    // Threads the free list through the blocks, first block first.
+void FixedPool::init() {
+    for(size_t ind = mNumBlocks; ind > 0; --ind) {
+        Node* node = reinterpret_cast< Node* >(mBuf + (ind - 1) * mBlockSize);
+        node->mNext = mFree;
+        mFree = node;
+    }
+    mNumFree = mNumBlocks;
+    mMinFree = mNumBlocks;
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
@@ -13,6 +13,8 @@
 #include "driver/i2s.h"
 #include "esp_log.h"
 
+#include "pnitrace.h"
+
 #include <cstdint>
 #include <cstddef>
 #include <vector>
@@ -145,6 +147,7 @@ class MicSph0645 {
             // TODO: Must document this complicated method!
         template< class VectorType >    // must be a vector
         int readSamples(VectorType& vec) {
+            PNI_TRACE_SCOPE("mic.read");
             const size_t ValSize = getSampleByteSize();
             const size_t SamplesInBuffer = getSamplesPerDmaByteSize();
             const size_t DmaBufferSize = getDmaByteSize();
@@ -0,0 +1,455 @@
+
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <cstdlib>
+#include <memory>
+
+#include "pniactor.h"
+#include "pniqueue.h"
+#include "pniringbuffer.h"
+#include "pnidispatcher.h"
+#include "pniworkerpool.h"
+#include "pnisem.h"
+#include "pnitask.h"
+
+using namespace std;
+using namespace pni;
+
+static atomic< size_t > gAllocs(0);
+
+void* operator new(size_t size) {
+    ++gAllocs;
+    void* ptr = malloc(size ? size : 1);
+    if( ! ptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+static const size_t Messages = 400000;
+
+template< typename Func >
+static double msgsPerSec(size_t msgs, Func func) {
+    auto beg = chrono::steady_clock::now();
+    func();
+    auto end = chrono::steady_clock::now();
+    return msgs / chrono::duration< double >(end - beg).count();
+}
+
+    // Spreads `Messages` posts over `producers` threads.
+template< typename Post >
+static void produce(size_t producers, Post post) {
+    vector< thread > threads;
+    for(size_t prod = 0; prod < producers; ++prod) {
+        threads.emplace_back([prod, producers, &post]() {
+            for(size_t num = prod; num < Messages; num += producers) {
+                post(num);
+            }
+        });
+    }
+    for(auto& thr : threads) {
+        thr.join();
+    }
+}
+
+    // Three words of capture, more than std::function keeps inline.
+static void benchActor(size_t producers, size_t queueLen) {
+    Actor actor("bench", queueLen);
+    actor.start();
+    uint64_t sum = 0;
+    uint64_t scale = 3;
+    uint64_t bias = 1;
+
+    size_t allocs = gAllocs;
+    double rate = msgsPerSec(Messages, [&]() {
+        produce(producers, [&](size_t num) {
+            actor.post([&sum, scale, bias, num]() { sum += num * scale + bias; }, portMAX_DELAY);
+        });
+        actor.stop();
+    });
+    allocs = gAllocs - allocs;
+
+    cout << "Actor          producers=" << producers << " queue=" << queueLen << ": "
+        << rate / 1e6 << " M msgs/sec, "
+        << double(Messages) / actor.getWakeups() << " msgs/wakeup, "
+        << double(allocs) / Messages << " allocs/msg (" << (sum & 1) << ")" << endl;
+}
+
+    // What TaskLambda style code does: std::function in a locked deque,
+    // one wakeup per message.
+static void benchFunctionDeque(size_t producers) {
+    mutex mtx;
+    condition_variable cond;
+    deque< function< void() > > queue;
+    bool done = false;
+    uint64_t sum = 0;
+    uint64_t scale = 3;
+    uint64_t bias = 1;
+
+    size_t allocs = gAllocs;
+    double rate = msgsPerSec(Messages, [&]() {
+        thread consumer([&]() {
+            while(true) {
+                function< void() > func;
+                {
+                    unique_lock< mutex > lock(mtx);
+                    cond.wait(lock, [&]() { return done || ! queue.empty(); });
+                    if(queue.empty()) {
+                        return;
+                    }
+                    func = std::move(queue.front());
+                    queue.pop_front();
+                }
+                func();
+            }
+        });
+        produce(producers, [&](size_t num) {
+            lock_guard< mutex > lock(mtx);
+            queue.emplace_back([&sum, scale, bias, num]() { sum += num * scale + bias; });
+            cond.notify_one();
+        });
+        {
+            lock_guard< mutex > lock(mtx);
+            done = true;
+            cond.notify_one();
+        }
+        consumer.join();
+    });
+    allocs = gAllocs - allocs;
+
+    cout << "function+deque producers=" << producers << ": "
+        << rate / 1e6 << " M msgs/sec, "
+        << double(allocs) / Messages << " allocs/msg (" << (sum & 1) << ")" << endl;
+}
+
+    // The existing Queue<Message> (xQueue copy in/out), one receive per message.
+struct Message {
+    void (*mFunc)(uint64_t* sum, size_t num);
+    uint64_t* mSum;
+    size_t mNum;
+};
+
+static void benchXQueue(size_t producers, size_t queueLen) {
+    Queue< Message > queue(queueLen);
+    uint64_t sum = 0;
+
+    double rate = msgsPerSec(Messages, [&]() {
+        thread consumer([&]() {
+            Message msg;
+            for(size_t num = 0; num < Messages; ++num) {
+                queue.receive(msg, portMAX_DELAY);
+                msg.mFunc(msg.mSum, msg.mNum);
+            }
+        });
+        produce(producers, [&](size_t num) {
+            Message msg = { [](uint64_t* sum, size_t num) { *sum += num * 3 + 1; }, &sum, num };
+            queue.send(msg, portMAX_DELAY);
+        });
+        consumer.join();
+    });
+
+    cout << "Queue<Message> producers=" << producers << " queue=" << queueLen << ": "
+        << rate / 1e6 << " M msgs/sec (" << (sum & 1) << ")" << endl;
+}
+
+    // No threads, just the queue: push a batch, drain it.
+static void benchLambdaQueue(size_t len) {
+    LambdaQueue<> queue(len);
+    uint64_t sum = 0;
+    uint64_t scale = 3;
+    uint64_t bias = 1;
+    double rate = msgsPerSec(Messages, [&]() {
+        for(size_t beg = 0; beg < Messages; beg += len) {
+            for(size_t num = beg; num < beg + len; ++num) {
+                queue.push([&sum, scale, bias, num]() { sum += num * scale + bias; });
+            }
+            queue.drain();
+        }
+    });
+    cout << "LambdaQueue    single thread queue=" << len << ": "
+        << rate / 1e6 << " M msgs/sec (" << (sum & 1) << ")" << endl;
+}
+
+    // Audio sized blocks, one producer and consumer: ring in place vs
+    // the mutex protected Queue (copied in and out).
+struct Block {
+    int16_t mSamples[ 256 ];
+};
+
+static const size_t Blocks = 200000;
+
+static void fillBlock(int16_t* samples, size_t num) {
+    for(size_t ind = 0; ind < 256; ++ind) {
+        samples[ ind ] = int16_t(num + ind);
+    }
+}
+
+static int64_t sumBlock(int16_t const* samples) {
+    int64_t sum = 0;
+    for(size_t ind = 0; ind < 256; ++ind) {
+        sum += samples[ ind ];
+    }
+    return sum;
+}
+
+static void benchBlocks() {
+    static RingSpsc< Block, 16 > ring;
+    int64_t ringSum = 0;
+    double ringRate = msgsPerSec(Blocks, [&]() {
+        thread consumer([&]() {
+            ring.setConsumer(xTaskGetCurrentTaskHandle());
+            for(size_t num = 0; num < Blocks; ) {
+                auto span = ring.peek();
+                if( ! span.mNum) {
+                    ring.waitForData(1);
+                    continue;
+                }
+                for(size_t ind = 0; ind < span.mNum; ++ind) {
+                    ringSum += sumBlock(span.mData[ ind ].mSamples);
+                }
+                ring.release(span.mNum);
+                num += span.mNum;
+            }
+        });
+        for(size_t num = 0; num < Blocks; ) {
+            auto span = ring.reserve(1);
+            if( ! span.mNum) {
+                this_thread::yield();
+                continue;
+            }
+            fillBlock(span.mData->mSamples, num++);
+            ring.commit(1);
+        }
+        consumer.join();
+    });
+
+    Queue< Block > queue(16);
+    int64_t queueSum = 0;
+    double queueRate = msgsPerSec(Blocks, [&]() {
+        thread consumer([&]() {
+            Block block;
+            for(size_t num = 0; num < Blocks; ++num) {
+                queue.receive(block, portMAX_DELAY);
+                queueSum += sumBlock(block.mSamples);
+            }
+        });
+        Block block;
+        for(size_t num = 0; num < Blocks; ++num) {
+            fillBlock(block.mSamples, num);
+            queue.send(block, portMAX_DELAY);
+        }
+        consumer.join();
+    });
+
+    cout << "512 byte blocks (M blocks/sec): RingSpsc in place " << ringRate / 1e6
+        << ", Queue copy " << queueRate / 1e6
+        << (ringSum == queueSum ? "" : " MISMATCH") << endl;
+}
+
+    // Small values, `producers` threads into one consumer.
+template< class Ring >
+static double ringRate(Ring& ring, size_t producers) {
+    uint64_t sum = 0;
+    return msgsPerSec(Messages, [&]() {
+        thread consumer([&]() {
+            uint32_t val;
+            for(size_t num = 0; num < Messages; ) {
+                if(ring.pop(val)) {
+                    sum += val;
+                    ++num;
+                } else {
+                    this_thread::yield();
+                }
+            }
+        });
+        produce(producers, [&](size_t num) {
+            while( ! ring.push(uint32_t(num))) {
+                this_thread::yield();
+            }
+        });
+        consumer.join();
+    });
+}
+
+static void benchSmall() {
+    static RingSpsc< uint32_t, 256 > spsc;
+    static RingMpsc< uint32_t, 256 > mpsc1;
+    static RingMpsc< uint32_t, 256 > mpsc4;
+    double spscRate = ringRate(spsc, 1);
+    double mpsc1Rate = ringRate(mpsc1, 1);
+    double mpsc4Rate = ringRate(mpsc4, 4);
+
+    Queue< uint32_t > queue(256);
+    double queueRate = msgsPerSec(Messages, [&]() {
+        thread consumer([&]() {
+            uint32_t val;
+            for(size_t num = 0; num < Messages; ++num) {
+                queue.receive(val, portMAX_DELAY);
+            }
+        });
+        produce(4, [&](size_t num) {
+            uint32_t val = uint32_t(num);
+            queue.send(val, portMAX_DELAY);
+        });
+        consumer.join();
+    });
+
+    cout << "uint32 (M msgs/sec): RingSpsc " << spscRate / 1e6
+        << ", RingMpsc 1 producer " << mpsc1Rate / 1e6
+        << ", RingMpsc 4 producers " << mpsc4Rate / 1e6
+        << ", Queue 4 producers " << queueRate / 1e6 << endl;
+}
+
+    // Publishes/sec to `subs` subscribers of one topic, plus 16 - subs on
+    // other topics so the scan always covers a full table.
+static const size_t Publishes = 1000000;
+
+static void addVal(void* ctx, Event const& event) {
+    *static_cast< uint64_t* >(ctx) += event.mUint;
+}
+
+static void benchDispatcher(size_t subs) {
+    uint64_t sum = 0;
+
+    Dispatcher inlineDisp;
+    for(size_t ind = 0; ind < 16; ++ind) {
+        inlineDisp.subscribe(ind < subs ? 1 : 2, addVal, &sum);
+    }
+    size_t allocs = gAllocs;
+    double inlineRate = msgsPerSec(Publishes, [&]() {
+        for(size_t num = 0; num < Publishes; ++num) {
+            inlineDisp.publish(Event(1, uint32_t(num)));
+        }
+    });
+    allocs = gAllocs - allocs;
+
+        // Latest value wins, so the readers never hold up the publisher.
+    Dispatcher queueDisp;
+    vector< unique_ptr< EventQueue > > queues;
+    for(size_t ind = 0; ind < 16; ++ind) {
+        queues.emplace_back(new EventQueue(1));
+        queueDisp.subscribe(ind < subs ? 1 : 2, *queues.back(), true);
+    }
+    double queueRate = msgsPerSec(Publishes, [&]() {
+        for(size_t num = 0; num < Publishes; ++num) {
+            queueDisp.publish(Event(1, uint32_t(num)));
+        }
+    });
+
+    Dispatcher actorDisp;
+    Actor actor("bench", 64);
+    actor.start();
+    for(size_t ind = 0; ind < 16; ++ind) {
+        actorDisp.subscribe(ind < subs ? 1 : 2, actor, addVal, &sum, true);
+    }
+    double actorRate = msgsPerSec(Publishes, [&]() {
+        for(size_t num = 0; num < Publishes; ++num) {
+            actorDisp.publish(Event(1, uint32_t(num)));
+        }
+    });
+    actor.stop();
+
+        // The usual std::function registry under a mutex.
+    mutex mtx;
+    map< int, vector< function< void(uint32_t) > > > registry;
+    for(size_t ind = 0; ind < 16; ++ind) {
+        registry[ ind < subs ? 1 : 2 ].push_back([&sum](uint32_t val) { sum += val; });
+    }
+    double mapRate = msgsPerSec(Publishes, [&]() {
+        for(size_t num = 0; num < Publishes; ++num) {
+            lock_guard< mutex > lock(mtx);
+            auto found = registry.find(1);
+            if(found != registry.end()) {
+                for(auto& func : found->second) {
+                    func(uint32_t(num));
+                }
+            }
+        }
+    });
+
+    cout << "Dispatcher subscribers=" << subs << " (M publishes/sec): inline " << inlineRate / 1e6
+        << " (" << double(allocs) / Publishes << " allocs/publish)"
+        << ", coalesced queue " << queueRate / 1e6
+        << ", coalesced actor " << actorRate / 1e6
+        << ", mutex+map+function " << mapRate / 1e6 << " (" << (sum & 1) << ")" << endl;
+}
+
+    // Cost of one fork/join with trivial work, i.e., the overhead a frame
+    // pays to split across cores, vs. a TaskLambda and Semaphore made per
+    // frame.
+static const size_t Frames = 20000;
+
+static void benchWorkerPool(size_t workers) {
+    WorkerPool pool(workers);
+    size_t threads = pool.getNumThreads();
+    vector< uint32_t > out(threads);
+    pool.forkJoin(threads, [](size_t ind) {});     // Host task handle for main()
+    size_t allocs = gAllocs;
+    double rate = msgsPerSec(Frames, [&]() {
+        for(size_t frame = 0; frame < Frames; ++frame) {
+            pool.forkJoin(threads, [&out, frame](size_t ind) { out[ ind ] = uint32_t(frame); });
+        }
+    });
+    allocs = gAllocs - allocs;
+    cout << "WorkerPool     workers=" << workers << ": " << 1e6 / rate << " us/dispatch, "
+        << double(allocs) / Frames << " allocs/dispatch (" << (out[ 0 ] & 1) << ")" << endl;
+}
+
+static void benchTaskPerFrame() {
+    static const size_t TaskFrames = 2000;
+    uint32_t out[ 2 ] = {};
+    size_t allocs = gAllocs;
+    double rate = msgsPerSec(TaskFrames, [&]() {
+        for(size_t frame = 0; frame < TaskFrames; ++frame) {
+            Semaphore done;
+            TaskLambda task("half", [&out, &done, frame]() {
+                out[ 1 ] = uint32_t(frame);
+                done.give();
+                vTaskDelete(0);
+            });
+            task.start();
+            out[ 0 ] = uint32_t(frame);
+            done.take(portMAX_DELAY);
+        }
+    });
+    allocs = gAllocs - allocs;
+    cout << "TaskLambda+Semaphore per frame: " << 1e6 / rate << " us/dispatch, "
+        << double(allocs) / TaskFrames << " allocs/dispatch (" << (out[ 1 ] & 1) << ")" << endl;
+}
+
+int main() {
+    benchLambdaQueue(16);
+    benchLambdaQueue(128);
+
+    for(size_t producers : { 1, 4 }) {
+        benchActor(producers, 16);
+        benchActor(producers, 128);
+        benchXQueue(producers, 16);
+        benchXQueue(producers, 128);
+        benchFunctionDeque(producers);
+    }
+
+    benchBlocks();
+    benchSmall();
+
+    for(size_t subs : { 1, 2, 4, 8, 16 }) {
+        benchDispatcher(subs);
+    }
+
+    benchWorkerPool(1);
+    benchWorkerPool(3);
+    benchTaskPerFrame();
+    return 0;
+}
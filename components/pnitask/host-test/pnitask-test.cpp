@@ -0,0 +1,795 @@
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <new>
+#include <cstdlib>
+
+#include "microtest/microtest.h"
+
+#include "pniactor.h"
+#include "pnidispatcher.h"
+#include "pniworkerpool.h"
+#include "pniperiodic.h"
+#include "pniringbuffer.h"
+
+using namespace std;
+using namespace pni;
+
+    // Counts heap allocations, to check message passing doesn't allocate.
+static atomic< size_t > gAllocs(0);
+
+void* operator new(size_t size) {
+    ++gAllocs;
+    void* ptr = malloc(size ? size : 1);
+    if( ! ptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+struct Counted {
+    static int sLive;
+    int* mCalls;
+
+    Counted(int* calls) : mCalls(calls) { ++sLive; }
+    Counted(Counted const& rhs) : mCalls(rhs.mCalls) { ++sLive; }
+    Counted(Counted&& rhs) : mCalls(rhs.mCalls) { ++sLive; }
+    ~Counted() { --sLive; }
+
+    void operator () () { ++*mCalls; }
+};
+
+int Counted::sLive = 0;
+
+TEST(taskConfig) {
+#if configSUPPORT_STATIC_ALLOCATION
+    static Task::Stack< 4096 > stack;
+#endif
+    Semaphore done;
+    atomic< bool > spin(true);
+    TaskLambda task("config", [&]() {
+        while(spin) {}
+        done.give();
+        vTaskDelete(0);
+    });
+    ASSERT_EQ(task.getPriority(), Task::DefaultPriority);
+    ASSERT_EQ(task.getCore(), tskNO_AFFINITY);
+    ASSERT_EQ(task.getStackHighWaterMark(), 0u);
+    ASSERT_EQ(task.getRunTime(), 0u);
+
+    task.setPriority(5);
+    task.setCore(1);
+#if configSUPPORT_STATIC_ALLOCATION
+    task.setStaticStack(stack);
+#else
+    task.setStackSize(4096);
+#endif
+    ASSERT_EQ(task.getStackSize(), 4096u);
+    bool ok = task.start();
+    ASSERT_TRUE(ok);
+    ASSERT_TRUE(task.getHandle() != 0);
+    ASSERT_EQ(task.getPriority(), 5u);
+
+        // Changes a running task's priority.
+    task.setPriority(7);
+    ASSERT_EQ(task.getPriority(), 7u);
+    ASSERT_TRUE(task.getStackHighWaterMark() > 0);
+
+        // Burn some CPU on the task, its run time counter should move.
+    auto beg = chrono::steady_clock::now();
+    while(task.getRunTime() < 2000 && chrono::steady_clock::now() - beg < chrono::seconds(5)) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(task.getRunTime() >= 2000);
+    spin = false;
+    done.take(portMAX_DELAY);
+
+        // Bad core or priority fails to start instead of asserting.
+    TaskLambda bad("bad", []() {});
+    bad.setCore(5);
+    ok = bad.start();
+    ASSERT_FALSE(ok);
+    bad.setCore(tskNO_AFFINITY);
+    bad.setPriority(configMAX_PRIORITIES);
+    ok = bad.start();
+    ASSERT_FALSE(ok);
+}
+
+TEST(lambdaFixed) {
+    int calls = 0;
+    {
+        LambdaFixed<> lambda(Counted{ &calls });
+        ASSERT_TRUE(bool(lambda));
+        ASSERT_EQ(Counted::sLive, 1);
+        lambda();
+        ASSERT_EQ(calls, 1);
+
+        LambdaFixed<> moved(std::move(lambda));
+        ASSERT_FALSE(bool(lambda));
+        ASSERT_EQ(Counted::sLive, 1);
+        moved();
+        ASSERT_EQ(calls, 2);
+
+            // Reassigning destroys the old callable.
+        int other = 0;
+        moved.assign([&other]() { other = 5; });
+        ASSERT_EQ(Counted::sLive, 0);
+        moved();
+        ASSERT_EQ(other, 5);
+
+        lambda = Counted{ &calls };
+        ASSERT_EQ(Counted::sLive, 1);
+    }
+    ASSERT_EQ(Counted::sLive, 0);
+
+        // Captures up to the size, in place.
+    size_t before = gAllocs;
+    void* a = 0; void* b = 0; void* c = 0;
+    int sum = 0;
+    LambdaFixed<> big([a, b, c, &sum]() { sum += (a == b && b == c) ? 1 : 0; });
+    big();
+    ASSERT_EQ(sum, 1);
+    ASSERT_EQ(gAllocs - before, 0u);
+}
+
+TEST(lambdaQueue) {
+    LambdaQueue<> queue(4);
+    vector< int > order;
+    for(int num = 0; num < 6; ++num) {
+        bool ok = queue.push([&order, num]() { order.push_back(num); });
+        ASSERT_EQ(ok, num < 4);
+    }
+    ASSERT_EQ(queue.size(), 4u);
+
+    order.reserve(16);
+    size_t ran = queue.drain();
+    ASSERT_EQ(ran, 4u);
+    ran = queue.drain();
+    ASSERT_EQ(ran, 0u);
+    ASSERT_EQ(order.size(), 4u);
+
+        // Wraps around, still in order.
+    for(int num = 10; num < 13; ++num) {
+        queue.push([&order, num]() { order.push_back(num); });
+    }
+    ran = queue.drain();
+    ASSERT_EQ(ran, 3u);
+    int expected[] = { 0, 1, 2, 3, 10, 11, 12 };
+    ASSERT_EQ(order.size(), 7u);
+    for(size_t ind = 0; ind < 7; ++ind) {
+        ASSERT_EQ(order[ ind ], expected[ ind ]);
+    }
+
+        // Callables are destroyed after they run.
+    int calls = 0;
+    queue.push(Counted{ &calls });
+    ASSERT_EQ(Counted::sLive, 1);
+    queue.drain();
+    ASSERT_EQ(Counted::sLive, 0);
+    ASSERT_EQ(calls, 1);
+}
+
+TEST(actorPost) {
+    Actor actor("actor", 8);
+    int sum = 0;            // Only touched on the actor's task
+
+        // Queued before start, run once it does.
+    for(int num = 1; num <= 3; ++num) {
+        bool ok = actor.post([&sum, num]() { sum += num; });
+        ASSERT_TRUE(ok);
+    }
+    actor.start();
+
+    size_t before = gAllocs;
+    for(int num = 0; num < 1000; ++num) {
+        actor.post([&sum]() { ++sum; }, portMAX_DELAY);
+    }
+    actor.stop();
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(sum, 1006);
+    ASSERT_EQ(actor.getProcessed(), 1004u);
+    ASSERT_EQ(actor.getDropped(), 0u);
+    ASSERT_TRUE(actor.getWakeups() <= actor.getProcessed());
+}
+
+TEST(actorStopRestart) {
+    Actor actor("actor", 4);
+    int sum = 0;
+
+        // Never started: nothing to wait for.
+    actor.stop();
+    ASSERT_TRUE(actor.getHandle() == 0);
+
+    actor.post([&sum]() { sum += 1; });
+    actor.start();
+    actor.stop();
+    ASSERT_EQ(sum, 1);
+    ASSERT_TRUE(actor.getHandle() == 0);
+    actor.stop();
+
+    actor.start();
+    actor.post([&sum]() { sum += 2; }, portMAX_DELAY);
+    actor.stop();
+    ASSERT_EQ(sum, 3);
+}
+
+TEST(actorProducers) {
+    static const int NumProducers = 4;
+    static const int PerProducer = 20000;
+    Actor actor("actor", 32);
+    actor.start();
+
+    long sum = 0;
+    vector< thread > producers;
+    for(int prod = 0; prod < NumProducers; ++prod) {
+        producers.emplace_back([&actor, &sum, prod]() {
+            for(int num = 0; num < PerProducer; ++num) {
+                long val = prod * PerProducer + num;
+                actor.post([&sum, val]() { sum += val; }, portMAX_DELAY);
+            }
+        });
+    }
+    for(auto& producer : producers) {
+        producer.join();
+    }
+    actor.stop();
+
+    long total = long(NumProducers) * PerProducer;
+    ASSERT_EQ(sum, total * (total - 1) / 2);
+    ASSERT_EQ(actor.getProcessed(), size_t(total + 1));
+}
+
+TEST(actorFromISR) {
+    Actor actor("actor", 2);
+    int sum = 0;
+    BaseType_t woken = pdFALSE;
+
+        // Not started, no notification, but queued.
+    bool ok1 = actor.postFromISR([&sum]() { sum += 1; }, &woken);
+    bool ok2 = actor.postFromISR([&sum]() { sum += 2; }, &woken);
+    bool ok3 = actor.postFromISR([&sum]() { sum += 4; }, &woken);
+    ASSERT_TRUE(ok1 && ok2);
+    ASSERT_FALSE(ok3);
+    ASSERT_EQ(woken, pdFALSE);
+    ASSERT_EQ(actor.getDropped(), 1u);
+
+    actor.start();
+    thread isr([&actor, &sum, &woken]() {
+        while( ! actor.postFromISR([&sum]() { sum += 8; }, &woken)) {
+            this_thread::yield();
+        }
+    });
+    isr.join();
+    ASSERT_EQ(woken, pdTRUE);
+    actor.stop();
+    ASSERT_EQ(sum, 11);
+}
+
+TEST(ringSpsc) {
+    RingSpsc< int, 8 > ring;
+    int val = 0;
+    bool ok = ring.pop(val);
+    ASSERT_FALSE(ok);
+
+        // Reserve stops at the wrap, and at what's free.
+    auto span = ring.reserve(5);
+    ASSERT_EQ(span.mNum, 5u);
+    for(size_t ind = 0; ind < 5; ++ind) {
+        span.mData[ ind ] = int(ind);
+    }
+    ring.commit(5);
+    ASSERT_EQ(ring.size(), 5u);
+
+    auto read = ring.peek(3);
+    ASSERT_EQ(read.mNum, 3u);
+    ASSERT_EQ(read.mData[ 2 ], 2);
+    ring.release(3);
+
+    span = ring.reserve(8);
+    ASSERT_EQ(span.mNum, 3u);           // Slots 5..7
+    ring.commit(3);
+    span = ring.reserve(8);
+    ASSERT_EQ(span.mNum, 3u);           // Slots 0..2, after the wrap
+    ring.commit(3);
+    span = ring.reserve(8);
+    ASSERT_EQ(span.mNum, 0u);
+    ok = ring.push(99);
+    ASSERT_FALSE(ok);
+
+    read = ring.peek();
+    ASSERT_EQ(read.mNum, 5u);           // 3, 4 and the 3 new, up to the wrap
+    ASSERT_EQ(read.mData[ 0 ], 3);
+    ring.release(5);
+    read = ring.peek();
+    ASSERT_EQ(read.mNum, 3u);
+    ring.release(3);
+    ASSERT_EQ(ring.size(), 0u);
+}
+
+TEST(ringMpsc) {
+    RingMpsc< int, 4 > ring;
+    size_t first, second;
+    int* ptr1 = ring.reserve(first);
+    int* ptr2 = ring.reserve(second);
+    ASSERT_TRUE(ptr1 && ptr2);
+    *ptr2 = 2;
+    ring.commit(second);
+        // Committed out of order, but the consumer waits for the first.
+    ASSERT_TRUE(ring.peek() == 0);
+    *ptr1 = 1;
+    ring.commit(first);
+
+    int val = 0;
+    bool ok = ring.pop(val);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(val, 1);
+    ok = ring.pop(val);
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(val, 2);
+
+    for(int num = 0; num < 5; ++num) {
+        ok = ring.push(num);
+        ASSERT_EQ(ok, num < 4);
+    }
+    for(int num = 0; num < 4; ++num) {
+        ok = ring.pop(val);
+        ASSERT_TRUE(ok && val == num);
+    }
+    ok = ring.pop(val);
+    ASSERT_FALSE(ok);
+}
+
+    // Consumer blocks in waitForData, checks every value arrives in order.
+TEST(ringSpscStress) {
+    static const uint32_t Num = 2000000;
+    static RingSpsc< uint32_t, 256 > ring;
+    atomic< bool > ready(false);
+    bool inOrder = true;
+    uint32_t count = 0;
+
+    thread consumer([&]() {
+        ring.setConsumer(xTaskGetCurrentTaskHandle());
+        ready = true;
+        while(count < Num) {
+            auto span = ring.peek();
+            if( ! span.mNum) {
+                ring.waitForData(10);
+                continue;
+            }
+            for(size_t ind = 0; ind < span.mNum; ++ind) {
+                inOrder = inOrder && span.mData[ ind ] == count++;
+            }
+            ring.release(span.mNum);
+        }
+    });
+    while( ! ready) {
+        this_thread::yield();
+    }
+
+    uint32_t next = 0;
+    while(next < Num) {
+        auto span = ring.reserve(std::min< size_t >(64, Num - next));
+        for(size_t ind = 0; ind < span.mNum; ++ind) {
+            span.mData[ ind ] = next++;
+        }
+        if(span.mNum) {
+            ring.commit(span.mNum);
+        } else {
+            this_thread::yield();
+        }
+    }
+    consumer.join();
+    ASSERT_TRUE(inOrder);
+    ASSERT_EQ(count, Num);
+}
+
+    // Per producer order must hold, and nothing lost or duplicated.
+TEST(ringMpscStress) {
+    static const uint32_t NumProducers = 4;
+    static const uint32_t PerProducer = 400000;
+    static RingMpsc< uint32_t, 64 > ring;
+    atomic< bool > ready(false);
+    bool inOrder = true;
+    uint64_t sum = 0;
+
+    thread consumer([&]() {
+        ring.setConsumer(xTaskGetCurrentTaskHandle());
+        ready = true;
+        uint32_t next[ NumProducers ] = {};
+        for(uint32_t count = 0; count < NumProducers * PerProducer; ) {
+            uint32_t* ptr = ring.peek();
+            if( ! ptr) {
+                ring.waitForData(10);
+                continue;
+            }
+            uint32_t prod = *ptr / PerProducer;
+            inOrder = inOrder && prod < NumProducers && *ptr % PerProducer == next[ prod ]++;
+            sum += *ptr;
+            ring.release();
+            ++count;
+        }
+    });
+    while( ! ready) {
+        this_thread::yield();
+    }
+
+    vector< thread > producers;
+    for(uint32_t prod = 0; prod < NumProducers; ++prod) {
+        producers.emplace_back([prod]() {
+            for(uint32_t num = 0; num < PerProducer; ++num) {
+                while( ! ring.push(prod * PerProducer + num)) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    for(auto& producer : producers) {
+        producer.join();
+    }
+    consumer.join();
+
+    uint64_t total = uint64_t(NumProducers) * PerProducer;
+    ASSERT_TRUE(inOrder);
+    ASSERT_EQ(sum, total * (total - 1) / 2);
+}
+
+TEST(histogram) {
+    ASSERT_EQ(Histogram::bucketFor(0), 0u);
+    ASSERT_EQ(Histogram::bucketFor(1), 1u);
+    ASSERT_EQ(Histogram::bucketFor(3), 2u);
+    ASSERT_EQ(Histogram::bucketFor(4), 3u);
+    ASSERT_EQ(Histogram::bucketFor(UINT32_MAX), Histogram::NumBuckets - 1);
+    ASSERT_EQ(Histogram::bucketMax(3), 7u);
+
+    Histogram hist;
+    ASSERT_EQ(hist.getPercentile(50), 0u);
+    for(uint32_t val = 1; val <= 100; ++val) {
+        hist.add(val);
+    }
+    ASSERT_EQ(hist.getTotal(), 100u);
+    ASSERT_EQ(hist.getMin(), 1u);
+    ASSERT_EQ(hist.getMax(), 100u);
+    ASSERT_EQ(hist.getMean(), 50u);
+    ASSERT_EQ(hist.getCount(7), 37u);       // 64..100
+    ASSERT_EQ(hist.getPercentile(50), 63u); // 50 is in 32..63
+    ASSERT_EQ(hist.getPercentile(99), 100u);
+    ASSERT_EQ(hist.getPercentile(0), 1u);
+}
+
+    // Deterministic: made up timestamps, 1000 us period from t = 5000.
+TEST(periodicSchedule) {
+    PeriodicSchedule sched(1000);
+    sched.begin(5000);
+    ASSERT_EQ(sched.getRelease(), 5000);
+
+        // On time, 200 us of work.
+    sched.started(5000);
+    sched.finished(5200);
+    ASSERT_EQ(sched.getRelease(), 6000);
+
+        // Woken 30 us late, releases don't drift with it.
+    sched.started(6030);
+    sched.finished(6500);
+    ASSERT_EQ(sched.getRelease(), 7000);
+
+        // Overruns into the next period: a miss, next starts late.
+    sched.started(7000);
+    sched.finished(8100);
+    ASSERT_EQ(sched.getRelease(), 8000);
+    sched.started(8100);
+    sched.finished(8300);
+    ASSERT_EQ(sched.getRelease(), 9000);
+
+        // Overruns by more than a whole period: a miss, the 10000 release
+        // is skipped and 11000 runs late.
+    sched.started(9000);
+    sched.finished(11500);
+    ASSERT_EQ(sched.getRelease(), 11000);
+
+    PeriodicStats const& stats = sched.getStats();
+    ASSERT_EQ(stats.mIterations, 5u);
+    ASSERT_EQ(stats.mMisses, 2u);
+    ASSERT_EQ(stats.mSkipped, 1u);
+    ASSERT_EQ(stats.mJitter.getMax(), 100u);
+    ASSERT_EQ(stats.mJitter.getCount(0), 3u);
+    ASSERT_EQ(stats.mExec.getMax(), 2500u);
+    ASSERT_EQ(stats.mExec.getMin(), 200u);
+
+        // New period from the next release on.
+    sched.setPeriod(500);
+    sched.started(11500);
+    sched.finished(11600);
+    ASSERT_EQ(sched.getRelease(), 11500);
+
+    sched.resetStats();
+    ASSERT_EQ(sched.getStats().mIterations, 0u);
+}
+
+    // Real clock, so only loose bounds: rate holds, nothing missed.
+TEST(periodicTask) {
+    static const uint32_t Period = 2000;
+    atomic< uint32_t > calls(0);
+    PeriodicTaskLambda task("periodic", Period, [&calls]() { ++calls; });
+    int64_t beg = esp_timer_get_time();
+    bool ok = task.start();
+    ASSERT_TRUE(ok);
+    this_thread::sleep_for(chrono::milliseconds(100));
+    task.stop();
+    int64_t elapsed = esp_timer_get_time() - beg;
+
+    PeriodicStats stats = task.getStats();
+    ASSERT_EQ(stats.mIterations, calls.load());
+    ASSERT_TRUE(stats.mIterations >= 25);
+    ASSERT_TRUE(stats.mIterations <= elapsed / Period + 1);
+    ASSERT_EQ(stats.mExec.getTotal(), stats.mIterations);
+    ASSERT_EQ(task.getPeriod(), Period);
+}
+
+TEST(periodicStopRestart) {
+    atomic< uint32_t > calls(0);
+    PeriodicTaskLambda task("periodic", 2000, [&calls]() { ++calls; });
+
+        // Never started: nothing to wait for.
+    task.stop();
+    ASSERT_TRUE(task.getHandle() == 0);
+
+    ASSERT_TRUE(task.start());
+    this_thread::sleep_for(chrono::milliseconds(20));
+    task.stop();
+    ASSERT_TRUE(task.getHandle() == 0);
+    task.stop();
+    uint32_t first = calls;
+    ASSERT_TRUE(first > 0);
+
+    ASSERT_TRUE(task.start());
+    this_thread::sleep_for(chrono::milliseconds(20));
+    task.stop();
+    ASSERT_TRUE(calls > first);
+    ASSERT_EQ(task.getStats().mIterations, calls.load());
+}
+
+static void addInt(void* ctx, Event const& event) {
+    *static_cast< int* >(ctx) += event.mInt;
+}
+
+TEST(dispatcherInline) {
+    DispatcherT< 4 > disp;
+    int sumA = 0;
+    int sumB = 0;
+    auto subA = disp.subscribe(1, addInt, &sumA);
+    auto subB = disp.subscribe(2, addInt, &sumB);
+    auto subA2 = disp.subscribe(1, addInt, &sumA);
+    ASSERT_TRUE(subA >= 0 && subB >= 0 && subA2 >= 0);
+    ASSERT_EQ(disp.getNumSubscribers(), 3u);
+
+    size_t before = gAllocs;
+    size_t num = disp.publish(Event(1, 5));
+    ASSERT_EQ(num, 2u);
+    num = disp.publish(Event(2, 7));
+    ASSERT_EQ(num, 1u);
+    num = disp.publish(Event(3, 9));
+    ASSERT_EQ(num, 0u);
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(sumA, 10);
+    ASSERT_EQ(sumB, 7);
+
+        // Freed slots get reused, the table stays fixed size.
+    disp.unsubscribe(subA2);
+    disp.publish(Event(1, 1));
+    ASSERT_EQ(sumA, 11);
+    auto subC = disp.subscribe(3, addInt, &sumB);
+    auto full = disp.subscribe(3, addInt, &sumB);
+    auto over = disp.subscribe(3, addInt, &sumB);
+    ASSERT_EQ(subC, subA2);
+    ASSERT_TRUE(full >= 0);
+    ASSERT_EQ(over, DispatcherT< 4 >::Invalid);
+}
+
+TEST(dispatcherQueue) {
+    DispatcherT< 4 > disp;
+    EventQueue all(2);
+    EventQueue latest(1);
+    auto subAll = disp.subscribe(1, all);
+    auto subLatest = disp.subscribe(1, latest, true);
+    for(int32_t val = 1; val <= 3; ++val) {
+        disp.publish(Event(1, val));
+    }
+        // The plain queue kept the first two and dropped the third, the
+        // coalesced one only has the last.
+    ASSERT_EQ(disp.getDropped(subAll), 1u);
+    ASSERT_EQ(disp.getDropped(subLatest), 0u);
+    Event event;
+    bool ok = all.receive(event, 0);
+    ASSERT_TRUE(ok && event.mInt == 1);
+    ok = all.receive(event, 0);
+    ASSERT_TRUE(ok && event.mInt == 2);
+    ok = latest.receive(event, 0);
+    ASSERT_TRUE(ok && event.mInt == 3 && event.mTopic == 1);
+    ok = latest.receive(event, 0);
+    ASSERT_FALSE(ok);
+
+    float level = 0.5f;
+    disp.publish(Event(1, level));
+    ok = latest.receive(event, 0);
+    ASSERT_TRUE(ok && event.mFloat == 0.5f);
+}
+
+struct Seen {
+    vector< int32_t > mVals;
+};
+
+static void record(void* ctx, Event const& event) {
+    static_cast< Seen* >(ctx)->mVals.push_back(event.mInt);
+}
+
+TEST(dispatcherActor) {
+    DispatcherT< 4 > disp;
+    Actor actor("subscriber", 64);
+    Seen all;
+    Seen latest;
+    all.mVals.reserve(64);
+    latest.mVals.reserve(64);
+    disp.subscribe(1, actor, record, &all);
+    disp.subscribe(1, actor, record, &latest, true);
+
+        // Not started yet, so everything queues up: every value for the
+        // plain subscription, one pending delivery for the coalesced one.
+    size_t before = gAllocs;
+    for(int32_t val = 0; val < 10; ++val) {
+        disp.publish(Event(1, val));
+    }
+    ASSERT_EQ(gAllocs - before, 0u);
+    actor.start();
+    actor.stop();
+
+    ASSERT_EQ(all.mVals.size(), 10u);
+    ASSERT_EQ(all.mVals[ 9 ], 9);
+    ASSERT_EQ(latest.mVals.size(), 1u);
+    ASSERT_EQ(latest.mVals[ 0 ], 9);
+}
+
+    // Deliveries already queued on an actor are skipped once unsubscribed.
+TEST(dispatcherUnsubscribe) {
+    DispatcherT< 4 > disp;
+    Actor actor("subscriber", 16);
+    Seen seen;
+    auto sub = disp.subscribe(1, actor, record, &seen);
+    disp.publish(Event(1, 1));
+    disp.unsubscribe(sub);
+    size_t num = disp.publish(Event(1, 2));
+    ASSERT_EQ(num, 0u);
+    actor.start();
+    actor.stop();
+    ASSERT_EQ(seen.mVals.size(), 0u);
+    ASSERT_EQ(disp.getNumSubscribers(), 0u);
+}
+
+struct Holder {
+    atomic< bool > mInside = { false };
+    atomic< bool > mReleased = { false };
+    atomic< bool > mTimedOut = { false };
+};
+
+    // Stays in the callback until released, for up to a second.
+static void hold(void* ctx, Event const& event) {
+    Holder* holder = static_cast< Holder* >(ctx);
+    holder->mInside = true;
+    auto end = chrono::steady_clock::now() + chrono::seconds(1);
+    while( ! holder->mReleased) {
+        if(chrono::steady_clock::now() > end) {
+            holder->mTimedOut = true;
+            break;
+        }
+        this_thread::yield();
+    }
+}
+
+    // Only waits on publishes to the subscription going away: one stuck
+    // in another topic's callback doesn't hold it up.
+TEST(dispatcherUnsubscribeBusy) {
+    DispatcherT< 4 > disp;
+    int sum = 0;
+    Holder holder;
+    auto sub = disp.subscribe(1, addInt, &sum);
+    disp.subscribe(2, hold, &holder);
+
+    thread publisher([&disp]() { disp.publish(Event(2, 0)); });
+    while( ! holder.mInside) {
+        this_thread::yield();
+    }
+    disp.unsubscribe(sub);
+    holder.mReleased = true;
+    publisher.join();
+    ASSERT_FALSE(holder.mTimedOut);
+    ASSERT_EQ(disp.publish(Event(1, 1)), 0u);
+    ASSERT_EQ(sum, 0);
+}
+
+    // A stale coalesced delivery mustn't clear the pending flag of the
+    // subscription that reused its record, or that one stops coalescing.
+TEST(dispatcherUnsubscribeLatest) {
+    DispatcherT< 1 > disp;
+    Actor actor("subscriber", 8);
+    Seen stale;
+    Seen seen;
+    seen.mVals.reserve(8);
+    auto sub = disp.subscribe(1, actor, record, &stale, true);
+    disp.publish(Event(1, 1));
+    disp.unsubscribe(sub);
+    auto reused = disp.subscribe(1, actor, record, &seen, true);
+    ASSERT_EQ(reused, sub);
+
+        // Queued: the stale delivery, a publish from the actor, then the
+        // live delivery, which should pick up 3.
+    actor.post([&disp]() { disp.publish(Event(1, 3)); });
+    disp.publish(Event(1, 2));
+    actor.start();
+    actor.stop();
+        // Once more, for anything posted while it was stopping.
+    actor.start();
+    actor.stop();
+    ASSERT_EQ(stale.mVals.size(), 0u);
+    ASSERT_EQ(seen.mVals.size(), 1u);
+    ASSERT_EQ(seen.mVals[ 0 ], 3);
+}
+
+TEST(workerPoolParallelFor) {
+    WorkerPool pool(2);
+    ASSERT_EQ(pool.getNumThreads(), 3u);
+
+    static const size_t Num = 1200;
+    vector< atomic< int > > hits(Num);
+    for(size_t grain : { 1, 7, 100, 1199, 5000 }) {
+        for(auto& hit : hits) {
+            hit = 0;
+        }
+        pool.parallelFor(0, Num, grain, [&hits, grain](size_t beg, size_t end) {
+            for(size_t ind = beg; ind < end; ++ind) {
+                ++hits[ ind ];
+            }
+        });
+        bool once = true;
+        for(auto& hit : hits) {
+            once = once && hit == 1;
+        }
+        ASSERT_TRUE(once);
+    }
+        // Single chunk (5000) and empty ranges don't wake anyone.
+    ASSERT_EQ(pool.getDispatches(), 4u);
+    pool.parallelFor(10, 10, 1, [](size_t beg, size_t end) {});
+    ASSERT_EQ(pool.getDispatches(), 4u);
+
+        // Offset range, and no allocations per dispatch.
+    atomic< size_t > sum(0);
+    size_t before = gAllocs;
+    pool.parallelFor(100, 200, 10, [&sum](size_t beg, size_t end) {
+        for(size_t ind = beg; ind < end; ++ind) {
+            sum += ind;
+        }
+    });
+    ASSERT_EQ(gAllocs - before, 0u);
+    ASSERT_EQ(sum.load(), size_t(14950));
+}
+
+    // Back to back dispatches, the join must never return early.
+TEST(workerPoolForkJoin) {
+    WorkerPool pool(3);
+    int chans[ 4 ] = {};
+    bool ok = true;
+    for(int frame = 1; frame <= 2000; ++frame) {
+        pool.forkJoin(4, [&chans, frame](size_t chan) { chans[ chan ] = frame; });
+        for(int chan = 0; chan < 4; ++chan) {
+            ok = ok && chans[ chan ] == frame;
+        }
+    }
+    ASSERT_TRUE(ok);
+}
+
+TEST_MAIN();
@@ -0,0 +1,256 @@
+////////////////////////////////////////////////////////////////////
+//
+//  LambdaQueue and Actor: passing work to a task without allocating.
+//
+//  LambdaQueue is a bounded ring of LambdaFixed slots, allocated once at
+//  construction.  Any number of tasks (or ISRs) push, one consumer
+//  drains.  Pushing constructs the callable straight into its slot,
+//  and draining runs a whole batch in place with only two trips
+//  through the critical section.
+//
+//  Actor is a Task that sleeps on its task notification and drains its
+//  LambdaQueue each time it wakes.  Producers only notify when the queue
+//  goes from empty to not, and the actor drains until it's empty before
+//  sleeping again, so under load one wakeup handles many messages.  E.g.:
+//    Actor display("display", 16);
+//    display.start();
+//    display.post([&graph]() { graph.draw(); graph.refresh(); });
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pniactor_h
+#define pniactor_h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "pnitask.h"
+#include "pnilambda.h"
+#include "pnisem.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+template< size_t MessageSize = LambdaFixedDefaultSize >
+class LambdaQueue {
+    public:
+        using Lambda = LambdaFixed< MessageSize >;
+
+        LambdaQueue(size_t len) :
+            mSlots(new Lambda[ len ]),
+            mLen(len) {
+        }
+
+        LambdaQueue(LambdaQueue const& rhs) = delete;
+        LambdaQueue& operator = (LambdaQueue const& rhs) = delete;
+
+            // False if full.  `func` is only moved from on success.
+            // `wasEmpty` says whether this was the first message queued,
+            // i.e., whether the consumer needs waking.
+        template< class Func >
+        bool push(Func&& func, bool* wasEmpty = nullptr) {
+            portENTER_CRITICAL(&mMux);
+            bool ret = pushLocked(std::forward< Func >(func), wasEmpty);
+            portEXIT_CRITICAL(&mMux);
+            return ret;
+        }
+
+        template< class Func >
+        bool pushFromISR(Func&& func, bool* wasEmpty = nullptr) {
+            portENTER_CRITICAL_ISR(&mMux);
+            bool ret = pushLocked(std::forward< Func >(func), wasEmpty);
+            portEXIT_CRITICAL_ISR(&mMux);
+            return ret;
+        }
+
+            // Runs everything queued so far, returns how many ran.  Single
+            // consumer only: producers never touch slots that are queued, so
+            // the batch runs outside the critical section.
+        size_t drain() {
+            portENTER_CRITICAL(&mMux);
+            size_t head = mHead;
+            size_t num = mCount;
+            portEXIT_CRITICAL(&mMux);
+
+            for(size_t ind = 0; ind < num; ++ind) {
+                Lambda& slot = mSlots[ wrap(head + ind) ];
+                slot();
+                slot.reset();
+            }
+
+            portENTER_CRITICAL(&mMux);
+            mHead = wrap(head + num);
+            mCount -= num;
+            portEXIT_CRITICAL(&mMux);
+            return num;
+        }
+
+        size_t size() const { return mCount; }
+        size_t capacity() const { return mLen; }
+
+    private:
+        template< class Func >
+        bool pushLocked(Func&& func, bool* wasEmpty) {
+            if(mCount == mLen) {
+                return false; // EARLY RETURN!!!
+            }
+            if(wasEmpty) {
+                *wasEmpty = mCount == 0;
+            }
+            mSlots[ wrap(mHead + mCount) ].assign(std::forward< Func >(func));
+            ++mCount;
+            return true;
+        }
+
+        size_t wrap(size_t pos) const { return pos < mLen ? pos : pos - mLen; }
+
+        std::unique_ptr< Lambda[] > mSlots;
+        size_t mLen;
+        size_t mHead = 0;
+        size_t mCount = 0;
+        portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+////////////////////////////////////////////////////////////////////
+
+template< size_t MessageSize = LambdaFixedDefaultSize >
+class ActorT : public Task {
+    public:
+        using Queue = LambdaQueue< MessageSize >;
+
+        ActorT(std::string const& name, size_t queueLen = 16) :
+            Task(name),
+            mQueue(queueLen),
+            mSpace(MaxWaiting) {
+        }
+
+            // Queues `func` to run on the actor's task.  Bounded: when full,
+            // returns false right away, or waits up to `wait` ticks for the
+            // actor to make room.
+        template< class Func >
+        bool post(Func&& func, TickType_t wait = 0) {
+            bool wasEmpty = false;
+            TickType_t beg = xTaskGetTickCount();
+            while( ! mQueue.push(std::forward< Func >(func), &wasEmpty)) {
+                if(wait == 0) {
+                    ++mDropped;
+                    return false; // EARLY RETURN!!!
+                }
+                    // Announce before the last try, so the actor can't drain
+                    // in between and miss giving mSpace.
+                ++mWaiting;
+                if(mQueue.push(std::forward< Func >(func), &wasEmpty)) {
+                    --mWaiting;
+                    break;
+                }
+                TickType_t left = wait;
+                if(wait != portMAX_DELAY) {
+                    TickType_t spent = xTaskGetTickCount() - beg;
+                    left = spent < wait ? wait - spent : 0;
+                }
+                bool gotSpace = mSpace.take(left);
+                --mWaiting;
+                if( ! gotSpace) {
+                    ++mDropped;
+                    return false; // EARLY RETURN!!!
+                }
+            }
+            if(wasEmpty) {
+                notify();
+            }
+            return true;
+        }
+
+            // Never blocks.  Pass `woken` on to portYIELD_FROM_ISR.
+        template< class Func >
+        bool postFromISR(Func&& func, BaseType_t* woken) {
+            bool wasEmpty = false;
+            if( ! mQueue.pushFromISR(std::forward< Func >(func), &wasEmpty)) {
+                ++mDropped;
+                return false; // EARLY RETURN!!!
+            }
+            TaskHandle_t handle = getHandle();
+            if(wasEmpty && handle) {
+                vTaskNotifyGiveFromISR(handle, woken);
+            }
+            return true;
+        }
+
+            // Runs what's already queued, then ends the task.  Blocks until
+            // it has, so the actor can be destroyed after this returns.
+            // Does nothing if not started, or already stopped; the actor
+            // can be started again afterwards.
+        void stop() {
+            if( ! getHandle()) {
+                return; // EARLY RETURN!!!
+            }
+            post([this]() { mRunning = false; }, portMAX_DELAY);
+            mDone.take(portMAX_DELAY);
+                // The task is gone, so its members are ours again.
+            clearHandle();
+            mRunning = true;
+        }
+
+            // Stats, only exact once stopped.
+        size_t getDropped() const { return mDropped; }
+        size_t getWakeups() const { return mWakeups; }
+        size_t getProcessed() const { return mProcessed; }
+
+    protected:
+        virtual void taskMethod() {
+                // Anything posted before start() is already queued.
+            while(mRunning) {
+                size_t num = mQueue.drain();
+                mProcessed += num;
+                size_t wake = std::min< size_t >(mWaiting, num);
+                for(size_t ind = 0; ind < wake; ++ind) {
+                    mSpace.give();
+                }
+                    // Only sleep once empty, that's when producers notify.
+                if(mRunning && num == 0) {
+                    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                    ++mWakeups;
+                }
+            }
+            mDone.give();
+                // Not cancel(): stop() may destroy this as soon as mDone is
+                // given, so delete by null handle without touching members.
+            vTaskDelete(0);
+        }
+
+        void notify() {
+            TaskHandle_t handle = getHandle();
+            if(handle) {
+                xTaskNotifyGive(handle);
+            }
+        }
+
+    private:
+        static const UBaseType_t MaxWaiting = 64;
+
+        Queue mQueue;
+        SemaphoreCounting mSpace;   // Given after a drain while posts wait
+        std::atomic< size_t > mWaiting = { 0 };
+        Semaphore mDone;
+        bool mRunning = true;       // Only touched on the actor's task
+        std::atomic< size_t > mDropped = { 0 };
+        size_t mWakeups = 0;
+        size_t mProcessed = 0;
+};
+
+using Actor = ActorT<>;
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pniactor_h
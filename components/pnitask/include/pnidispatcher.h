@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Dispatcher: process-wide publish/subscribe on integer topics.
+//
+//  Events are small and fixed size (a topic plus one 32 bit value or a
+//  pointer), so they're copied around by value and publishing never
+//  allocates.  Bigger payloads go by pointer to data the publisher
+//  keeps alive (e.g., the latest FFT bins).
+//
+//  Subscribers sit in a fixed size table, and each one picks how it's
+//  delivered to:
+//  * Inline: a callback run on the publisher's task, during publish().
+//  * Queue: copied into a Queue<Event>, or with `coalesce`, written
+//    over the one slot of a length 1 Queue (Queue::overwrite), so a
+//    slow reader only ever sees the latest value.
+//  * Actor: the callback is posted to an Actor and runs on its task.
+//    With `coalesce`, at most one delivery is queued at a time and it
+//    picks up whatever value is latest when it runs.
+//  E.g.:
+//    enum { TopicLevel = 1 };
+//    Dispatcher::global().subscribe(TopicLevel, display, onLevel, &graph, true);
+//    ...
+//    Dispatcher::global().publish(Event(TopicLevel, level));
+//
+//  Subscribing and unsubscribing are meant for setup and teardown:
+//  unsubscribe() waits for publishes still delivering to that
+//  subscription (not to others), so don't call it from its own inline
+//  callback, and unsubscribe an actor's subscriptions on that actor (or
+//  once it's stopped).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnidispatcher_h
+#define pnidispatcher_h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "pniqueue.h"
+#include "pniactor.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+typedef uint16_t Topic;
+
+struct Event {
+    Event() : mTopic(0), mPtr(0) {}
+    Event(Topic topic, int32_t val) : mTopic(topic) { mPtr = 0; mInt = val; }
+    Event(Topic topic, uint32_t val) : mTopic(topic) { mPtr = 0; mUint = val; }
+    Event(Topic topic, float val) : mTopic(topic) { mPtr = 0; mFloat = val; }
+    Event(Topic topic, void const* val) : mTopic(topic), mPtr(val) {}
+
+    Topic mTopic;
+    union {
+        int32_t mInt;
+        uint32_t mUint;
+        float mFloat;
+        void const* mPtr;
+    };
+};
+
+using EventQueue = Queue< Event >;
+
+////////////////////////////////////////////////////////////////////
+
+template< size_t MaxSubscribers = 32 >
+class DispatcherT {
+    public:
+        typedef void (*Callback)(void* ctx, Event const& event);
+
+            // Subscription handle, Invalid when the table is full.
+        typedef int Subscription;
+        static const Subscription Invalid = -1;
+
+        static const Topic NoTopic = 0xffff;
+
+        DispatcherT() {
+            for(size_t ind = 0; ind < MaxSubscribers; ++ind) {
+                mTopics[ ind ].store(NoTopic, std::memory_order_relaxed);
+            }
+        }
+
+        DispatcherT(DispatcherT const& rhs) = delete;
+        DispatcherT& operator = (DispatcherT const& rhs) = delete;
+
+            // The shared instance, for modules that don't otherwise know
+            // about each other.
+        static DispatcherT& global() {
+            static DispatcherT dispatcher;
+            return dispatcher;
+        }
+
+            // Inline: `func` runs on the publishing task.
+        Subscription subscribe(Topic topic, Callback func, void* ctx) {
+            return add(topic, &deliverInline, 0, func, ctx);
+        }
+
+            // Never blocks the publisher, full queues count as drops.  With
+            // `coalesce` the queue must have length 1.
+        Subscription subscribe(Topic topic, EventQueue& queue, bool coalesce = false) {
+            return add(topic, coalesce ? &deliverOverwrite : &deliverQueue, &queue, 0, 0);
+        }
+
+            // `func` runs on `actor`'s task.
+        template< size_t MessageSize >
+        Subscription subscribe(Topic topic, ActorT< MessageSize >& actor, Callback func, void* ctx, bool coalesce = false) {
+            return add(topic, coalesce ? &deliverActorLatest< MessageSize > : &deliverActor< MessageSize >, &actor, func, ctx);
+        }
+
+            // Returns once no publish can still be delivering to it.
+        void unsubscribe(Subscription sub) {
+            if(sub < 0 || size_t(sub) >= MaxSubscribers) {
+                return; // EARLY RETURN!!!
+            }
+            Record& rec = mRecords[ sub ];
+                // Store then load here, increment then load in publish(),
+                // all seq_cst, so either publish() sees NoTopic or this
+                // sees it delivering.
+            portENTER_CRITICAL(&mMux);
+            mTopics[ sub ].store(NoTopic);
+            ++rec.mGen;
+            portEXIT_CRITICAL(&mMux);
+
+            while(rec.mBusy.load()) {
+                vTaskDelay(1);
+            }
+
+            portENTER_CRITICAL(&mMux);
+            rec.mUsed = false;
+            portEXIT_CRITICAL(&mMux);
+        }
+
+            // Returns how many subscribers took it (drops not counted).
+        size_t publish(Event const& event) {
+            size_t num = mEnd.load(std::memory_order_acquire);
+            size_t delivered = 0;
+            for(size_t ind = 0; ind < num; ++ind) {
+                if(mTopics[ ind ].load(std::memory_order_relaxed) != event.mTopic) {
+                    continue;
+                }
+                    // Mark it busy, then check again that it's still
+                    // subscribed (see unsubscribe()).
+                Record& rec = mRecords[ ind ];
+                rec.mBusy.fetch_add(1);
+                if(mTopics[ ind ].load() == event.mTopic) {
+                    if(rec.mDeliver(rec, event)) {
+                        ++delivered;
+                    } else {
+                        rec.mDropped.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                rec.mBusy.fetch_sub(1, std::memory_order_release);
+            }
+            return delivered;
+        }
+
+            // Deliveries that didn't fit in a full queue or actor.
+        uint32_t getDropped(Subscription sub) const {
+            return mRecords[ sub ].mDropped.load(std::memory_order_relaxed);
+        }
+
+        size_t getNumSubscribers() const {
+            size_t num = 0;
+            for(size_t ind = 0; ind < MaxSubscribers; ++ind) {
+                num += mTopics[ ind ].load(std::memory_order_relaxed) != NoTopic;
+            }
+            return num;
+        }
+
+        static constexpr size_t capacity() { return MaxSubscribers; }
+
+    private:
+        struct Record;
+        typedef bool (*Deliver)(Record& rec, Event const& event);
+
+        struct Record {
+            Deliver mDeliver = 0;
+            void* mTarget = 0;
+            Callback mFunc = 0;
+            void* mCtx = 0;
+            bool mUsed = false;
+            std::atomic< uint32_t > mGen = { 0 };         // Bumped on unsubscribe
+            std::atomic< uint32_t > mBusy = { 0 };        // Publishes delivering to it
+            std::atomic< uint32_t > mDropped = { 0 };
+
+                // Coalesced actor delivery
+            portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+            Event mLatest;
+            bool mPending = false;
+        };
+
+        Subscription add(Topic topic, Deliver deliver, void* target, Callback func, void* ctx) {
+            if(topic == NoTopic) {
+                return Invalid; // EARLY RETURN!!!
+            }
+            Subscription ret = Invalid;
+            portENTER_CRITICAL(&mMux);
+            for(size_t ind = 0; ind < MaxSubscribers; ++ind) {
+                Record& rec = mRecords[ ind ];
+                if(rec.mUsed) {
+                    continue;
+                }
+                rec.mUsed = true;
+                rec.mDeliver = deliver;
+                rec.mTarget = target;
+                rec.mFunc = func;
+                rec.mCtx = ctx;
+                rec.mDropped.store(0, std::memory_order_relaxed);
+                rec.mPending = false;
+                    // Publishers only look at the record once they see the topic.
+                mTopics[ ind ].store(topic, std::memory_order_release);
+                if(ind >= mEnd.load(std::memory_order_relaxed)) {
+                    mEnd.store(ind + 1, std::memory_order_release);
+                }
+                ret = Subscription(ind);
+                break;
+            }
+            portEXIT_CRITICAL(&mMux);
+            return ret;
+        }
+
+        static bool deliverInline(Record& rec, Event const& event) {
+            rec.mFunc(rec.mCtx, event);
+            return true;
+        }
+
+        static bool deliverQueue(Record& rec, Event const& event) {
+            return static_cast< EventQueue* >(rec.mTarget)->send(event, 0);
+        }
+
+        static bool deliverOverwrite(Record& rec, Event const& event) {
+            return static_cast< EventQueue* >(rec.mTarget)->overwrite(event);
+        }
+
+            // Captures stay within LambdaFixed's default size on the ESP32
+            // (4 pointers): the record, its generation and the event.
+        template< size_t MessageSize >
+        static bool deliverActor(Record& rec, Event const& event) {
+            Record* ptr = &rec;
+            uint32_t gen = rec.mGen.load(std::memory_order_relaxed);
+            return static_cast< ActorT< MessageSize >* >(rec.mTarget)->post([ptr, gen, event]() {
+                if(ptr->mGen.load(std::memory_order_relaxed) == gen) {
+                    ptr->mFunc(ptr->mCtx, event);
+                }
+            });
+        }
+
+        template< size_t MessageSize >
+        static bool deliverActorLatest(Record& rec, Event const& event) {
+            portENTER_CRITICAL(&rec.mMux);
+            rec.mLatest = event;
+            bool queued = rec.mPending;
+            rec.mPending = true;
+            portEXIT_CRITICAL(&rec.mMux);
+            if(queued) {
+                return true; // EARLY RETURN!!!
+            }
+
+            Record* ptr = &rec;
+            uint32_t gen = rec.mGen.load(std::memory_order_relaxed);
+            bool ok = static_cast< ActorT< MessageSize >* >(rec.mTarget)->post([ptr, gen]() {
+                    // Stale once unsubscribed, and then the record (and its
+                    // pending flag) may already belong to someone else.
+                portENTER_CRITICAL(&ptr->mMux);
+                bool current = ptr->mGen.load(std::memory_order_relaxed) == gen;
+                Event latest = ptr->mLatest;
+                if(current) {
+                    ptr->mPending = false;
+                }
+                portEXIT_CRITICAL(&ptr->mMux);
+                if(current) {
+                    ptr->mFunc(ptr->mCtx, latest);
+                }
+            });
+            if( ! ok) {
+                portENTER_CRITICAL(&rec.mMux);
+                rec.mPending = false;
+                portEXIT_CRITICAL(&rec.mMux);
+            }
+            return ok;
+        }
+
+            // Topics apart from the records, so publish() scans one small
+            // array and only touches the records that match.
+        std::atomic< Topic > mTopics[ MaxSubscribers ];
+        std::atomic< size_t > mEnd = { 0 };             // One past the highest slot used
+        Record mRecords[ MaxSubscribers ];
+        portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+template< size_t MaxSubscribers >
+const typename DispatcherT< MaxSubscribers >::Subscription DispatcherT< MaxSubscribers >::Invalid;
+
+template< size_t MaxSubscribers >
+const Topic DispatcherT< MaxSubscribers >::NoTopic;
+
+using Dispatcher = DispatcherT<>;
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pnidispatcher_h
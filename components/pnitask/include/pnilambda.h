@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////
+//
+//  LambdaFixed: a `void()` callable with fixed inline storage.
+//
+//  Like std::function, but the callable always lives inside the object,
+//  so constructing, moving and destroying one never touches the heap.
+//  Captures that don't fit are a compile error rather than a silent
+//  allocation; raise `Size` (or capture a pointer) instead.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnilambda_h
+#define pnilambda_h
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+    // Room for four pointers of captures by default.
+static const size_t LambdaFixedDefaultSize = 4 * sizeof(void*);
+
+template< size_t Size = LambdaFixedDefaultSize >
+class LambdaFixed {
+    public:
+        static const size_t Capacity = Size;
+
+        LambdaFixed() {}
+
+        template< class Func, class = typename std::enable_if<
+            ! std::is_same< typename std::decay< Func >::type, LambdaFixed >::value >::type >
+        LambdaFixed(Func&& func) {
+            assign(std::forward< Func >(func));
+        }
+
+        LambdaFixed(LambdaFixed&& rhs) {
+            moveFrom(rhs);
+        }
+
+        LambdaFixed& operator = (LambdaFixed&& rhs) {
+            if(this != &rhs) {
+                reset();
+                moveFrom(rhs);
+            }
+            return *this;
+        }
+
+        LambdaFixed(LambdaFixed const& rhs) = delete;
+        LambdaFixed& operator = (LambdaFixed const& rhs) = delete;
+
+        ~LambdaFixed() {
+            reset();
+        }
+
+        template< class Func >
+        void assign(Func&& func) {
+            using Type = typename std::decay< Func >::type;
+            static_assert(sizeof(Type) <= Size, "Callable too big for LambdaFixed, increase Size");
+            static_assert(alignof(Type) <= alignof(Storage), "Callable alignment too strict for LambdaFixed");
+            reset();
+            new (&mStorage) Type(std::forward< Func >(func));
+            mOps = Ops::template get< Type >();
+        }
+
+        void reset() {
+            if(mOps) {
+                mOps->mDestroy(&mStorage);
+                mOps = nullptr;
+            }
+        }
+
+        void operator () () {
+            mOps->mInvoke(&mStorage);
+        }
+
+        explicit operator bool () const { return mOps != nullptr; }
+
+    private:
+        using Storage = typename std::aligned_storage< Size, alignof(std::max_align_t) >::type;
+
+            // Per callable type "vtable", one static instance each.
+        struct Ops {
+            void (*mInvoke)(void* self);
+            void (*mMove)(void* dst, void* src);
+            void (*mDestroy)(void* self);
+
+            template< class Type >
+            static void invoke(void* self) { (*static_cast< Type* >(self))(); }
+
+            template< class Type >
+            static void move(void* dst, void* src) {
+                new (dst) Type(std::move(*static_cast< Type* >(src)));
+                static_cast< Type* >(src)->~Type();
+            }
+
+            template< class Type >
+            static void destroy(void* self) { static_cast< Type* >(self)->~Type(); }
+
+            template< class Type >
+            static Ops const* get() {
+                static const Ops ops = { &invoke< Type >, &move< Type >, &destroy< Type > };
+                return &ops;
+            }
+        };
+
+        void moveFrom(LambdaFixed& rhs) {
+            if(rhs.mOps) {
+                rhs.mOps->mMove(&mStorage, &rhs.mStorage);
+                mOps = rhs.mOps;
+                rhs.mOps = nullptr;
+            }
+        }
+
+        Storage mStorage;
+        Ops const* mOps = nullptr;
+};
+
+template< size_t Size >
+const size_t LambdaFixed< Size >::Capacity;
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pnilambda_h
@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////
+//
+//  PeriodicTask: runs a method at a fixed rate, with deadline stats.
+//
+//  Releases are start + n * period, not "period after the last one
+//  ended", so the body's run time doesn't make the rate drift.  Between
+//  releases the task sleeps on a one shot esp_timer, which gives
+//  microsecond resolution where vTaskDelay/vTaskDelayUntil only do
+//  whole (10 ms) ticks.
+//
+//  Each iteration records its execution time and its jitter (how late
+//  it started after its release) into log2 histograms, and counts as a
+//  deadline miss if it finished after the next release.  An iteration
+//  that overruns by whole periods skips those releases instead of
+//  running them back to back.  E.g.:
+//    PeriodicTaskLambda leds("leds", 16667, [&]() { strip.update(); });
+//    leds.setCore(1);
+//    leds.start();
+//    ...
+//    auto stats = leds.getStats();
+//
+//  PeriodicSchedule is that bookkeeping on its own, fed explicit
+//  timestamps, so it can be tested deterministically.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pniperiodic_h
+#define pniperiodic_h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "pnitask.h"
+#include "pnisem.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+    // Counts of microsecond values in power of 2 buckets: bucket 0 is 0,
+    // bucket b is [2^(b-1), 2^b), and the last one takes everything
+    // from 2^(NumBuckets-2) (~262 ms) up.
+class Histogram {
+    public:
+        static const size_t NumBuckets = 20;
+
+        void add(uint32_t val);
+        void reset() { *this = Histogram(); }
+
+        static size_t bucketFor(uint32_t val);
+        static uint32_t bucketMax(size_t bucket);
+
+        uint32_t getCount(size_t bucket) const { return mCounts[ bucket ]; }
+        uint32_t getTotal() const { return mTotal; }
+        uint32_t getMin() const { return mTotal ? mMin : 0; }
+        uint32_t getMax() const { return mMax; }
+        uint32_t getMean() const { return mTotal ? uint32_t(mSum / mTotal) : 0; }
+
+            // Upper bound of the bucket holding the `pct` percentile, so
+            // within a factor of 2 (and never above getMax).
+        uint32_t getPercentile(uint32_t pct) const;
+
+    private:
+        uint32_t mCounts[ NumBuckets ] = {};
+        uint32_t mTotal = 0;
+        uint32_t mMin = UINT32_MAX;
+        uint32_t mMax = 0;
+        uint64_t mSum = 0;
+};
+
+struct PeriodicStats {
+    Histogram mExec;            // Release start to end, microseconds
+    Histogram mJitter;          // Release time to start, microseconds
+    uint32_t mIterations = 0;
+    uint32_t mMisses = 0;       // Finished after the next release
+    uint32_t mSkipped = 0;      // Releases dropped after overruns
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // All times in microseconds on any monotonic clock.
+class PeriodicSchedule {
+    public:
+        PeriodicSchedule(uint32_t periodUs = 1000) : mPeriod(periodUs) {}
+
+            // Takes effect from the next release on.
+        void setPeriod(uint32_t val) { mPeriod = val; }
+        uint32_t getPeriod() const { return uint32_t(mPeriod); }
+
+            // First release is `now`.
+        void begin(int64_t now) { mRelease = now; }
+        int64_t getRelease() const { return mRelease; }
+
+        void started(int64_t now);
+        void finished(int64_t now);
+
+        PeriodicStats const& getStats() const { return mStats; }
+        void resetStats() { mStats = PeriodicStats(); }
+
+    private:
+        int64_t mPeriod;
+        int64_t mRelease = 0;
+        int64_t mStart = 0;
+        PeriodicStats mStats;
+};
+
+////////////////////////////////////////////////////////////////////
+
+class PeriodicTask : public Task {
+    public:
+        PeriodicTask(std::string const& name, uint32_t periodUs);
+
+            // Can change while running, from the next release on.
+        void setPeriod(uint32_t val);
+        uint32_t getPeriod() const;
+
+            // Lets the current iteration finish, then ends the task.  Blocks
+            // until it has.  Does nothing if not started, or already
+            // stopped; the task can be started again afterwards.
+        void stop();
+
+            // Snapshot, safe from any task.
+        PeriodicStats getStats() const;
+        void resetStats();
+
+    protected:
+            // Called once per period.  Owns the task's notification, so
+            // don't wait on ulTaskNotifyTake in here.
+        virtual void periodMethod();
+
+        virtual void taskMethod();
+
+    private:
+        static void timerFunc(void* arg);
+        void sleepUntil(int64_t time);
+
+        PeriodicSchedule mSchedule;     // Guarded by mMux
+        mutable portMUX_TYPE mMux = portMUX_INITIALIZER_UNLOCKED;
+        esp_timer_handle_t mTimer = 0;
+        std::atomic< TaskHandle_t > mWaiter = { 0 };
+        std::atomic< bool > mRunning = { true };
+        Semaphore mDone;
+};
+
+////////////////////////////////////////////////////////////////////
+
+class PeriodicTaskLambda : public PeriodicTask {
+    public:
+        using Lambda = std::function< void() >;
+
+        PeriodicTaskLambda(std::string const& name, uint32_t periodUs, Lambda lambda);
+
+    protected:
+        virtual void periodMethod();
+
+    private:
+        Lambda mLambda;
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pniperiodic_h
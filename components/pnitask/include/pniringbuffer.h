@@ -0,0 +1,331 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Lock-free ring buffers, for streams between tasks (and cores).
+//
+//  RingSpsc: one producer, one consumer.  Producer and consumer each
+//  own one index, on separate cache lines, plus a cached copy of the
+//  other side's, so the common case touches no shared line at all.
+//  Both sides can work in place on contiguous runs of slots
+//  (reserve/commit, peek/release), e.g., an I2S reader can DMA or
+//  convert straight into the ring and the FFT task read out of it.
+//
+//  RingMpsc: many producers (tasks or ISRs), one consumer.  Bounded
+//  queue with a sequence number per slot (D. Vyukov's design), so
+//  producers claim slots with one CAS and commit out of order.
+//
+//  Unlike pni::Queue (xQueue), nothing goes through the kernel or gets
+//  copied twice.  Slots hold live `Type`s, default constructed once up
+//  front and then assigned/written in place.
+//
+//  Optional blocking: give the ring the consumer's task handle and it
+//  can sleep in waitForData(); producers only notify when it's asleep.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pniringbuffer_h
+#define pniringbuffer_h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////
+
+    // ESP32 caches (flash/PSRAM) use 32 byte lines, hosts 64.
+#if defined(__XTENSA__)
+    #define PNI_CACHE_LINE 32
+#else
+    #define PNI_CACHE_LINE 64
+#endif
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+    // Consumer wakeup shared by both rings.  The consumer sets mWaiting
+    // before its last check for data and producers check it after
+    // publishing, both with full fences, so one of them always sees the
+    // other (no lost wakeups) and producers skip the notify otherwise.
+class RingNotify {
+    public:
+            // Task that calls waitForData, 0 to disable notifications.
+        void setConsumer(TaskHandle_t task) { mConsumer = task; }
+        TaskHandle_t getConsumer() const { return mConsumer; }
+
+    protected:
+        template< class HasData >
+        bool waitFor(HasData hasData, TickType_t wait) {
+            if(hasData() || ! mConsumer || wait == 0) {
+                return hasData(); // EARLY RETURN!!!
+            }
+            mWaiting.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if( ! hasData()) {
+                ulTaskNotifyTake(pdTRUE, wait);
+            }
+            mWaiting.store(false, std::memory_order_relaxed);
+            return hasData();
+        }
+
+        void notify() {
+            if(mConsumer && consumerWaiting()) {
+                xTaskNotifyGive(mConsumer);
+            }
+        }
+
+        void notifyFromISR(BaseType_t* woken) {
+            if(mConsumer && consumerWaiting()) {
+                vTaskNotifyGiveFromISR(mConsumer, woken);
+            }
+        }
+
+    private:
+        bool consumerWaiting() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return mWaiting.load(std::memory_order_relaxed);
+        }
+
+        TaskHandle_t mConsumer = 0;
+        std::atomic< bool > mWaiting = { false };
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Len must be a power of 2.  Indices run freely and wrap by mask, so
+    // full is tail - head == Len.
+template< class Type, size_t Len >
+class RingSpsc : public RingNotify {
+    public:
+        static_assert(Len && (Len & (Len - 1)) == 0, "RingSpsc length must be a power of 2");
+
+            // Contiguous slots, num may be less than asked for at the wrap.
+        struct Span {
+            Type* mData;
+            size_t mNum;
+        };
+
+        RingSpsc() {}
+        RingSpsc(RingSpsc const& rhs) = delete;
+        RingSpsc& operator = (RingSpsc const& rhs) = delete;
+
+        static constexpr size_t capacity() { return Len; }
+
+            // Approximate unless called from the producer or consumer.
+        size_t size() const {
+            return mTail.load(std::memory_order_acquire) - mHead.load(std::memory_order_acquire);
+        }
+
+        ////// Producer side
+
+            // Up to `maxNum` free slots to write in place, then commit().
+        Span reserve(size_t maxNum = Len) {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            size_t free = Len - (tail - mHeadCache);
+            if(free < maxNum) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                free = Len - (tail - mHeadCache);
+            }
+            size_t pos = tail & Mask;
+            size_t num = std::min(std::min(free, maxNum), Len - pos);
+            return { mSlots + pos, num };
+        }
+
+            // Publishes `num` reserved slots.
+        void commit(size_t num) {
+            mTail.store(mTail.load(std::memory_order_relaxed) + num, std::memory_order_release);
+            notify();
+        }
+
+        void commitFromISR(size_t num, BaseType_t* woken) {
+            mTail.store(mTail.load(std::memory_order_relaxed) + num, std::memory_order_release);
+            notifyFromISR(woken);
+        }
+
+            // Copying convenience, false if full.
+        template< class Val >
+        bool push(Val&& val) {
+            Span span = reserve(1);
+            if( ! span.mNum) {
+                return false; // EARLY RETURN!!!
+            }
+            *span.mData = std::forward< Val >(val);
+            commit(1);
+            return true;
+        }
+
+        ////// Consumer side
+
+            // Up to `maxNum` filled slots to read in place, then release().
+        Span peek(size_t maxNum = Len) {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t avail = mTailCache - head;
+            if(avail < maxNum) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                avail = mTailCache - head;
+            }
+            size_t pos = head & Mask;
+            size_t num = std::min(std::min(avail, maxNum), Len - pos);
+            return { mSlots + pos, num };
+        }
+
+            // Hands `num` peeked slots back to the producer.
+        void release(size_t num) {
+            mHead.store(mHead.load(std::memory_order_relaxed) + num, std::memory_order_release);
+        }
+
+            // Moving convenience, false if empty.
+        bool pop(Type& val) {
+            Span span = peek(1);
+            if( ! span.mNum) {
+                return false; // EARLY RETURN!!!
+            }
+            val = std::move(*span.mData);
+            release(1);
+            return true;
+        }
+
+            // Blocks up to `wait` ticks for data, needs setConsumer().  Can
+            // return false early on a stale notification, so loop on it.
+        bool waitForData(TickType_t wait = portMAX_DELAY) {
+            return waitFor([this]() { return peek(1).mNum != 0; }, wait);
+        }
+
+    private:
+        static const size_t Mask = Len - 1;
+
+            // Consumer's line
+        alignas(PNI_CACHE_LINE) std::atomic< size_t > mHead = { 0 };
+        size_t mTailCache = 0;
+            // Producer's line
+        alignas(PNI_CACHE_LINE) std::atomic< size_t > mTail = { 0 };
+        size_t mHeadCache = 0;
+
+        alignas(PNI_CACHE_LINE) Type mSlots[ Len ];
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Len must be a power of 2.  Each slot's sequence number says whose
+    // turn it is: pos for a producer claiming ticket pos, pos + 1 once
+    // committed (consumer's turn), pos + Len when released.
+template< class Type, size_t Len >
+class RingMpsc : public RingNotify {
+    public:
+        static_assert(Len >= 2 && (Len & (Len - 1)) == 0, "RingMpsc length must be a power of 2, at least 2");
+
+        RingMpsc() {
+            for(size_t ind = 0; ind < Len; ++ind) {
+                mSlots[ ind ].mSeq.store(ind, std::memory_order_relaxed);
+            }
+        }
+
+        RingMpsc(RingMpsc const& rhs) = delete;
+        RingMpsc& operator = (RingMpsc const& rhs) = delete;
+
+        static constexpr size_t capacity() { return Len; }
+
+        ////// Producer side, any number of tasks/ISRs
+
+            // Claims one slot to write in place, 0 if full.  Pass `ticket`
+            // to commit().  Other producers can claim and commit later slots
+            // meanwhile, the consumer just won't get past this one until
+            // it's committed, so don't sit on it.
+        Type* reserve(size_t& ticket) {
+            size_t pos = mTail.load(std::memory_order_relaxed);
+            while(true) {
+                Slot& slot = mSlots[ pos & Mask ];
+                size_t seq = slot.mSeq.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(seq) - intptr_t(pos);
+                if(diff == 0) {
+                    if(mTail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        ticket = pos;
+                        return &slot.mVal; // EARLY RETURN!!!
+                    }
+                } else if(diff < 0) {
+                    return 0; // EARLY RETURN!!!
+                } else {
+                    pos = mTail.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void commit(size_t ticket) {
+            mSlots[ ticket & Mask ].mSeq.store(ticket + 1, std::memory_order_release);
+            notify();
+        }
+
+        void commitFromISR(size_t ticket, BaseType_t* woken) {
+            mSlots[ ticket & Mask ].mSeq.store(ticket + 1, std::memory_order_release);
+            notifyFromISR(woken);
+        }
+
+        template< class Val >
+        bool push(Val&& val) {
+            size_t ticket;
+            Type* ptr = reserve(ticket);
+            if( ! ptr) {
+                return false; // EARLY RETURN!!!
+            }
+            *ptr = std::forward< Val >(val);
+            commit(ticket);
+            return true;
+        }
+
+        ////// Consumer side, one task
+
+            // Next committed slot to read in place, 0 if none.  Then release().
+        Type* peek() {
+            Slot& slot = mSlots[ mHead & Mask ];
+            if(slot.mSeq.load(std::memory_order_acquire) != mHead + 1) {
+                return 0; // EARLY RETURN!!!
+            }
+            return &slot.mVal;
+        }
+
+        void release() {
+            mSlots[ mHead & Mask ].mSeq.store(mHead + Len, std::memory_order_release);
+            ++mHead;
+        }
+
+        bool pop(Type& val) {
+            Type* ptr = peek();
+            if( ! ptr) {
+                return false; // EARLY RETURN!!!
+            }
+            val = std::move(*ptr);
+            release();
+            return true;
+        }
+
+        bool waitForData(TickType_t wait = portMAX_DELAY) {
+            return waitFor([this]() { return peek() != 0; }, wait);
+        }
+
+    private:
+        static const size_t Mask = Len - 1;
+
+        struct Slot {
+            std::atomic< size_t > mSeq;
+            Type mVal;
+        };
+
+            // Consumer only
+        alignas(PNI_CACHE_LINE) size_t mHead = 0;
+            // Shared by producers
+        alignas(PNI_CACHE_LINE) std::atomic< size_t > mTail = { 0 };
+
+        alignas(PNI_CACHE_LINE) Slot mSlots[ Len ];
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pniringbuffer_h
@@ -45,6 +45,31 @@ class Semaphore {
         SemaphoreHandle_t mSema;
 };
 
+    // Counting semaphore, starts at `initial`.
+class SemaphoreCounting {
+    public:
+        SemaphoreCounting(UBaseType_t maxCount, UBaseType_t initial = 0) {
+            mSema = xSemaphoreCreateCounting(maxCount, initial);
+        }
+
+        ~SemaphoreCounting() {
+            vSemaphoreDelete(mSema);
+            mSema = 0;
+        }
+
+            // False if it timed out.
+        bool take(TickType_t wait = 0) {
+            return xSemaphoreTake(mSema, wait) == pdTRUE;
+        }
+
+        void give() {
+            xSemaphoreGive(mSema);
+        }
+
+    private:
+        SemaphoreHandle_t mSema;
+};
+
 class Mutex {
 
     public:
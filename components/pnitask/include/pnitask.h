@@ -7,6 +7,9 @@
 #ifndef task_h
 #define task_h
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include <string>
 #include <functional>
 
@@ -20,10 +23,56 @@ class Task {
         Task(std::string const& name);
         virtual ~Task();
 
-            // Can only change stack size before calling `start`.
+        static const UBaseType_t DefaultPriority = 1;
+        static const size_t DefaultStackSize = 2000;
+
+            // Can only change stack size before calling `start`.  In bytes
+            // on ESP-IDF.
         void setStackSize(size_t val) { mStackSize = val; }
         size_t getStackSize() const { return mStackSize; }
 
+            // 0 (idle) to configMAX_PRIORITIES - 1.  Takes effect right away
+            // if already started.
+        void setPriority(UBaseType_t val);
+        UBaseType_t getPriority() const;
+
+            // Core to pin to (0 or 1 on the ESP32), or tskNO_AFFINITY to
+            // let the scheduler pick.  Only before calling `start`.
+        void setCore(BaseType_t val) { mCore = val; }
+        BaseType_t getCore() const { return mCore; }
+
+#if configSUPPORT_STATIC_ALLOCATION
+            // Runs the task on caller owned memory (xTaskCreateStatic)
+            // instead of allocating a stack and TCB on the heap.  Both must
+            // outlive the task, e.g., a static Task::Stack.  Only before
+            // calling `start`, and sets the stack size to match.  Needs
+            // CONFIG_SUPPORT_STATIC_ALLOCATION.
+        void setStaticStack(StackType_t* stack, size_t size, StaticTask_t* tcb);
+
+        template< size_t Size >
+        struct Stack {
+            StackType_t mStack[ Size ];
+            StaticTask_t mTcb;
+        };
+
+        template< size_t Size >
+        void setStaticStack(Stack< Size >& stack) { setStaticStack(stack.mStack, Size, &stack.mTcb); }
+#endif
+
+            // 0 until `start`.
+        TaskHandle_t getHandle() const { return mTask; }
+
+            // Runtime stats, 0 if not started.  Stack high-water mark is the
+            // least free stack seen so far (bytes on ESP-IDF).  Run time is
+            // the FreeRTOS run time counter (microseconds with the default
+            // ESP-IDF esp_timer clock), needs configGENERATE_RUN_TIME_STATS
+            // and configUSE_TRACE_FACILITY, else 0.
+        size_t getStackHighWaterMark() const;
+        uint32_t getRunTime() const;
+
+            // Core the caller is running on.
+        static BaseType_t getCurrentCore();
+
         bool start();
         virtual void cancel();  // Not called by destructor, should be called at end of `taskMethod`.
 
@@ -36,10 +85,18 @@ class Task {
         static void taskFunc( void* param );
         virtual void taskMethod();
 
+            // For tasks that end themselves with vTaskDelete(0) rather than
+            // cancel(), once they're known to be gone.
+        void clearHandle() { mTask = 0; }
+
     private:
         std::string mName = "Unnamed task";
         TaskHandle_t mTask = 0;
-        size_t mStackSize = 2000;
+        size_t mStackSize = DefaultStackSize;
+        UBaseType_t mPriority = DefaultPriority;
+        BaseType_t mCore = tskNO_AFFINITY;
+        StackType_t* mStaticStack = 0;
+        StaticTask_t* mStaticTcb = 0;
 
 };
 
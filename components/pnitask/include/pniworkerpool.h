@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////
+//
+//  WorkerPool: splits one piece of work across cores, fork/join style.
+//
+//  The workers are Tasks created once, pinned one per core (other than
+//  the creating task's), that sleep on their task notifications.  Each
+//  dispatch wakes them with a notification, the calling task works too,
+//  and they all pull `grain` sized chunks off one atomic counter until
+//  the range is done.  The last worker to finish notifies the caller,
+//  so no semaphores are created, deleted or even taken per dispatch,
+//  and nothing is allocated.  E.g.:
+//    WorkerPool pool;      // One worker per other core
+//    ...
+//    pool.parallelFor(0, NumLeds, 100, [&](size_t beg, size_t end) {
+//        for(size_t ind = beg; ind < end; ++ind) {
+//            rgb[ ind ] = hsv[ ind ].toRgb();
+//        }
+//    });
+//    pool.forkJoin(2, [&](size_t chan) { ffts[ chan ].run(); });
+//
+//  Only one task should dispatch on a given pool, and not from inside
+//  the work it dispatched.  Joining waits on the calling task's
+//  notification, so a caller that also uses it for something else has
+//  to tolerate early wakeups (Actor and PeriodicTask do).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pniworkerpool_h
+#define pniworkerpool_h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "pnitask.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+class WorkerPool {
+    public:
+            // Workers go on the cores after the creating task's, round robin.
+        WorkerPool(size_t numWorkers = portNUM_PROCESSORS - 1, UBaseType_t priority = Task::DefaultPriority);
+        ~WorkerPool();
+
+        WorkerPool(WorkerPool const& rhs) = delete;
+        WorkerPool& operator = (WorkerPool const& rhs) = delete;
+
+            // Workers plus the calling task.
+        size_t getNumThreads() const { return mWorkers.size() + 1; }
+
+            // Calls func(beg, end) on chunks of at most `grain` that cover
+            // [begin, end), in parallel, and returns once all are done.
+            // Ranges of one chunk run right on the caller.
+        template< class Func >
+        void parallelFor(size_t begin, size_t end, size_t grain, Func&& func) {
+            dispatch(begin, end, grain, &invokeRange< typename std::remove_reference< Func >::type >,
+                    const_cast< void* >(static_cast< void const* >(&func)));
+        }
+
+            // Calls func(ind) for each ind in [0, num), in parallel.
+        template< class Func >
+        void forkJoin(size_t num, Func&& func) {
+            parallelFor(0, num, 1, [&func](size_t beg, size_t end) {
+                for(size_t ind = beg; ind < end; ++ind) {
+                    func(ind);
+                }
+            });
+        }
+
+            // Dispatches that woke workers, and chunks the caller ran.
+        size_t getDispatches() const { return mDispatches; }
+        size_t getCallerChunks() const { return mCallerChunks; }
+
+    private:
+        typedef void (*Invoke)(void* ctx, size_t beg, size_t end);
+
+        class Worker : public Task {
+            public:
+                Worker(WorkerPool& pool);
+
+            protected:
+                virtual void taskMethod();
+
+            private:
+                WorkerPool& mPool;
+        };
+
+        template< class Func >
+        static void invokeRange(void* ctx, size_t beg, size_t end) {
+            (*static_cast< Func* >(ctx))(beg, end);
+        }
+
+        void dispatch(size_t begin, size_t end, size_t grain, Invoke invoke, void* ctx);
+        size_t runChunks();
+        void finished();
+
+        std::vector< std::unique_ptr< Worker > > mWorkers;
+
+            // Current job, written by the caller before waking workers.
+        Invoke mInvoke = 0;
+        void* mCtx = 0;
+        size_t mEnd = 0;
+        size_t mGrain = 1;
+        TaskHandle_t mCaller = 0;
+        bool mQuit = false;
+
+        std::atomic< size_t > mNext = { 0 };        // Start of the next unclaimed chunk
+        std::atomic< size_t > mPending = { 0 };     // Woken workers not done yet
+
+        size_t mDispatches = 0;
+        size_t mCallerChunks = 0;
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // pniworkerpool_h
@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include "esp_log.h"
+
+#include "pniperiodic.h"
+
+////////////////////////////////////////////////////////////////////
+
+static const char* TAG = "periodic";
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+const size_t Histogram::NumBuckets;
+
+size_t Histogram::bucketFor(uint32_t val) {
+    if(val == 0) {
+        return 0; // EARLY RETURN!!!
+    }
+    size_t bucket = 32 - __builtin_clz(val);
+    return bucket < NumBuckets ? bucket : NumBuckets - 1;
+}
+
+uint32_t Histogram::bucketMax(size_t bucket) {
+    if(bucket == 0) {
+        return 0; // EARLY RETURN!!!
+    }
+    return bucket < NumBuckets - 1 ? (uint32_t(1) << bucket) - 1 : UINT32_MAX;
+}
+
+void Histogram::add(uint32_t val) {
+    ++mCounts[ bucketFor(val) ];
+    ++mTotal;
+    mSum += val;
+    mMin = val < mMin ? val : mMin;
+    mMax = val > mMax ? val : mMax;
+}
+
+uint32_t Histogram::getPercentile(uint32_t pct) const {
+    if(mTotal == 0) {
+        return 0; // EARLY RETURN!!!
+    }
+    uint64_t want = (uint64_t(mTotal) * pct + 99) / 100;
+    uint64_t seen = 0;
+    for(size_t bucket = 0; bucket < NumBuckets; ++bucket) {
+        seen += mCounts[ bucket ];
+        if(seen >= want && seen > 0) {
+            uint32_t max = bucketMax(bucket);
+            return max < mMax ? max : mMax; // EARLY RETURN!!!
+        }
+    }
+    return mMax;
+}
+
+////////////////////////////////////////////////////////////////////
+
+void PeriodicSchedule::started(int64_t now) {
+    mStart = now;
+    mStats.mJitter.add(now > mRelease ? uint32_t(now - mRelease) : 0);
+}
+
+void PeriodicSchedule::finished(int64_t now) {
+    ++mStats.mIterations;
+    mStats.mExec.add(uint32_t(now - mStart));
+
+    mRelease += mPeriod;
+    if(now > mRelease) {
+        ++mStats.mMisses;
+            // Start late on the release just missed, but don't queue up
+            // a burst of the ones before it.
+        int64_t behind = (now - mRelease) / mPeriod;
+        mRelease += behind * mPeriod;
+        mStats.mSkipped += uint32_t(behind);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+PeriodicTask::PeriodicTask(std::string const& name, uint32_t periodUs) :
+    Task(name),
+    mSchedule(periodUs)
+{
+
+}
+
+void PeriodicTask::setPeriod(uint32_t val) {
+    portENTER_CRITICAL(&mMux);
+    mSchedule.setPeriod(val);
+    portEXIT_CRITICAL(&mMux);
+}
+
+uint32_t PeriodicTask::getPeriod() const {
+    portENTER_CRITICAL(&mMux);
+    uint32_t ret = mSchedule.getPeriod();
+    portEXIT_CRITICAL(&mMux);
+    return ret;
+}
+
+void PeriodicTask::stop() {
+    if(getHandle() == 0) {
+        return; // EARLY RETURN!!!
+    }
+    mRunning = false;
+    TaskHandle_t waiter = mWaiter;
+    if(waiter) {
+        xTaskNotifyGive(waiter);
+    }
+    mDone.take(portMAX_DELAY);
+        // The task is gone, so its members are ours again.
+    clearHandle();
+    mWaiter = 0;
+    mRunning = true;
+}
+
+PeriodicStats PeriodicTask::getStats() const {
+    portENTER_CRITICAL(&mMux);
+    PeriodicStats ret = mSchedule.getStats();
+    portEXIT_CRITICAL(&mMux);
+    return ret;
+}
+
+void PeriodicTask::resetStats() {
+    portENTER_CRITICAL(&mMux);
+    mSchedule.resetStats();
+    portEXIT_CRITICAL(&mMux);
+}
+
+void PeriodicTask::periodMethod() {
+
+}
+
+void PeriodicTask::taskMethod() {
+    mWaiter = xTaskGetCurrentTaskHandle();
+
+    esp_timer_create_args_t args = {};
+    args.callback = timerFunc;
+    args.arg = this;
+    args.name = "periodic";
+    if(esp_timer_create(&args, &mTimer) != ESP_OK) {
+        ESP_LOGE(TAG, "PeriodicTask::taskMethod timer create failed");
+        mTimer = 0;
+        mRunning = false;
+    }
+
+    portENTER_CRITICAL(&mMux);
+    mSchedule.begin(esp_timer_get_time());
+    int64_t release = mSchedule.getRelease();
+    portEXIT_CRITICAL(&mMux);
+
+    while(mRunning) {
+        sleepUntil(release);
+        if( ! mRunning) {
+            break;
+        }
+
+        int64_t now = esp_timer_get_time();
+        portENTER_CRITICAL(&mMux);
+        mSchedule.started(now);
+        portEXIT_CRITICAL(&mMux);
+
+        periodMethod();
+
+        now = esp_timer_get_time();
+        portENTER_CRITICAL(&mMux);
+        mSchedule.finished(now);
+        release = mSchedule.getRelease();
+        portEXIT_CRITICAL(&mMux);
+    }
+
+    if(mTimer) {
+        esp_timer_stop(mTimer);
+        esp_timer_delete(mTimer);
+        mTimer = 0;
+    }
+    mDone.give();
+        // Like Actor, stop() may destroy this once mDone is given.
+    vTaskDelete(0);
+}
+
+void PeriodicTask::timerFunc(void* arg) {
+    PeriodicTask* self = reinterpret_cast< PeriodicTask* >(arg);
+    xTaskNotifyGive(self->mWaiter);
+}
+
+    // Loops since the notification can also come from stop() or a stale
+    // timer shot.
+void PeriodicTask::sleepUntil(int64_t time) {
+    while(mRunning) {
+        int64_t left = time - esp_timer_get_time();
+        if(left <= 0) {
+            return; // EARLY RETURN!!!
+        }
+        esp_timer_stop(mTimer);    // Fails harmlessly if it already fired
+        esp_timer_start_once(mTimer, uint64_t(left));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+PeriodicTaskLambda::PeriodicTaskLambda(std::string const& name, uint32_t periodUs, Lambda lambda) :
+    PeriodicTask(name, periodUs),
+    mLambda(lambda)
+{
+
+}
+
+void PeriodicTaskLambda::periodMethod() {
+    mLambda();
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
@@ -21,6 +21,9 @@ namespace pni {
 
 ////////////////////////////////////////////////////////////////////
 
+const UBaseType_t Task::DefaultPriority;
+const size_t Task::DefaultStackSize;
+
 Task::Task(std::string const& name) :
         mName(name),
         mTask(0) {
@@ -31,11 +34,64 @@ Task::~Task() {
     // Does not cancel automatically.
 }
 
+void Task::setPriority(UBaseType_t val) {
+    mPriority = val;
+    if(mTask != 0) {
+        vTaskPrioritySet(mTask, val);
+    }
+}
+
+UBaseType_t Task::getPriority() const {
+    return mTask != 0 ? uxTaskPriorityGet(mTask) : mPriority;
+}
+
+#if configSUPPORT_STATIC_ALLOCATION
+void Task::setStaticStack(StackType_t* stack, size_t size, StaticTask_t* tcb) {
+    mStaticStack = stack;
+    mStaticTcb = tcb;
+    mStackSize = size;
+}
+#endif
+
+size_t Task::getStackHighWaterMark() const {
+    return mTask != 0 ? uxTaskGetStackHighWaterMark(mTask) : 0;
+}
+
+uint32_t Task::getRunTime() const {
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    if(mTask == 0) {
+        return 0; // EARLY RETURN!!!
+    }
+    TaskStatus_t status;
+    vTaskGetInfo(mTask, &status, pdFALSE, eInvalid);
+    return status.ulRunTimeCounter;
+#else
+    return 0;
+#endif
+}
+
+BaseType_t Task::getCurrentCore() {
+    return xPortGetCoreID();
+}
+
 bool Task::start() {
     ESP_LOGV(TAG, "Task::start beg");
-    BaseType_t ret = xTaskCreate(taskFunc, mName.c_str(), mStackSize, this, 1, &mTask); // TODO: Fix magic numbers
+#if configSUPPORT_STATIC_ALLOCATION
+    if(mStaticStack) {
+        mTask = xTaskCreateStaticPinnedToCore(taskFunc, mName.c_str(), mStackSize, this, mPriority,
+                mStaticStack, mStaticTcb, mCore);
+        if(mTask == 0) {
+            ESP_LOGE(TAG, "Task::start static create failed for %s", mName.c_str());
+            return false;
+        }
+        ESP_LOGV(TAG, "Task::start end");
+        return true; // EARLY RETURN!!!
+    }
+#endif
 
+    BaseType_t ret = xTaskCreatePinnedToCore(taskFunc, mName.c_str(), mStackSize, this, mPriority, &mTask, mCore);
     if( ret != pdPASS) {
+        ESP_LOGE(TAG, "Task::start create failed for %s", mName.c_str());
         return false;
     }
 
@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#include "pniworkerpool.h"
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////
+
+static const char* TAG = "workerpool";
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+WorkerPool::Worker::Worker(WorkerPool& pool) :
+    Task("worker"),
+    mPool(pool)
+{
+
+}
+
+void WorkerPool::Worker::taskMethod() {
+    while(true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if(mPool.mQuit) {
+            break;
+        }
+        mPool.runChunks();
+        mPool.finished();
+    }
+        // ~WorkerPool may free this as soon as it's told, so delete by
+        // null handle after.
+    mPool.finished();
+    vTaskDelete(0);
+}
+
+////////////////////////////////////////////////////////////////////
+
+WorkerPool::WorkerPool(size_t numWorkers, UBaseType_t priority) {
+    BaseType_t core = Task::getCurrentCore();
+    for(size_t ind = 0; ind < numWorkers; ++ind) {
+        std::unique_ptr< Worker > worker(new Worker(*this));
+        worker->setPriority(priority);
+        worker->setCore(BaseType_t((core + 1 + ind) % portNUM_PROCESSORS));
+        if( ! worker->start()) {
+            ESP_LOGE(TAG, "WorkerPool worker %u failed to start", unsigned(ind));
+            break;
+        }
+        mWorkers.push_back(std::move(worker));
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    if(mWorkers.empty()) {
+        return; // EARLY RETURN!!!
+    }
+    mCaller = xTaskGetCurrentTaskHandle();
+    mQuit = true;
+    mPending = mWorkers.size();
+    for(auto& worker : mWorkers) {
+        xTaskNotifyGive(worker->getHandle());
+    }
+    while(mPending.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void WorkerPool::dispatch(size_t begin, size_t end, size_t grain, Invoke invoke, void* ctx) {
+    grain = std::max< size_t >(grain, 1);
+    if(end <= begin) {
+        return; // EARLY RETURN!!!
+    }
+    size_t chunks = (end - begin + grain - 1) / grain;
+    size_t wake = std::min(mWorkers.size(), chunks - 1);
+    if(wake == 0) {
+        invoke(ctx, begin, end);
+        return; // EARLY RETURN!!!
+    }
+
+    mInvoke = invoke;
+    mCtx = ctx;
+    mEnd = end;
+    mGrain = grain;
+    mCaller = xTaskGetCurrentTaskHandle();
+    mNext.store(begin, std::memory_order_relaxed);
+    mPending.store(wake, std::memory_order_relaxed);
+        // The notification publishes the job to the worker.
+    for(size_t ind = 0; ind < wake; ++ind) {
+        xTaskNotifyGive(mWorkers[ ind ]->getHandle());
+    }
+    ++mDispatches;
+
+    mCallerChunks += runChunks();
+    while(mPending.load(std::memory_order_acquire)) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+size_t WorkerPool::runChunks() {
+    size_t num = 0;
+    while(true) {
+        size_t beg = mNext.fetch_add(mGrain, std::memory_order_relaxed);
+        if(beg >= mEnd) {
+            return num; // EARLY RETURN!!!
+        }
+        mInvoke(mCtx, beg, std::min(beg + mGrain, mEnd));
+        ++num;
+    }
+}
+
+    // Last one out wakes the caller.
+void WorkerPool::finished() {
+    TaskHandle_t caller = mCaller;
+    if(mPending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        xTaskNotifyGive(caller);
+    }
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
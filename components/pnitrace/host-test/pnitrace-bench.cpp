@@ -0,0 +1,50 @@
+
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+
+#include "pnitrace.h"
+
+using namespace std;
+using namespace pni;
+
+uint32_t tracedDisabled(uint32_t val);
+
+static const size_t Iters = 10000000;
+
+template< typename Func >
+static double nsPerOp(Func func) {
+    auto beg = chrono::steady_clock::now();
+    func();
+    auto end = chrono::steady_clock::now();
+    return chrono::duration< double, nano >(end - beg).count() / Iters;
+}
+
+static uint32_t traced(uint32_t val) {
+    PNI_TRACE_SCOPE("enabled");
+    return val * 3 + 1;
+}
+
+int main() {
+    uint32_t sum = 0;
+    double off = nsPerOp([&]() {
+        for(size_t num = 0; num < Iters; ++num) {
+            sum += tracedDisabled(uint32_t(num));
+        }
+    });
+    double on = nsPerOp([&]() {
+        for(size_t num = 0; num < Iters; ++num) {
+            sum += traced(uint32_t(num));
+        }
+    });
+    Trace::setEnabled(false);
+    double paused = nsPerOp([&]() {
+        for(size_t num = 0; num < Iters; ++num) {
+            sum += traced(uint32_t(num));
+        }
+    });
+
+    cout << "PNI_TRACE_SCOPE (ns/zone): compiled out " << off << ", recording " << on
+        << ", paused " << paused << " (" << (sum & 1) << ")" << endl;
+    return 0;
+}
@@ -0,0 +1,17 @@
+
+    // Built with tracing compiled out, to check the macro costs nothing.
+#undef PNI_TRACE_ENABLED
+#define PNI_TRACE_ENABLED 0
+
+#include "pnitrace.h"
+
+#include <cstdint>
+
+#ifdef PNI_TRACE_CONCAT
+    #error "PNI_TRACE_ENABLED=0 should compile the tracer out"
+#endif
+
+uint32_t tracedDisabled(uint32_t val) {
+    PNI_TRACE_SCOPE("disabled");
+    return val * 3 + 1;
+}
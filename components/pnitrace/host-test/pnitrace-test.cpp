@@ -0,0 +1,152 @@
+
+#include <cstdlib>
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "microtest/microtest.h"
+
+#include "pnitrace.h"
+
+using namespace std;
+using namespace pni;
+
+uint32_t tracedDisabled(uint32_t val);
+
+static vector< Trace::Record > snapshot() {
+    vector< Trace::Record > recs;
+    Trace::forEach([&recs](size_t core, Trace::Record const& rec) { recs.push_back(rec); });
+    return recs;
+}
+
+TEST(scopes) {
+    Trace::clear();
+    {
+        PNI_TRACE_SCOPE("outer");
+        {
+            PNI_TRACE_SCOPE("inner");
+            this_thread::sleep_for(chrono::milliseconds(2));
+        }
+    }
+    auto recs = snapshot();
+    ASSERT_EQ(recs.size(), 2u);
+        // Recorded as they close, inner first.
+    ASSERT_EQ(string(recs[ 0 ].mName), "inner");
+    ASSERT_EQ(string(recs[ 1 ].mName), "outer");
+    ASSERT_TRUE(recs[ 0 ].mDur >= 2 * 1000 * 1000);
+    ASSERT_TRUE(recs[ 1 ].mDur >= recs[ 0 ].mDur);
+    ASSERT_TRUE(Trace::Ticks(recs[ 0 ].mStart - recs[ 1 ].mStart) < recs[ 1 ].mDur);
+}
+
+TEST(disabled) {
+    Trace::clear();
+    uint32_t val = tracedDisabled(2);
+    ASSERT_EQ(val, 7u);
+    ASSERT_EQ(Trace::getCount(0), 0u);
+
+        // Paused at runtime.
+    Trace::setEnabled(false);
+    {
+        PNI_TRACE_SCOPE("paused");
+    }
+    Trace::setEnabled(true);
+    ASSERT_EQ(Trace::getCount(0), 0u);
+}
+
+    // Keeps the newest RingSize, oldest first.
+TEST(wrap) {
+    Trace::clear();
+    static const char* Names[] = { "a", "b", "c" };
+    for(size_t num = 0; num < Trace::RingSize + 5; ++num) {
+        Trace::record(Names[ num % 3 ], Trace::Ticks(num), Trace::Ticks(num + 1));
+    }
+    auto recs = snapshot();
+    ASSERT_EQ(recs.size(), Trace::RingSize);
+    ASSERT_EQ(recs[ 0 ].mStart, 5u);
+    ASSERT_EQ(recs.back().mStart, Trace::Ticks(Trace::RingSize + 4));
+    ASSERT_EQ(Trace::getCount(0), Trace::RingSize + 5);
+}
+
+TEST(threads) {
+    Trace::clear();
+    static const size_t PerThread = 100;
+    vector< thread > threads;
+    for(size_t ind = 0; ind < 4; ++ind) {
+        threads.emplace_back([]() {
+            for(size_t num = 0; num < PerThread; ++num) {
+                PNI_TRACE_SCOPE("worker");
+            }
+        });
+    }
+    for(auto& thr : threads) {
+        thr.join();
+    }
+    size_t total = 0;
+    for(size_t core = 0; core < Trace::NumCores; ++core) {
+        total += Trace::getCount(core);
+    }
+    ASSERT_EQ(total, 4 * PerThread);
+    auto recs = snapshot();
+    bool named = true;
+    for(auto& rec : recs) {
+        named = named && string(rec.mName) == "worker";
+    }
+    ASSERT_TRUE(named);
+}
+
+    // Times come out relative to the earliest zone, in microseconds,
+    // even across a wrap of the 32 bit ticks.
+TEST(dumpChrome) {
+    Trace::clear();
+    Trace::Ticks now = Trace::now();
+    Trace::Ticks beg = now - 3000000;       // 3 ms ago
+    Trace::record("fft", beg, beg + 1500);
+    Trace::record("graph.draw", beg + 2000, beg + 2500);
+
+    string json;
+    Trace::dumpChrome([](void* ctx, const char* text) { *static_cast< string* >(ctx) += text; }, &json);
+    ASSERT_TRUE(Trace::isEnabled());
+    ASSERT_TRUE(json.find("{\"traceEvents\":[") == 0);
+    ASSERT_TRUE(json.find("{\"name\":\"fft\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0.000,\"dur\":1.500}") != string::npos);
+    ASSERT_TRUE(json.find("{\"name\":\"graph.draw\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":2.000,\"dur\":0.500}") != string::npos);
+    ASSERT_TRUE(json.find("\"displayTimeUnit\":\"ns\"}") != string::npos);
+
+        // Straddling the wrap.
+    Trace::clear();
+    Trace::record("before", Trace::Ticks(-1000), Trace::Ticks(-500));
+    Trace::record("after", Trace::Ticks(-100), Trace::Ticks(400));
+    json.clear();
+    Trace::dumpChrome([](void* ctx, const char* text) { *static_cast< string* >(ctx) += text; }, &json);
+    ASSERT_TRUE(json.find("\"name\":\"after\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0.900,\"dur\":0.500") != string::npos);
+}
+
+    // Each core's ticks count from wherever they like, so rings line up
+    // on esp_timer instead: here core 1's ticks are a second ahead, and
+    // its zone ends just before core 0's.
+TEST(dumpChromeCores) {
+    Trace::clear();
+    xTaskCreatePinnedToCore([](void* param) {
+        Trace::Ticks ahead = Trace::now() + 1000000000;
+        Trace::record("core1", ahead - 3000, ahead);
+        vTaskDelete(0);
+    }, "core1", 4096, 0, 1, 0, 1);
+    while(Trace::getCount(1) == 0) {
+        this_thread::yield();
+    }
+    Trace::Ticks now = Trace::now();
+    Trace::record("core0", now - 1000, now);
+
+    string json;
+    Trace::dumpChrome([](void* ctx, const char* text) { *static_cast< string* >(ctx) += text; }, &json);
+    ASSERT_TRUE(json.find("\"name\":\"core1\",\"ph\":\"X\",\"pid\":0,\"tid\":1,\"ts\":0.000,\"dur\":3.000") != string::npos);
+    string core0 = "\"name\":\"core0\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":";
+    size_t pos = json.find(core0);
+    ASSERT_TRUE(pos != string::npos);
+        // 2 us plus however long it took to get here.
+    double ts = atof(json.c_str() + pos + core0.size());
+    ASSERT_TRUE(ts > 1.0 && ts < 1000.0);
+}
+
+TEST_MAIN();
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Trace: timestamped zones for seeing where a frame's time goes.
+//
+//  PNI_TRACE_SCOPE("fft") at the top of a block records one zone (name,
+//  start, duration) when the block exits.  Records go into a ring per
+//  core, claimed with one atomic add, so tasks on both cores (and
+//  tasks preempting each other) can trace without locks; the ring
+//  keeps the newest RingSize zones per core.  Timestamps are the CPU
+//  cycle counter on the ESP32, steady_clock nanoseconds on hosts.  The
+//  two cores' cycle counters aren't kept in step, so once per lap each
+//  ring also notes esp_timer's time, which both cores share.
+//
+//  Compiled out unless built with PNI_TRACE_ENABLED=1 (e.g., CPPFLAGS +=
+//  -DPNI_TRACE_ENABLED=1 in the project Makefile): otherwise the macro
+//  is empty and nothing else is compiled in.  Trace::setEnabled pauses
+//  it at runtime, down to one flag check per zone.
+//
+//  Trace::dumpChrome writes what's in the rings as Chrome trace event
+//  JSON, one "complete" event per zone with the core as the thread, and
+//  the cores lined up on esp_timer (to within a microsecond or so).
+//  Save it to a file and open it in chrome://tracing or Perfetto.
+//
+//  Zone names must be string literals (only the pointer is stored).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnitrace_h
+#define pnitrace_h
+
+#ifndef PNI_TRACE_ENABLED
+    #define PNI_TRACE_ENABLED 0
+#endif
+
+#if PNI_TRACE_ENABLED
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__XTENSA__)
+    #include "rom/ets_sys.h"
+#else
+    #include <chrono>
+#endif
+
+    // Zones kept per core, must be a power of 2.
+#ifndef PNI_TRACE_RING_SIZE
+    #define PNI_TRACE_RING_SIZE 512
+#endif
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+class Trace {
+    public:
+        typedef uint32_t Ticks;     // Wraps, ~18 s at 240 MHz, ~4 s on hosts
+
+        struct Record {
+            const char* mName;
+            Ticks mStart;
+            Ticks mDur;
+        };
+
+        static const size_t RingSize = PNI_TRACE_RING_SIZE;
+        static const size_t NumCores = portNUM_PROCESSORS;
+        static_assert(RingSize && (RingSize & (RingSize - 1)) == 0, "PNI_TRACE_RING_SIZE must be a power of 2");
+
+        static Ticks now() {
+#if defined(__XTENSA__)
+            Ticks val;
+            __asm__ __volatile__("rsr %0, ccount" : "=a"(val));
+            return val;
+#else
+            return Ticks(std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+            // The CPU clock as it is now, so durations come out skewed if
+            // power management changes it while tracing.
+        static double getTicksPerUs() {
+#if defined(__XTENSA__)
+            return ets_get_cpu_frequency();
+#else
+            return 1000.0;
+#endif
+        }
+
+            // Claiming a slot is atomic but filling it isn't: a task
+            // preempted mid-record for a whole lap of its core's ring can
+            // land on the slot a newer zone is writing, and leave it with
+            // parts of both.  Keep RingSize well above the zones recorded
+            // while any one task is preempted.
+        static void record(const char* name, Ticks start, Ticks end) {
+            if( ! sEnabled.load(std::memory_order_relaxed)) {
+                return; // EARLY RETURN!!!
+            }
+            Ring& ring = sRings[ xPortGetCoreID() ];
+            uint32_t pos = ring.mHead.fetch_add(1, std::memory_order_relaxed);
+            Record& rec = ring.mRecords[ pos & (RingSize - 1) ];
+            rec.mName = name;
+            rec.mStart = start;
+            rec.mDur = end - start;
+            if((pos & (RingSize - 1)) == 0) {
+                ring.mAnchorUs = esp_timer_get_time();
+            }
+        }
+
+            // Pauses/resumes recording at runtime.
+        static void setEnabled(bool val) { sEnabled.store(val, std::memory_order_relaxed); }
+        static bool isEnabled() { return sEnabled.load(std::memory_order_relaxed); }
+
+        static void clear();
+
+            // Zones recorded on `core` so far, including overwritten ones.
+        static uint32_t getCount(size_t core) { return sRings[ core ].mHead.load(std::memory_order_relaxed); }
+
+            // Calls func(core, record) on what's still in the rings, oldest
+            // first per core.  Pause recording first for a clean snapshot.
+        template< class Func >
+        static void forEach(Func func) {
+            for(size_t core = 0; core < NumCores; ++core) {
+                Ring& ring = sRings[ core ];
+                uint32_t end = ring.mHead.load(std::memory_order_acquire);
+                uint32_t beg = end > RingSize ? end - RingSize : 0;
+                for(uint32_t pos = beg; pos != end; ++pos) {
+                    func(core, ring.mRecords[ pos & (RingSize - 1) ]);
+                }
+            }
+        }
+
+            // Writes Chrome trace JSON a piece at a time to `write`, e.g.,
+            // to a file or the console.  Pauses recording meanwhile.
+        typedef void (*Writer)(void* ctx, const char* text);
+        static void dumpChrome(Writer write, void* ctx);
+        static void dumpChrome(FILE* file);
+
+    private:
+        struct Ring {
+            alignas(64) std::atomic< uint32_t > mHead;
+            int64_t mAnchorUs;          // esp_timer at the end of slot 0's zone
+            Record mRecords[ RingSize ];
+        };
+
+        static Ring sRings[ NumCores ];
+        static std::atomic< bool > sEnabled;
+};
+
+////////////////////////////////////////////////////////////////////
+
+    // Checks once on the way in, so a paused tracer doesn't read the
+    // clock.
+class TraceScope {
+    public:
+        TraceScope(const char* name) :
+            mName(Trace::isEnabled() ? name : nullptr),
+            mStart(mName ? Trace::now() : 0) {
+        }
+
+        ~TraceScope() {
+            if(mName) {
+                Trace::record(mName, mStart, Trace::now());
+            }
+        }
+
+        TraceScope(TraceScope const& rhs) = delete;
+        TraceScope& operator = (TraceScope const& rhs) = delete;
+
+    private:
+        const char* mName;
+        Trace::Ticks mStart;
+};
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#define PNI_TRACE_CONCAT2(lhs, rhs) lhs ## rhs
+#define PNI_TRACE_CONCAT(lhs, rhs) PNI_TRACE_CONCAT2(lhs, rhs)
+#define PNI_TRACE_SCOPE(name) ::pni::TraceScope PNI_TRACE_CONCAT(pniTraceScope, __LINE__)(name)
+
+#else // PNI_TRACE_ENABLED
+
+#define PNI_TRACE_SCOPE(name) do {} while(0)
+
+#endif // PNI_TRACE_ENABLED
+
+#endif // pnitrace_h
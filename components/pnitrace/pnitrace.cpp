@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////
+//
+//
+//
+////////////////////////////////////////////////////////////////////
+
+#include "pnitrace.h"
+
+#if PNI_TRACE_ENABLED
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////
+
+namespace pni {
+
+////////////////////////////////////////////////////////////////////
+
+const size_t Trace::RingSize;
+const size_t Trace::NumCores;
+
+Trace::Ring Trace::sRings[ Trace::NumCores ];
+std::atomic< bool > Trace::sEnabled(true);
+
+void Trace::clear() {
+    for(auto& ring : sRings) {
+        ring.mHead.store(0, std::memory_order_relaxed);
+    }
+}
+
+    // Ticks wrap, so rebuild 64 bit times.  Within a ring, records are in
+    // (roughly) end order, so consecutive ends are close together and
+    // the wrapped difference is the real one.  Each ring is then shifted
+    // onto esp_timer's clock by its anchor, the one zone in it that was
+    // recorded in slot 0, since the cores' tick counters differ.
+void Trace::dumpChrome(Writer write, void* ctx) {
+    bool wasEnabled = isEnabled();
+    setEnabled(false);
+
+    double perUs = getTicksPerUs();
+    int64_t shifts[ NumCores ] = {};
+    int64_t minStart = INT64_MAX;
+    bool first = true;
+    for(size_t pass = 0; pass < 3; ++pass) {
+        if(pass == 1) {
+            for(size_t core = 0; core < NumCores; ++core) {
+                    // shifts holds each ring's unwrapped anchor end.
+                shifts[ core ] = int64_t(sRings[ core ].mAnchorUs * perUs) - shifts[ core ];
+            }
+        } else if(pass == 2) {
+            write(ctx, "{\"traceEvents\":[\n");
+        }
+        size_t lastCore = NumCores;
+        int64_t lastEnd = 0;
+        uint32_t pos = 0;
+        forEach([&](size_t core, Record const& rec) {
+            Ticks end = rec.mStart + rec.mDur;
+            if(core != lastCore) {
+                lastCore = core;
+                lastEnd = end;
+                uint32_t count = getCount(core);
+                pos = count > RingSize ? count - RingSize : 0;
+            } else {
+                lastEnd += int32_t(end - Ticks(lastEnd));
+                ++pos;
+            }
+            if(pass == 0) {
+                if((pos & (RingSize - 1)) == 0) {
+                    shifts[ core ] = lastEnd;
+                }
+                return; // EARLY RETURN!!!
+            }
+            int64_t start = lastEnd + shifts[ core ] - rec.mDur;
+            if(pass == 1) {
+                minStart = std::min(minStart, start);
+                return; // EARLY RETURN!!!
+            }
+
+            char buf[ 160 ];
+            snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    first ? "" : ",\n", rec.mName, unsigned(core), (start - minStart) / perUs, rec.mDur / perUs);
+            write(ctx, buf);
+            first = false;
+        });
+    }
+    write(ctx, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    setEnabled(wasEnabled);
+}
+
+void Trace::dumpChrome(FILE* file) {
+    dumpChrome([](void* ctx, const char* text) { fputs(text, static_cast< FILE* >(ctx)); }, file);
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pni
+
+#endif // PNI_TRACE_ENABLED
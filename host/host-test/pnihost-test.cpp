@@ -0,0 +1,203 @@
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "microtest/microtest.h"
+
+#include "driver/i2s.h"
+#include "pnihost/i2ssources.h"
+#include "pnihost/gpiocapture.h"
+
+#include "pniapa102.h"
+#include "pnimicsph0645.h"
+
+using namespace std;
+using namespace pni;
+using namespace pnihost;
+
+static i2s_config_t makeConfig(i2s_bits_per_sample_t bits, i2s_channel_fmt_t format) {
+    i2s_config_t config = {};
+    config.mode = i2s_mode_t(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = 8000;
+    config.bits_per_sample = bits;
+    config.channel_format = format;
+    config.dma_buf_count = 4;
+    config.dma_buf_len = 64;
+    return config;
+}
+
+TEST(i2sGenerator16) {
+    I2sGenerator gen({ { 1000.0f, 0.5f } }, 0.0f, 100);
+    i2sSetSource(I2S_NUM_0, &gen);
+    i2s_config_t config = makeConfig(I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_FMT_ONLY_RIGHT);
+    esp_err_t err = i2s_driver_install(I2S_NUM_0, &config, 0, 0);
+    ASSERT_EQ(err, ESP_OK);
+    err = i2s_driver_install(I2S_NUM_0, &config, 0, 0);
+    ASSERT_EQ(err, ESP_ERR_INVALID_STATE);
+
+    vector< int16_t > buf(64);
+    int got = i2s_read_bytes(I2S_NUM_0, (char*) &buf[ 0 ], buf.size() * 2, portMAX_DELAY);
+    ASSERT_EQ(got, 128);
+        // 1 kHz at 8 kHz: 0, 45, 90 degrees...
+    ASSERT_EQ(buf[ 0 ], 0);
+    ASSERT_TRUE(abs(buf[ 2 ] - 16383) <= 1);
+    ASSERT_TRUE(abs(buf[ 6 ] + 16383) <= 1);
+
+        // 100 sample clip, then dry.
+    got = i2s_read_bytes(I2S_NUM_0, (char*) &buf[ 0 ], buf.size() * 2, portMAX_DELAY);
+    ASSERT_EQ(got, 72);
+    got = i2s_read_bytes(I2S_NUM_0, (char*) &buf[ 0 ], buf.size() * 2, portMAX_DELAY);
+    ASSERT_EQ(got, 0);
+
+    err = i2s_driver_uninstall(I2S_NUM_0);
+    ASSERT_EQ(err, ESP_OK);
+    got = i2s_read_bytes(I2S_NUM_0, (char*) &buf[ 0 ], 2, portMAX_DELAY);
+    ASSERT_EQ(got, ESP_FAIL);
+    i2sSetSource(I2S_NUM_0, 0);
+}
+
+TEST(i2sStereo32) {
+    I2sGenerator gen({ { 1000.0f, -1.0f } });
+    i2sSetSource(I2S_NUM_1, &gen);
+    i2s_config_t config = makeConfig(I2S_BITS_PER_SAMPLE_32BIT, I2S_CHANNEL_FMT_RIGHT_LEFT);
+    esp_err_t err = i2s_driver_install(I2S_NUM_1, &config, 0, 0);
+    ASSERT_EQ(err, ESP_OK);
+
+    vector< int32_t > buf(16);
+    size_t bytes = 0;
+    err = i2s_read(I2S_NUM_1, &buf[ 0 ], buf.size() * 4, &bytes, portMAX_DELAY);
+    ASSERT_EQ(err, ESP_OK);
+    ASSERT_EQ(bytes, 64);
+        // Mic in the first slot, 18 bits MSB aligned; zero in the second.
+    ASSERT_EQ(buf[ 4 ], -(((1 << 17) - 1) << 14));
+    for(size_t ind = 0; ind < buf.size(); ind += 2) {
+        ASSERT_EQ(buf[ ind ] & ((1 << 14) - 1), 0);
+        ASSERT_EQ(buf[ ind + 1 ], 0);
+    }
+
+    i2s_driver_uninstall(I2S_NUM_1);
+    i2sSetSource(I2S_NUM_1, 0);
+}
+
+TEST(i2sWavFile) {
+    const char* path = "pnihost-test.wav";
+    vector< float > samples(300);
+    for(size_t ind = 0; ind < samples.size(); ++ind) {
+        samples[ ind ] = sinf(ind * 0.1f) * 0.8f;
+    }
+    ASSERT_TRUE(writeWav(path, samples, 16000));
+
+    I2sWavFile wav(path);
+    remove(path);
+    ASSERT_TRUE(wav.isOpen());
+    ASSERT_EQ(wav.getSampleRate(), 16000);
+    ASSERT_EQ(wav.getSamples().size(), samples.size());
+
+    vector< float > out(200);
+    size_t got = wav.read(&out[ 0 ], out.size(), 16000);
+    ASSERT_EQ(got, 200);
+    for(size_t ind = 0; ind < out.size(); ++ind) {
+        ASSERT_TRUE(fabsf(out[ ind ] - samples[ ind ]) < 1.0f / 16384);
+    }
+    got = wav.read(&out[ 0 ], out.size(), 16000);
+    ASSERT_EQ(got, 100);
+    got = wav.read(&out[ 0 ], out.size(), 16000);
+    ASSERT_EQ(got, 0);
+
+    I2sWavFile missing("no-such-file.wav");
+    ASSERT_FALSE(missing.isOpen());
+}
+
+TEST(i2sRealTime) {
+    I2sGenerator gen({ { 440.0f, 0.5f } });
+    i2sSetSource(I2S_NUM_0, &gen);
+    i2sSetRealTime(I2S_NUM_0, true);
+    i2s_config_t config = makeConfig(I2S_BITS_PER_SAMPLE_16BIT, I2S_CHANNEL_FMT_ONLY_RIGHT);
+    i2s_driver_install(I2S_NUM_0, &config, 0, 0);
+
+        // 400 samples at 8 kHz is 50 ms.
+    vector< int16_t > buf(400);
+    auto beg = chrono::steady_clock::now();
+    i2s_read_bytes(I2S_NUM_0, (char*) &buf[ 0 ], buf.size() * 2, portMAX_DELAY);
+    auto ms = chrono::duration_cast< chrono::milliseconds >(chrono::steady_clock::now() - beg).count();
+    ASSERT_TRUE(ms >= 45);
+
+    i2s_driver_uninstall(I2S_NUM_0);
+    i2sSetRealTime(I2S_NUM_0, false);
+    i2sSetSource(I2S_NUM_0, 0);
+}
+
+TEST(micSph0645) {
+    I2sGenerator gen({ { 1000.0f, 0.01f } });
+    i2sSetSource(I2S_NUM_0, &gen);
+
+    MicSph0645 mic;
+    MicSph0645::Config config = { 0, 8000, 2, 32, 4, 64, 26, 25, I2S_PIN_NO_CHANGE, 22 };
+    ASSERT_TRUE(mic.init(config));
+
+    vector< int32_t > samples;
+    int bytes = mic.readSamples(samples);
+    ASSERT_EQ(bytes, 4 * 64 * 4 * 2);
+    mic.reorderSamples(samples);
+    ASSERT_EQ(samples.size(), 4 * 64);
+        // 18 bit sample << 14, then readSamples' << 5.
+    int32_t expect = int32_t(0.01f * ((1 << 17) - 1)) << 19;
+    ASSERT_EQ(samples[ 2 ], expect);
+
+    mic.uninit();
+    i2sSetSource(I2S_NUM_0, 0);
+}
+
+TEST(gpioCapture) {
+    GpioCapture capture({ GPIO_NUM_4 });
+    gpio_set_level(GPIO_NUM_4, 1);
+    gpio_set_level(GPIO_NUM_4, 1);
+    gpio_set_level(GPIO_NUM_5, 1);
+    gpio_set_level(GPIO_NUM_4, 0);
+    ASSERT_EQ(gpio_get_level(GPIO_NUM_5), 1);
+    ASSERT_EQ(capture.mChanges.size(), 2);
+    ASSERT_EQ(capture.mChanges[ 0 ].mLevel, 1);
+    ASSERT_EQ(capture.mChanges[ 1 ].mLevel, 0);
+    esp_err_t err = gpio_set_level(GPIO_NUM_MAX, 1);
+    ASSERT_EQ(err, ESP_ERR_INVALID_ARG);
+}
+
+TEST(spiCaptureApa102) {
+    SpiCapture spi(GPIO_NUM_18, GPIO_NUM_23);
+    Apa102Software apa;
+    apa.init({ GPIO_NUM_23, GPIO_NUM_18 });
+
+    Apa102::Colors colors;
+    for(uint8_t ind = 0; ind < 10; ++ind) {
+        colors.mColor.push_back({ uint8_t(ind * 20), uint8_t(255 - ind), uint8_t(ind), uint8_t(ind + 3) });
+    }
+    apa.writeColors(colors);
+    apa.writeColors(colors);
+    ASSERT_EQ(spi.mBytes.size(), 2 * (4 + 10 * 4 + 4));
+    ASSERT_EQ(spi.mClocks, spi.mBytes.size() * 8);
+
+    vector< Apa102Frame > frames;
+    size_t used = decodeApa102(spi.mBytes, frames);
+    ASSERT_EQ(used, spi.mBytes.size());
+    ASSERT_EQ(frames.size(), 2);
+    ASSERT_EQ(frames[ 1 ].size(), 10);
+    for(size_t ind = 0; ind < 10; ++ind) {
+        ASSERT_EQ(frames[ 1 ][ ind ].r, colors.mColor[ ind ].r);
+        ASSERT_EQ(frames[ 1 ][ ind ].g, colors.mColor[ ind ].g);
+        ASSERT_EQ(frames[ 1 ][ ind ].b, colors.mColor[ ind ].b);
+        ASSERT_EQ(frames[ 1 ][ ind ].v, colors.mColor[ ind ].v);
+    }
+
+        // Half a frame isn't decoded yet.
+    spi.clear();
+    apa.writeColors(colors);
+    vector< uint8_t > half(spi.mBytes.begin(), spi.mBytes.begin() + 20);
+    frames.clear();
+    used = decodeApa102(half, frames);
+    ASSERT_EQ(used, 0);
+    ASSERT_EQ(frames.size(), 0);
+}
+
+TEST_MAIN();
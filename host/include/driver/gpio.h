@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for esp-idf driver/gpio.h.  The types, plus gpio_config
+//  and gpio_set/get_level over an array of pin levels, enough for
+//  drivers that bit-bang pins to run on a host.
+//
+//  pnihost::gpioAddWatcher hooks every gpio_set_level, e.g., to decode
+//  a bit-banged bus (see pnihost/gpiocapture.h).  Add and remove
+//  watchers while no task is setting levels.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_driver_gpio_h
+#define pnihost_driver_gpio_h
+
+#include <cstdint>
+#include <vector>
+
+#include "esp_err.h"
+
+typedef enum {
+    GPIO_NUM_NC = -1,
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_1 = 1,
+    GPIO_NUM_2 = 2,
+    GPIO_NUM_3 = 3,
+    GPIO_NUM_4 = 4,
+    GPIO_NUM_5 = 5,
+    GPIO_NUM_6 = 6,
+    GPIO_NUM_7 = 7,
+    GPIO_NUM_8 = 8,
+    GPIO_NUM_9 = 9,
+    GPIO_NUM_10 = 10,
+    GPIO_NUM_11 = 11,
+    GPIO_NUM_12 = 12,
+    GPIO_NUM_13 = 13,
+    GPIO_NUM_14 = 14,
+    GPIO_NUM_15 = 15,
+    GPIO_NUM_16 = 16,
+    GPIO_NUM_17 = 17,
+    GPIO_NUM_18 = 18,
+    GPIO_NUM_19 = 19,
+    GPIO_NUM_20 = 20,
+    GPIO_NUM_21 = 21,
+    GPIO_NUM_22 = 22,
+    GPIO_NUM_23 = 23,
+    GPIO_NUM_24 = 24,
+    GPIO_NUM_25 = 25,
+    GPIO_NUM_26 = 26,
+    GPIO_NUM_27 = 27,
+    GPIO_NUM_28 = 28,
+    GPIO_NUM_29 = 29,
+    GPIO_NUM_30 = 30,
+    GPIO_NUM_31 = 31,
+    GPIO_NUM_32 = 32,
+    GPIO_NUM_33 = 33,
+    GPIO_NUM_34 = 34,
+    GPIO_NUM_35 = 35,
+    GPIO_NUM_36 = 36,
+    GPIO_NUM_37 = 37,
+    GPIO_NUM_38 = 38,
+    GPIO_NUM_39 = 39,
+    GPIO_NUM_MAX = 40
+} gpio_num_t;
+
+typedef enum {
+    GPIO_MODE_DISABLE = 0,
+    GPIO_MODE_INPUT = 1,
+    GPIO_MODE_OUTPUT = 2,
+    GPIO_MODE_OUTPUT_OD = 6,
+    GPIO_MODE_INPUT_OUTPUT_OD = 7,
+    GPIO_MODE_INPUT_OUTPUT = 3
+} gpio_mode_t;
+
+typedef enum {
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE = 1
+} gpio_pullup_t;
+
+typedef enum {
+    GPIO_PULLDOWN_DISABLE = 0,
+    GPIO_PULLDOWN_ENABLE = 1
+} gpio_pulldown_t;
+
+typedef enum {
+    GPIO_INTR_DISABLE = 0,
+    GPIO_INTR_POSEDGE = 1,
+    GPIO_INTR_NEGEDGE = 2,
+    GPIO_INTR_ANYEDGE = 3,
+    GPIO_INTR_LOW_LEVEL = 4,
+    GPIO_INTR_HIGH_LEVEL = 5
+} gpio_int_type_t;
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+namespace pnihost {
+
+inline volatile uint32_t* gpioLevels() {
+    static volatile uint32_t levels[ GPIO_NUM_MAX ] = {};
+    return levels;
+}
+
+typedef void (*GpioWatch)(void* ctx, gpio_num_t pin, uint32_t level);
+
+struct GpioWatcher {
+    GpioWatch mFunc;
+    void* mCtx;
+};
+
+inline std::vector< GpioWatcher >& gpioWatchers() {
+    static std::vector< GpioWatcher > watchers;
+    return watchers;
+}
+
+inline void gpioAddWatcher(GpioWatch func, void* ctx) {
+    gpioWatchers().push_back(GpioWatcher{ func, ctx });
+}
+
+inline void gpioRemoveWatcher(void* ctx) {
+    auto& watchers = gpioWatchers();
+    for(size_t ind = 0; ind < watchers.size(); ) {
+        if(watchers[ ind ].mCtx == ctx) {
+            watchers.erase(watchers.begin() + ind);
+        } else {
+            ++ind;
+        }
+    }
+}
+
+} // end namespace pnihost
+
+inline esp_err_t gpio_config(const gpio_config_t* config) {
+    return config && (config->pin_bit_mask >> GPIO_NUM_MAX) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+inline esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if(pin < 0 || pin >= GPIO_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG; // EARLY RETURN!!!
+    }
+    pnihost::gpioLevels()[ pin ] = level & 1;
+    for(auto const& watcher : pnihost::gpioWatchers()) {
+        watcher.mFunc(watcher.mCtx, pin, level & 1);
+    }
+    return ESP_OK;
+}
+
+inline esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode) {
+    return pin < 0 || pin >= GPIO_NUM_MAX ? ESP_ERR_INVALID_ARG : ESP_OK;
+}
+
+inline int gpio_get_level(gpio_num_t pin) {
+    return pin < 0 || pin >= GPIO_NUM_MAX ? 0 : int(pnihost::gpioLevels()[ pin ]);
+}
+
+#endif // pnihost_driver_gpio_h
@@ -0,0 +1,232 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for esp-idf driver/i2s.h, the receive side.
+//
+//  Samples come from a pnihost::I2sSource attached to the port with
+//  pnihost::i2sSetSource (see pnihost/i2ssources.h for a tone
+//  generator and a WAV file reader).  i2s_read_bytes packs them the
+//  way the hardware delivers them:
+//  * 8/16 bit: full scale signed samples.
+//  * 24/32 bit: signed, MSB aligned in 32 bit slots, with only the
+//    top mValidBits set (18 by default, like the SPH0645 mic).
+//  * I2S_CHANNEL_FMT_RIGHT_LEFT: two slots per frame, the source in
+//    the first and zero in the second (one mic on a stereo bus).
+//    The ONLY/ALL formats are one slot per frame.
+//
+//  By default reads return as fast as the source can fill them, for
+//  profiling.  pnihost::i2sSetRealTime paces them to the sample rate
+//  like DMA does.  A source that runs dry makes reads return 0.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_driver_i2s_h
+#define pnihost_driver_i2s_h
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "esp_err.h"
+#include "esp_intr_alloc.h"
+#include "freertos/FreeRTOS.h"
+
+////////////////////////////////////////////////////////////////////
+
+typedef enum {
+    I2S_NUM_0 = 0,
+    I2S_NUM_1 = 1,
+    I2S_NUM_MAX
+} i2s_port_t;
+
+typedef enum {
+    I2S_BITS_PER_SAMPLE_8BIT = 8,
+    I2S_BITS_PER_SAMPLE_16BIT = 16,
+    I2S_BITS_PER_SAMPLE_24BIT = 24,
+    I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum {
+    I2S_CHANNEL_MONO = 1,
+    I2S_CHANNEL_STEREO = 2
+} i2s_channel_t;
+
+typedef enum {
+    I2S_CHANNEL_FMT_RIGHT_LEFT = 0,
+    I2S_CHANNEL_FMT_ALL_RIGHT,
+    I2S_CHANNEL_FMT_ALL_LEFT,
+    I2S_CHANNEL_FMT_ONLY_RIGHT,
+    I2S_CHANNEL_FMT_ONLY_LEFT
+} i2s_channel_fmt_t;
+
+typedef enum {
+    I2S_COMM_FORMAT_I2S = 0x01,
+    I2S_COMM_FORMAT_I2S_MSB = 0x02,
+    I2S_COMM_FORMAT_I2S_LSB = 0x04,
+    I2S_COMM_FORMAT_PCM = 0x08,
+    I2S_COMM_FORMAT_PCM_SHORT = 0x10,
+    I2S_COMM_FORMAT_PCM_LONG = 0x20
+} i2s_comm_format_t;
+
+typedef enum {
+    I2S_MODE_MASTER = 1,
+    I2S_MODE_SLAVE = 2,
+    I2S_MODE_TX = 4,
+    I2S_MODE_RX = 8,
+    I2S_MODE_DAC_BUILT_IN = 16,
+    I2S_MODE_ADC_BUILT_IN = 32,
+    I2S_MODE_PDM = 64
+} i2s_mode_t;
+
+typedef struct {
+    i2s_mode_t mode;
+    int sample_rate;
+    i2s_bits_per_sample_t bits_per_sample;
+    i2s_channel_fmt_t channel_format;
+    i2s_comm_format_t communication_format;
+    int intr_alloc_flags;
+    int dma_buf_count;
+    int dma_buf_len;
+} i2s_config_t;
+
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+    int bck_io_num;
+    int ws_io_num;
+    int data_out_num;
+    int data_in_num;
+} i2s_pin_config_t;
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnihost {
+
+    // Where a port's samples come from.  Samples are [-1, 1].
+class I2sSource {
+    public:
+        virtual ~I2sSource() {}
+
+            // Fills up to `num` samples, returns how many, 0 when done.
+        virtual size_t read(float* dst, size_t num, size_t sampleRate) = 0;
+};
+
+struct I2sPort {
+    bool mInstalled = false;
+    i2s_config_t mConfig;
+    I2sSource* mSource = 0;
+    size_t mValidBits = 18;                     // Of 24/32 bit slots
+    bool mRealTime = false;
+    uint64_t mFrames = 0;                       // Read since install
+    std::chrono::steady_clock::time_point mStart;
+    std::vector< float > mScratch;
+};
+
+inline I2sPort& i2sPort(i2s_port_t port) {
+    static I2sPort ports[ I2S_NUM_MAX ];
+    return ports[ port ];
+}
+
+    // Not owned, must outlive reads.  Set before tasks start reading.
+inline void i2sSetSource(i2s_port_t port, I2sSource* source) { i2sPort(port).mSource = source; }
+inline void i2sSetRealTime(i2s_port_t port, bool realTime) { i2sPort(port).mRealTime = realTime; }
+inline void i2sSetValidBits(i2s_port_t port, size_t bits) { i2sPort(port).mValidBits = bits; }
+
+inline size_t i2sSlotsPerFrame(i2s_config_t const& config) {
+    return config.channel_format == I2S_CHANNEL_FMT_RIGHT_LEFT ? 2 : 1;
+}
+
+inline int32_t i2sQuantize(float val, size_t bits) {
+    val = std::max(-1.0f, std::min(val, 1.0f));
+    int64_t full = (int64_t(1) << (bits - 1)) - 1;
+    return int32_t(int64_t(val * full));
+}
+
+} // end namespace pnihost
+
+////////////////////////////////////////////////////////////////////
+
+inline esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t* config, int queueSize, void* queue) {
+    if(port < 0 || port >= I2S_NUM_MAX || ! config || ! (config->mode & I2S_MODE_RX) ||
+            config->sample_rate <= 0 || config->dma_buf_count <= 0 || config->dma_buf_len <= 0) {
+        return ESP_ERR_INVALID_ARG; // EARLY RETURN!!!
+    }
+    pnihost::I2sPort& state = pnihost::i2sPort(port);
+    if(state.mInstalled) {
+        return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+    }
+    state.mInstalled = true;
+    state.mConfig = *config;
+    state.mFrames = 0;
+    state.mStart = std::chrono::steady_clock::now();
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_driver_uninstall(i2s_port_t port) {
+    if(port < 0 || port >= I2S_NUM_MAX || ! pnihost::i2sPort(port).mInstalled) {
+        return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+    }
+    pnihost::i2sPort(port).mInstalled = false;
+    return ESP_OK;
+}
+
+inline esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t* pins) {
+    return port >= 0 && port < I2S_NUM_MAX && pnihost::i2sPort(port).mInstalled ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+inline esp_err_t i2s_start(i2s_port_t port) { return i2s_set_pin(port, 0); }
+inline esp_err_t i2s_stop(i2s_port_t port) { return i2s_set_pin(port, 0); }
+
+    // Whole frames only, like DMA.  Returns bytes read, or -1 (ESP_FAIL)
+    // if the port isn't installed.
+inline int i2s_read_bytes(i2s_port_t port, char* dest, size_t size, TickType_t ticksToWait) {
+    if(port < 0 || port >= I2S_NUM_MAX || ! pnihost::i2sPort(port).mInstalled) {
+        return ESP_FAIL; // EARLY RETURN!!!
+    }
+    pnihost::I2sPort& state = pnihost::i2sPort(port);
+    i2s_config_t const& config = state.mConfig;
+    size_t slotBytes = config.bits_per_sample <= 8 ? 1 : (config.bits_per_sample <= 16 ? 2 : 4);
+    size_t slots = pnihost::i2sSlotsPerFrame(config);
+    size_t frames = size / (slotBytes * slots);
+
+    state.mScratch.resize(frames);
+    size_t got = state.mSource ? state.mSource->read(state.mScratch.data(), frames, config.sample_rate) : 0;
+
+    for(size_t frame = 0; frame < got; ++frame) {
+        float val = state.mScratch[ frame ];
+        for(size_t slot = 0; slot < slots; ++slot) {
+            char* dst = dest + (frame * slots + slot) * slotBytes;
+            if(slot) {
+                memset(dst, 0, slotBytes);
+            } else if(slotBytes == 1) {
+                int8_t out = int8_t(pnihost::i2sQuantize(val, 8));
+                memcpy(dst, &out, 1);
+            } else if(slotBytes == 2) {
+                int16_t out = int16_t(pnihost::i2sQuantize(val, 16));
+                memcpy(dst, &out, 2);
+            } else {
+                uint32_t out = uint32_t(pnihost::i2sQuantize(val, state.mValidBits)) << (32 - state.mValidBits);
+                memcpy(dst, &out, 4);
+            }
+        }
+    }
+
+    state.mFrames += got;
+    if(state.mRealTime && got) {
+        std::this_thread::sleep_until(state.mStart + std::chrono::microseconds(state.mFrames * 1000000 / config.sample_rate));
+    }
+    return int(got * slots * slotBytes);
+}
+
+inline esp_err_t i2s_read(i2s_port_t port, void* dest, size_t size, size_t* bytesRead, TickType_t ticksToWait) {
+    int ret = i2s_read_bytes(port, static_cast< char* >(dest), size, ticksToWait);
+    if(bytesRead) {
+        *bytesRead = ret < 0 ? 0 : size_t(ret);
+    }
+    return ret < 0 ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+#endif // pnihost_driver_i2s_h
@@ -0,0 +1,21 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for esp_err.h, just the codes the pni components and
+//  the other stand-ins use.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_esp_err_h
+#define pnihost_esp_err_h
+
+#include <cstdint>
+
+typedef int32_t esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+
+#endif // pnihost_esp_err_h
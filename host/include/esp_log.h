@@ -0,0 +1,20 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for the esp-idf logging macros, so components can be
+//  built and tested on Linux/macOS.  Errors and warnings go to stderr,
+//  info to stdout, debug and verbose are compiled out.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_esp_log_h
+#define pnihost_esp_log_h
+
+#include <cstdio>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) fprintf(stdout, "I (%s) " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do {} while(0)
+#define ESP_LOGV(tag, format, ...) do {} while(0)
+
+#endif // pnihost_esp_log_h
@@ -0,0 +1,154 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for the ESP-IDF high resolution timer, on
+//  std::chrono::steady_clock.
+//
+//  esp_timer_get_time is microseconds since first use.  Each timer gets
+//  its own thread that runs the callback, where ESP-IDF runs them all
+//  on one esp_timer task, so callbacks should stay short either way.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_esp_timer_h
+#define pnihost_esp_timer_h
+
+#include <cstdint>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "esp_err.h"
+
+////////////////////////////////////////////////////////////////////
+
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnihost {
+
+struct Timer {
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::thread mThread;
+    esp_timer_cb_t mCallback = nullptr;
+    void* mArg = nullptr;
+    bool mArmed = false;
+    bool mQuit = false;
+    Clock::time_point mDeadline;
+    Clock::duration mPeriod = Clock::duration::zero();     // 0 for one shot
+
+    void run() {
+        std::unique_lock< std::mutex > lock(mMutex);
+        while( ! mQuit) {
+            if( ! mArmed) {
+                mCond.wait(lock);
+                continue;
+            }
+            if(mCond.wait_until(lock, mDeadline) == std::cv_status::no_timeout) {
+                continue;   // Re-armed, stopped or quitting, check again
+            }
+            if( ! mArmed || Clock::now() < mDeadline) {
+                continue;
+            }
+            if(mPeriod == Clock::duration::zero()) {
+                mArmed = false;
+            } else {
+                mDeadline += mPeriod;
+            }
+            lock.unlock();
+            mCallback(mArg);
+            lock.lock();
+        }
+    }
+};
+
+} // end namespace pnihost
+
+typedef pnihost::Timer* esp_timer_handle_t;
+
+////////////////////////////////////////////////////////////////////
+
+inline int64_t esp_timer_get_time() {
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - start).count();
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+    if( ! args || ! args->callback || ! handle) {
+        return ESP_ERR_INVALID_ARG; // EARLY RETURN!!!
+    }
+    auto timer = new pnihost::Timer();
+    timer->mCallback = args->callback;
+    timer->mArg = args->arg;
+    timer->mThread = std::thread([timer]() { timer->run(); });
+    *handle = timer;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+    std::lock_guard< std::mutex > lock(timer->mMutex);
+    if(timer->mArmed) {
+        return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+    }
+    timer->mArmed = true;
+    timer->mPeriod = pnihost::Timer::Clock::duration::zero();
+    timer->mDeadline = pnihost::Timer::Clock::now() + std::chrono::microseconds(timeoutUs);
+    timer->mCond.notify_one();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+    std::lock_guard< std::mutex > lock(timer->mMutex);
+    if(timer->mArmed) {
+        return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+    }
+    timer->mArmed = true;
+    timer->mPeriod = std::chrono::microseconds(periodUs);
+    timer->mDeadline = pnihost::Timer::Clock::now() + timer->mPeriod;
+    timer->mCond.notify_one();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    std::lock_guard< std::mutex > lock(timer->mMutex);
+    if( ! timer->mArmed) {
+        return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+    }
+    timer->mArmed = false;
+    timer->mCond.notify_one();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    {
+        std::lock_guard< std::mutex > lock(timer->mMutex);
+        if(timer->mArmed) {
+            return ESP_ERR_INVALID_STATE; // EARLY RETURN!!!
+        }
+        timer->mQuit = true;
+        timer->mCond.notify_one();
+    }
+    timer->mThread.join();
+    delete timer;
+    return ESP_OK;
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // pnihost_esp_timer_h
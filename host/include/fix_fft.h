@@ -0,0 +1,18 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for the 3p/fix_fft submodule's header, just the
+//  declaration, so pnifft.h compiles on hosts without the submodule
+//  checked out.  Anything that calls FftFix::doFft still has to link
+//  the real fix_fft.cpp (and put 3p/fix_fft ahead of this on the
+//  include path).
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_fix_fft_h
+#define pnihost_fix_fft_h
+
+#include <cstdint>
+
+int fix_fft(int16_t fr[], int16_t fi[], int16_t m, int16_t inverse);
+
+#endif // pnihost_fix_fft_h
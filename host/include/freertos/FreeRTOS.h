@@ -0,0 +1,493 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for the ESP-IDF FreeRTOS headers, on std::thread.
+//
+//  Covers what the pni components use: tasks (detached threads), task
+//  notifications, queues, semaphores/mutexes and critical sections.
+//  Scheduling is up to the host OS, so priorities and core affinity
+//  are recorded but don't affect anything, and the *FromISR calls are
+//  plain calls from whatever thread makes them.  Run time stats are the
+//  thread's CPU time in microseconds.
+//
+//  Known differences:
+//  * vTaskDelete only works on the calling task (it unwinds the
+//    thread).  Host threads can't be killed from outside, so deleting
+//    another task is a no-op.
+//  * Task control blocks are never freed, since handles can outlive
+//    the threads.  Fine for tests and benchmarks.
+//  * Stacks are the host thread's own, a static stack buffer is only
+//    checked for, and the stack high-water mark is always the full
+//    requested size.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_freertos_h
+#define pnihost_freertos_h
+
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include <pthread.h>
+#include <time.h>
+
+////////////////////////////////////////////////////////////////////
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+typedef uint8_t StackType_t;            // ESP-IDF stack depths are in bytes
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define errQUEUE_FULL 0
+
+#define portMAX_DELAY TickType_t(0xffffffff)
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) TickType_t(uint64_t(ms) * configTICK_RATE_HZ / 1000)
+#define portYIELD_FROM_ISR(...)
+#define portNUM_PROCESSORS 2
+
+#define tskIDLE_PRIORITY 0
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7fffffff
+
+    // Like ESP-IDF's FreeRTOSConfig.h, from the sdkconfig option, which
+    // the project leaves off; host builds can pass
+    // -DCONFIG_SUPPORT_STATIC_ALLOCATION=1 to turn it on.
+#if CONFIG_SUPPORT_STATIC_ALLOCATION
+#define configSUPPORT_STATIC_ALLOCATION 1
+#else
+#define configSUPPORT_STATIC_ALLOCATION 0
+#endif
+#define configUSE_TRACE_FACILITY 1
+#define configGENERATE_RUN_TIME_STATS 1
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnihost {
+
+template< class Pred >
+inline bool waitTicks(std::unique_lock< std::mutex >& lock, std::condition_variable& cond, TickType_t ticks, Pred pred) {
+    if(ticks == portMAX_DELAY) {
+        cond.wait(lock, pred);
+        return true;
+    }
+    return cond.wait_for(lock, std::chrono::milliseconds(uint64_t(ticks) * portTICK_PERIOD_MS), pred);
+}
+
+inline std::chrono::steady_clock::time_point startTime() {
+    static auto start = std::chrono::steady_clock::now();
+    return start;
+}
+
+    // Per thread CPU time in microseconds.
+inline uint32_t threadCpuMicros(pthread_t thread) {
+    clockid_t clock;
+    timespec time;
+    if(pthread_getcpuclockid(thread, &clock) || clock_gettime(clock, &time)) {
+        return 0; // EARLY RETURN!!!
+    }
+    return uint32_t(uint64_t(time.tv_sec) * 1000000 + time.tv_nsec / 1000);
+}
+
+struct Task {
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    uint32_t mNotify = 0;
+
+    const char* mName = "";
+    uint32_t mStackDepth = 0;
+    std::atomic< UBaseType_t > mPriority = { 0 };
+    BaseType_t mCore = tskNO_AFFINITY;
+    pthread_t mThread;
+    std::atomic< bool > mStarted = { false };
+    std::atomic< bool > mExited = { false };
+    std::atomic< uint32_t > mRunTime = { 0 };   // Final CPU time, once exited
+};
+
+    // Thrown by vTaskDelete to unwind the calling task's thread.
+struct TaskExit {};
+
+    // Not the real thing, just room for a pointer so code can declare them.
+struct StaticTask {
+    void* mReserved;
+};
+
+inline Task*& currentTask() {
+    static thread_local Task* task = nullptr;
+    return task;
+}
+
+struct Queue {
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    std::vector< uint8_t > mData;
+    size_t mItemSize = 0;
+    size_t mLen = 0;
+    size_t mHead = 0;
+    size_t mCount = 0;
+};
+
+struct Semaphore {
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    UBaseType_t mCount = 0;
+    UBaseType_t mMax = 1;
+    bool mIsMutex = false;
+    std::thread::id mOwner;
+    UBaseType_t mDepth = 0;
+};
+
+} // end namespace pnihost
+
+typedef pnihost::Task* TaskHandle_t;
+typedef pnihost::Queue* QueueHandle_t;
+typedef pnihost::Semaphore* SemaphoreHandle_t;
+typedef pnihost::StaticTask StaticTask_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char* pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint32_t ulRunTimeCounter;
+    StackType_t* pxStackBase;
+    uint32_t usStackHighWaterMark;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+////////////////////////////////////////////////////////////////////
+// Critical sections, recursive like the ESP32 portMUX.
+
+struct portMUX_TYPE {
+    std::recursive_mutex mMutex;
+};
+
+#define portMUX_INITIALIZER_UNLOCKED {}
+#define portENTER_CRITICAL(mux) (mux)->mMutex.lock()
+#define portEXIT_CRITICAL(mux) (mux)->mMutex.unlock()
+#define portENTER_CRITICAL_ISR(mux) (mux)->mMutex.lock()
+#define portEXIT_CRITICAL_ISR(mux) (mux)->mMutex.unlock()
+
+////////////////////////////////////////////////////////////////////
+// Tasks
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    auto& task = pnihost::currentTask();
+    if( ! task) {
+            // e.g., main(), so it can be notified too.
+        task = new pnihost::Task();
+        task->mName = "main";
+        task->mThread = pthread_self();
+        task->mStarted = true;
+    }
+    return task;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t func, const char* name, uint32_t stackDepth,
+        void* param, UBaseType_t priority, TaskHandle_t* handle, BaseType_t coreId) {
+    if(priority >= configMAX_PRIORITIES || (coreId != tskNO_AFFINITY && (coreId < 0 || coreId >= portNUM_PROCESSORS))) {
+        return pdFAIL; // EARLY RETURN!!!
+    }
+    auto task = new pnihost::Task();
+    task->mName = name;
+    task->mStackDepth = stackDepth;
+    task->mPriority = priority;
+    task->mCore = coreId;
+    if(handle) {
+        *handle = task;
+    }
+    std::thread([func, param, task]() {
+        pnihost::currentTask() = task;
+        task->mThread = pthread_self();
+        task->mStarted = true;
+        try {
+            func(param);
+        } catch(pnihost::TaskExit const&) {
+        }
+        task->mRunTime = pnihost::threadCpuMicros(pthread_self());
+        task->mExited = true;
+    }).detach();
+    return pdPASS;
+}
+
+    // Only declared with static allocation, as in ESP-IDF.
+#if configSUPPORT_STATIC_ALLOCATION
+inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t func, const char* name, uint32_t stackDepth,
+        void* param, UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb, BaseType_t coreId) {
+    if( ! stack || ! tcb) {
+        return 0; // EARLY RETURN!!!
+    }
+    TaskHandle_t handle = 0;
+    xTaskCreatePinnedToCore(func, name, stackDepth, param, priority, &handle, coreId);
+    return handle;
+}
+
+inline TaskHandle_t xTaskCreateStatic(TaskFunction_t func, const char* name, uint32_t stackDepth,
+        void* param, UBaseType_t priority, StackType_t* stack, StaticTask_t* tcb) {
+    return xTaskCreateStaticPinnedToCore(func, name, stackDepth, param, priority, stack, tcb, tskNO_AFFINITY);
+}
+#endif
+
+inline BaseType_t xTaskCreate(TaskFunction_t func, const char* name, uint32_t stackDepth,
+        void* param, UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(func, name, stackDepth, param, priority, handle, tskNO_AFFINITY);
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+    if( ! task || task == pnihost::currentTask()) {
+        throw pnihost::TaskExit();
+    }
+}
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(uint64_t(ticks) * portTICK_PERIOD_MS));
+}
+
+#define taskYIELD() std::this_thread::yield()
+
+inline TickType_t xTaskGetTickCount() {
+    auto elapsed = std::chrono::steady_clock::now() - pnihost::startTime();
+    return TickType_t(std::chrono::duration_cast< std::chrono::milliseconds >(elapsed).count() / portTICK_PERIOD_MS);
+}
+
+inline UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+    return (task ? task : xTaskGetCurrentTaskHandle())->mPriority;
+}
+
+inline void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+    (task ? task : xTaskGetCurrentTaskHandle())->mPriority = priority;
+}
+
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task ? task : xTaskGetCurrentTaskHandle())->mStackDepth;
+}
+
+    // The core a task is pinned to, else 0.
+inline BaseType_t xPortGetCoreID() {
+    auto task = pnihost::currentTask();
+    return task && task->mCore != tskNO_AFFINITY ? task->mCore : 0;
+}
+
+inline void vTaskGetInfo(TaskHandle_t task, TaskStatus_t* status, BaseType_t getFreeStackSpace, eTaskState state) {
+    task = task ? task : xTaskGetCurrentTaskHandle();
+    bool exited = task->mExited;
+    status->xHandle = task;
+    status->pcTaskName = task->mName;
+    status->xTaskNumber = 0;
+    status->eCurrentState = exited ? eDeleted : eReady;
+    status->uxCurrentPriority = task->mPriority;
+    status->uxBasePriority = task->mPriority;
+    if(exited) {
+        status->ulRunTimeCounter = task->mRunTime;
+    } else {
+        status->ulRunTimeCounter = task->mStarted ? pnihost::threadCpuMicros(task->mThread) : 0;
+    }
+    status->pxStackBase = 0;
+    status->usStackHighWaterMark = getFreeStackSpace ? task->mStackDepth : 0;
+    status->xCoreID = task->mCore;
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard< std::mutex > lock(task->mMutex);
+    ++task->mNotify;
+    task->mCond.notify_one();
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotifyGive(task);
+    if(woken) {
+        *woken = pdTRUE;
+    }
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+    auto task = xTaskGetCurrentTaskHandle();
+    std::unique_lock< std::mutex > lock(task->mMutex);
+    pnihost::waitTicks(lock, task->mCond, wait, [task]() { return task->mNotify > 0; });
+    uint32_t val = task->mNotify;
+    if(val) {
+        task->mNotify = clearOnExit ? 0 : val - 1;
+    }
+    return val;
+}
+
+////////////////////////////////////////////////////////////////////
+// Queues, items are copied in and out like the real thing.
+
+inline QueueHandle_t xQueueCreate(UBaseType_t len, UBaseType_t itemSize) {
+    auto queue = new pnihost::Queue();
+    queue->mData.resize(len * itemSize);
+    queue->mItemSize = itemSize;
+    queue->mLen = len;
+    return queue;
+}
+
+inline void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) {
+    std::unique_lock< std::mutex > lock(queue->mMutex);
+    if( ! pnihost::waitTicks(lock, queue->mCond, wait, [queue]() { return queue->mCount < queue->mLen; })) {
+        return errQUEUE_FULL;
+    }
+    size_t pos = (queue->mHead + queue->mCount) % queue->mLen;
+    memcpy(queue->mData.data() + pos * queue->mItemSize, item, queue->mItemSize);
+    ++queue->mCount;
+    queue->mCond.notify_all();
+    return pdPASS;
+}
+
+#define xQueueSendToBack xQueueSend
+
+inline BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) {
+    BaseType_t ret = xQueueSend(queue, item, 0);
+    if(woken) {
+        *woken = ret;
+    }
+    return ret;
+}
+
+    // Only meant for length 1 queues.
+inline BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    std::lock_guard< std::mutex > lock(queue->mMutex);
+    memcpy(queue->mData.data() + queue->mHead * queue->mItemSize, item, queue->mItemSize);
+    queue->mCount = 1;
+    queue->mCond.notify_all();
+    return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) {
+    std::unique_lock< std::mutex > lock(queue->mMutex);
+    if( ! pnihost::waitTicks(lock, queue->mCond, wait, [queue]() { return queue->mCount > 0; })) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->mData.data() + queue->mHead * queue->mItemSize, queue->mItemSize);
+    queue->mHead = (queue->mHead + 1) % queue->mLen;
+    --queue->mCount;
+    queue->mCond.notify_all();
+    return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard< std::mutex > lock(queue->mMutex);
+    return queue->mCount;
+}
+
+inline void vQueueAddToRegistry(QueueHandle_t queue, const char* name) {}
+inline void vQueueUnregisterQueue(QueueHandle_t queue) {}
+
+////////////////////////////////////////////////////////////////////
+// Semaphores and mutexes
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    auto sema = new pnihost::Semaphore();
+    sema->mMax = maxCount;
+    sema->mCount = initialCount;
+    return sema;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    auto sema = xSemaphoreCreateCounting(1, 1);
+    sema->mIsMutex = true;
+    return sema;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() {
+    return xSemaphoreCreateMutex();
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t sema) {
+    delete sema;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sema, TickType_t wait) {
+    std::unique_lock< std::mutex > lock(sema->mMutex);
+    if( ! pnihost::waitTicks(lock, sema->mCond, wait, [sema]() { return sema->mCount > 0; })) {
+        return pdFALSE;
+    }
+    --sema->mCount;
+    if(sema->mIsMutex) {
+        sema->mOwner = std::this_thread::get_id();
+    }
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sema) {
+    std::lock_guard< std::mutex > lock(sema->mMutex);
+    if(sema->mCount >= sema->mMax) {
+        return pdFALSE;
+    }
+    ++sema->mCount;
+    sema->mCond.notify_one();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sema, BaseType_t* woken) {
+    BaseType_t ret = xSemaphoreGive(sema);
+    if(woken) {
+        *woken = ret;
+    }
+    return ret;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sema, TickType_t wait) {
+    {
+        std::lock_guard< std::mutex > lock(sema->mMutex);
+        if(sema->mDepth && sema->mOwner == std::this_thread::get_id()) {
+            ++sema->mDepth;
+            return pdTRUE;
+        }
+    }
+    if( ! xSemaphoreTake(sema, wait)) {
+        return pdFALSE;
+    }
+    std::lock_guard< std::mutex > lock(sema->mMutex);
+    sema->mDepth = 1;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sema) {
+    {
+        std::lock_guard< std::mutex > lock(sema->mMutex);
+        if(sema->mDepth == 0 || sema->mOwner != std::this_thread::get_id()) {
+            return pdFALSE;
+        }
+        if(--sema->mDepth) {
+            return pdTRUE;
+        }
+        sema->mOwner = std::thread::id();
+    }
+    return xSemaphoreGive(sema);
+}
+
+////////////////////////////////////////////////////////////////////
+
+#endif // pnihost_freertos_h
@@ -0,0 +1,16 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for freertos/portmacro.h.  The port types live in
+//  FreeRTOS.h, this adds the legacy names.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_freertos_portmacro_h
+#define pnihost_freertos_portmacro_h
+
+#include "freertos/FreeRTOS.h"
+
+typedef TickType_t portTickType;
+typedef BaseType_t portBASE_TYPE;
+
+#endif // pnihost_freertos_portmacro_h
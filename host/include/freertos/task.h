@@ -0,0 +1,7 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in, everything lives in FreeRTOS.h.
+//
+////////////////////////////////////////////////////////////////////
+
+#include "freertos/FreeRTOS.h"
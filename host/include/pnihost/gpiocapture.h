@@ -0,0 +1,176 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host only: captures what drivers write to the gpio stand-in.
+//
+//  GpioCapture records every level change on a set of pins, in order.
+//  SpiCapture decodes a bit-banged SPI bus (mode 0, MSB first: data is
+//  sampled on the clock's rising edge) into bytes, and decodeApa102
+//  turns those bytes back into the LED frames a strip would latch.
+//  E.g.:
+//    SpiCapture spi(GPIO_NUM_18, GPIO_NUM_23);    // clock, data
+//    apa102.writeColors(colors);
+//    std::vector< Apa102Frame > frames;
+//    decodeApa102(spi.mBytes, frames);
+//
+//  Both hook gpio_set_level for their lifetime, so create them before
+//  (and destroy them after) the tasks that drive the pins.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_gpiocapture_h
+#define pnihost_gpiocapture_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "driver/gpio.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnihost {
+
+////////////////////////////////////////////////////////////////////
+
+class GpioCapture {
+    public:
+        struct Change {
+            gpio_num_t mPin;
+            uint32_t mLevel;
+        };
+
+            // Empty `pins` captures every pin.
+        GpioCapture(std::vector< gpio_num_t > const& pins = std::vector< gpio_num_t >()) : mPins(pins) {
+            gpioAddWatcher(&GpioCapture::watch, this);
+        }
+
+        ~GpioCapture() {
+            gpioRemoveWatcher(this);
+        }
+
+        GpioCapture(GpioCapture const& rhs) = delete;
+        GpioCapture& operator = (GpioCapture const& rhs) = delete;
+
+        void clear() { mChanges.clear(); }
+
+            // Sets that didn't change the level are left out.
+        std::vector< Change > mChanges;
+
+    private:
+        static void watch(void* ctx, gpio_num_t pin, uint32_t level) {
+            GpioCapture& self = *static_cast< GpioCapture* >(ctx);
+            if( ! self.mPins.empty() && std::find(self.mPins.begin(), self.mPins.end(), pin) == self.mPins.end()) {
+                return; // EARLY RETURN!!!
+            }
+            if(self.mLast[ pin ] != level) {
+                self.mLast[ pin ] = level;
+                self.mChanges.push_back(Change{ pin, level });
+            }
+        }
+
+        std::vector< gpio_num_t > mPins;
+        uint32_t mLast[ GPIO_NUM_MAX ] = {};
+};
+
+////////////////////////////////////////////////////////////////////
+
+class SpiCapture {
+    public:
+        SpiCapture(gpio_num_t clock, gpio_num_t data) : mClock(clock), mData(data) {
+            gpioAddWatcher(&SpiCapture::watch, this);
+        }
+
+        ~SpiCapture() {
+            gpioRemoveWatcher(this);
+        }
+
+        SpiCapture(SpiCapture const& rhs) = delete;
+        SpiCapture& operator = (SpiCapture const& rhs) = delete;
+
+            // Drops bytes and any partial byte.
+        void clear() {
+            mBytes.clear();
+            mBits = 0;
+            mNumBits = 0;
+        }
+
+        std::vector< uint8_t > mBytes;
+        size_t mClocks = 0;
+
+    private:
+        static void watch(void* ctx, gpio_num_t pin, uint32_t level) {
+            SpiCapture& self = *static_cast< SpiCapture* >(ctx);
+            if(pin != self.mClock) {
+                return; // EARLY RETURN!!!
+            }
+            bool rising = level && ! self.mClockLevel;
+            self.mClockLevel = level;
+            if( ! rising) {
+                return; // EARLY RETURN!!!
+            }
+            ++self.mClocks;
+            self.mBits = uint8_t((self.mBits << 1) | gpio_get_level(self.mData));
+            if(++self.mNumBits == 8) {
+                self.mBytes.push_back(self.mBits);
+                self.mNumBits = 0;
+            }
+        }
+
+        gpio_num_t mClock;
+        gpio_num_t mData;
+        uint32_t mClockLevel = 0;
+        uint8_t mBits = 0;
+        size_t mNumBits = 0;
+};
+
+////////////////////////////////////////////////////////////////////
+
+struct Apa102Led {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t v;      // 5 bit brightness
+};
+
+typedef std::vector< Apa102Led > Apa102Frame;
+
+    // Each frame starts with 32 zero bits, then one 0b111vvvvv, b, g, r
+    // quad per LED; anything else (the end frame) ends it.  Returns the
+    // number of bytes used, so a caller can keep any partial frame.
+inline size_t decodeApa102(std::vector< uint8_t > const& bytes, std::vector< Apa102Frame >& frames) {
+    size_t pos = 0;
+    size_t used = 0;
+    size_t end = bytes.size();
+    while(pos < end) {
+        if(bytes[ pos ]) {
+            used = ++pos;       // Can't be a start frame
+            continue;
+        }
+        if(pos + 4 > end) {
+            break;              // Might be one
+        }
+        if(bytes[ pos + 1 ] || bytes[ pos + 2 ] || bytes[ pos + 3 ]) {
+            used = ++pos;
+            continue;
+        }
+        pos += 4;
+        Apa102Frame frame;
+        while(pos + 4 <= end && (bytes[ pos ] & 0xe0) == 0xe0) {
+            frame.push_back(Apa102Led{ bytes[ pos + 3 ], bytes[ pos + 2 ], bytes[ pos + 1 ], uint8_t(bytes[ pos ] & 0x1f) });
+            pos += 4;
+        }
+        if(pos + 4 > end) {
+            break;      // Might not be finished yet
+        }
+        frames.push_back(frame);
+        used = pos;
+    }
+    return used;
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pnihost
+
+#endif // pnihost_gpiocapture_h
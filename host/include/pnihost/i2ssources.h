@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host only: sample sources for the driver/i2s.h stand-in.
+//
+//  I2sGenerator: sum of sine tones plus white noise, optionally for a
+//  fixed number of samples.  Seeded, so every run is the same.
+//  I2sWavFile: plays a PCM (8/16/24/32 bit int or 32 bit float) WAV
+//  file, first channel only, at whatever rate the port runs.
+//  E.g.:
+//    I2sWavFile wav("clip.wav");
+//    pnihost::i2sSetSource(I2S_NUM_0, &wav);
+//    mic.init(config);
+//
+//  writeWav saves 16 bit mono, for making test clips.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_i2ssources_h
+#define pnihost_i2ssources_h
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "driver/i2s.h"
+
+////////////////////////////////////////////////////////////////////
+
+namespace pnihost {
+
+////////////////////////////////////////////////////////////////////
+
+class I2sGenerator : public I2sSource {
+    public:
+        struct Tone {
+            float mFreq;        // Hz
+            float mAmp;         // Of full scale
+        };
+
+        std::vector< Tone > mTones;
+        float mNoise = 0.0f;        // Of full scale
+        size_t mLength = 0;         // Samples, 0 for endless
+
+        I2sGenerator() {}
+        I2sGenerator(std::vector< Tone > const& tones, float noise = 0.0f, size_t length = 0) :
+            mTones(tones), mNoise(noise), mLength(length) {}
+
+        size_t getPos() const { return mPos; }
+
+        virtual size_t read(float* dst, size_t num, size_t sampleRate) {
+            if(mLength) {
+                num = mPos >= mLength ? 0 : std::min(num, mLength - mPos);
+            }
+            const double TwoPi = 8.0 * atan(1.0);
+            for(size_t ind = 0; ind < num; ++ind) {
+                double time = double(mPos + ind) / sampleRate;
+                double val = 0.0;
+                for(auto const& tone : mTones) {
+                    val += tone.mAmp * sin(TwoPi * tone.mFreq * time);
+                }
+                mSeed = mSeed * 1664525 + 1013904223;
+                val += mNoise * ((mSeed >> 8) * (2.0 / (1 << 24)) - 1.0);
+                dst[ ind ] = float(val);
+            }
+            mPos += num;
+            return num;
+        }
+
+    private:
+        size_t mPos = 0;
+        uint32_t mSeed = 12345;
+};
+
+////////////////////////////////////////////////////////////////////
+
+class I2sWavFile : public I2sSource {
+    public:
+        I2sWavFile(std::string const& path, bool loop = false) : mLoop(loop) {
+            mOpen = load(path);
+        }
+
+        bool isOpen() const { return mOpen; }
+        size_t getSampleRate() const { return mSampleRate; }
+        std::vector< float > const& getSamples() const { return mSamples; }
+
+        virtual size_t read(float* dst, size_t num, size_t sampleRate) {
+            size_t got = 0;
+            while(got < num && ! mSamples.empty()) {
+                if(mPos == mSamples.size()) {
+                    if( ! mLoop) {
+                        break;
+                    }
+                    mPos = 0;
+                }
+                size_t run = std::min(num - got, mSamples.size() - mPos);
+                memcpy(dst + got, &mSamples[ mPos ], run * sizeof(float));
+                got += run;
+                mPos += run;
+            }
+            return got;
+        }
+
+    private:
+        static uint32_t get32(uint8_t const* ptr) { return ptr[ 0 ] | ptr[ 1 ] << 8 | ptr[ 2 ] << 16 | uint32_t(ptr[ 3 ]) << 24; }
+        static uint16_t get16(uint8_t const* ptr) { return uint16_t(ptr[ 0 ] | ptr[ 1 ] << 8); }
+
+        bool load(std::string const& path) {
+            FILE* file = fopen(path.c_str(), "rb");
+            if( ! file) {
+                fprintf(stderr, "E (i2s) can't open %s\n", path.c_str());
+                return false; // EARLY RETURN!!!
+            }
+            std::vector< uint8_t > data;
+            uint8_t buf[ 4096 ];
+            size_t num;
+            while((num = fread(buf, 1, sizeof(buf), file)) > 0) {
+                data.insert(data.end(), buf, buf + num);
+            }
+            fclose(file);
+
+            if(data.size() < 12 || memcmp(&data[ 0 ], "RIFF", 4) || memcmp(&data[ 8 ], "WAVE", 4)) {
+                fprintf(stderr, "E (i2s) %s isn't a WAV file\n", path.c_str());
+                return false; // EARLY RETURN!!!
+            }
+
+            uint16_t format = 0;
+            uint16_t channels = 0;
+            uint16_t bits = 0;
+            for(size_t pos = 12; pos + 8 <= data.size(); ) {
+                uint8_t const* chunk = &data[ pos ];
+                size_t size = std::min< size_t >(get32(chunk + 4), data.size() - pos - 8);
+                if( ! memcmp(chunk, "fmt ", 4) && size >= 16) {
+                    format = get16(chunk + 8);
+                    channels = get16(chunk + 10);
+                    mSampleRate = get32(chunk + 12);
+                    bits = get16(chunk + 22);
+                    if(format == 0xfffe && size >= 26) {     // WAVE_FORMAT_EXTENSIBLE, sub format follows
+                        format = get16(chunk + 32);
+                    }
+                } else if( ! memcmp(chunk, "data", 4) && channels) {
+                    return decode(chunk + 8, size, format, channels, bits, path); // EARLY RETURN!!!
+                }
+                pos += 8 + size + (size & 1);
+            }
+            fprintf(stderr, "E (i2s) %s has no fmt/data chunks\n", path.c_str());
+            return false;
+        }
+
+        bool decode(uint8_t const* data, size_t size, uint16_t format, uint16_t channels, uint16_t bits, std::string const& path) {
+            bool isInt = format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+            bool isFloat = format == 3 && bits == 32;
+            if( ! isInt && ! isFloat) {
+                fprintf(stderr, "E (i2s) %s: unsupported format %u, %u bits\n", path.c_str(), format, bits);
+                return false; // EARLY RETURN!!!
+            }
+            size_t bytes = bits / 8;
+            size_t frames = size / (bytes * channels);
+            mSamples.resize(frames);
+            for(size_t frame = 0; frame < frames; ++frame) {
+                uint8_t const* ptr = data + frame * bytes * channels;
+                float val;
+                if(isFloat) {
+                    uint32_t raw = get32(ptr);
+                    memcpy(&val, &raw, sizeof(val));
+                } else if(bits == 8) {
+                    val = (int(ptr[ 0 ]) - 128) / 128.0f;       // 8 bit WAV is unsigned
+                } else {
+                    int32_t raw = 0;
+                    for(size_t ind = 0; ind < bytes; ++ind) {
+                        raw |= int32_t(uint32_t(ptr[ ind ]) << (32 - bits + ind * 8));
+                    }
+                    val = raw / 2147483648.0f;
+                }
+                mSamples[ frame ] = val;
+            }
+            return true;
+        }
+
+        std::vector< float > mSamples;
+        size_t mSampleRate = 0;
+        size_t mPos = 0;
+        bool mLoop;
+        bool mOpen;
+};
+
+////////////////////////////////////////////////////////////////////
+
+inline bool writeWav(std::string const& path, std::vector< float > const& samples, size_t sampleRate) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if( ! file) {
+        return false; // EARLY RETURN!!!
+    }
+    auto put32 = [&](uint32_t val) { uint8_t buf[ 4 ] = { uint8_t(val), uint8_t(val >> 8), uint8_t(val >> 16), uint8_t(val >> 24) }; fwrite(buf, 1, 4, file); };
+    auto put16 = [&](uint16_t val) { uint8_t buf[ 2 ] = { uint8_t(val), uint8_t(val >> 8) }; fwrite(buf, 1, 2, file); };
+
+    uint32_t dataSize = uint32_t(samples.size() * 2);
+    fwrite("RIFF", 1, 4, file);
+    put32(36 + dataSize);
+    fwrite("WAVEfmt ", 1, 8, file);
+    put32(16);
+    put16(1);                       // PCM
+    put16(1);                       // Mono
+    put32(uint32_t(sampleRate));
+    put32(uint32_t(sampleRate * 2));
+    put16(2);                       // Block align
+    put16(16);
+    fwrite("data", 1, 4, file);
+    put32(dataSize);
+    for(float val : samples) {
+        put16(uint16_t(int16_t(i2sQuantize(val, 16))));
+    }
+    return fclose(file) == 0;
+}
+
+////////////////////////////////////////////////////////////////////
+
+} // end namespace pnihost
+
+#endif // pnihost_i2ssources_h
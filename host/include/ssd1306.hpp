@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////
+//
+//  Host stand-in for the OLED class from 3p/esp32-i2c-ssd1306-oled.
+//
+//  Same drawing API and the same behavior where it matters for
+//  performance work: a page-major 1-bpp buffer, per-pixel drawing
+//  primitives, and a dirty bounding box so refresh(false) only sends
+//  the touched pages/columns.  Instead of I2C it counts what would be
+//  sent, so renderers can be compared on host.
+//
+//  The counters and getBuffer() are host-only additions.
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef pnihost_ssd1306_hpp
+#define pnihost_ssd1306_hpp
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include "driver/gpio.h"
+
+////////////////////////////////////////////////////////////////////
+
+typedef enum {
+    SSD1306_128x64 = 1,
+    SSD1306_128x32 = 2
+} ssd1306_panel_type_t;
+
+typedef enum {
+    TRANSPARENT = -1,
+    BLACK = 0,
+    WHITE = 1,
+    INVERT = 2
+} ssd1306_color_t;
+
+class OLED {
+    public:
+        OLED(gpio_num_t scl, gpio_num_t sda, ssd1306_panel_type_t type, uint8_t address = 0x78) :
+            mType(type),
+            mWidth(128),
+            mHeight(type == SSD1306_128x64 ? 64 : 32) {
+            clear();
+        }
+
+        bool init() { return true; }
+        void term() {}
+
+        uint8_t get_width() const { return mWidth; }
+        uint8_t get_height() const { return mHeight; }
+
+        void clear() {
+            memset(mBuffer, 0, sizeof(mBuffer));
+            markAll();
+        }
+
+            // Sends the dirty box (or everything), then resets it.
+        void refresh(bool force) {
+            if(force) {
+                markAll();
+            }
+            if(mTop <= mBottom && mLeft <= mRight) {
+                ++mRefreshes;
+                    // Column and page address commands.
+                mBusBytes += Transaction + 6;
+                size_t cols = mRight - mLeft + 1;
+                size_t pages = mBottom / 8 - mTop / 8 + 1;
+                    // Data goes out in 16 byte transactions.
+                mBusBytes += pages * (cols + ((cols + 15) / 16) * Transaction);
+            }
+            mTop = 255; mBottom = 0; mLeft = 255; mRight = 0;
+        }
+
+        void draw_pixel(int8_t x, int8_t y, ssd1306_color_t color) {
+            if(x < 0 || x >= mWidth || y < 0 || y >= mHeight) {
+                return;
+            }
+            uint8_t& byte = mBuffer[ x + (y / 8) * mWidth ];
+            uint8_t bit = 1 << (y & 7);
+            switch(color) {
+                case WHITE: byte |= bit; break;
+                case BLACK: byte &= ~bit; break;
+                case INVERT: byte ^= bit; break;
+                default: return;
+            }
+            ++mPixelWrites;
+            mark(x, y);
+        }
+
+        void draw_hline(int8_t x, int8_t y, uint8_t w, ssd1306_color_t color) {
+            for(int num = x; num < x + w; ++num) {
+                draw_pixel(num, y, color);
+            }
+        }
+
+        void draw_vline(int8_t x, int8_t y, uint8_t h, ssd1306_color_t color) {
+            for(int num = y; num < y + h; ++num) {
+                draw_pixel(x, num, color);
+            }
+        }
+
+        void draw_rectangle(int8_t x, int8_t y, uint8_t w, uint8_t h, ssd1306_color_t color) {
+            draw_hline(x, y, w, color);
+            draw_hline(x, y + h - 1, w, color);
+            draw_vline(x, y, h, color);
+            draw_vline(x + w - 1, y, h, color);
+        }
+
+        void fill_rectangle(int8_t x, int8_t y, uint8_t w, uint8_t h, ssd1306_color_t color) {
+            for(int num = x; num < x + w; ++num) {
+                draw_vline(num, y, h, color);
+            }
+        }
+
+            // Replaces the whole buffer, everything becomes dirty.
+        void update_buffer(uint8_t* data, uint16_t length) {
+            memcpy(mBuffer, data, length < sizeof(mBuffer) ? length : sizeof(mBuffer));
+            markAll();
+        }
+
+        void invert_display(bool invert) { mBusBytes += Transaction + 1; }
+
+            // Host only
+        uint8_t const* getBuffer() const { return mBuffer; }
+        size_t getBufferSize() const { return mWidth * mHeight / 8; }
+        bool getPixel(int x, int y) const { return mBuffer[ x + (y / 8) * mWidth ] & (1 << (y & 7)); }
+        void resetCounters() { mPixelWrites = 0; mBusBytes = 0; mRefreshes = 0; }
+
+        size_t mPixelWrites = 0;        // draw_pixel calls that touched the buffer
+        size_t mBusBytes = 0;           // bytes that would go over I2C, including addressing
+        size_t mRefreshes = 0;          // refresh calls that sent anything
+
+    private:
+        static const size_t Transaction = 2;     // I2C address + control byte
+
+        void mark(uint8_t x, uint8_t y) {
+            if(x < mLeft) mLeft = x;
+            if(x > mRight) mRight = x;
+            if(y < mTop) mTop = y;
+            if(y > mBottom) mBottom = y;
+        }
+
+        void markAll() {
+            mTop = 0; mBottom = mHeight - 1; mLeft = 0; mRight = mWidth - 1;
+        }
+
+        ssd1306_panel_type_t mType;
+        uint8_t mWidth;
+        uint8_t mHeight;
+        uint8_t mBuffer[ 128 * 64 / 8 ];
+        uint8_t mTop = 255;
+        uint8_t mBottom = 0;
+        uint8_t mLeft = 255;
+        uint8_t mRight = 0;
+};
+
+#endif // pnihost_ssd1306_hpp
@@ -0,0 +1,329 @@
+////////////////////////////////////////////////////////////////////
+//
+//  pnipipeline: the mic -> filter -> FFT -> color -> LED pipeline,
+//  end to end on a host, on the host stand-ins.
+//
+//  A mic task reads the SPH0645 (I2S from a WAV file or a tone
+//  generator) into a RingSpsc of FFT sized blocks.  The main task
+//  windows and transforms each block, smooths the spectrum, maps it to
+//  an HSV bar per LED, bit-bangs the frame out to the APA102 strip
+//  (captured and decoded off the gpio stand-in), and draws the
+//  spectrum on the OLED framebuffer.
+//
+//  Runs as fast as it can unless -r, so it can be profiled, e.g.:
+//    perf record -g ./pnipipeline -s 30 && perf report
+//  Built with PNI_TRACE_ENABLED=1, -t writes a Chrome trace.
+//
+////////////////////////////////////////////////////////////////////
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "driver/i2s.h"
+#include "pnihost/i2ssources.h"
+#include "pnihost/gpiocapture.h"
+#include "ssd1306.hpp"
+
+#include "pnimicsph0645.h"
+#include "pnifft.h"
+#include "pnifilters.h"
+#include "pnicolor.h"
+#include "pniapa102.h"
+#include "pnigraph.h"
+#include "pnigraphssd1306.h"
+#include "pniringbuffer.h"
+#include "pnitask.h"
+#include "pnitrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace pni;
+
+////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const size_t SampleRate = 22050;
+const size_t FftPow = 9;
+const size_t FftNum = 1 << FftPow;
+const size_t NumLeds = 60;
+const size_t NumBars = 32;
+const gpio_num_t LedData = GPIO_NUM_23;
+const gpio_num_t LedClock = GPIO_NUM_18;
+
+struct Block {
+    FftSDatum mSamples[ FftNum ];
+};
+
+using BlockRing = RingSpsc< Block, 16 >;
+
+    // Fills blocks straight from the mic until the source runs dry.
+class MicTask : public Task {
+    public:
+        MicTask(MicSph0645& mic, BlockRing& ring) : Task("mic"), mMic(mic), mRing(ring) {}
+
+        std::atomic< bool > mDone = { false };
+        size_t mSamples = 0;
+
+    protected:
+        virtual void taskMethod() {
+            vector< int32_t > raw;
+            size_t fill = 0;
+            BlockRing::Span span = { 0, 0 };
+            while(true) {
+                if(mMic.readSamples(raw) <= 0) {
+                    break;
+                }
+                mMic.reorderSamples(raw);
+                for(int32_t val : raw) {
+                    while( ! span.mNum) {
+                        span = mRing.reserve(1);
+                        if( ! span.mNum) {
+                            taskYIELD();        // Consumer is behind
+                        }
+                    }
+                        // 18 bits MSB aligned, << 5 by readSamples.
+                    span.mData->mSamples[ fill ] = FftSDatum(val >> 16);
+                    if(++fill == FftNum) {
+                        mRing.commit(1);
+                        span.mNum = 0;
+                        fill = 0;
+                    }
+                }
+                mSamples += raw.size();
+            }
+            mDone.store(true, std::memory_order_release);     // Consumer polls for this
+            vTaskDelete(0);
+        }
+
+    private:
+        MicSph0645& mMic;
+        BlockRing& mRing;
+};
+
+    // Log spaced FFT bins per output, so the low end isn't all in one.
+vector< size_t > makeBands(size_t num, size_t numBins) {
+    vector< size_t > edges(num + 1);
+    for(size_t ind = 0; ind <= num; ++ind) {
+        edges[ ind ] = size_t(1.0 + (numBins - 1) * (pow(2.0, 8.0 * ind / num) - 1.0) / 255.0);
+    }
+    for(size_t ind = 1; ind <= num; ++ind) {
+        edges[ ind ] = max(edges[ ind ], edges[ ind - 1 ] + 1);
+    }
+    edges[ num ] = min(edges[ num ], numBins);
+    return edges;
+}
+
+FftSDatum bandMax(FftSData const& spectrum, vector< size_t > const& edges, size_t band) {
+    FftSDatum ret = 0;
+    for(size_t bin = edges[ band ]; bin < edges[ band + 1 ] && bin < spectrum.size(); ++bin) {
+        ret = max(ret, spectrum[ bin ]);
+    }
+    return ret;
+}
+
+void writePbm(char const* path, OLED const& oled) {
+    FILE* file = fopen(path, "w");
+    if( ! file) {
+        ESP_LOGE("pipeline", "can't write %s", path);
+        return; // EARLY RETURN!!!
+    }
+    fprintf(file, "P1\n%d %d\n", oled.get_width(), oled.get_height());
+    for(int yy = 0; yy < oled.get_height(); ++yy) {
+        for(int xx = 0; xx < oled.get_width(); ++xx) {
+            fputs(oled.getPixel(xx, yy) ? "1 " : "0 ", file);
+        }
+        fputs("\n", file);
+    }
+    fclose(file);
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: pnipipeline [-w file.wav] [-s seconds] [-r] [-o oled.pbm] [-t trace.json]\n"
+            "  -w  play a WAV file, otherwise a tone generator (440 Hz + 2 kHz + noise)\n"
+            "  -s  generator length, default 10 s of audio\n"
+            "  -r  real time, pace the mic to the sample rate\n"
+            "  -o  write the last OLED frame as a PBM image\n"
+            "  -t  write a Chrome trace (needs PNI_TRACE_ENABLED=1)\n");
+}
+
+} // end anonymous namespace
+
+////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+    char const* wavPath = 0;
+    char const* pbmPath = 0;
+    char const* tracePath = 0;
+    float seconds = 10.0f;
+    bool realTime = false;
+
+    int opt;
+    while((opt = getopt(argc, argv, "w:s:ro:t:h")) != -1) {
+        switch(opt) {
+            case 'w': wavPath = optarg; break;
+            case 's': seconds = float(atof(optarg)); break;
+            case 'r': realTime = true; break;
+            case 'o': pbmPath = optarg; break;
+            case 't': tracePath = optarg; break;
+            default: usage(); return 2;
+        }
+    }
+
+        // Source
+    unique_ptr< pnihost::I2sSource > source;
+    if(wavPath) {
+        unique_ptr< pnihost::I2sWavFile > wav(new pnihost::I2sWavFile(wavPath));
+        if( ! wav->isOpen()) {
+            return 1;
+        }
+        source = std::move(wav);
+    } else {
+            // Quiet, the FFT output is int16 and unscaled.
+        source.reset(new pnihost::I2sGenerator({ { 440.0f, 0.0002f }, { 2000.0f, 0.0001f } }, 0.00002f, size_t(seconds * SampleRate)));
+    }
+    pnihost::i2sSetSource(I2S_NUM_0, source.get());
+    pnihost::i2sSetRealTime(I2S_NUM_0, realTime);
+
+        // Mic, mono 32 bit on a stereo bus, 128 frame DMA buffers.
+    MicSph0645 mic;
+    MicSph0645::Config micConfig = { 0, SampleRate, 2, 32, 4, 128, 26, 25, I2S_PIN_NO_CHANGE, 22 };
+    if( ! mic.init(micConfig)) {
+        return 1;
+    }
+
+        // LEDs, captured off the gpio pins.
+    pnihost::SpiCapture spi(LedClock, LedData);
+    Apa102Software apa;
+    apa.init({ LedData, LedClock });
+    Apa102::Colors colors;
+    colors.mColor.resize(NumLeds);
+
+        // OLED spectrum
+    OLED oled(GPIO_NUM_22, GPIO_NUM_21, SSD1306_128x64);
+    GraphT< GraphSsd1306Framebuffer > graph(&oled);
+    graph.mViewport = { 0, 0, 128, 64 };
+    graph.resize(NumBars, 0);
+    graph.mXAxis.setRange(0, 0, int(NumBars));
+    graph.mYAxis.setRange(0, 0, 0x2000);
+
+    FftPffft< FftPow > fft;
+    LowPassFilter smooth(0.5f);
+    FftSData spectrum(FftNum);
+    vector< size_t > ledBands = makeBands(NumLeds, fft.NumOut);
+    vector< size_t > barBands = makeBands(NumBars, fft.NumOut);
+
+    BlockRing ring;
+    ring.setConsumer(xTaskGetCurrentTaskHandle());
+    MicTask micTask(mic, ring);
+    micTask.setPriority(5);
+
+    size_t frames = 0;
+    size_t ledFrames = 0;
+    size_t lastLeds = 0;
+    vector< size_t > peakHist(fft.NumOut);
+    vector< pnihost::Apa102Frame > decoded;
+    auto beg = chrono::steady_clock::now();
+    double busyNs = 0.0;
+
+    micTask.start();
+    while(true) {
+        BlockRing::Span span = ring.peek(1);
+        if( ! span.mNum) {
+            if(micTask.mDone.load(std::memory_order_acquire) && ! ring.peek(1).mNum) {
+                break;
+            }
+            ring.waitForData(pdMS_TO_TICKS(100));
+            continue;
+        }
+        auto frameBeg = chrono::steady_clock::now();
+        {
+            PNI_TRACE_SCOPE("pipeline.frame");
+
+            copy(span.mData->mSamples, span.mData->mSamples + FftNum, fft.mReal.begin());
+            ring.release(1);
+
+            fft.doHanningWindow(fft.calcBias());
+            fft.doFft();
+            fft.convToReal();
+
+                // Spectrum peak, skipping DC.
+            size_t peak = 1 + size_t(max_element(fft.mReal.begin() + 1, fft.mReal.begin() + fft.NumOut) - fft.mReal.begin() - 1);
+            ++peakHist[ peak ];
+
+            smooth.apply(spectrum, fft.mReal);
+
+            {
+                PNI_TRACE_SCOPE("pipeline.color");
+                for(size_t led = 0; led < NumLeds; ++led) {
+                    float mag = min(1.0f, bandMax(spectrum, ledBands, led) / float(0x2000));
+                    ColorHsv hsv(Color::Hsv{ Color::Component(float(led) / NumLeds), Color::Component(1.0f), Color::Component(mag) });
+                    Color::Rgb rgb = hsv.toRgb();
+                    Apa102::Color& out = colors.mColor[ led ];
+                    out.r = uint8_t(min(255.0f, rgb.r.getFloat() * 255.0f));
+                    out.g = uint8_t(min(255.0f, rgb.g.getFloat() * 255.0f));
+                    out.b = uint8_t(min(255.0f, rgb.b.getFloat() * 255.0f));
+                    out.v = 0x1f;
+                }
+            }
+            apa.writeColors(colors);
+
+            for(size_t bar = 0; bar < NumBars; ++bar) {
+                graph.mYAxis.mData[ bar ] = bandMax(spectrum, barBands, bar);
+            }
+            graph.draw();
+            graph.refresh();
+        }
+        busyNs += chrono::duration< double, nano >(chrono::steady_clock::now() - frameBeg).count();
+        ++frames;
+
+            // Decode the strip as it goes, so the capture stays small.
+        decoded.clear();
+        size_t used = pnihost::decodeApa102(spi.mBytes, decoded);
+        spi.mBytes.erase(spi.mBytes.begin(), spi.mBytes.begin() + used);
+        ledFrames += decoded.size();
+        if( ! decoded.empty()) {
+            lastLeds = decoded.back().size();
+        }
+    }
+    double wallSec = chrono::duration< double >(chrono::steady_clock::now() - beg).count();
+
+    mic.uninit();
+    apa.deinit();
+
+    size_t peak = size_t(max_element(peakHist.begin(), peakHist.end()) - peakHist.begin());
+    double audioSec = double(micTask.mSamples) / SampleRate;
+    printf("samples %u (%.2f s of audio) in %.3f s wall, %.1fx real time\n",
+            unsigned(micTask.mSamples), audioSec, wallSec, wallSec > 0.0 ? audioSec / wallSec : 0.0);
+    printf("frames %u, %.1f us/frame processing\n", unsigned(frames), frames ? busyNs / frames / 1000.0 : 0.0);
+    printf("most common peak: bin %u (%.0f Hz)\n", unsigned(peak), double(peak) * SampleRate / FftNum);
+    printf("led frames decoded %u, %u leds in the last one\n", unsigned(ledFrames), unsigned(lastLeds));
+    printf("oled refreshes %u, %u bus bytes\n", unsigned(oled.mRefreshes), unsigned(oled.mBusBytes));
+
+    if(pbmPath) {
+        writePbm(pbmPath, oled);
+    }
+    if(tracePath) {
+#if PNI_TRACE_ENABLED
+        if(FILE* file = fopen(tracePath, "w")) {
+            Trace::dumpChrome(file);
+            fclose(file);
+        }
+#else
+        ESP_LOGE("pipeline", "built without PNI_TRACE_ENABLED, no trace");
+#endif
+    }
+
+    return frames == ledFrames && frames ? 0 : 1;
+}